@@ -0,0 +1,95 @@
+//
+//  BCLAdminBulkOperation.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import "BCLTypes.h"
+
+@class BCLBeacon;
+@class BCLZone;
+
+typedef NS_ENUM(NSUInteger, BCLAdminBulkOperationType) {
+    BCLAdminBulkOperationTypeCreateBeacon,
+    BCLAdminBulkOperationTypeUpdateBeacon,
+    BCLAdminBulkOperationTypeDeleteBeacon,
+    BCLAdminBulkOperationTypeSyncBeacon,
+    BCLAdminBulkOperationTypeCreateZone,
+    BCLAdminBulkOperationTypeUpdateZone,
+    BCLAdminBulkOperationTypeDeleteZone
+};
+
+/*!
+ * A single beacon or zone mutation performed as a part of a bulk request
+ */
+@interface BCLAdminBulkOperation : NSObject
+
+/** @name Properties */
+
+/// Type of the mutation
+@property (nonatomic, readonly) BCLAdminBulkOperationType type;
+
+/// A beacon to create, update, delete or sync; nil for zone operations
+@property (nonatomic, readonly) BCLBeacon *beacon;
+
+/// A zone to create, update or delete; nil for beacon operations
+@property (nonatomic, readonly) BCLZone *zone;
+
+/// Name of the test action for beacon create and update operations
+@property (nonatomic, readonly, copy) NSString *testActionName;
+
+/// Trigger of the test action for beacon create and update operations
+@property (nonatomic, readonly) BCLEventType testActionTrigger;
+
+/// Attributes of the test action for beacon create and update operations
+@property (nonatomic, readonly, copy) NSArray *testActionAttributes;
+
+/** @name Methods */
+
++ (instancetype)createBeaconOperationWithBeacon:(BCLBeacon *)beacon testActionName:(NSString *)testActionName testActionTrigger:(BCLEventType)trigger testActionAttributes:(NSArray *)testActionAttributes;
+
++ (instancetype)updateBeaconOperationWithBeacon:(BCLBeacon *)beacon testActionName:(NSString *)testActionName testActionTrigger:(BCLEventType)trigger testActionAttributes:(NSArray *)testActionAttributes;
+
++ (instancetype)deleteBeaconOperationWithBeacon:(BCLBeacon *)beacon;
+
++ (instancetype)syncBeaconOperationWithBeacon:(BCLBeacon *)beacon;
+
++ (instancetype)createZoneOperationWithZone:(BCLZone *)zone;
+
++ (instancetype)updateZoneOperationWithZone:(BCLZone *)zone;
+
++ (instancetype)deleteZoneOperationWithZone:(BCLZone *)zone;
+
+@end
+
+/*!
+ * An outcome of a single bulk operation
+ */
+@interface BCLAdminBulkOperationResult : NSObject
+
+/** @name Properties */
+
+/// The operation this result belongs to
+@property (nonatomic, readonly) BCLAdminBulkOperation *operation;
+
+/// YES, if the operation has eventually succeeded
+@property (nonatomic, readonly) BOOL success;
+
+/// An error of the last attempt, nil on success
+@property (nonatomic, readonly) NSError *error;
+
+/// A beacon or zone returned by the backend for create operations
+@property (nonatomic, readonly) id object;
+
+/// Number of requests made for this operation
+@property (nonatomic, readonly) NSUInteger attempts;
+
+- (instancetype)initWithOperation:(BCLAdminBulkOperation *)operation success:(BOOL)success object:(id)object error:(NSError *)error attempts:(NSUInteger)attempts;
+
+@end
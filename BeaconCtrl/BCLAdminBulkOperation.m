@@ -0,0 +1,95 @@
+//
+//  BCLAdminBulkOperation.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLAdminBulkOperation.h"
+
+@interface BCLAdminBulkOperation ()
+
+@property (nonatomic, readwrite) BCLAdminBulkOperationType type;
+@property (nonatomic, readwrite) BCLBeacon *beacon;
+@property (nonatomic, readwrite) BCLZone *zone;
+@property (nonatomic, readwrite, copy) NSString *testActionName;
+@property (nonatomic, readwrite) BCLEventType testActionTrigger;
+@property (nonatomic, readwrite, copy) NSArray *testActionAttributes;
+
+@end
+
+@implementation BCLAdminBulkOperation
+
++ (instancetype)operationWithType:(BCLAdminBulkOperationType)type beacon:(BCLBeacon *)beacon zone:(BCLZone *)zone
+{
+    BCLAdminBulkOperation *operation = [self new];
+    operation.type = type;
+    operation.beacon = beacon;
+    operation.zone = zone;
+    return operation;
+}
+
++ (instancetype)createBeaconOperationWithBeacon:(BCLBeacon *)beacon testActionName:(NSString *)testActionName testActionTrigger:(BCLEventType)trigger testActionAttributes:(NSArray *)testActionAttributes
+{
+    BCLAdminBulkOperation *operation = [self operationWithType:BCLAdminBulkOperationTypeCreateBeacon beacon:beacon zone:nil];
+    operation.testActionName = testActionName;
+    operation.testActionTrigger = trigger;
+    operation.testActionAttributes = testActionAttributes;
+    return operation;
+}
+
++ (instancetype)updateBeaconOperationWithBeacon:(BCLBeacon *)beacon testActionName:(NSString *)testActionName testActionTrigger:(BCLEventType)trigger testActionAttributes:(NSArray *)testActionAttributes
+{
+    BCLAdminBulkOperation *operation = [self operationWithType:BCLAdminBulkOperationTypeUpdateBeacon beacon:beacon zone:nil];
+    operation.testActionName = testActionName;
+    operation.testActionTrigger = trigger;
+    operation.testActionAttributes = testActionAttributes;
+    return operation;
+}
+
++ (instancetype)deleteBeaconOperationWithBeacon:(BCLBeacon *)beacon
+{
+    return [self operationWithType:BCLAdminBulkOperationTypeDeleteBeacon beacon:beacon zone:nil];
+}
+
++ (instancetype)syncBeaconOperationWithBeacon:(BCLBeacon *)beacon
+{
+    return [self operationWithType:BCLAdminBulkOperationTypeSyncBeacon beacon:beacon zone:nil];
+}
+
++ (instancetype)createZoneOperationWithZone:(BCLZone *)zone
+{
+    return [self operationWithType:BCLAdminBulkOperationTypeCreateZone beacon:nil zone:zone];
+}
+
++ (instancetype)updateZoneOperationWithZone:(BCLZone *)zone
+{
+    return [self operationWithType:BCLAdminBulkOperationTypeUpdateZone beacon:nil zone:zone];
+}
+
++ (instancetype)deleteZoneOperationWithZone:(BCLZone *)zone
+{
+    return [self operationWithType:BCLAdminBulkOperationTypeDeleteZone beacon:nil zone:zone];
+}
+
+@end
+
+@implementation BCLAdminBulkOperationResult
+
+- (instancetype)initWithOperation:(BCLAdminBulkOperation *)operation success:(BOOL)success object:(id)object error:(NSError *)error attempts:(NSUInteger)attempts
+{
+    if (self = [super init]) {
+        _operation = operation;
+        _success = success;
+        _object = object;
+        _error = error;
+        _attempts = attempts;
+    }
+    return self;
+}
+
+@end
@@ -22,9 +22,6 @@
 extern NSString * const BCLInvalidBeaconIdentifierException;
 extern NSString * const BCLBeaconTimerFireNotification;
 
-#define BLEBeaconStaysCacheName(beacon) \
-    [NSString stringWithFormat:@"com.up-next.BeaconCtrl.stays.%@",beacon.identifier]
-
 /*!
  * A class representing beacons in BeaconCtrl
  */
@@ -50,6 +47,11 @@ extern NSString * const BCLBeaconTimerFireNotification;
 /// Intance id of an Eddystone beacon
 @property (readwrite, nonatomic, strong) NSString *instanceId;
 
+/*
+ * Proximity, accuracy, estimated distance, RSSI and last entered and left dates are updated with every reading, on the
+ * main thread only, and aren't locked. Code reading them on other threads takes a snapshot on the main thread instead.
+ */
+
 /// Proximity of a beacon to a device running the SDK described as a CLProximity constant
 @property (readwrite, nonatomic, assign) CLProximity proximity;
 
@@ -65,6 +67,9 @@ extern NSString * const BCLBeaconTimerFireNotification;
 /// The date when a beacon's range was last entered
 @property (readwrite, nonatomic, strong) NSDate *lastEnteredDate;
 
+/// The date when a beacon's range was last left, which is when it was last seen if it's out of range
+@property (readwrite, nonatomic, strong) NSDate *lastLeftDate;
+
 /// Name of a beacon.
 @property (strong) NSString *name;
 
@@ -8,12 +8,13 @@
 
 #import "BCLBeacon.h"
 
-#import <SAMCache/SAMCache.h>
 #import <UNNetworking/UNCodingUtil.h>
 #import "BCLBeaconCtrl.h"
 
 #import "CLBeacon+BeaconCtrl.h"
 #import "BCLLocation.h"
+#import "BCLBeaconIdentity.h"
+#import "BCLClock.h"
 
 
 #define NSUINT_BIT (CHAR_BIT * sizeof(NSUInteger))
@@ -24,16 +25,18 @@ NSString * const BCLBeaconTimerFireNotification = @"BCLBeaconTimerFireNotificati
 
 const int kMaxAccuracyReadouts = 5;
 const int kResetAccuracyReadoutsInterval = 60;
+const int kMinProximityRepeatInterval = 60;
 
-@interface BCLBeacon ()
+@interface BCLBeacon () {
+    // Clock uptimes, 0 if not set yet. Plain ivars, so they're not encoded.
+    NSTimeInterval _lastAccuracyReadoutTime;
+    NSTimeInterval _proximitySetTimes[CLProximityFar + 1];
+}
 
 @property (strong) dispatch_source_t timer;
 @property (assign) BOOL timerIsActive;
 
 @property (nonatomic, strong) NSMutableArray *accuracyReadouts;
-@property (nonatomic, strong) NSDate *lastAccuracyReadoutDate;
-
-@property (nonatomic, strong) NSMutableDictionary *proximitiesSetTimestampsMapping;
 
 @end
 
@@ -49,17 +52,7 @@ const int kResetAccuracyReadoutsInterval = 60;
 - (instancetype) init
 {
     if (self = [super init]) {
-        // remove only if period of time is significant
-        SAMCache *staysCache = [[SAMCache alloc] initWithName:BLEBeaconStaysCacheName(self)];
-        [staysCache removeAllObjects];
-        
         [self scheduleStaysTimer];
-        
-        self.proximitiesSetTimestampsMapping = [@{
-                                                  @(CLProximityFar)          : @0,
-                                                  @(CLProximityNear)         : @0,
-                                                  @(CLProximityImmediate)    : @0
-                                                  } mutableCopy];
     }
     return self;
 }
@@ -88,6 +81,7 @@ const int kResetAccuracyReadoutsInterval = 60;
     copyBeacon.estimatedDistance = self.estimatedDistance;
     copyBeacon.rssi = self.rssi;
     copyBeacon.lastEnteredDate = self.lastEnteredDate;
+    copyBeacon.lastLeftDate = self.lastLeftDate;
     copyBeacon.location = self.location;
     copyBeacon.zone = self.zone;
     copyBeacon.name = self.name;
@@ -162,12 +156,17 @@ const int kResetAccuracyReadoutsInterval = 60;
     }
 }
 
+- (void)setTriggers:(NSArray *)triggers
+{
+    @synchronized(self) {
+        _triggers = triggers;
+    }
+}
+
 - (NSTimeInterval) staysTimeInterval
 {
-    SAMCache *staysCache = [[SAMCache alloc] initWithName:BLEBeaconStaysCacheName(self)];
-    NSDate *lastEnter = [staysCache objectForKey:self.identifier];
-    if (lastEnter) {
-        return [[NSDate date] timeIntervalSinceDate:lastEnter];
+    if (self.lastEnteredDate) {
+        return [BCLClock currentClock].timeIntervalSince1970 - [self.lastEnteredDate timeIntervalSince1970];
     }
     return 0;
 }
@@ -251,13 +250,13 @@ const int kResetAccuracyReadoutsInterval = 60;
         return;
     }
     
-    NSDate *now = [NSDate date];
+    NSTimeInterval now = [BCLClock currentClock].uptime;
     
-    if (self.lastAccuracyReadoutDate && [now timeIntervalSinceDate:self.lastAccuracyReadoutDate] > kResetAccuracyReadoutsInterval) {
+    if (_lastAccuracyReadoutTime && now - _lastAccuracyReadoutTime > kResetAccuracyReadoutsInterval) {
         self.accuracyReadouts = nil;
     }
     
-    self.lastAccuracyReadoutDate = now;
+    _lastAccuracyReadoutTime = MAX(now, DBL_MIN);
     
     [self.accuracyReadouts insertObject:@(accuracy) atIndex:0];
     
@@ -278,12 +277,15 @@ const int kResetAccuracyReadoutsInterval = 60;
 
 - (void)setProximity:(CLProximity)proximity
 {
-    self.proximitiesSetTimestampsMapping[@(proximity)] = @([[NSDate date] timeIntervalSince1970]);
+    if (proximity <= CLProximityFar) {
+        _proximitySetTimes[proximity] = MAX([BCLClock currentClock].uptime, DBL_MIN);
+    }
     
     if (self.lastEnteredDate == nil && proximity != CLProximityUnknown) {
-        self.lastEnteredDate = [NSDate date];
+        self.lastEnteredDate = [[BCLClock currentClock] date];
     } else if (self.lastEnteredDate != nil && proximity == CLProximityUnknown) {
         self.lastEnteredDate = nil;
+        self.lastLeftDate = [[BCLClock currentClock] date];
     }
     
     _proximity = proximity;
@@ -295,7 +297,7 @@ const int kResetAccuracyReadoutsInterval = 60;
         return NO;
     }
     
-    if ([[NSDate date] timeIntervalSince1970] - [self.proximitiesSetTimestampsMapping[@(newProximity)] intValue] < 60) {
+    if (newProximity <= CLProximityFar && _proximitySetTimes[newProximity] && [BCLClock currentClock].uptime - _proximitySetTimes[newProximity] < kMinProximityRepeatInterval) {
         return NO;
     }
     
@@ -320,51 +322,34 @@ const int kResetAccuracyReadoutsInterval = 60;
     
     if (dictionary[@"proximity_id"]) {
         NSString *idString = [dictionary[@"proximity_id"] description];
-        NSError *error = NULL;
+        BCLBeaconIdentity identity;
         
-        if ([self->_protocol.lowercaseString isEqualToString:@"ibeacon"]) {
-            NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:@"^([\\w-]*)(\\+(\\d*)){0,1}(\\+(\\d*)){0,1}" options:NSRegularExpressionCaseInsensitive | NSRegularExpressionAnchorsMatchLines error:&error];
-            NSArray *matches =  [regex matchesInString:idString
-                                               options:0
-                                                 range:NSMakeRange(0, [idString length])];
+        if ([self->_protocol.lowercaseString isEqualToString:@"ibeacon"] && BCLBeaconIdentityParseString(idString, BCLBeaconIdentityTypeIBeacon, &identity)) {
+            self.proximityUUID = [[NSUUID alloc] initWithUUIDBytes:identity.uuid];
             
-            NSTextCheckingResult *match = matches[0];
-            for (int idx = 1; idx < match.numberOfRanges; idx++) {
-                NSRange range = [match rangeAtIndex:idx];
-                if (range.location != NSNotFound && idx == 1) {
-                    self.proximityUUID = [[NSUUID alloc] initWithUUIDString:[idString substringWithRange:range]];
-                }
-                
-                if (range.location != NSNotFound && idx == 3) {
-                    self.major = @([[idString substringWithRange:range] integerValue]);
-                }
-                
-                if (range.location != NSNotFound && idx == 5) {
-                    self.minor = @([[idString substringWithRange:range] integerValue]);
-                }
+            if (identity.fields & BCLBeaconIdentityFieldMajor) {
+                self.major = @(identity.major);
             }
             
-        } else if ([self->_protocol.lowercaseString isEqualToString:@"eddystone"]) {
-            NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:@"^([\\w-]*)\\+([\\w-]*)\\+([\\w-]*)" options:NSRegularExpressionCaseInsensitive | NSRegularExpressionAnchorsMatchLines error:&error];
-            NSArray *matches =  [regex matchesInString:idString
-                                               options:0
-                                                 range:NSMakeRange(0, [idString length])];
-            
-            NSTextCheckingResult *match = matches[0];
-            for (int idx = 1; idx < match.numberOfRanges; idx++) {
-                NSRange range = [match rangeAtIndex:idx];
-                if (range.location != NSNotFound && idx == 1) {
-                    self.proximityUUID = [[NSUUID alloc] initWithUUIDString:[idString substringWithRange:range]];
-                }
-                
-                if (range.location != NSNotFound && idx == 3) {
-                    self.namespaceId = [idString substringWithRange:range];
-                }
-                
-                if (range.location != NSNotFound && idx == 5) {
-                    self.instanceId = [idString substringWithRange:range];
-                }
+            if (identity.fields & BCLBeaconIdentityFieldMinor) {
+                self.minor = @(identity.minor);
+            }
+        } else if ([self->_protocol.lowercaseString isEqualToString:@"eddystone"] && BCLBeaconIdentityParseString(idString, BCLBeaconIdentityTypeEddystone, &identity)) {
+            if (identity.fields & BCLBeaconIdentityFieldUUID) {
+                self.proximityUUID = [[NSUUID alloc] initWithUUIDBytes:identity.uuid];
             }
+            
+            char hexString[2 * sizeof(identity.namespaceId) + 1];
+            
+            BCLBeaconIdentityHexString(identity.namespaceId, sizeof(identity.namespaceId), hexString);
+            self.namespaceId = @(hexString);
+            
+            BCLBeaconIdentityHexString(identity.instanceId, sizeof(identity.instanceId), hexString);
+            self.instanceId = @(hexString);
+        } else {
+#ifdef DEBUG
+            NSLog(@"Invalid %@ beacon identifier '%@'", self->_protocol, idString);
+#endif
         }
         
 //        if (!self.proximityUUID) {
@@ -25,6 +25,22 @@ extern NSString * const BCLDeniedLocationServicesErrorKey;
 extern NSString * const BCLDeniedBackgroundAppRefreshErrorKey;
 extern NSString * const BCLDeniedNotificationsErrorKey;
 extern NSString * const BCLErrorDomain;
+extern NSString * const BCLRangingHistoryTimestampKey;
+extern NSString * const BCLRangingHistoryRSSIKey;
+extern NSString * const BCLRangingHistoryAccuracyKey;
+extern NSString * const BCLObservedBeaconsDistanceWeightKey;
+extern NSString * const BCLObservedBeaconsTriggersWeightKey;
+extern NSString * const BCLObservedBeaconsZoneCoverageWeightKey;
+extern NSString * const BCLObservedBeaconsActivityWeightKey;
+extern NSString * const BCLNetworkPendingRequestsCountKey;
+extern NSString * const BCLNetworkRunningRequestsCountKey;
+extern NSString * const BCLNetworkCompletedRequestsCountKey;
+extern NSString * const BCLNetworkFailedRequestsCountKey;
+extern NSString * const BCLNetworkCancelledRequestsCountKey;
+extern NSString * const BCLNetworkMeanQueueTimeKey;
+extern NSString * const BCLNetworkMeanDurationKey;
+extern NSString * const BCLNetworkTailDurationKey;
+extern NSString * const BCLNetworkMaxDurationKey;
 
 @protocol BCLExtension;
 
@@ -41,6 +57,17 @@ typedef NS_ENUM(NSUInteger, BCLBeaconCtrlPushEnvironment) {
     BCLBeaconCtrlPushEnvironmentProduction
 };
 
+/*!
+ * @typedef BCLEventUploadMode
+ * @brief A list of possible ways of uploading action events
+ * @constant BCLEventUploadModeRaw uploads every event, after coalescing
+ * @constant BCLEventUploadModeAggregated uploads hourly visit counts, dwell time histograms and transitions per zone instead of the events, plus a sample of raw events
+ */
+typedef NS_ENUM(NSUInteger, BCLEventUploadMode) {
+    BCLEventUploadModeRaw,
+    BCLEventUploadModeAggregated
+};
+
 /*!
  * A BCLBeaconCtrl singleton is the main point of interaction with BeaconCtrl Client API
  */
@@ -48,8 +75,8 @@ typedef NS_ENUM(NSUInteger, BCLBeaconCtrlPushEnvironment) {
 
 /** @name Properties */
 
-/// A reference to beacons', zones' and actions' configuration fetched from the backend
-@property (nonatomic, strong) BCLConfiguration *configuration;
+/// A reference to beacons', zones' and actions' configuration fetched from the backend. Replaced as a whole when a new one is fetched, so it's safe to keep a reference to it while reading from other threads.
+@property (strong) BCLConfiguration *configuration;
 
 /// Processing status. YES if processing is paused.
 @property (assign) BOOL paused;
@@ -69,6 +96,27 @@ typedef NS_ENUM(NSUInteger, BCLBeaconCtrlPushEnvironment) {
 /// a weak reference to the delegate
 @property (weak) id <BCLBeaconCtrlDelegate> delegate;
 
+/// Time window, in seconds, in which a leave followed by an enter of the same beacon or zone is dropped and repeated range events are merged before being stored and sent. 0 disables coalescing. Defaults to 30 seconds.
+@property (nonatomic) NSTimeInterval eventCoalescingInterval;
+
+/// Fraction of generated action events that were suppressed by coalescing since launch, between 0 and 1
+@property (nonatomic, readonly) double eventSuppressionRatio;
+
+/// Weights of the factors beacons are scored by when picking ones to monitor, keyed by BCLObservedBeaconsDistanceWeightKey (closeness, defaults to 1), BCLObservedBeaconsTriggersWeightKey (number of triggers, defaults to 0.5), BCLObservedBeaconsZoneCoverageWeightKey (covering zones not covered yet, defaults to 0.5) and BCLObservedBeaconsActivityWeightKey (being in range or entered recently, defaults to 1). Missing keys keep their defaults. Changes are applied with the next update of monitored beacons.
+@property (nonatomic, copy) NSDictionary<NSString *, NSNumber *> *observedBeaconsWeights;
+
+/// How action events are uploaded to the backend. Defaults to BCLEventUploadModeRaw.
+@property (nonatomic) BCLEventUploadMode eventUploadMode;
+
+/// Fraction of action events that are still uploaded as they are in BCLEventUploadModeAggregated, between 0 and 1. Defaults to 0.
+@property (nonatomic) double rawEventSamplingRatio;
+
+/// Times, in seconds, of staying in range of a beacon or inside a zone after which a dwell time event is fired, once per stay. Defaults to 60, 300 and 900 seconds.
+@property (nonatomic, copy) NSArray *dwellTimeThresholds;
+
+/// Whether rssi and accuracy readings of ranged beacons are recorded on the device, for debugging venue coverage and tuning. Recorded readings are kept within a fixed memory and disk budget, oldest ones being dropped first, and are removed when recording is switched off. Defaults to NO.
+@property (nonatomic, getter=isRangingHistoryEnabled) BOOL rangingHistoryEnabled;
+
 /** @name Methods */
 
 /*!
@@ -130,6 +178,11 @@ typedef NS_ENUM(NSUInteger, BCLBeaconCtrlPushEnvironment) {
  */
 - (BCLZone *)currentZone;
 
+/*!
+ * @return Probability, between 0 and 1, that the user's device is in the current zone, or outside of any zone if there's no current zone
+ */
+- (double)currentZoneConfidence;
+
 /*!
  * @brief Recalculates the current zone basing on the signal strengths of visible beacons
  */
@@ -150,6 +203,35 @@ typedef NS_ENUM(NSUInteger, BCLBeaconCtrlPushEnvironment) {
  */
 - (NSArray<BCLBeacon *> *)beaconsSortedByDistance;
 
+/*!
+ * @brief Metrics of delivering events to extensions, which get them asynchronously, filtered by their subscriptions
+ * @return A dictionary keyed by extension names, with dictionaries of numbers keyed by BCLExtensionPendingEventsCountKey, BCLExtensionDeliveredEventsCountKey, BCLExtensionDroppedEventsCountKey, BCLExtensionLastEventLagKey and BCLExtensionMaxEventLagKey (in seconds)
+ */
+- (NSDictionary<NSString *, NSDictionary *> *)extensionEventMetrics;
+
+/*!
+ * @brief Metrics of requests sent to the backend, which are queued by priority: token, configuration, events, presence and admin
+ * @return A dictionary keyed by priority names, with dictionaries of numbers keyed by BCLNetworkPendingRequestsCountKey, BCLNetworkRunningRequestsCountKey, BCLNetworkCompletedRequestsCountKey, BCLNetworkFailedRequestsCountKey, BCLNetworkCancelledRequestsCountKey, BCLNetworkMeanQueueTimeKey, BCLNetworkMeanDurationKey, BCLNetworkTailDurationKey (95th percentile of recent requests) and BCLNetworkMaxDurationKey (in seconds)
+ */
+- (NSDictionary<NSString *, NSDictionary *> *)networkMetrics;
+
+/*!
+ * @brief Readings of a beacon recorded while rangingHistoryEnabled was on
+ * @param beacon A beacon to return readings of
+ * @param fromDate The start of the time window
+ * @param toDate The end of the time window
+ * @return An array of dictionaries with BCLRangingHistoryTimestampKey (seconds since 1970), BCLRangingHistoryRSSIKey and BCLRangingHistoryAccuracyKey (meters, negative if unknown) values, oldest first
+ */
+- (NSArray<NSDictionary *> *)rangingHistoryForBeacon:(BCLBeacon *)beacon fromDate:(NSDate *)fromDate toDate:(NSDate *)toDate;
+
+/*!
+ * @brief Writes all recorded readings to a file, in a compact binary format
+ * @param path A path to write the file to
+ * @param error Set if the file couldn't be written
+ * @return YES if the file has been written
+ */
+- (BOOL)exportRangingHistoryToFile:(NSString *)path error:(NSError **)error;
+
 /*!
  * @brief the main setup method for the SDK
  * @param clientId Client id obtained from the admin panel for authentication
@@ -21,9 +21,13 @@
 #import "CLBeacon+BeaconCtrl.h"
 #import "BCLEventScheduler.h"
 #import "BCLActionEventScheduler.h"
+#import "BCLActionEventCoalescer.h"
 #import "BCLActionEvent.h"
 
 #import "BCLBackend.h"
+#import "BCLPresenceClient.h"
+#import "BCLHTTPTransport.h"
+#import "BCLClock.h"
 
 #import "BCLBeaconCtrl.h"
 #import "BCLBeacon.h"
@@ -31,13 +35,29 @@
 #import "BCLTrigger.h"
 
 #import "BCLObservedBeaconsPicker.h"
+#import "BCLConfigurationShardStore.h"
+#import "BCLBeaconDistanceIndex.h"
+#import "BCLZoneEstimator.h"
+#import "BCLRangingHistory.h"
+#import "BCLExtensionEventBus.h"
+#import "BCLRuntimeStateSnapshot.h"
+#import "BCLLocationGovernor.h"
+#import "BCLAdvertisementDecoder.h"
 
 #import "BCLActionHandlerFactory.h"
+#import "BCLActionExecutor.h"
+#import "BCLDwellTracker.h"
 
 #import "BCLKontaktIOBeaconConfigManager.h"
 
 #define BCLDelayEventTimeInterval 3
 
+/// How often the runtime state is snapshotted while beacons are monitored, besides on backgrounding and on enters and leaves
+static NSTimeInterval const BCLRuntimeStateSnapshotInterval = 30;
+
+/// How long a beacon seen only through BLE scanning may go without advertising before it's considered left
+static NSTimeInterval const BCLScannedBeaconTimeoutInterval = 10;
+
 @import UserNotifications;
 
 NSInteger const BCLInvalidParametersErrorCode = -1;
@@ -55,6 +75,21 @@ static NSString * const BCLCurrentZoneKey = @"currentZone";
 
 NSString * const BCLErrorDomain = @"com.up-next.BCLBeaconCtrl";
 
+NSString * const BCLObservedBeaconsDistanceWeightKey = @"distance";
+NSString * const BCLObservedBeaconsTriggersWeightKey = @"triggers";
+NSString * const BCLObservedBeaconsZoneCoverageWeightKey = @"zoneCoverage";
+NSString * const BCLObservedBeaconsActivityWeightKey = @"activity";
+
+NSString * const BCLNetworkPendingRequestsCountKey = @"BCLNetworkPendingRequestsCountKey";
+NSString * const BCLNetworkRunningRequestsCountKey = @"BCLNetworkRunningRequestsCountKey";
+NSString * const BCLNetworkCompletedRequestsCountKey = @"BCLNetworkCompletedRequestsCountKey";
+NSString * const BCLNetworkFailedRequestsCountKey = @"BCLNetworkFailedRequestsCountKey";
+NSString * const BCLNetworkCancelledRequestsCountKey = @"BCLNetworkCancelledRequestsCountKey";
+NSString * const BCLNetworkMeanQueueTimeKey = @"BCLNetworkMeanQueueTimeKey";
+NSString * const BCLNetworkMeanDurationKey = @"BCLNetworkMeanDurationKey";
+NSString * const BCLNetworkTailDurationKey = @"BCLNetworkTailDurationKey";
+NSString * const BCLNetworkMaxDurationKey = @"BCLNetworkMaxDurationKey";
+
 static NSString * const monitoredRegionIdentifiersKey = @"monitoredRegionIdentifiers";
 
 static NSString * const BCLBeaconCtrlCacheDirectoryName = @"BeaconCtrl";
@@ -63,18 +98,46 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 @interface BCLBeaconCtrl () <CLLocationManagerDelegate, CBCentralManagerDelegate, BCLBeaconRangingBatchDelegate, BCLKontaktIOBeaconConfigManagerDelegate >
 
 @property (strong) CLLocationManager *locationManager;
+@property (strong) BCLLocationGovernor *locationGovernor;
 @property (strong) CBCentralManager *bluetoothCentralManager;
 @property (strong) BCLBeaconRangingBatch *beaconBatch;
 @property (strong) BCLEventScheduler *eventScheduler;
 @property (strong) BCLActionEventScheduler *actionEventScheduler;
+@property (strong) BCLActionEventCoalescer *eventCoalescer;
 @property (strong, nonatomic) BCLBackend *backend;
+@property (strong, nonatomic) BCLPresenceClient *presenceClient;
 
 @property (nonatomic, copy, readwrite) NSSet *observedBeacons;
 
 @property (nonatomic, strong) BCLActionHandlerFactory *actionHandlerFactory;
 
+@property (nonatomic, strong) BCLActionExecutor *actionExecutor;
+
+@property (nonatomic, strong) BCLDwellTracker *dwellTracker;
+
 @property (nonatomic, strong) BCLObservedBeaconsPicker *observedBeaconsPicker;
 
+@property (nonatomic, strong) BCLBeaconDistanceIndex *distanceIndex;
+
+@property (nonatomic, strong) BCLZoneEstimator *zoneEstimator;
+
+@property (nonatomic, strong) BCLRangingHistory *rangingHistory;
+
+@property (nonatomic, strong) BCLExtensionEventBus *extensionEventBus;
+
+@property (nonatomic, strong) BCLAdvertisementResolver *advertisementResolver;
+@property (nonatomic, strong) CBUUID *eddystoneServiceUUID;
+@property (nonatomic) BOOL isClosestBeaconCheckScheduled;
+/// Uptimes of the last advertisements of beacons entered through BLE scanning, by identifier
+@property (nonatomic, strong) NSMutableDictionary *scannedBeaconLastSeenTimes;
+@property (nonatomic, strong) BCLClockTimer *scannedBeaconsTimeoutTimer;
+
+@property (nonatomic, strong) dispatch_source_t runtimeStateSnapshotTimer;
+@property (nonatomic) BOOL isRuntimeStateSnapshotEnabled;
+@property (nonatomic) BOOL isRuntimeStateSnapshotScheduled;
+/// Beacons restored as entered, whose first reported region state mustn't fire another enter
+@property (nonatomic, strong) NSMutableSet *warmStartedBeaconIdentifiers;
+
 @property (nonatomic, strong) BCLLocation *estimatedUserLocation;
 
 @property (nonatomic, weak) BCLBeacon *cachedClosestBeacon;
@@ -89,6 +152,8 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 
 @implementation BCLBeaconCtrl
 
+@synthesize observedBeacons = _observedBeacons;
+
 - (instancetype)init
 {
     if (self = [super init]) {
@@ -110,13 +175,24 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
         [[NSFileManager defaultManager] createDirectoryAtPath:cacheDirectoryPath withIntermediateDirectories:YES attributes:nil error:nil];
     }
     
-    return [NSKeyedArchiver archiveRootObject:self toFile:[cacheDirectoryPath stringByAppendingPathComponent:BCLBeaconCtrlArchiveFilename]];
+    if (![NSKeyedArchiver archiveRootObject:self toFile:[cacheDirectoryPath stringByAppendingPathComponent:BCLBeaconCtrlArchiveFilename]]) {
+        return NO;
+    }
+    
+    // Shards of superseded configurations can only go once the archive refers to the current one's
+    [self.configuration removeShardsOfOtherConfigurations];
+    
+    return YES;
 }
 
 + (void)deleteBeaconCtrlFromCache
 {
     [BCLActionEventScheduler clearCache];
+    [[SAMCache bcl_dwellCheckpointCache] removeAllObjects];
     [[NSFileManager defaultManager] removeItemAtPath:[[self cacheDirectoryPath] stringByAppendingPathComponent:BCLBeaconCtrlArchiveFilename] error:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:[BCLConfigurationShardStore defaultDirectoryPath] error:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:[BCLRangingHistory defaultDirectoryPath] error:nil];
+    [[SAMCache bcl_runtimeStateCache] removeAllObjects];
 }
 
 + (void)setupBeaconCtrlWithClientId:(NSString *)clientId clientSecret:(NSString *)clientSecret userId:(NSString *)userId pushEnvironment:(BCLBeaconCtrlPushEnvironment)pushEnvironment pushToken:(NSString *)pushToken completion:(void (^)(BCLBeaconCtrl *, BOOL, NSError *))completion
@@ -160,6 +236,10 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 - (void)dealloc
 {
     [[NSNotificationCenter defaultCenter] removeObserver:self];
+    
+    if (_runtimeStateSnapshotTimer) {
+        dispatch_source_cancel(_runtimeStateSnapshotTimer);
+    }
 }
 
 - (NSSet *)observedBeacons
@@ -167,6 +247,74 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     return _observedBeacons;
 }
 
+- (void)setObservedBeacons:(NSSet *)observedBeacons
+{
+    _observedBeacons = [observedBeacons copy];
+    [self.distanceIndex setBeacons:_observedBeacons];
+}
+
+- (BCLBeaconDistanceIndex *)distanceIndex
+{
+    if (!_distanceIndex) {
+        _distanceIndex = [[BCLBeaconDistanceIndex alloc] init];
+    }
+    return _distanceIndex;
+}
+
+- (NSTimeInterval)eventCoalescingInterval
+{
+    return self.eventCoalescer.interval;
+}
+
+- (void)setEventCoalescingInterval:(NSTimeInterval)eventCoalescingInterval
+{
+    self.eventCoalescer.interval = eventCoalescingInterval;
+}
+
+- (double)eventSuppressionRatio
+{
+    return self.eventCoalescer.suppressionRatio;
+}
+
+- (NSArray *)dwellTimeThresholds
+{
+    return self.dwellTracker.thresholds;
+}
+
+- (void)setDwellTimeThresholds:(NSArray *)dwellTimeThresholds
+{
+    self.dwellTracker.thresholds = dwellTimeThresholds;
+}
+
+- (void)setObservedBeaconsWeights:(NSDictionary<NSString *, NSNumber *> *)observedBeaconsWeights
+{
+    _observedBeaconsWeights = [observedBeaconsWeights copy];
+    [self applyObservedBeaconsWeightsToPicker:self.observedBeaconsPicker];
+}
+
+- (BOOL)isRangingHistoryEnabled
+{
+    return self.rangingHistory != nil;
+}
+
+- (void)setRangingHistoryEnabled:(BOOL)rangingHistoryEnabled
+{
+    if (rangingHistoryEnabled && !self.rangingHistory) {
+        self.rangingHistory = [[BCLRangingHistory alloc] initWithDirectoryPath:[BCLRangingHistory defaultDirectoryPath]];
+    } else if (!rangingHistoryEnabled && self.rangingHistory) {
+        [self.rangingHistory removeAllReadings];
+        self.rangingHistory = nil;
+    }
+}
+
+- (BCLPresenceClient *)presenceClient
+{
+    if (!_presenceClient) {
+        _presenceClient = [[BCLPresenceClient alloc] initWithBackend:self.backend];
+    }
+    return _presenceClient;
+}
+
 - (NSString *)userId
 {
     return self.backend.userId;
@@ -265,7 +413,18 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
         return NO;
     }
 
+    [self restoreRuntimeState];
+    
     BOOL result = [self updateMonitoredBeacons];
+    
+    [self scheduleLeavesForUnobservedRestoredBeacons];
+
+    [self startScanningForEddystoneBeacons];
+    
+    [self startRuntimeStateSnapshots];
+    
+    self.locationGovernor.beaconAreas = [self.configuration beaconAreas];
+    [self.locationGovernor start];
 
     self.initiallyMonitoredRegions = self.locationManager.monitoredRegions;
     [self performSelector:@selector(processInitiallyRangedRegions) withObject:nil afterDelay:3];
@@ -292,12 +451,62 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     }
     [[SAMCache bcl_monitoredProximityCache] removeObjectForKey:monitoredRegionIdentifiersKey];
     
+    // Nobody waits for presence anymore. Batches of events being uploaded go back to the outbox and are sent with the
+    // next upload, together with the leave events stored below.
+    [self.backend.transport cancelAllRequestsWithPriority:BCLHTTPRequestPriorityPresence];
+    [self.backend.transport cancelAllRequestsWithPriority:BCLHTTPRequestPriorityEvents];
+    
+    [self.eventCoalescer flush];
+    
+    self.advertisementResolver = nil;
+    if (self.bluetoothCentralManager.state == CBCentralManagerStatePoweredOn) {
+        [self.bluetoothCentralManager stopScan];
+    }
+    
+    [self.scannedBeaconsTimeoutTimer invalidate];
+    self.scannedBeaconsTimeoutTimer = nil;
+    [self.scannedBeaconLastSeenTimes removeAllObjects];
+    
     for (BCLBeacon *beacon in self.observedBeacons) {
         beacon.proximity = CLProximityUnknown;
         [self beaconProximityDidChange:beacon];
     }
     
+    [self.dwellTracker endAllDwells];
+    [self.zoneEstimator reset];
+    
     self.observedBeacons = nil;
+    
+    [self stopRuntimeStateSnapshots];
+    [self.locationGovernor stop];
+}
+
+- (BCLObservedBeaconsPicker *)observedBeaconsPickerWithConfiguration:(BCLConfiguration *)configuration
+{
+    BCLObservedBeaconsPicker *picker = [[BCLObservedBeaconsPicker alloc] initWithBeacons:configuration.beacons andZones:configuration.zones];
+    [self applyObservedBeaconsWeightsToPicker:picker];
+    return picker;
+}
+
+- (void)applyObservedBeaconsWeightsToPicker:(BCLObservedBeaconsPicker *)picker
+{
+    NSDictionary *weights = self.observedBeaconsWeights;
+    
+    if (weights[BCLObservedBeaconsDistanceWeightKey]) {
+        picker.distanceWeight = [weights[BCLObservedBeaconsDistanceWeightKey] doubleValue];
+    }
+    
+    if (weights[BCLObservedBeaconsTriggersWeightKey]) {
+        picker.triggersWeight = [weights[BCLObservedBeaconsTriggersWeightKey] doubleValue];
+    }
+    
+    if (weights[BCLObservedBeaconsZoneCoverageWeightKey]) {
+        picker.zoneCoverageWeight = [weights[BCLObservedBeaconsZoneCoverageWeightKey] doubleValue];
+    }
+    
+    if (weights[BCLObservedBeaconsActivityWeightKey]) {
+        picker.activityWeight = [weights[BCLObservedBeaconsActivityWeightKey] doubleValue];
+    }
 }
 
 /*!
@@ -305,6 +514,10 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
  */
 - (BOOL)updateMonitoredBeacons
 {
+    if ([self.configuration loadShardsNearLocation:self.estimatedUserLocation.location]) {
+        [self configurationBeaconsDidChange];
+    }
+    
     BOOL didObservedBeaconsChange = NO;
     NSSet *beaconsToObserve = [self.observedBeaconsPicker observedBeaconsWithLocation:self.estimatedUserLocation beaconsDidChange:&didObservedBeaconsChange];
     
@@ -377,38 +590,12 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 
 - (BCLZone *)currentZone
 {
-    NSLog(@"Checking the current zone!");
-    
-    if (self.isInBackground) {
-        NSLog(@"Checking the current zone in background!!");
-        BCLZone *candidate = [self zonesSortedByRatioOfVisibleBeacons].firstObject;
-        NSLog(@"Current zone candidate: %@", candidate.name);
-        BOOL hasRange = NO;
-        for (BCLBeacon *beacon in candidate.beacons) {
-            if (beacon.proximity != CLProximityUnknown) {
-                hasRange = YES;
-                break;
-            }
-        }
-        NSLog(@"Any beacon in candidate has proximity: %i", hasRange);
-        return hasRange ? candidate : nil;
-    } else {
-        __block BCLZone *currentZone;
-        
-        NSArray *beacons = [self beaconsSortedByDistance];
-        
-        [beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, NSUInteger idx, BOOL *stop) {
-            if (beacon.proximity == CLProximityUnknown) {
-                // The closes beacon is out of range, so we're not in any zone
-                *stop = YES;
-            } else if (beacon.zone) {
-                currentZone = beacon.zone;
-                *stop = YES;
-            }
-        }];
-        
-        return currentZone;
-    }
+    return self.zoneEstimator.currentZone;
+}
+
+- (double)currentZoneConfidence
+{
+    return self.zoneEstimator.confidence;
 }
 
 - (void)recheckCurrentZone
@@ -422,7 +609,7 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 
 - (BCLBeacon *)closestBeacon
 {
-    BCLBeacon *candidate = [[self beaconsSortedByDistance] firstObject];
+    BCLBeacon *candidate = [self.distanceIndex closestBeacon];
     if (candidate.estimatedDistance == NSNotFound) {
         return nil;
     }
@@ -441,21 +628,24 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 
 - (NSArray<BCLBeacon *> *)beaconsSortedByDistance
 {
-    NSArray *result = [self.observedBeacons.allObjects sortedArrayUsingComparator:^NSComparisonResult(BCLBeacon *beacon1, BCLBeacon *beacon2) {
-        if (beacon1.estimatedDistance > beacon2.estimatedDistance) {
-            return NSOrderedDescending;
-        } else if (beacon1.estimatedDistance < beacon2.estimatedDistance) {
-            return NSOrderedAscending;
-        } else {
-            return NSOrderedSame;
+    return [self.distanceIndex closestBeacons:self.distanceIndex.count];
+}
+
+- (NSArray<NSDictionary *> *)rangingHistoryForBeacon:(BCLBeacon *)beacon fromDate:(NSDate *)fromDate toDate:(NSDate *)toDate
+{
+    return [self.rangingHistory readingsForBeaconIdentifier:beacon.identifier fromTimestamp:[fromDate timeIntervalSince1970] toTimestamp:[toDate timeIntervalSince1970]] ?: @[];
+}
+
+- (BOOL)exportRangingHistoryToFile:(NSString *)path error:(NSError *__autoreleasing *)error
+{
+    if (!self.rangingHistory) {
+        if (error) {
+            *error = [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Ranging history is not enabled"}];
         }
-    }];
-    
-    [result enumerateObjectsUsingBlock:^(BCLBeacon *beacon, NSUInteger idx, BOOL *stop) {
-        NSLog(@"Proximity: %lu, accuracy: %f, estimatedDistance: %f", beacon.proximity, beacon.accuracy, beacon.estimatedDistance);
-    }];
+        return NO;
+    }
     
-    return result;
+    return [self.rangingHistory exportToFile:path error:error];
 }
 
 - (BOOL)handleNotification:(NSDictionary *)userInfo error:(NSError *__autoreleasing *)error
@@ -511,8 +701,10 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
                 }];
             }
             
+            [configuration loadShardsNearLocation:weakSelf.estimatedUserLocation.location];
             weakSelf.configuration = configuration;
-            weakSelf.observedBeaconsPicker = [[BCLObservedBeaconsPicker alloc] initWithBeacons:weakSelf.configuration.beacons andZones:weakSelf.configuration.zones];
+            weakSelf.observedBeaconsPicker = [weakSelf observedBeaconsPickerWithConfiguration:configuration];
+            weakSelf.locationGovernor.beaconAreas = [configuration beaconAreas];
             
             if (configuration.kontaktIOAPIKey) {
                 self.kontaktIOManager = [[BCLKontaktIOBeaconConfigManager alloc] initWithApiKey:configuration.kontaktIOAPIKey];
@@ -539,7 +731,7 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 
 - (void)fetchUsersInRangesOfBeacons:(NSSet *)beacons zones:(NSSet *)zones completion:(void (^)(NSDictionary *, NSError *))completion
 {
-    [self.backend fetchUsersInRangesOfBeacons:beacons zones:zones completion:completion];
+    [self.presenceClient fetchUsersInRangesOfBeacons:beacons zones:zones completion:completion];
 }
 
 #pragma mark - BCLKontaktIOBeaconConfigManagerDelegate
@@ -548,16 +740,16 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 {
     [self.configuration.beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, BOOL *stop) {
         if (beacon.vendorIdentifier) {
-            if ([manager.configsToUpdate.allKeys containsObject:beacon.vendorIdentifier]) {
+            if (manager.configsToUpdate[beacon.vendorIdentifier]) {
                 beacon.needsCharacteristicsUpdate = YES;
                 beacon.fieldsToUpdate = [manager fieldsToUpdateForKontaktBeacon:manager.configsToUpdate[beacon.vendorIdentifier]];
             }
             
-            if ([manager.firmwaresToUpdate.allKeys containsObject:beacon.vendorIdentifier]) {
+            if (manager.firmwaresToUpdate[beacon.vendorIdentifier]) {
                 beacon.needsFirmwareUpdate = YES;
             }
             
-            if ([manager.kontaktBeaconsDictionary.allKeys containsObject:beacon.vendorIdentifier]) {
+            if (manager.kontaktBeaconsDictionary[beacon.vendorIdentifier]) {
                 KTKBeacon *kontaktBeacon = manager.kontaktBeaconsDictionary[beacon.vendorIdentifier];
                 beacon.transmissionPower = kontaktBeacon.power.integerValue;
                 beacon.transmissionInterval = kontaktBeacon.interval.integerValue;
@@ -575,7 +767,7 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 
     __block KTKBeaconDevice *device;
     [self.configuration.beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, BOOL *stop) {
-        if (beacon.vendorIdentifier && [devicesDictionary.allKeys containsObject:beacon.vendorIdentifier]) {
+        if (beacon.vendorIdentifier && devicesDictionary[beacon.vendorIdentifier]) {
             device = devicesDictionary[beacon.vendorIdentifier];
             beacon.batteryLevel = device.batteryLevel;
             beacon.vendorFirmwareVersion = device.firmwareVersion.stringValue;
@@ -728,14 +920,39 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     self.eventScheduler = [[BCLEventScheduler alloc] init];
     
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(handleBeaconTimerEvent:) name:BCLBeaconTimerFireNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(snapshotRuntimeState) name:UIApplicationDidEnterBackgroundNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(snapshotRuntimeState) name:UIApplicationWillTerminateNotification object:nil];
+    
+    self.warmStartedBeaconIdentifiers = [NSMutableSet set];
+    self.scannedBeaconLastSeenTimes = [NSMutableDictionary dictionary];
+    
+    __weak typeof(self) weakSelf = self;
+    self.eventCoalescer = [[BCLActionEventCoalescer alloc] initWithEventHandler:^(BCLActionEvent *event) {
+        [weakSelf scheduleCoalescedEvent:event];
+    }];
     
     self.locationManager = [[CLLocationManager alloc] init];
     self.locationManager.delegate = self;
     
+    self.locationGovernor = [[BCLLocationGovernor alloc] initWithLocationManager:[[CLLocationManager alloc] init] handler:^(CLLocation *location) {
+        [weakSelf locationGovernorDidUpdateLocation:location];
+    }];
+    
+    self.eddystoneServiceUUID = [CBUUID UUIDWithString:BCLEddystoneServiceUUIDString];
     self.bluetoothCentralManager = [[CBCentralManager alloc] initWithDelegate:self queue:dispatch_get_main_queue() options:@{CBCentralManagerOptionShowPowerAlertKey: @NO}];
     
     self.actionHandlerFactory = [[BCLActionHandlerFactory alloc] init];
     
+    self.zoneEstimator = [[BCLZoneEstimator alloc] init];
+    
+    self.actionExecutor = [[BCLActionExecutor alloc] initWithPerformer:^(BCLAction *action, BCLTrigger *trigger, BCLEventType eventType) {
+        [weakSelf performAction:action withTrigger:trigger withEventType:eventType];
+    }];
+    
+    self.dwellTracker = [[BCLDwellTracker alloc] initWithCheckpointCache:[SAMCache bcl_dwellCheckpointCache] handler:^(NSString *key, NSTimeInterval threshold) {
+        [weakSelf handleDwellForKey:key threshold:threshold];
+    }];
+    
     if ([UIDevice currentDevice].systemVersion.floatValue >= 8.0) {
         [self.locationManager performSelector:@selector(requestAlwaysAuthorization) withObject:nil];
     }
@@ -764,6 +981,30 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     return self.configuration.extensions;
 }
 
+/*!
+ * @brief Event bus of extensions of the current configuration, replaced whenever they change
+ */
+- (BCLExtensionEventBus *)extensionEventBus
+{
+    NSSet *extensions = [self extensions];
+    
+    if (!_extensionEventBus || _extensionEventBus.extensions != extensions) {
+        _extensionEventBus = [[BCLExtensionEventBus alloc] initWithExtensions:extensions];
+    }
+    
+    return _extensionEventBus;
+}
+
+- (NSDictionary<NSString *, NSDictionary *> *)extensionEventMetrics
+{
+    return [self.extensionEventBus metrics];
+}
+
+- (NSDictionary<NSString *, NSDictionary *> *)networkMetrics
+{
+    return [[BCLHTTPTransport sharedTransport] metrics];
+}
+
 /*
  * @brief A shortcut method that returns an extension with a given name from the current configuration
  */
@@ -781,76 +1022,6 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     return [subset anyObject];
 }
 
-/*!
- * @brief A method that returns an array of zones sorted by the amount of beacons from each zone that are in range (with some modifiers that are supposed to compensate size differences between zones.
- */
-- (NSArray *)zonesSortedByRatioOfVisibleBeacons
-{
-    BOOL didChange = NO;
-    
-    NSSet *observedZones = [self.observedBeaconsPicker observedZones:&didChange];
-    
-    NSLog(@"Observed beacons picker: %@", self.observedBeaconsPicker);
-    NSLog(@"Observed zones: %@", observedZones);
-    
-    __block CGFloat ratio1;
-    __block NSDate *zone1LastEnterDate;
-    __block CGFloat ratio2;
-    __block NSDate *zone2LastEnterDate;
-    
-    NSArray *result = [observedZones.allObjects sortedArrayUsingComparator:^NSComparisonResult(BCLZone *zone1, BCLZone *zone2) {
-        NSLog(@"Comparing zone %@ and zone %@", zone1.name, zone2.name);
-        
-        ratio1 = 0.0;
-        zone1LastEnterDate = nil;
-        ratio2 = 0.0;
-        zone2LastEnterDate = nil;
-        
-        for (BCLBeacon *beacon in zone1.beacons) {
-            if (beacon.proximity == CLProximityUnknown || ![self.observedBeacons containsObject:beacon]) {
-                continue;
-            }
-            
-            ratio1 += 1.0;
-            zone1LastEnterDate = [zone1LastEnterDate laterDate:beacon.lastEnteredDate];
-        }
-        
-        for (BCLBeacon *beacon in zone2.beacons) {
-            if (beacon.proximity == CLProximityUnknown || ![self.observedBeacons containsObject:beacon]) {
-                continue;
-            }
-            
-            ratio2 += 1.0;
-            zone2LastEnterDate = [zone2LastEnterDate laterDate:beacon.lastEnteredDate];
-        }
-        
-        ratio1 /= zone1.beacons.count;
-        ratio2 /= zone2.beacons.count;
-        
-        if (ratio1 == ratio2) {
-            // If the ratio is the same, we want to favor the zone with a beacon with the earlier
-            // enter date
-            switch ([zone1LastEnterDate compare:zone2LastEnterDate]) {
-                case NSOrderedAscending:
-                    ratio1 += 1.0;
-                    break;
-                case NSOrderedDescending:
-                    ratio2 += 1.0;
-                    break;
-                default:
-                    break;
-            }
-        }
-        
-        NSLog(@"Zone %@ ratio is %f", zone1.name, ratio1);
-        NSLog(@"Zone %@ ratio is %f", zone2.name, ratio2);
-        
-        return [@(ratio2) compare:@(ratio1)];
-    }];
-    
-    return result;
-}
-
 /*!
  * @return YES, if there's any beacon in range, NO otherwise
  */
@@ -888,6 +1059,16 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     }
 }
 
+/*!
+ * @brief Updates the zone estimate with the current distances of observed beacons and processes the change of the current zone, if there is one
+ */
+- (void)updateZoneEstimate
+{
+    if ([self.zoneEstimator updateWithBeacons:self.observedBeacons]) {
+        [self processCurrentZoneChange];
+    }
+}
+
 /*!
  * @brief A method that checks if the currently occupied zone has changed since the previous check and triggers all the necessary actions, if so.
  */
@@ -905,6 +1086,13 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
                                         BCLCurrentZoneKey : currentZone ?: [NSNull null],
     };
     
+    if ((currentZone == self.cachedClosestZone || [currentZone isEqual:self.cachedClosestZone]) && [self.eventScheduler isChangeZoneEventScheduled]) {
+        // The estimate went back to the zone we're in before the change was fired
+        [self.eventScheduler cancelChangeZoneEvent];
+        self.previousZoneChange = nil;
+        return;
+    }
+    
     if (![currentZone isEqual:self.cachedClosestZone] && !(currentZone == nil && self.cachedClosestZone == nil) && ![self.previousZoneChange isEqual:currentZoneChange]) {
         if ([self.eventScheduler isChangeZoneEventScheduled]) {
             [self.eventScheduler cancelChangeZoneEvent];
@@ -923,6 +1111,7 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
             if (previousZone) {
                 // We want to send enter and leave events for each zone
                 NSLog(@"Scheduling zone leave event for zone: %@", previousZone.name);
+                [weakSelf.dwellTracker endDwellForKey:[weakSelf dwellKeyForZone:previousZone]];
                 [weakSelf storeActionEventWithType:BCLEventTypeLeave beacon:nil zone:previousZone action:nil];
                 [weakSelf performActionsForZone:previousZone eventType:BCLEventTypeLeave];
             }
@@ -935,9 +1124,10 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
                 if (!self.isInBackground) {
                     weakSelf.estimatedUserLocation = [weakSelf centerOfZone:newZone];
                 }
-                [weakSelf.locationManager stopUpdatingLocation];
+                weakSelf.locationGovernor.suspended = YES;
                 // We want to send enter and leave events for each zone
                 NSLog(@"Scheduling zone enter event for zone: %@", newZone.name);
+                [weakSelf.dwellTracker beginDwellForKey:[weakSelf dwellKeyForZone:newZone]];
                 [weakSelf storeActionEventWithType:BCLEventTypeEnter beacon:nil zone:newZone action:nil];
                 [weakSelf performActionsForZone:newZone eventType:BCLEventTypeEnter];
             } else {
@@ -945,12 +1135,14 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
                     weakSelf.estimatedUserLocation = nil;
                 }
                 
-                [weakSelf.locationManager startUpdatingLocation];
+                weakSelf.locationGovernor.suspended = NO;
             }
             
             if (!self.isInBackground) {
                 [weakSelf updateMonitoredBeacons];
             }
+            
+            [weakSelf setNeedsRuntimeStateSnapshot];
         }];
     }
 }
@@ -1006,6 +1198,22 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
         event.actionName = action.name;
     }
     
+    [self.eventCoalescer addEvent:event];
+}
+
+/*!
+ * @brief Hands over a coalesced action event to be uploaded as it is, or folded into visit aggregates and sampled, depending on the upload mode
+ */
+- (void)scheduleCoalescedEvent:(BCLActionEvent *)event
+{
+    if (self.eventUploadMode == BCLEventUploadModeAggregated) {
+        [self.actionEventScheduler aggregateEvent:event];
+        
+        if (arc4random_uniform(1000000) >= self.rawEventSamplingRatio * 1000000) {
+            return;
+        }
+    }
+    
     [self.actionEventScheduler storeEvent:event];
 }
 
@@ -1017,7 +1225,13 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     __block BCLAction *actionToPerform;
     __block BCLTrigger *triggerToFire;
     
-    [self.configuration.beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, BOOL *beaconStop) {
+    BCLConfiguration *configuration = self.configuration;
+    
+    if ([configuration loadShardContainingActionIdentifier:actionIdentifier]) {
+        [self configurationBeaconsDidChange];
+    }
+    
+    [configuration.beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, BOOL *beaconStop) {
         [beacon.triggers enumerateObjectsUsingBlock:^(BCLTrigger *trigger, NSUInteger triggerIdx, BOOL *triggerStop) {
             [trigger.actions enumerateObjectsUsingBlock:^(BCLAction *action, NSUInteger actionIdx, BOOL *actionStop) {
                 if ([action.identifier isEqual:actionIdentifier]) {
@@ -1033,7 +1247,7 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
         *trigger = triggerToFire;
         *action = actionToPerform;
     } else {
-        [self.configuration.zones enumerateObjectsUsingBlock:^(BCLZone *zone, BOOL *zoneStop) {
+        [configuration.zones enumerateObjectsUsingBlock:^(BCLZone *zone, BOOL *zoneStop) {
             [zone.triggers enumerateObjectsUsingBlock:^(BCLTrigger *trigger, NSUInteger triggerIdx, BOOL *triggerStop) {
                 [trigger.actions enumerateObjectsUsingBlock:^(BCLAction *action, NSUInteger actionIdx, BOOL *actionStop) {
                     if ([action.identifier isEqual:actionIdentifier]) {
@@ -1084,7 +1298,7 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     
     if (triggerOK) {
         for (BCLAction *action in trigger.actions) {
-            [self performAction:action withTrigger:trigger withEventType:eventType];
+            [self.actionExecutor enqueueAction:action trigger:trigger eventType:eventType];
         }
     }
     
@@ -1181,9 +1395,7 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
             break;
     }
     
-    for (id <BCLExtension> extension in [self extensions]) {
-        [extension event:eventType forBeacon:beacon];
-    }
+    [self.extensionEventBus publishEvent:eventType forBeacon:beacon];
     
     // Triggers with actions
     [self performActionsForBeacon:beacon eventType:eventType];
@@ -1199,13 +1411,55 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     
     BCLBeacon *beacon = notification.object;
     
-    for (id <BCLExtension> extension in [self extensions]) {
-        [extension event:BCLEventTypeTimer forBeacon:beacon];
-    }
+    [self.extensionEventBus publishEvent:BCLEventTypeTimer forBeacon:beacon];
     
     [self performActionsForBeacon:beacon eventType:BCLEventTypeTimer];
 }
 
+- (NSString *)dwellKeyForBeacon:(BCLBeacon *)beacon
+{
+    return [NSString stringWithFormat:@"beacon.%@", beacon.identifier];
+}
+
+- (NSString *)dwellKeyForZone:(BCLZone *)zone
+{
+    return [NSString stringWithFormat:@"zone.%@", zone.zoneIdentifier];
+}
+
+/*!
+ * @brief Fires dwell time events when a stay in range of a beacon or inside a zone crosses one of the dwellTimeThresholds
+ */
+- (void)handleDwellForKey:(NSString *)key threshold:(NSTimeInterval)threshold
+{
+    if (self.paused) {
+        return;
+    }
+    
+#ifdef DEBUG
+    NSLog(@"Dwell time of %@ crossed %.0f seconds", key, threshold);
+#endif
+    
+    if ([key hasPrefix:@"beacon."]) {
+        BCLBeacon *beacon = [[self.observedBeacons filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"identifier == %@", [key substringFromIndex:@"beacon.".length]]] anyObject];
+        if (!beacon) {
+            return;
+        }
+        
+        [self.extensionEventBus publishEvent:BCLEventTypeDwellTime forBeacon:beacon];
+        
+        [self performActionsForBeacon:beacon eventType:BCLEventTypeDwellTime];
+        [self storeActionEventWithType:BCLEventTypeDwellTime beacon:beacon zone:nil action:nil];
+    } else if ([key hasPrefix:@"zone."]) {
+        BCLZone *zone = self.cachedClosestZone;
+        if (!zone || ![[self dwellKeyForZone:zone] isEqualToString:key]) {
+            return;
+        }
+        
+        [self performActionsForZone:zone eventType:BCLEventTypeDwellTime];
+        [self storeActionEventWithType:BCLEventTypeDwellTime beacon:nil zone:zone action:nil];
+    }
+}
+
 /*!
  * @brief Processes enters and leaves from beacons' ranges and fires all the relevant actions
  */
@@ -1244,7 +1498,8 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
         return;
     }
     
-    SAMCache *staysCache = [[SAMCache alloc] initWithName:BLEBeaconStaysCacheName(foundBeacon)];
+    BOOL isWarmStarted = [self.warmStartedBeaconIdentifiers containsObject:foundBeacon.identifier];
+    [self.warmStartedBeaconIdentifiers removeObject:foundBeacon.identifier];
     
     // Schedule
     if (eventType == BCLEventTypeEnter) {
@@ -1252,80 +1507,285 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
         // if leave is scheduled then unschedule leave and do nothing
         if ([self.eventScheduler isScheduledForBeacon:foundBeacon]) {
             [self.eventScheduler cancelForBeacon:foundBeacon];
-        } else {
-            foundBeacon.proximity = CLProximityFar;
-            
-            // Stop checking GPS user location for determining beacons to look for
-            [self.locationManager stopUpdatingLocation];
-            
-            [staysCache setObject:[NSDate date] forKey:foundBeacon.identifier];
-            
-            // perform actual action
-            if (foundBeacon.onEnterCallback) {
-                foundBeacon.onEnterCallback(foundBeacon);
-            }
-            
-            // Extensions
-            for (id <BCLExtension> extension in [self extensions]) {
-                [extension event:eventType forBeacon:foundBeacon];
-            }
-            
-            // Triggers with actions
-            [self performActionsForBeacon:foundBeacon eventType:eventType];
-            
+        } else if (isWarmStarted) {
+            // The beacon was entered before the app was relaunched, the enter has already been fired
             if (![self.locationManager.rangedRegions containsObject:region]) {
                 [self.locationManager startRangingBeaconsInRegion:region];
             }
+        } else {
+            [self fireEnterForBeacon:foundBeacon];
             
-            if (self.isInBackground) {
-                self.estimatedUserLocation = foundBeacon.location;
-                [self updateMonitoredBeacons];
+            if (![self.locationManager.rangedRegions containsObject:region]) {
+                [self.locationManager startRangingBeaconsInRegion:region];
             }
-            
-            [self processCurrentZoneChange];
-            
-            // We want to send enter and leave events for each ranged beacon
-            [self storeActionEventWithType:eventType beacon:foundBeacon zone:nil action:nil];
         }
     } else if (eventType == BCLEventTypeLeave) {
         // schedule new leave cancelling old one (re-schedule)
-        [self.eventScheduler scheduleEventForBeacon:foundBeacon afterDelay:BCLDelayEventTimeInterval onTime:^(BCLBeacon *scheduledBeacon) {
-            // if beacon leave then assume that proximity is unknown (it's FAR FAr Far far away)
-            foundBeacon.proximity = CLProximityUnknown;
-            NSLog(@"Setting proximity unknown for beacon: %@", foundBeacon);
-            foundBeacon.accuracy = 0;
-            
-            foundBeacon.rssi = 0;
-            
-            // clear stays cache
-            [staysCache removeObjectForKey:foundBeacon.identifier];
-            
-            if (scheduledBeacon.onExitCallback) {
-                scheduledBeacon.onExitCallback(foundBeacon);
-            }
-            
-            // Extensions
-            for (id <BCLExtension> extension in [self extensions]) {
-                [extension event:eventType forBeacon:foundBeacon];
-            }
-            
-            // Triggers with actions
-            [self performActionsForBeacon:foundBeacon eventType:eventType];
-            
-            [self processCurrentZoneChange];
-            
-            // We want to send enter and leave events for each ranged beacon
-            [self storeActionEventWithType:eventType beacon:foundBeacon zone:nil action:nil];
-            
-            // Start using GPS to determine which beacons to monitor
-            if (![self isInAnyRange]) {
-                self.estimatedUserLocation = nil;
-                [self.locationManager startUpdatingLocation];
-            }
-        }];
+        [self scheduleLeaveForBeacon:foundBeacon afterDelay:BCLDelayEventTimeInterval];
+    }
+    
+    [self setNeedsRuntimeStateSnapshot];
+}
+
+/*!
+ * @brief Fires an enter into a beacon's range, whether the beacon's region was entered or the beacon was seen by BLE scanning
+ */
+- (void)fireEnterForBeacon:(BCLBeacon *)foundBeacon
+{
+    foundBeacon.proximity = CLProximityFar;
+    
+    // Stop checking GPS user location for determining beacons to look for
+    self.locationGovernor.suspended = YES;
+    
+    [self.dwellTracker beginDwellForKey:[self dwellKeyForBeacon:foundBeacon]];
+    
+    // perform actual action
+    if (foundBeacon.onEnterCallback) {
+        foundBeacon.onEnterCallback(foundBeacon);
+    }
+    
+    // Extensions
+    [self.extensionEventBus publishEvent:BCLEventTypeEnter forBeacon:foundBeacon];
+    
+    // Triggers with actions
+    [self performActionsForBeacon:foundBeacon eventType:BCLEventTypeEnter];
+    
+    if (self.isInBackground) {
+        self.estimatedUserLocation = foundBeacon.location;
+        [self updateMonitoredBeacons];
+    }
+    
+    [self updateZoneEstimate];
+    
+    // We want to send enter and leave events for each ranged beacon
+    [self storeActionEventWithType:BCLEventTypeEnter beacon:foundBeacon zone:nil action:nil];
+}
+
+/*!
+ * @brief Schedules firing a leave from a beacon's range, unless the beacon is entered again in the meantime
+ */
+- (void)scheduleLeaveForBeacon:(BCLBeacon *)foundBeacon afterDelay:(NSTimeInterval)delay
+{
+    [self.eventScheduler scheduleEventForBeacon:foundBeacon afterDelay:delay onTime:^(BCLBeacon *scheduledBeacon) {
+        // if beacon leave then assume that proximity is unknown (it's FAR FAr Far far away)
+        foundBeacon.proximity = CLProximityUnknown;
+        NSLog(@"Setting proximity unknown for beacon: %@", foundBeacon);
+        foundBeacon.accuracy = 0;
+        [self.distanceIndex updateBeacon:foundBeacon];
+        
+        foundBeacon.rssi = 0;
+        
+        [self.dwellTracker endDwellForKey:[self dwellKeyForBeacon:foundBeacon]];
+        
+        if (scheduledBeacon.onExitCallback) {
+            scheduledBeacon.onExitCallback(foundBeacon);
+        }
+        
+        // Extensions
+        [self.extensionEventBus publishEvent:BCLEventTypeLeave forBeacon:foundBeacon];
+        
+        // Triggers with actions
+        [self performActionsForBeacon:foundBeacon eventType:BCLEventTypeLeave];
+        
+        [self updateZoneEstimate];
+        
+        // We want to send enter and leave events for each ranged beacon
+        [self storeActionEventWithType:BCLEventTypeLeave beacon:foundBeacon zone:nil action:nil];
+        
+        // Start using GPS to determine which beacons to monitor
+        if (![self isInAnyRange]) {
+            self.estimatedUserLocation = nil;
+            self.locationGovernor.suspended = NO;
+        }
+        
+        [self setNeedsRuntimeStateSnapshot];
+    }];
+}
+
+/*!
+ * @brief Restores the runtime state snapshotted before the app was relaunched, so zones and pending leaves continue where they were instead of being rebuilt, and fired again, by the following region states and ranging
+ */
+- (void)restoreRuntimeState
+{
+    if (self.isRuntimeStateSnapshotEnabled) {
+        return;
+    }
+    
+    BCLRuntimeStateSnapshot *snapshot = [BCLRuntimeStateSnapshot snapshotFromCache:[SAMCache bcl_runtimeStateCache]];
+    NSTimeInterval now = [BCLClock currentClock].timeIntervalSince1970;
+    
+    if (!snapshot || [snapshot isExpiredAtTime:now]) {
+        return;
+    }
+    
+    if (!self.estimatedUserLocation && snapshot.estimatedUserLocation) {
+        self.estimatedUserLocation = snapshot.estimatedUserLocation;
+        
+        if ([self.configuration loadShardsNearLocation:self.estimatedUserLocation.location]) {
+            [self configurationBeaconsDidChange];
+        }
+    }
+    
+    NSMutableDictionary *beaconsByIdentifier = [NSMutableDictionary dictionaryWithCapacity:self.configuration.beacons.count];
+    for (BCLBeacon *beacon in self.configuration.beacons) {
+        if (beacon.identifier) {
+            beaconsByIdentifier[beacon.identifier] = beacon;
+        }
+    }
+    
+    for (NSString *identifier in snapshot.beaconIdentifiers) {
+        BCLBeacon *beacon = beaconsByIdentifier[identifier];
+        BCLRuntimeBeaconState state;
+        
+        if (!beacon || ![snapshot getState:&state forBeaconIdentifier:identifier atTime:now] || state.proximity == CLProximityUnknown) {
+            continue;
+        }
+        
+        // The enter date has to be set first, setting a proximity would start a new stay
+        beacon.lastEnteredDate = state.enterTime > 0 ? [NSDate dateWithTimeIntervalSince1970:state.enterTime] : nil;
+        beacon.proximity = state.proximity;
+        beacon.accuracy = state.estimatedDistance != NSNotFound ? state.estimatedDistance : 0;
+        beacon.rssi = state.rssi;
+        
+        [self.warmStartedBeaconIdentifiers addObject:identifier];
+        
+        // Leaves that became due while the app wasn't running are fired right away
+        if (state.leaveTime > 0) {
+            [self scheduleLeaveForBeacon:beacon afterDelay:MAX(state.leaveTime - now, 0)];
+        }
+    }
+    
+    BCLZone *zone = nil;
+    BCLZone *estimatedZone = nil;
+    for (BCLZone *candidate in self.configuration.zones) {
+        if ([candidate.zoneIdentifier isEqualToString:snapshot.zoneIdentifier]) {
+            zone = candidate;
+        }
+        if ([candidate.zoneIdentifier isEqualToString:snapshot.estimatedZoneIdentifier]) {
+            estimatedZone = candidate;
+        }
+    }
+    
+    self.cachedClosestZone = zone;
+    [self.zoneEstimator restoreZone:estimatedZone confidence:snapshot.estimatedZoneConfidence age:[snapshot ageAtTime:now]];
+    
+    // A zone change was pending when the snapshot was taken
+    if (zone != estimatedZone) {
+        [self processCurrentZoneChange];
     }
 }
 
+/*!
+ * @brief Schedules leaves of restored beacons that weren't picked to be observed again. Their regions aren't monitored anymore, so nothing else would ever leave them.
+ */
+- (void)scheduleLeavesForUnobservedRestoredBeacons
+{
+    if (!self.warmStartedBeaconIdentifiers.count) {
+        return;
+    }
+    
+    for (BCLBeacon *beacon in self.configuration.beacons) {
+        if (![self.warmStartedBeaconIdentifiers containsObject:beacon.identifier] || [self.observedBeacons containsObject:beacon]) {
+            continue;
+        }
+        
+        [self.warmStartedBeaconIdentifiers removeObject:beacon.identifier];
+        
+        // Leaves that were pending in the snapshot are already scheduled
+        if (![self.eventScheduler isScheduledForBeacon:beacon]) {
+            [self scheduleLeaveForBeacon:beacon afterDelay:BCLDelayEventTimeInterval];
+        }
+    }
+}
+
+/*!
+ * @brief Snapshots the runtime state now and then while beacons are monitored
+ */
+- (void)startRuntimeStateSnapshots
+{
+    self.isRuntimeStateSnapshotEnabled = YES;
+    
+    if (self.runtimeStateSnapshotTimer) {
+        return;
+    }
+    
+    __weak typeof(self) weakSelf = self;
+    self.runtimeStateSnapshotTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+    dispatch_source_set_event_handler(self.runtimeStateSnapshotTimer, ^{
+        [weakSelf snapshotRuntimeState];
+    });
+    int64_t interval = (int64_t)(BCLRuntimeStateSnapshotInterval * NSEC_PER_SEC);
+    dispatch_source_set_timer(self.runtimeStateSnapshotTimer, dispatch_time(DISPATCH_TIME_NOW, interval), (uint64_t)interval, 5 * NSEC_PER_SEC);
+    dispatch_resume(self.runtimeStateSnapshotTimer);
+}
+
+/*!
+ * @brief Stops snapshotting and drops the last snapshot, as monitoring will start from scratch
+ */
+- (void)stopRuntimeStateSnapshots
+{
+    self.isRuntimeStateSnapshotEnabled = NO;
+    
+    if (self.runtimeStateSnapshotTimer) {
+        dispatch_source_cancel(self.runtimeStateSnapshotTimer);
+        self.runtimeStateSnapshotTimer = nil;
+    }
+    
+    [self.warmStartedBeaconIdentifiers removeAllObjects];
+    [BCLRuntimeStateSnapshot removeFromCache:[SAMCache bcl_runtimeStateCache]];
+}
+
+/*!
+ * @brief Snapshots the runtime state once the current run loop iteration is done, so a burst of region states is written once
+ */
+- (void)setNeedsRuntimeStateSnapshot
+{
+    if (!self.isRuntimeStateSnapshotEnabled || self.isRuntimeStateSnapshotScheduled) {
+        return;
+    }
+    
+    self.isRuntimeStateSnapshotScheduled = YES;
+    
+    __weak typeof(self) weakSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        weakSelf.isRuntimeStateSnapshotScheduled = NO;
+        [weakSelf snapshotRuntimeState];
+    });
+}
+
+/*!
+ * @brief Stores what's needed to resume after a relaunch: beacons in range with their distances and pending leaves, zones and the estimated location
+ */
+- (void)snapshotRuntimeState
+{
+    // Nothing is known until monitoring starts, which would overwrite a snapshot that's yet to be restored
+    if (!self.isRuntimeStateSnapshotEnabled) {
+        return;
+    }
+    
+    BCLRuntimeStateSnapshot *snapshot = [[BCLRuntimeStateSnapshot alloc] initWithTimestamp:[BCLClock currentClock].timeIntervalSince1970];
+    snapshot.zoneIdentifier = self.cachedClosestZone.zoneIdentifier;
+    snapshot.estimatedZoneIdentifier = self.zoneEstimator.currentZone.zoneIdentifier;
+    snapshot.estimatedZoneConfidence = self.zoneEstimator.confidence;
+    snapshot.estimatedUserLocation = self.estimatedUserLocation;
+    
+    for (BCLBeacon *beacon in self.observedBeacons) {
+        if (beacon.proximity == CLProximityUnknown) {
+            continue;
+        }
+        
+        BCLRuntimeBeaconState state;
+        state.proximity = beacon.proximity;
+        state.estimatedDistance = beacon.estimatedDistance;
+        state.rssi = beacon.rssi;
+        state.enterTime = [beacon.lastEnteredDate timeIntervalSince1970];
+        state.leaveTime = [[self.eventScheduler fireDateForBeacon:beacon] timeIntervalSince1970];
+        [snapshot setState:state forBeaconIdentifier:beacon.identifier];
+    }
+    
+    [snapshot storeInCache:[SAMCache bcl_runtimeStateCache]];
+}
+
 /*!
  * @return YES, if the running application is in background, NO otherwise
  */
@@ -1366,18 +1826,156 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 {
     return @[@"eventScheduler",
              @"actionEventScheduler",
+             @"eventCoalescer",
+             @"eventCoalescingInterval",
+             @"eventSuppressionRatio",
+             @"presenceClient",
              @"actionHandlerFactory",
+             @"actionExecutor",
+             @"dwellTracker",
+             @"dwellTimeThresholds",
              @"delegate",
              @"locationManager",
+             @"locationGovernor",
              @"estimatedUserLocation",
-             @"beaconBatch"];
+             @"beaconBatch",
+             @"distanceIndex",
+             @"zoneEstimator",
+             @"rangingHistory",
+             @"extensionEventBus",
+             @"currentZoneConfidence",
+             @"advertisementResolver",
+             @"eddystoneServiceUUID",
+             @"isClosestBeaconCheckScheduled",
+             @"scannedBeaconLastSeenTimes",
+             @"scannedBeaconsTimeoutTimer",
+             @"runtimeStateSnapshotTimer",
+             @"isRuntimeStateSnapshotEnabled",
+             @"isRuntimeStateSnapshotScheduled",
+             @"warmStartedBeaconIdentifiers"];
 }
 
 #pragma mark - CBCentralManagerDelegate
 
 - (void)centralManagerDidUpdateState:(CBCentralManager *)central
 {
+    if (central.state == CBCentralManagerStatePoweredOn && self.advertisementResolver.eddystoneBeaconsCount) {
+        [central scanForPeripheralsWithServices:@[self.eddystoneServiceUUID] options:@{CBCentralManagerScanOptionAllowDuplicatesKey: @YES}];
+    }
+}
+
+/**
+ *  Eddystone beacons are not visible to CoreLocation, so their frames are decoded here and fed into the same
+ *  proximity processing as ranged iBeacons
+ */
+- (void)centralManager:(CBCentralManager *)central didDiscoverPeripheral:(CBPeripheral *)peripheral advertisementData:(NSDictionary *)advertisementData RSSI:(NSNumber *)RSSI
+{
+    if (self.paused || !self.advertisementResolver) {
+        return;
+    }
+    
+    NSData *serviceData = advertisementData[CBAdvertisementDataServiceDataKey][self.eddystoneServiceUUID];
+    if (!serviceData) {
+        return;
+    }
+    
+    BCLAdvertisementFrame frame = {BCLAdvertisementPayloadKindEddystoneServiceData, (int16_t)RSSI.integerValue, serviceData.bytes, serviceData.length};
+    BCLAdvertisementReading reading;
+    if (!BCLAdvertisementDecode(&frame, &reading)) {
+        return;
+    }
+    
+    BCLBeacon *beacon = [self.advertisementResolver beaconForReading:&reading];
+    if (!beacon) {
+        return;
+    }
+    
+    [self processAdvertisementOfScannedBeacon:beacon];
     
+    double distance = BCLAdvertisementReadingEstimatedDistance(&reading);
+    [self.rangingHistory recordReadingForBeaconIdentifier:beacon.identifier rssi:reading.rssi accuracy:distance timestamp:[BCLClock currentClock].timeIntervalSince1970];
+    [self updateBeacon:beacon withAccuracy:distance > 0 ? distance : 0 rssi:reading.rssi];
+    
+    // Advertisements come in many times a second, so the closest beacon is checked at most once a second
+    if (!self.isClosestBeaconCheckScheduled) {
+        self.isClosestBeaconCheckScheduled = YES;
+        [[BCLClock currentClock] scheduleTimerWithDelay:1 queue:dispatch_get_main_queue() handler:^{
+            self.isClosestBeaconCheckScheduled = NO;
+            [self checkIfClosestBeaconHasChanged];
+            [self updateZoneEstimate];
+        }];
+    }
+}
+
+/**
+ *  Scanned beacons have no regions to report enters and leaves, so a beacon is entered on its first advertisement
+ *  and left once it hasn't advertised for BCLScannedBeaconTimeoutInterval
+ */
+- (void)processAdvertisementOfScannedBeacon:(BCLBeacon *)beacon
+{
+    BOOL isEntered = self.scannedBeaconLastSeenTimes[beacon.identifier] != nil;
+    self.scannedBeaconLastSeenTimes[beacon.identifier] = @([BCLClock currentClock].uptime);
+    
+    if (isEntered) {
+        return;
+    }
+    
+    // if leave is scheduled then unschedule leave and do nothing
+    if ([self.eventScheduler isScheduledForBeacon:beacon]) {
+        [self.eventScheduler cancelForBeacon:beacon];
+    } else {
+        [self fireEnterForBeacon:beacon];
+    }
+    
+    [self scheduleScannedBeaconsTimeoutCheck];
+    [self setNeedsRuntimeStateSnapshot];
+}
+
+- (void)scheduleScannedBeaconsTimeoutCheck
+{
+    if (self.scannedBeaconsTimeoutTimer.isValid || !self.scannedBeaconLastSeenTimes.count) {
+        return;
+    }
+    
+    __weak typeof(self) weakSelf = self;
+    self.scannedBeaconsTimeoutTimer = [[BCLClock currentClock] scheduleTimerWithDelay:BCLScannedBeaconTimeoutInterval / 2 queue:dispatch_get_main_queue() handler:^{
+        weakSelf.scannedBeaconsTimeoutTimer = nil;
+        [weakSelf checkScannedBeaconsTimeout];
+        [weakSelf scheduleScannedBeaconsTimeoutCheck];
+    }];
+}
+
+/**
+ *  Schedules leaves of scanned beacons which stopped advertising, the same way as exits from beacons' regions
+ */
+- (void)checkScannedBeaconsTimeout
+{
+    if (self.paused) {
+        return;
+    }
+    
+    NSTimeInterval now = [BCLClock currentClock].uptime;
+    NSMutableDictionary *beaconsByIdentifier = [NSMutableDictionary dictionaryWithCapacity:self.scannedBeaconLastSeenTimes.count];
+    for (BCLBeacon *beacon in self.configuration.beacons) {
+        if (beacon.identifier && self.scannedBeaconLastSeenTimes[beacon.identifier]) {
+            beaconsByIdentifier[beacon.identifier] = beacon;
+        }
+    }
+    
+    for (NSString *identifier in self.scannedBeaconLastSeenTimes.allKeys) {
+        if (now - [self.scannedBeaconLastSeenTimes[identifier] doubleValue] < BCLScannedBeaconTimeoutInterval) {
+            continue;
+        }
+        
+        [self.scannedBeaconLastSeenTimes removeObjectForKey:identifier];
+        
+        BCLBeacon *beacon = beaconsByIdentifier[identifier];
+        if (beacon) {
+            [self scheduleLeaveForBeacon:beacon afterDelay:BCLDelayEventTimeInterval];
+        }
+    }
+    
+    [self setNeedsRuntimeStateSnapshot];
 }
 
 #pragma mark - CLLocationManagerDelegate
@@ -1415,7 +2013,7 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
 {
     if (status == kCLAuthorizationStatusAuthorized || status == kCLAuthorizationStatusAuthorizedAlways || status == kCLAuthorizationStatusAuthorizedWhenInUse) {
         if (!self.estimatedUserLocation) {
-            [self.locationManager startUpdatingLocation];
+            [self.locationGovernor refreshLocation];
         }
     }
 }
@@ -1425,11 +2023,17 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
  */
 - (void)locationManager:(CLLocationManager *)manager didRangeBeacons:(NSArray *)rangedBeacons inRegion:(CLBeaconRegion *)region
 {
-    [self.locationManager stopUpdatingLocation];
+    self.locationGovernor.suspended = YES;
     
     if (self.isInBackground)
         return;
     
+    if (self.rangingHistory) {
+        NSTimeInterval timestamp = [BCLClock currentClock].timeIntervalSince1970;
+        for (CLBeacon *rangedBeacon in rangedBeacons) {
+            [self.rangingHistory recordReadingForBeaconIdentifier:rangedBeacon.bcl_identifier rssi:rangedBeacon.rssi accuracy:rangedBeacon.accuracy timestamp:timestamp];
+        }
+    }
     
 //    if (rangedBeacons.count == 0){
 //        [manager stopRangingBeaconsInRegion:region];
@@ -1481,13 +2085,13 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
     }
 }
 
-- (void)locationManager:(CLLocationManager *)manager didUpdateLocations:(NSArray *)locations
+/**
+ *  Called by the location governor only once the device has moved far enough to pick observed beacons again
+ */
+- (void)locationGovernorDidUpdateLocation:(CLLocation *)lastKnownLocation
 {
-    //[self.locationManager allowDeferredLocationUpdatesUntilTraveled:10 timeout:5];
-    
     NSLog(@"Updated GPS Location!");
     
-    CLLocation *lastKnownLocation = locations.lastObject;
     NSNumber *floor;
     if ([lastKnownLocation respondsToSelector:@selector(floor)]) {
         if ([lastKnownLocation performSelector:@selector(floor)]) {
@@ -1516,43 +2120,73 @@ static NSString * const BCLBeaconCtrlArchiveFilename = @"beacon_ctrl.data";
         [self.observedBeacons enumerateObjectsUsingBlock:^(BCLBeacon *bleBeacon, BOOL *stop) {
             CLBeacon *rangedBeacon = rangedBeaconsSorted[0];
             if ([rangedBeacon.bcl_identifier hasPrefix:bleBeacon.identifier]) {
-                if (rangedBeacon.proximity != CLProximityUnknown && rangedBeacon.accuracy > 0) {
-                    bleBeacon.accuracy = rangedBeacon.accuracy;
-                    bleBeacon.rssi = rangedBeacon.rssi;
-                    // Guess the proximty based on accuracy value
-                    CLProximity guessedProximity = CLProximityUnknown;
-                    if (rangedBeacon.accuracy < 0.5) {
-                        guessedProximity = CLProximityImmediate;
-                    } else if (rangedBeacon.accuracy <= 3.0) {
-                        guessedProximity = CLProximityNear;
-                    } else {
-                        guessedProximity = CLProximityFar;
-                    }
-                    
-                    if ([bleBeacon canSetProximity:guessedProximity]) {
-                        bleBeacon.proximity = guessedProximity;
-                        [self beaconProximityDidChange:bleBeacon];
-                    }
-                } else {
-                    bleBeacon.proximity = CLProximityUnknown;
-                    bleBeacon.accuracy = 0;
-                    bleBeacon.rssi = 0;
-                }
+                BOOL isKnown = rangedBeacon.proximity != CLProximityUnknown && rangedBeacon.accuracy > 0;
+                [self updateBeacon:bleBeacon withAccuracy:isKnown ? rangedBeacon.accuracy : 0 rssi:rangedBeacon.rssi];
                 *stop = YES;
             }
         }];
     }
     
-    BOOL closestBeaconHasChanged = [self checkIfClosestBeaconHasChanged];
+    [self checkIfClosestBeaconHasChanged];
+    [self updateZoneEstimate];
+}
+
+/**
+ *  Updates a beacon with a new distance readout, 0 meaning the beacon's distance is unknown
+ */
+- (void)updateBeacon:(BCLBeacon *)bleBeacon withAccuracy:(CLLocationAccuracy)accuracy rssi:(NSInteger)rssi
+{
+    if (accuracy > 0) {
+        bleBeacon.accuracy = accuracy;
+        bleBeacon.rssi = rssi;
+        [self.distanceIndex updateBeacon:bleBeacon];
+        // Guess the proximty based on accuracy value
+        CLProximity guessedProximity = CLProximityUnknown;
+        if (accuracy < 0.5) {
+            guessedProximity = CLProximityImmediate;
+        } else if (accuracy <= 3.0) {
+            guessedProximity = CLProximityNear;
+        } else {
+            guessedProximity = CLProximityFar;
+        }
+        
+        if ([bleBeacon canSetProximity:guessedProximity]) {
+            bleBeacon.proximity = guessedProximity;
+            [self beaconProximityDidChange:bleBeacon];
+        }
+    } else {
+        bleBeacon.proximity = CLProximityUnknown;
+        bleBeacon.accuracy = 0;
+        bleBeacon.rssi = 0;
+        [self.distanceIndex updateBeacon:bleBeacon];
+    }
+}
+
+/**
+ *  Called after shards of the configuration have been loaded or evicted
+ */
+- (void)configurationBeaconsDidChange
+{
+    self.observedBeaconsPicker = [self observedBeaconsPickerWithConfiguration:self.configuration];
     
-    if (closestBeaconHasChanged && !self.isInBackground) {
-        [self processCurrentZoneChange];
+    if (self.advertisementResolver) {
+        [self startScanningForEddystoneBeacons];
     }
 }
 
+/**
+ *  Builds the advertisement resolver for the current configuration and starts scanning if there are any Eddystone beacons
+ */
+- (void)startScanningForEddystoneBeacons
+{
+    self.advertisementResolver = [[BCLAdvertisementResolver alloc] initWithBeacons:self.configuration.beacons];
+    [self centralManagerDidUpdateState:self.bluetoothCentralManager];
+}
+
 - (void)logout
 {
     [self.backend reset];
+    [self.presenceClient invalidateCache];
     [BCLActionEventScheduler clearCache];
 }
 
@@ -11,6 +11,7 @@
 
 #import <Foundation/Foundation.h>
 #import "BCLTypes.h"
+#import "BCLAdminBulkOperation.h"
 
 @class BCLBeacon;
 @class BCLZone;
@@ -31,6 +32,9 @@
 // Available zone colors fetched from the backend
 @property(nonatomic, strong) NSArray *zoneColors;
 
+/// Maximum number of requests sent at the same time by bulk operations. Defaults to 4.
+@property(nonatomic) NSUInteger maxConcurrentBulkOperations;
+
 
 /** @name Methods */
 
@@ -48,6 +52,15 @@
  */
 - (void)fetchZonesAndBeacons:(void (^)(NSError *error))completion;
 
+/*!
+ * @brief Fethes beacons and zones from the backend page by page
+ * @discussion Beacons are fetched first, zones afterwards. The page handlers are called on a background queue with the objects of every page as soon as it's loaded, so that they can be shown before the whole fetch is finished.
+ * @param beaconsPageHandler A handler that is called with a set of beacons from each loaded page
+ * @param zonesPageHandler A handler that is called with a set of zones from each loaded page
+ * @param completion A completion handler that is called after the fetch is finished
+ */
+- (void)fetchZonesAndBeaconsWithBeaconsPageHandler:(void (^)(NSSet *beacons))beaconsPageHandler zonesPageHandler:(void (^)(NSSet *zones))zonesPageHandler completion:(void (^)(NSError *error))completion;
+
 /*!
  * @brief Syncs a given beacon with its state on the backend
  * @param beacon A beacon to sync
@@ -142,6 +155,21 @@
  */
 - (void)fetchVendors:(void (^)(NSArray *vendors, NSError *error))completion;
 
+/*!
+ * @brief Performs a list of beacon and zone mutations on the backend
+ * @discussion Up to maxConcurrentBulkOperations requests are kept in flight at a time. An operation that fails is retried once at the end of the run, unless it failed because of invalid parameters.
+ * @param operations An array of BCLAdminBulkOperation objects
+ * @param completion A completion handler called on the main queue with an array of BCLAdminBulkOperationResult objects, in the same order as the operations
+ */
+- (void)performBulkOperations:(NSArray *)operations completion:(void (^)(NSArray *results))completion;
+
+/*!
+ * @brief Performs again only those operations that have failed in a previous bulk run
+ * @param results An array of BCLAdminBulkOperationResult objects returned by a previous bulk run
+ * @param completion A completion handler called on the main queue with an array of BCLAdminBulkOperationResult objects; results of operations that have succeeded before are passed through unchanged
+ */
+- (void)retryFailedBulkOperationsFromResults:(NSArray *)results completion:(void (^)(NSArray *results))completion;
+
 - (void)logout;
 
 @end
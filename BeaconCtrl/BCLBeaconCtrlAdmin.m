@@ -11,6 +11,7 @@
 
 #import "BCLBeaconCtrlAdmin.h"
 #import "BCLAdminBackend.h"
+#import "BCLAdminBulkExecutor.h"
 
 @interface BCLBeaconCtrlAdmin ()
 
@@ -19,6 +20,8 @@
 
 @property (nonatomic, strong) BCLAdminBackend *backend;
 
+@property (nonatomic, strong) BCLAdminBulkExecutor *bulkExecutor;
+
 @end
 
 @implementation BCLBeaconCtrlAdmin
@@ -31,17 +34,23 @@
     beaconCtrlAdmin.clientSecret = clientSecret;
     
     beaconCtrlAdmin.backend = [[BCLAdminBackend alloc] initWithClientId:clientId clientSecret:clientSecret];
+    beaconCtrlAdmin.bulkExecutor = [[BCLAdminBulkExecutor alloc] initWithBackend:beaconCtrlAdmin.backend];
     
     return beaconCtrlAdmin;
 }
 
 - (void)fetchZonesAndBeacons:(void(^)(NSError *error))completion
+{
+    [self fetchZonesAndBeaconsWithBeaconsPageHandler:nil zonesPageHandler:nil completion:completion];
+}
+
+- (void)fetchZonesAndBeaconsWithBeaconsPageHandler:(void (^)(NSSet *))beaconsPageHandler zonesPageHandler:(void (^)(NSSet *))zonesPageHandler completion:(void (^)(NSError *))completion
 {
     __weak BCLBeaconCtrlAdmin *weakSelf = self;
-    [self.backend fetchBeacons:^(NSSet *beacons, NSError *error) {
+    [self.backend fetchBeaconsWithPageHandler:beaconsPageHandler completion:^(NSSet *beacons, NSError *error) {
         if (!error) {
             weakSelf.beacons = beacons;
-            [weakSelf.backend fetchZones:beacons completion:^(NSSet *zones, NSError *error) {
+            [weakSelf.backend fetchZones:beacons pageHandler:zonesPageHandler completion:^(NSSet *zones, NSError *error) {
                 if (!error) {
                     weakSelf.zones = zones;
                 }
@@ -122,6 +131,42 @@
     [self.backend deleteZone:zone completion:completion];
 }
 
+- (NSUInteger)maxConcurrentBulkOperations
+{
+    return self.bulkExecutor.maxConcurrentOperations;
+}
+
+- (void)setMaxConcurrentBulkOperations:(NSUInteger)maxConcurrentBulkOperations
+{
+    self.bulkExecutor.maxConcurrentOperations = maxConcurrentBulkOperations;
+}
+
+- (void)performBulkOperations:(NSArray *)operations completion:(void (^)(NSArray *))completion
+{
+    [self.bulkExecutor performOperations:operations completion:completion];
+}
+
+- (void)retryFailedBulkOperationsFromResults:(NSArray *)results completion:(void (^)(NSArray *))completion
+{
+    NSMutableArray *failedOperations = [NSMutableArray array];
+    NSMutableIndexSet *failedIndexes = [NSMutableIndexSet indexSet];
+
+    [results enumerateObjectsUsingBlock:^(BCLAdminBulkOperationResult *result, NSUInteger idx, BOOL *stop) {
+        if (!result.success) {
+            [failedOperations addObject:result.operation];
+            [failedIndexes addIndex:idx];
+        }
+    }];
+
+    [self.bulkExecutor performOperations:failedOperations completion:^(NSArray *retriedResults) {
+        NSMutableArray *mergedResults = [results mutableCopy];
+        [mergedResults replaceObjectsAtIndexes:failedIndexes withObjects:retriedResults];
+        if (completion) {
+            completion(mergedResults.copy);
+        }
+    }];
+}
+
 - (void)logout
 {
     [self.backend reset];
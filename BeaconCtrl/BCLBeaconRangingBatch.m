@@ -7,13 +7,15 @@
 //
 
 #import "BCLBeaconRangingBatch.h"
+#import "BCLClock.h"
 
 #define BCLRangingSecondsTimeFrame 1
 
 // timeout value since last read. After that amount of time batch is cheared out
 #define BCLRangingSecondsTimeout 120
 
-static NSDate *lastRanging;
+// Clock uptime of the last read, 0 before the first one
+static NSTimeInterval lastRangingTime;
 
 @implementation BCLBeaconRangingBatch
 
@@ -34,20 +36,21 @@ static NSDate *lastRanging;
             [self resetForRegion:region];
         }
         
-        NSTimeInterval timeIntervalSinceLastRanging = [[NSDate date] timeIntervalSinceDate:lastRanging ?: [NSDate dateWithTimeIntervalSinceReferenceDate:0]];
-        if (timeIntervalSinceLastRanging >= BCLRangingSecondsTimeout) {
+        NSTimeInterval now = [BCLClock currentClock].uptime;
+        
+        if (!lastRangingTime || now - lastRangingTime >= BCLRangingSecondsTimeout) {
             [self resetForRegion:region];
         }
         
-        lastRanging = [NSDate date];
+        lastRangingTime = MAX(now, DBL_MIN);
         
         NSArray *beaconsInBatch = self.batch[region.identifier][@"beacons"];
         
         if (beaconsInBatch.count > 0) {
             // if time elapsed from the last read is significant I assume that there was
             // break and batch is processed as new
-            NSDate *refDate = self.batch[region.identifier][@"refdate"];
-            NSTimeInterval timeInterval = [[NSDate date] timeIntervalSinceDate:refDate];
+            NSNumber *refTime = self.batch[region.identifier][@"reftime"];
+            NSTimeInterval timeInterval = now - refTime.doubleValue;
             
             // reset batch after BCLRangingSecondsTimeout
             if (timeInterval >= BCLRangingSecondsTimeout) {
@@ -57,7 +60,7 @@ static NSDate *lastRanging;
             
             // expand
             beaconsInBatch = [beaconsInBatch arrayByAddingObjectsFromArray:rangedBeacons];
-            self.batch[region.identifier] = @{@"refdate": refDate, @"beacons": beaconsInBatch};
+            self.batch[region.identifier] = @{@"reftime": refTime, @"beacons": beaconsInBatch};
 
             if (timeInterval >= BCLRangingSecondsTimeFrame) {
                 id <BCLBeaconRangingBatchDelegate> delegateStrong = self.delegate;
@@ -68,7 +71,7 @@ static NSDate *lastRanging;
             }
         } else {
             // init with ranged beacons
-            self.batch[region.identifier] = @{@"refdate": [NSDate date], @"beacons": rangedBeacons};
+            self.batch[region.identifier] = @{@"reftime": @(now), @"beacons": rangedBeacons};
             id <BCLBeaconRangingBatchDelegate> delegateStrong = self.delegate;
             if ([delegateStrong conformsToProtocol:@protocol(BCLBeaconRangingBatchDelegate)]) {
                 [delegateStrong processBeaconBatch:self beacons:rangedBeacons];
@@ -87,7 +90,7 @@ static NSDate *lastRanging;
 
 - (void) resetForRegion:(CLBeaconRegion *)region
 {
-    self.batch[region.identifier] = @{@"refdate": [NSDate date], @"beacons": [NSArray array]};
+    self.batch[region.identifier] = @{@"reftime": @([BCLClock currentClock].uptime), @"beacons": [NSArray array]};
 }
 
 @end
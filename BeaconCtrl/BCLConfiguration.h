@@ -9,6 +9,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
 #import "BCLExtension.h"
 #import "BCLEncodableObject.h"
 
@@ -23,12 +24,15 @@
 /// Fetched extensions. Set of initialized instances of objects.
 @property (strong, nonatomic, readonly) NSSet <BCLExtension> *extensions;
 
-/// Fetched beacons. A set of CTLBeacon objects
+/// Fetched beacons. A set of CTLBeacon objects. For sharded configurations, only beacons of loaded shards.
 @property (strong, nonatomic, readonly) NSSet <BCLBeacon *> *beacons;
 
-/// Fetched zones. A set of CTLZone objects
+/// Fetched zones. A set of CTLZone objects. For sharded configurations, only zones of loaded shards.
 @property (strong, nonatomic, readonly) NSSet *zones;
 
+/// YES if beacons and zones are split into per-venue shards kept on disk
+@property (nonatomic, readonly, getter=isSharded) BOOL sharded;
+
 /// Kontakt.io API key or nil if the kontakt.io add-on is not switched on
 @property (nonatomic, copy, readonly) NSString *kontaktIOAPIKey;
 
@@ -41,11 +45,58 @@
 - (instancetype) initWithJSON:(NSData *)jsonData;
 
 /*!
- * @brief Finds a class with a given name (found by calling a given selector on a class) and protocol
+ * @brief inits a BCLConfiguration object with jsonData fetched from the backend
+ * @param jsonData An NSData object that contains json with a configuration representation fetched from the backend
+ * @param error A pointer to an NSError object that will be populated with the offset and reason, if jsonData is not a valid configuration
+ * @return nil if jsonData is not a valid configuration
+ */
+- (instancetype) initWithJSON:(NSData *)jsonData error:(NSError **)error;
+
+/*!
+ * @brief Loads shards of venues near a given location, evicting the least recently used ones
+ * @param location Current location of the device
+ * @return YES if beacons and zones have changed
+ */
+- (BOOL)loadShardsNearLocation:(CLLocation *)location;
+
+/*!
+ * @brief Loads a shard that has an action with a given identifier, if it isn't loaded yet
+ * @param actionIdentifier An identifier of the action
+ * @return YES if beacons and zones have changed
+ */
+- (BOOL)loadShardContainingActionIdentifier:(NSNumber *)actionIdentifier;
+
+/*!
+ * @brief Removes shards of other, superseded configurations from disk. Call it only once this configuration has been
+ * archived, so that no archive refers to removed shards.
+ */
+- (void)removeShardsOfOtherConfigurations;
+
+/*!
+ * @brief Circular areas where the configured beacons are, whether their shards are loaded or not: one per shard and one per cluster of other beacons with a location
+ * @return An array of CLCircularRegion objects
+ */
+- (NSArray <CLCircularRegion *> *)beaconAreas;
+
+/*!
+ * @brief Finds a class with a given name (found by calling a given selector on a class) and protocol. Registered classes
+ * are found right away, other ones by scanning all classes once per protocol.
  * @param name A name of the class to find
  * @param protocol A protocol that the class needs to conform to
  * @param nameSelector A selector that will be called on a class to get its name
  */
 + (Class) classForName:(NSString *)name protocol:(Protocol *)protocol selector:(SEL)nameSelector;
 
+/*!
+ * @brief Registers an extension class under its bcl_extensionName. Should be called before the configuration is loaded.
+ * @param extensionClass A class conforming to BCLExtension
+ */
++ (void) registerExtensionClass:(Class)extensionClass;
+
+/*!
+ * @brief Registers a condition class under its bcl_conditionType. Should be called before the configuration is loaded.
+ * @param conditionClass A class conforming to BCLCondition
+ */
++ (void) registerConditionClass:(Class)conditionClass;
+
 @end
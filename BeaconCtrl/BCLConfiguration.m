@@ -10,16 +10,74 @@
 
 #import "BCLConfiguration.h"
 #import "BCLBeacon.h"
+#import "BCLLocation.h"
 #import "BCLZone.h"
 #import "BCLTrigger.h"
+#import "BCLConfigurationShard.h"
+#import "BCLConfigurationShardStore.h"
+#import "BCLClassRegistry.h"
+#import "BCLCondition.h"
+#import "BCLConfigurationDecoder.h"
 
-#import <objc/runtime.h>
+/// Smaller configurations are kept in memory as a whole
+static NSUInteger const BCLConfigurationShardingMinBeaconsCount = 100;
+
+/// Shards with geofences closer than this to the device are loaded, in meters
+static CLLocationDistance const BCLConfigurationShardLoadingRadius = 1000;
+
+/// Beacons closer than this to the first beacon of an area belong to the same area
+static CLLocationDistance const BCLConfigurationBeaconAreaClusterRadius = 250;
+
+/// Radius of an area with a single beacon
+static CLLocationDistance const BCLConfigurationBeaconAreaMinRadius = 50;
+
+/**
+ *  Beacons and zones published together. The sets are never mutated once created, so they can be read from any thread
+ *  without locking. The beacons and zones in them are still live objects updated on the main thread, they guard their
+ *  own mutable state.
+ */
+@interface BCLConfigurationSnapshot : NSObject
+
+@property (copy, nonatomic, readonly) NSSet *beacons;
+@property (copy, nonatomic, readonly) NSSet *zones;
+
+- (instancetype)initWithBeacons:(NSSet *)beacons zones:(NSSet *)zones;
+
+@end
+
+@implementation BCLConfigurationSnapshot
+
+- (instancetype)initWithBeacons:(NSSet *)beacons zones:(NSSet *)zones
+{
+    if (self = [super init]) {
+        _beacons = [beacons copy];
+        _zones = [zones copy];
+    }
+    return self;
+}
+
+@end
 
 @interface BCLConfiguration ()
 @property (strong, nonatomic, readwrite) NSSet <BCLExtension> *extensions;
 @property (strong, nonatomic, readwrite) NSSet *beacons;
 @property (strong, nonatomic, readwrite) NSSet *zones;
 @property (copy, nonatomic, readwrite) NSString *kontaktIOAPIKey;
+
+// Beacons and zones that don't belong to any shard, all of them if the configuration isn't sharded
+@property (strong, nonatomic) NSSet *residentBeacons;
+@property (strong, nonatomic) NSSet *residentZones;
+
+@property (copy, nonatomic) NSArray *shardDescriptors;
+// Name of the directory keeping shards of this configuration, so that a newer configuration never touches them
+@property (copy, nonatomic) NSString *shardsVersion;
+@property (copy, nonatomic) NSArray *loadedShards;
+@property (strong, nonatomic) BCLConfigurationShardStore *shardStore;
+
+// Replaced as a whole whenever beacons or zones change. Atomic, so that readers on other threads always get a retained,
+// complete snapshot while it's being swapped without locking. Writers replace it under @synchronized(self), so that
+// concurrent writers don't lose each other's updates.
+@property (strong) BCLConfigurationSnapshot *snapshot;
 @end
 
 @implementation BCLConfiguration
@@ -35,11 +93,165 @@
 - (instancetype) initWithJSON:(NSData *)jsonData
 {
     if (self = [self init]) {
-        [self loadFromJSON:jsonData];
+        [self loadFromJSON:jsonData error:nil];
+    }
+    return self;
+}
+
+- (instancetype) initWithJSON:(NSData *)jsonData error:(NSError **)error
+{
+    if (self = [self init]) {
+        if (![self loadFromJSON:jsonData error:error]) {
+            return nil;
+        }
     }
     return self;
 }
 
+- (instancetype)initWithCoder:(NSCoder *)aDecoder
+{
+    if (self = [super initWithCoder:aDecoder]) {
+        // Archived before configurations were sharded
+        if (!self.residentBeacons && !self.shardDescriptors) {
+            self.residentBeacons = self.beacons ?: [NSSet set];
+            self.residentZones = self.zones ?: [NSSet set];
+        }
+        
+        // Loaded shards are archived together with beacons and zones, so that the objects stay the same
+        [self.shardStore restoreLoadedShards:self.loadedShards];
+        [self updateBeaconsAndZones];
+    }
+    return self;
+}
+
+- (NSSet *)beacons
+{
+    return self.snapshot.beacons;
+}
+
+- (void)setBeacons:(NSSet *)beacons
+{
+    @synchronized(self) {
+        self.snapshot = [[BCLConfigurationSnapshot alloc] initWithBeacons:beacons zones:self.snapshot.zones];
+    }
+}
+
+- (NSSet *)zones
+{
+    return self.snapshot.zones;
+}
+
+- (void)setZones:(NSSet *)zones
+{
+    @synchronized(self) {
+        self.snapshot = [[BCLConfigurationSnapshot alloc] initWithBeacons:self.snapshot.beacons zones:zones];
+    }
+}
+
+- (BCLConfigurationShardStore *)shardStore
+{
+    if (!_shardStore) {
+        // Configurations archived before shards were versioned keep theirs right in the default directory
+        if (!self.shardsVersion && !self.shardDescriptors) {
+            self.shardsVersion = [NSUUID UUID].UUIDString;
+        }
+        
+        NSString *directoryPath = [BCLConfigurationShardStore defaultDirectoryPath];
+        if (self.shardsVersion) {
+            directoryPath = [directoryPath stringByAppendingPathComponent:self.shardsVersion];
+        }
+        _shardStore = [[BCLConfigurationShardStore alloc] initWithDirectoryPath:directoryPath];
+    }
+    return _shardStore;
+}
+
+- (void)removeShardsOfOtherConfigurations
+{
+    [BCLConfigurationShardStore removeAllShardsExceptInDirectoryPath:self.shardStore.directoryPath];
+}
+
+- (BOOL)isSharded
+{
+    return self.shardDescriptors.count > 0;
+}
+
+- (BOOL)loadShardsNearLocation:(CLLocation *)location
+{
+    if (!location || !self.isSharded) {
+        return NO;
+    }
+    
+    NSMutableDictionary *distances = [NSMutableDictionary dictionary];
+    for (BCLConfigurationShardDescriptor *descriptor in self.shardDescriptors) {
+        CLLocationDistance distance = [descriptor distanceFromLocation:location];
+        if (distance <= BCLConfigurationShardLoadingRadius) {
+            distances[descriptor.shardIdentifier] = @(distance);
+        }
+    }
+    
+    NSArray *nearDescriptors = [[self.shardDescriptors filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"shardIdentifier IN %@", distances.allKeys]] sortedArrayUsingComparator:^NSComparisonResult(BCLConfigurationShardDescriptor *descriptor1, BCLConfigurationShardDescriptor *descriptor2) {
+        return [distances[descriptor1.shardIdentifier] compare:distances[descriptor2.shardIdentifier]];
+    }];
+    
+    if (nearDescriptors.count > self.shardStore.maxLoadedShardsCount) {
+        nearDescriptors = [nearDescriptors subarrayWithRange:NSMakeRange(0, self.shardStore.maxLoadedShardsCount)];
+    }
+    
+    // The closest shard is loaded last, so that it's evicted last
+    for (BCLConfigurationShardDescriptor *descriptor in nearDescriptors.reverseObjectEnumerator) {
+        [self.shardStore shardWithDescriptor:descriptor];
+    }
+    
+    return [self updateBeaconsAndZones];
+}
+
+- (BOOL)loadShardContainingActionIdentifier:(NSNumber *)actionIdentifier
+{
+    for (BCLConfigurationShardDescriptor *descriptor in self.shardDescriptors) {
+        if ([descriptor.actionIdentifiers containsObject:actionIdentifier]) {
+            [self.shardStore shardWithDescriptor:descriptor];
+            return [self updateBeaconsAndZones];
+        }
+    }
+    
+    return NO;
+}
+
+/**
+ *  Rebuilds beacons and zones from resident ones and loaded shards. Returns YES if the set of loaded shards has changed.
+ */
+- (BOOL)updateBeaconsAndZones
+{
+    @synchronized(self) {
+        NSArray *loadedShards = self.shardStore.loadedShards;
+        BOOL didChange = ![[NSSet setWithArray:loadedShards] isEqualToSet:[NSSet setWithArray:self.loadedShards ?: @[]]];
+        self.loadedShards = loadedShards;
+        
+        BCLConfigurationSnapshot *snapshot = self.snapshot;
+        if (!didChange && snapshot.beacons && snapshot.zones) {
+            return NO;
+        }
+        
+        NSMutableSet *beacons = [NSMutableSet setWithSet:self.residentBeacons ?: [NSSet set]];
+        NSMutableSet *zones = [NSMutableSet setWithSet:self.residentZones ?: [NSSet set]];
+        for (BCLConfigurationShard *shard in loadedShards) {
+            [beacons unionSet:shard.beacons];
+            [zones unionSet:shard.zones];
+        }
+        
+        self.snapshot = [[BCLConfigurationSnapshot alloc] initWithBeacons:beacons zones:zones];
+        
+        return didChange;
+    }
+}
+
+- (NSArray *)propertiesToExcludeFromEncoding
+{
+    return @[@"shardStore",
+             @"sharded",
+             @"snapshot"];
+}
+
 - (NSSet<BCLExtension> *)extensions
 {
     if (!_extensions) {
@@ -48,19 +260,61 @@
     return _extensions;
 }
 
-- (BOOL) loadFromJSON:(NSData *)jsonData
+- (NSArray<CLCircularRegion *> *)beaconAreas
 {
-    // load json and translato to BeaconCtrl format
-    NSError *error = nil;
-    NSDictionary *configurationDictionary = nil;
-    if (jsonData) {
-        configurationDictionary = [NSJSONSerialization JSONObjectWithData:jsonData options:0 error:&error];
+    NSMutableArray *areas = [NSMutableArray arrayWithCapacity:self.shardDescriptors.count];
+    
+    for (BCLConfigurationShardDescriptor *descriptor in self.shardDescriptors) {
+        CLLocationCoordinate2D center = CLLocationCoordinate2DMake((descriptor.minLatitude + descriptor.maxLatitude) / 2, (descriptor.minLongitude + descriptor.maxLongitude) / 2);
+        CLLocation *centerLocation = [[CLLocation alloc] initWithLatitude:center.latitude longitude:center.longitude];
+        CLLocation *cornerLocation = [[CLLocation alloc] initWithLatitude:descriptor.maxLatitude longitude:descriptor.maxLongitude];
+        CLLocationDistance radius = MAX([centerLocation distanceFromLocation:cornerLocation], BCLConfigurationBeaconAreaMinRadius);
+        [areas addObject:[[CLCircularRegion alloc] initWithCenter:center radius:radius identifier:[NSString stringWithFormat:@"shard.%@", descriptor.shardIdentifier]]];
     }
-    if (error || !configurationDictionary)
+    
+    // Beacons outside of shards are clustered greedily, each cluster around its first beacon
+    NSMutableArray *clusterCenters = [NSMutableArray array];
+    NSMutableArray *clusterRadii = [NSMutableArray array];
+    
+    for (BCLBeacon *beacon in self.residentBeacons) {
+        CLLocation *location = beacon.location.location;
+        if (!location) {
+            continue;
+        }
+        
+        BOOL isClustered = NO;
+        for (NSUInteger idx = 0; idx < clusterCenters.count; idx++) {
+            CLLocationDistance distance = [clusterCenters[idx] distanceFromLocation:location];
+            if (distance <= BCLConfigurationBeaconAreaClusterRadius) {
+                clusterRadii[idx] = @(MAX([clusterRadii[idx] doubleValue], distance));
+                isClustered = YES;
+                break;
+            }
+        }
+        
+        if (!isClustered) {
+            [clusterCenters addObject:location];
+            [clusterRadii addObject:@(BCLConfigurationBeaconAreaMinRadius)];
+        }
+    }
+    
+    for (NSUInteger idx = 0; idx < clusterCenters.count; idx++) {
+        CLLocation *center = clusterCenters[idx];
+        [areas addObject:[[CLCircularRegion alloc] initWithCenter:center.coordinate radius:[clusterRadii[idx] doubleValue] identifier:[NSString stringWithFormat:@"beacons.%lu", (unsigned long)idx]]];
+    }
+    
+    return [areas copy];
+}
+
+- (BOOL) loadFromJSON:(NSData *)jsonData error:(NSError **)error
+{
+    // Decoded in a single pass, straight into model objects
+    BCLConfigurationDecoder *decoder = [[BCLConfigurationDecoder alloc] init];
+    if (!jsonData || ![decoder decodeData:jsonData error:error])
         return NO;
 
     // Load and initialize extension classess
-    NSDictionary *extensionsDictionary = configurationDictionary[@"extensions"];
+    NSDictionary *extensionsDictionary = decoder.extensionsParameters;
     if (extensionsDictionary) {
         for (NSString *extensionKey in extensionsDictionary.allKeys) {
             Class extensionClass = [BCLConfiguration classForName:extensionKey protocol:@protocol(BCLExtension) selector:@selector(bcl_extensionName)];
@@ -71,60 +325,36 @@
         }
     }
 
-    // Load beacons
-    NSMutableSet *beaconsSet = [NSMutableSet set];
-
-    for (NSDictionary *beaconDictionary in configurationDictionary[@"ranges"]) {
-        BCLBeacon *beacon = [[BCLBeacon alloc] init];
-        [beacon updatePropertiesFromDictionary:beaconDictionary];
-        [beaconsSet addObject:beacon];
-    }
-
-    // load zones
-    NSMutableSet *zonesSet = [NSMutableSet set];
+    NSSet *beaconsSet = decoder.beacons;
+    NSSet *zonesSet = decoder.zones;
     
-    for (NSDictionary *zoneDictionary in configurationDictionary[@"zones"]) {
-        BCLZone *zone = [[BCLZone alloc] init];
-        [zone updatePropertiesFromDictionary:zoneDictionary beacons:beaconsSet];
-        [zonesSet addObject:zone];
-    }
+    self.residentBeacons = [beaconsSet copy];
+    self.residentZones = [zonesSet copy];
+    self.shardDescriptors = nil;
     
-    // load triggers
-    for (NSDictionary *triggerDictionary in configurationDictionary[@"triggers"]) {
-        [triggerDictionary[@"range_ids"] enumerateObjectsUsingBlock:^(NSNumber *beaconId, NSUInteger idx, BOOL *stop) {
-            BCLTrigger *trigger = [[BCLTrigger alloc] init];
-            
-            if ([beaconId isEqual:@236]) {
-                NSLog(@"");
-            }
-            
-            NSSet *beaconSet = [beaconsSet filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"beaconIdentifier == %@", beaconId.description]];
-            for (BCLBeacon *beacon in beaconSet) {
-                trigger.beacon = beacon; //FIXME: fix strong cross reference
-                [trigger updatePropertiesFromDictionary:triggerDictionary];
-                beacon.triggers = [beacon.triggers arrayByAddingObject:trigger];
-            }
-        }];
+    if (beaconsSet.count >= BCLConfigurationShardingMinBeaconsCount) {
+        NSSet *residentBeacons;
+        NSSet *residentZones;
+        NSArray *shards = [BCLConfigurationShard shardsWithBeacons:beaconsSet zones:zonesSet residentBeacons:&residentBeacons residentZones:&residentZones];
         
-        [triggerDictionary[@"zone_ids"] enumerateObjectsUsingBlock:^(NSNumber *zoneId, NSUInteger idx, BOOL *stop) {
-            BCLTrigger *trigger = [[BCLTrigger alloc] init];
-            
-            NSSet *zoneSet = [zonesSet filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"zoneIdentifier == %@", zoneId.description]];
-            for (BCLZone *zone in zoneSet) {
-                trigger.zone = zone; //FIXME: fix strong cross reference
-                [trigger updatePropertiesFromDictionary:triggerDictionary];
-                zone.triggers = [zone.triggers arrayByAddingObject:trigger];
-            }
-        }];
+        if (shards.count > 1 && [self.shardStore storeShards:shards]) {
+            self.residentBeacons = residentBeacons;
+            self.residentZones = residentZones;
+            self.shardDescriptors = [shards valueForKey:@"descriptor"];
+        }
     }
-
     
+    if (!self.isSharded) {
+        [self.shardStore removeAllShards];
+    }
     
-    self.beacons = [beaconsSet copy];
-    self.zones = [zonesSet copy];
+    @synchronized(self) {
+        self.snapshot = nil;
+        [self updateBeaconsAndZones];
+    }
     
-    if (configurationDictionary[@"kontakt_api_key"] != [NSNull null] && ![configurationDictionary[@"kontakt_api_key"] isEqualToString:@""]) {
-        self.kontaktIOAPIKey = configurationDictionary[@"kontakt_api_key"];
+    if (decoder.kontaktIOAPIKey) {
+        self.kontaktIOAPIKey = decoder.kontaktIOAPIKey;
     }
     
     return YES;
@@ -132,28 +362,17 @@
 
 + (Class) classForName:(NSString *)name protocol:(Protocol *)protocol selector:(SEL)nameSelector
 {
-    int numberOfClasses = objc_getClassList(NULL, 0);
-    Class classList[numberOfClasses];
-    numberOfClasses = objc_getClassList(classList, numberOfClasses);
-
-    for (int idx = 0; idx < numberOfClasses; idx++)
-    {
-        Class class = classList[idx];
-        if (class_getClassMethod(class, @selector(conformsToProtocol:)) && [class conformsToProtocol:protocol])
-        {
-#ifdef DEBUG
-            NSLog(@"Found class %@ (%@)", NSStringFromClass(class), NSStringFromProtocol(protocol));
-#endif
-            Class <BCLExtension> extensionClass = class;
-            if ([class respondsToSelector:nameSelector]) {
-                NSString *identifier = [class performSelector:nameSelector];
-                if ([identifier isEqualToString:name]) {
-                    return extensionClass;
-                }
-            }
-        }
-    }
-    return nil;
+    return [[BCLClassRegistry sharedRegistry] classForName:name protocol:protocol selector:nameSelector];
+}
+
++ (void) registerExtensionClass:(Class)extensionClass
+{
+    [[BCLClassRegistry sharedRegistry] registerClass:extensionClass forName:[extensionClass bcl_extensionName] protocol:@protocol(BCLExtension)];
+}
+
++ (void) registerConditionClass:(Class)conditionClass
+{
+    [[BCLClassRegistry sharedRegistry] registerClass:conditionClass forName:[conditionClass bcl_conditionType] protocol:@protocol(BCLCondition)];
 }
 
 @end
@@ -63,6 +63,14 @@
  */
 - (BOOL) isScheduledForBeacon:(BCLBeacon *)beacon;
 
+/**
+ *  @brief When the event scheduled for a beacon is due
+ *  @param beacon A beacon that will be checked for scheduled events
+ *
+ *  @return nil if no event is scheduled for a beacon
+ */
+- (NSDate *) fireDateForBeacon:(BCLBeacon *)beacon;
+
 /*!
  * @brief Check if there's a scheduled 'enter' zone event
  * @return YES if there's any scheduled 'enter' zone event
@@ -11,6 +11,7 @@
 #import "BCLBeacon.h"
 #import "BCLZone.h"
 #import "BCLActionEventScheduler.h"
+#import "BCLClock.h"
 
 @interface BCLEventScheduler ()
 
@@ -48,8 +49,9 @@
 
         // Schedule event for delay
         __weak typeof(self)selfWeak = self;
-        NSTimer *timer = [NSTimer timerWithTimeInterval:delay target:selfWeak selector:@selector(handleBeaconTimer:) userInfo:userInfo repeats:NO];
-        [[NSRunLoop mainRunLoop] addTimer:timer forMode:NSDefaultRunLoopMode];
+        BCLClockTimer *timer = [[BCLClock currentClock] scheduleTimerWithDelay:delay queue:dispatch_get_main_queue() handler:^{
+            [selfWeak handleBeaconTimerWithUserInfo:userInfo];
+        }];
         
         [self.beaconTimers setObject:@{@"userInfo":userInfo, @"timer": timer} forKey:beacon.identifier];
     }
@@ -70,22 +72,23 @@
         
         // Schedule event for delay
         __weak typeof(self)selfWeak = self;
-        NSTimer *timer = [NSTimer timerWithTimeInterval:delay target:selfWeak selector:@selector(handleChangeZoneTimer:) userInfo:userInfo repeats:NO];
-        [[NSRunLoop mainRunLoop] addTimer:timer forMode:NSDefaultRunLoopMode];
+        BCLClockTimer *timer = [[BCLClock currentClock] scheduleTimerWithDelay:delay queue:dispatch_get_main_queue() handler:^{
+            [selfWeak handleChangeZoneTimerWithUserInfo:userInfo];
+        }];
         
         self.zoneTimers[@"changeZoneEventTimer"] = @{@"userInfo" : userInfo, @"timer" : timer};
     }
 }
 
-- (void) handleBeaconTimer:(NSTimer *)timer
+- (void) handleBeaconTimerWithUserInfo:(NSDictionary *)userInfo
 {
     @synchronized(self) {
-        void (^callback)(BCLBeacon *beacon) = [timer.userInfo objectForKey:@"callback"];
+        void (^callback)(BCLBeacon *beacon) = [userInfo objectForKey:@"callback"];
         
-        UIBackgroundTaskIdentifier timerBackgroundTaskIdentifier = [timer.userInfo[BCLActionEventSchedulerBackgroundTaskIdentifier] unsignedIntegerValue];
+        UIBackgroundTaskIdentifier timerBackgroundTaskIdentifier = [userInfo[BCLActionEventSchedulerBackgroundTaskIdentifier] unsignedIntegerValue];
         UIBackgroundTaskIdentifier newBackgroundTaskIdentifier = [[UIApplication sharedApplication] beginBackgroundTaskWithExpirationHandler:nil];
 
-        BCLBeacon *beacon = timer.userInfo[@"beacon"];
+        BCLBeacon *beacon = userInfo[@"beacon"];
         if (callback) {
             callback(beacon);
         }
@@ -109,20 +112,20 @@
     }
 }
 
-- (void) handleChangeZoneTimer:(NSTimer *)timer
+- (void) handleChangeZoneTimerWithUserInfo:(NSDictionary *)userInfo
 {
     @synchronized(self) {
-        void (^callback)(BCLZone *previousZone, BCLZone *newZone) = [timer.userInfo objectForKey:@"callback"];
+        void (^callback)(BCLZone *previousZone, BCLZone *newZone) = [userInfo objectForKey:@"callback"];
         
-        UIBackgroundTaskIdentifier timerBackgroundTaskIdentifier = [timer.userInfo[BCLActionEventSchedulerBackgroundTaskIdentifier] unsignedIntegerValue];
+        UIBackgroundTaskIdentifier timerBackgroundTaskIdentifier = [userInfo[BCLActionEventSchedulerBackgroundTaskIdentifier] unsignedIntegerValue];
         UIBackgroundTaskIdentifier newBackgroundTaskIdentifier = [[UIApplication sharedApplication] beginBackgroundTaskWithExpirationHandler:nil];
         
-        id previousZone = timer.userInfo[@"previousZone"];
+        id previousZone = userInfo[@"previousZone"];
         if (previousZone == [NSNull null]) {
             previousZone = nil;
         }
         
-        id newZone = timer.userInfo[@"newZone"];
+        id newZone = userInfo[@"newZone"];
         if (newZone == [NSNull null]) {
             newZone = nil;
         }
@@ -154,8 +157,8 @@
         
         NSDictionary *timerDict = self.beaconTimers[beacon.identifier];
         if (timerDict) {
-            NSTimer *timer = timerDict[@"timer"];
-            NSDictionary *userInfo = timerDict[@"userInfo"]; //workaround for crashin timer.userInfo
+            BCLClockTimer *timer = timerDict[@"timer"];
+            NSDictionary *userInfo = timerDict[@"userInfo"];
             
             // stop background if any
             UIBackgroundTaskIdentifier backgroundTaskIdentifier = [userInfo[BCLActionEventSchedulerBackgroundTaskIdentifier] unsignedIntegerValue];
@@ -187,8 +190,8 @@
         NSDictionary *timerDict = self.zoneTimers[@"changeZoneEventTimer"];
         
         if (timerDict) {
-            NSTimer *timer = timerDict[@"timer"];
-            NSDictionary *userInfo = timerDict[@"userInfo"]; //workaround for crashin timer.userInfo
+            BCLClockTimer *timer = timerDict[@"timer"];
+            NSDictionary *userInfo = timerDict[@"userInfo"];
             
             // stop background if any
             UIBackgroundTaskIdentifier backgroundTaskIdentifier = [userInfo[BCLActionEventSchedulerBackgroundTaskIdentifier] unsignedIntegerValue];
@@ -218,6 +221,14 @@
     }
 }
 
+- (NSDate *) fireDateForBeacon:(BCLBeacon *)beacon
+{
+    @synchronized(self) {
+        BCLClockTimer *timer = self.beaconTimers[beacon.identifier][@"timer"];
+        return [timer fireDate];
+    }
+}
+
 - (BOOL) isChangeZoneEventScheduled
 {
     @synchronized(self) {
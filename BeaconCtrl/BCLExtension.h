@@ -10,6 +10,7 @@
 
 #import <Foundation/Foundation.h>
 #import "BCLTypes.h"
+#import "BCLExtensionSubscription.h"
 
 @class BCLBeacon;
 
@@ -21,4 +22,9 @@
 
 - (void) event:(BCLEventType)eventType forBeacon:(BCLBeacon *)beacon;
 
+@optional
+
+/// Events to deliver to the extension and how to queue them. All events, queued with the default policy, if not implemented.
+- (BCLExtensionSubscription *) bcl_subscription;
+
 @end
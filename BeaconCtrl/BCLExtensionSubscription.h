@@ -0,0 +1,73 @@
+//
+//  BCLExtensionSubscription.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import "BCLTypes.h"
+
+/// Keys of per-extension event delivery metrics returned by -[BCLBeaconCtrl extensionEventMetrics]
+extern NSString * const BCLExtensionPendingEventsCountKey;
+extern NSString * const BCLExtensionDeliveredEventsCountKey;
+extern NSString * const BCLExtensionDroppedEventsCountKey;
+extern NSString * const BCLExtensionLastEventLagKey;
+extern NSString * const BCLExtensionMaxEventLagKey;
+
+/*!
+ * @typedef BCLEventTypeMask
+ * @brief A set of event types, with one bit per BCLEventType
+ */
+typedef NS_OPTIONS(NSUInteger, BCLEventTypeMask) {
+    BCLEventTypeMaskEnter = 1 << BCLEventTypeEnter,
+    BCLEventTypeMaskLeave = 1 << BCLEventTypeLeave,
+    BCLEventTypeMaskRangeImmediate = 1 << BCLEventTypeRangeImmediate,
+    BCLEventTypeMaskRangeNear = 1 << BCLEventTypeRangeNear,
+    BCLEventTypeMaskRangeFar = 1 << BCLEventTypeRangeFar,
+    BCLEventTypeMaskDwellTime = 1 << BCLEventTypeDwellTime,
+    BCLEventTypeMaskTimer = 1 << BCLEventTypeTimer,
+    BCLEventTypeMaskAll = NSUIntegerMax
+};
+
+/*!
+ * @typedef BCLExtensionOverflowPolicy
+ * @brief What happens to a new event when an extension's queue is full. Publishing never waits for an extension.
+ * @constant BCLExtensionOverflowPolicyDropOldest drops the oldest event waiting in the queue
+ * @constant BCLExtensionOverflowPolicyDropNewest keeps the queued events and fails publishing the new one
+ */
+typedef NS_ENUM(NSUInteger, BCLExtensionOverflowPolicy) {
+    BCLExtensionOverflowPolicyDropOldest,
+    BCLExtensionOverflowPolicyDropNewest
+};
+
+/*!
+ * A BCLExtensionSubscription describes which events an extension is interested in and how they're queued for it.
+ * Events are delivered asynchronously and in order, on the main queue unless another one is given. Each event carries
+ * a snapshot of the beacon taken when it was published, so it can be read on any queue.
+ */
+@interface BCLExtensionSubscription : NSObject
+
+/// Event types to deliver. Defaults to BCLEventTypeMaskAll.
+@property (nonatomic) BCLEventTypeMask eventTypes;
+
+/// Identifiers assigned by the backend of beacons to deliver events of. If neither beacons nor zones are given, events of all beacons are delivered.
+@property (nonatomic, copy) NSSet<NSString *> *beaconIdentifiers;
+
+/// Identifiers of zones whose beacons to deliver events of. An event is delivered if its beacon is one of beaconIdentifiers or belongs to one of these zones.
+@property (nonatomic, copy) NSSet<NSString *> *zoneIdentifiers;
+
+/// Maximum number of events waiting for the extension. Defaults to 64.
+@property (nonatomic) NSUInteger queueCapacity;
+
+/// Defaults to BCLExtensionOverflowPolicyDropOldest
+@property (nonatomic) BCLExtensionOverflowPolicy overflowPolicy;
+
+/// A queue to deliver events on, one at a time. Defaults to the main queue.
+@property (nonatomic, strong) dispatch_queue_t deliveryQueue;
+
+@end
@@ -0,0 +1,32 @@
+//
+//  BCLExtensionSubscription.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLExtensionSubscription.h"
+
+NSString * const BCLExtensionPendingEventsCountKey = @"BCLExtensionPendingEventsCountKey";
+NSString * const BCLExtensionDeliveredEventsCountKey = @"BCLExtensionDeliveredEventsCountKey";
+NSString * const BCLExtensionDroppedEventsCountKey = @"BCLExtensionDroppedEventsCountKey";
+NSString * const BCLExtensionLastEventLagKey = @"BCLExtensionLastEventLagKey";
+NSString * const BCLExtensionMaxEventLagKey = @"BCLExtensionMaxEventLagKey";
+
+@implementation BCLExtensionSubscription
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _eventTypes = BCLEventTypeMaskAll;
+        _queueCapacity = 64;
+        _overflowPolicy = BCLExtensionOverflowPolicyDropOldest;
+    }
+    return self;
+}
+
+@end
@@ -11,6 +11,14 @@
 @class BCLKontaktIOBeaconConfigManager;
 @class KTKBeacon;
 
+typedef NS_ENUM(NSUInteger, BCLKontaktIOBeaconUpdateState) {
+    BCLKontaktIOBeaconUpdateStateQueued,
+    BCLKontaktIOBeaconUpdateStateConnecting,
+    BCLKontaktIOBeaconUpdateStateUpdating,
+    BCLKontaktIOBeaconUpdateStateDone,
+    BCLKontaktIOBeaconUpdateStateFailed
+};
+
 @protocol BCLKontaktIOBeaconConfigManagerDelegate <NSObject>
 
 - (void)kontaktIOBeaconManagerDidFetchKontaktIOBeacons:(BCLKontaktIOBeaconConfigManager *)manager;
@@ -21,18 +29,29 @@
 - (void)kontaktIOBeaconManager:(BCLKontaktIOBeaconConfigManager *)manager isUpdatingFirmwareForBeaconWithUniqueId:(NSString *)uniqueId progress:(NSUInteger)progress;
 - (void)kontaktIOBeaconManager:(BCLKontaktIOBeaconConfigManager *)manager didFinishUpdatingFirmwareForBeaconWithUniqueId:(NSString *)uniqueId newFirwmareVersion:(NSString *)firmwareVersion success:(BOOL)success;
 
+@optional
+
+- (void)kontaktIOBeaconManager:(BCLKontaktIOBeaconConfigManager *)manager didChangeUpdateState:(BCLKontaktIOBeaconUpdateState)state forBeaconWithUniqueId:(NSString *)uniqueId;
+- (void)kontaktIOBeaconManager:(BCLKontaktIOBeaconConfigManager *)manager didUpdateBeaconsWithFinishedCount:(NSUInteger)finishedCount failedCount:(NSUInteger)failedCount totalCount:(NSUInteger)totalCount;
+
 @end
 
 @interface BCLKontaktIOBeaconConfigManager : NSObject
 
 @property (nonatomic, weak) id <BCLKontaktIOBeaconConfigManagerDelegate> delegate;
 
-@property (nonatomic, copy) NSMutableDictionary *configsToUpdate;
+@property (nonatomic, strong) NSMutableDictionary *configsToUpdate;
 
-@property (nonatomic, copy) NSMutableDictionary *firmwaresToUpdate;
+@property (nonatomic, strong) NSMutableDictionary *firmwaresToUpdate;
 
 @property (nonatomic, strong) NSMutableDictionary *kontaktBeaconsDictionary;
 
+/// Maximum number of beacons reconfigured at the same time. Defaults to 3.
+@property (nonatomic) NSUInteger maxConcurrentUpdates;
+
+/// Number of attempts made to update a single beacon before it's reported as failed. Defaults to 3.
+@property (nonatomic) NSUInteger maxUpdateAttempts;
+
 - (instancetype)initWithApiKey:(NSString *)apiKey;
 
 - (void)fetchConfiguration:(void(^)(NSError *error))completion;
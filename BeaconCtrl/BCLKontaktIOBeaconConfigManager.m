@@ -7,6 +7,7 @@
 //
 
 #import "BCLKontaktIOBeaconConfigManager.h"
+#import "BCLKontaktIODeviceUpdateEngine.h"
 #import <KontaktSDK-OLD/KTKClient.h>
 #import <KontaktSDK-OLD/KTKBluetoothManager.h>
 #import <KontaktSDK-OLD/KTKBeacon.h>
@@ -16,11 +17,62 @@
 #import <KontaktSDK-OLD/KTKPagingConfigs.h>
 #import <KontaktSDK-OLD/KTKFirmware.h>
 
-@interface BCLKontaktIOBeaconConfigManager () <KTKBluetoothManagerDelegate>
+@interface BCLKontaktIOBeaconDevice : NSObject <BCLKontaktIODevice>
+
+@property (nonatomic, strong, readonly) KTKBeaconDevice *beaconDevice;
+@property (nonatomic, copy) NSString *masterPassword;
+
+- (instancetype)initWithBeaconDevice:(KTKBeaconDevice *)beaconDevice;
+
+@end
+
+@implementation BCLKontaktIOBeaconDevice
+
+- (instancetype)initWithBeaconDevice:(KTKBeaconDevice *)beaconDevice
+{
+    if (self = [super init]) {
+        _beaconDevice = beaconDevice;
+    }
+    return self;
+}
+
+- (NSString *)uniqueID
+{
+    return self.beaconDevice.uniqueID;
+}
+
+- (NSNumber *)RSSI
+{
+    return self.beaconDevice.RSSI;
+}
+
+- (NSUInteger)batteryLevel
+{
+    return self.beaconDevice.batteryLevel;
+}
+
+- (BOOL)connectWithPassword:(NSString *)password error:(NSError **)error
+{
+    NSError *connectError;
+    BOOL success = [self.beaconDevice connectWithPassword:password andError:&connectError];
+    if (!success && error) {
+        *error = connectError;
+    }
+    return success;
+}
+
+- (void)disconnect
+{
+    [self.beaconDevice disconnect];
+}
+
+@end
+
+@interface BCLKontaktIOBeaconConfigManager () <KTKBluetoothManagerDelegate, BCLKontaktIODeviceUpdateEngineDelegate>
 
 @property (nonatomic, strong) KTKClient *kontaktClient;
 @property (nonatomic, strong) KTKBluetoothManager *kontaktBluetoothManager;
-@property (nonatomic) BOOL isUpdatingBeacons;
+@property (nonatomic, strong) BCLKontaktIODeviceUpdateEngine *updateEngine;
 
 @end
 
@@ -36,6 +88,9 @@
         _kontaktBluetoothManager.delegate = self;
         
         _configsToUpdate = @{}.mutableCopy;
+
+        _updateEngine = [BCLKontaktIODeviceUpdateEngine new];
+        _updateEngine.delegate = self;
     }
     
     return self;
@@ -54,9 +109,11 @@
         return;
     }
     
-    [configsToChangeArray enumerateObjectsUsingBlock:^(KTKBeacon *beacon, NSUInteger idx, BOOL *stop) {
-        self.configsToUpdate[beacon.uniqueID] = beacon;
-    }];
+    @synchronized(self) {
+        [configsToChangeArray enumerateObjectsUsingBlock:^(KTKBeacon *beacon, NSUInteger idx, BOOL *stop) {
+            self.configsToUpdate[beacon.uniqueID] = beacon;
+        }];
+    }
     
     NSArray *kontaktBeacons = [self.kontaktClient beaconsPaged:[[KTKPagingBeacons alloc] initWithIndexStart:0 andMaxResults:1000] withError:&error];
     
@@ -78,7 +135,10 @@
     self.kontaktBeaconsDictionary = kontaktBeaconsDictionary;
     
     NSError *firmareUpdatesError;
-    self.firmwaresToUpdate = [self.kontaktClient firmwaresLatestForBeaconsUniqueIds:kontaktBeaconsUniqueIds.copy withError:&firmareUpdatesError].mutableCopy;
+    NSMutableDictionary *firmwaresToUpdate = [self.kontaktClient firmwaresLatestForBeaconsUniqueIds:kontaktBeaconsUniqueIds.copy withError:&firmareUpdatesError].mutableCopy;
+    @synchronized(self) {
+        self.firmwaresToUpdate = firmwaresToUpdate;
+    }
     
     if (firmareUpdatesError) {
         if (completion) {
@@ -94,6 +154,26 @@
     }
 }
 
+- (NSUInteger)maxConcurrentUpdates
+{
+    return self.updateEngine.maxConcurrentUpdates;
+}
+
+- (void)setMaxConcurrentUpdates:(NSUInteger)maxConcurrentUpdates
+{
+    self.updateEngine.maxConcurrentUpdates = maxConcurrentUpdates;
+}
+
+- (NSUInteger)maxUpdateAttempts
+{
+    return self.updateEngine.maxAttempts;
+}
+
+- (void)setMaxUpdateAttempts:(NSUInteger)maxUpdateAttempts
+{
+    self.updateEngine.maxAttempts = maxUpdateAttempts;
+}
+
 - (void)startManagement
 {
     [self.kontaktBluetoothManager startFindingDevices];
@@ -135,53 +215,85 @@
 - (void)bluetoothManager:(KTKBluetoothManager *)bluetoothManager didChangeDevices:(NSSet *)devices
 {
     NSLog(@"Kontakt.io bluetooth manager did change devices: %@", devices);
-    if (self.isUpdatingBeacons) {
-        return;
-    }
-    
     [self.delegate kontaktIOBeaconManager:self didMonitorBeaconDevices:[devices allObjects]];
     [self updateKontaktBeaconDevices:devices];
 }
 
+#pragma mark - BCLKontaktIODeviceUpdateEngineDelegate
+
+- (BOOL)updateEngine:(BCLKontaktIODeviceUpdateEngine *)engine connectDevice:(id<BCLKontaktIODevice>)device error:(NSError **)error
+{
+    NSLog(@"Trying update kontakt.io beacon with uniqueId %@", device.uniqueID);
+    NSString *password;
+    NSString *masterPassword;
+    KTKError *passwordError;
+    [self.kontaktClient beaconPassword:&password andMasterPassword:&masterPassword byUniqueId:device.uniqueID withError:&passwordError];
+    if (passwordError) {
+        if (error) {
+            *error = passwordError;
+        }
+        return NO;
+    }
+
+    if ([device isKindOfClass:[BCLKontaktIOBeaconDevice class]]) {
+        ((BCLKontaktIOBeaconDevice *)device).masterPassword = masterPassword;
+    }
+    return [device connectWithPassword:password error:error];
+}
+
+- (BOOL)updateEngine:(BCLKontaktIODeviceUpdateEngine *)engine updateDevice:(id<BCLKontaktIODevice>)device error:(NSError **)error
+{
+    if (![device isKindOfClass:[BCLKontaktIOBeaconDevice class]]) {
+        return NO;
+    }
+    BCLKontaktIOBeaconDevice *kontaktDevice = (BCLKontaktIOBeaconDevice *)device;
+
+    KTKBeacon *newConfig;
+    KTKFirmware *newFirmware;
+    @synchronized(self) {
+        newConfig = self.configsToUpdate[device.uniqueID];
+        newFirmware = self.firmwaresToUpdate[device.uniqueID];
+    }
+
+    if (newConfig && ![self updateKontaktBeaconDevice:kontaktDevice.beaconDevice withNewConfig:newConfig error:error]) {
+        return NO;
+    }
+
+    if (newFirmware && ![self updateFirmwareForKontaktBeaconDevice:kontaktDevice.beaconDevice masterPassword:kontaktDevice.masterPassword newFirmware:newFirmware error:error]) {
+        return NO;
+    }
+
+    return YES;
+}
+
+- (void)updateEngine:(BCLKontaktIODeviceUpdateEngine *)engine device:(id<BCLKontaktIODevice>)device didChangeState:(BCLKontaktIOBeaconUpdateState)state
+{
+    if ([self.delegate respondsToSelector:@selector(kontaktIOBeaconManager:didChangeUpdateState:forBeaconWithUniqueId:)]) {
+        [self.delegate kontaktIOBeaconManager:self didChangeUpdateState:state forBeaconWithUniqueId:device.uniqueID];
+    }
+}
+
+- (void)updateEngine:(BCLKontaktIODeviceUpdateEngine *)engine didUpdateProgressWithFinishedCount:(NSUInteger)finishedCount failedCount:(NSUInteger)failedCount totalCount:(NSUInteger)totalCount
+{
+    if ([self.delegate respondsToSelector:@selector(kontaktIOBeaconManager:didUpdateBeaconsWithFinishedCount:failedCount:totalCount:)]) {
+        [self.delegate kontaktIOBeaconManager:self didUpdateBeaconsWithFinishedCount:finishedCount failedCount:failedCount totalCount:totalCount];
+    }
+}
+
 #pragma mark - Private
 
 - (void)updateKontaktBeaconDevices:(NSSet *)devices
 {
-    self.isUpdatingBeacons = YES;
-    dispatch_async(dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0), ^() {
-        [devices enumerateObjectsUsingBlock:^(KTKBeaconDevice *beacon, BOOL *stop) {
-            if ([self.configsToUpdate.allKeys containsObject:beacon.uniqueID] || [self.firmwaresToUpdate.allKeys containsObject:beacon.uniqueID]) {
-                NSLog(@"Trying update kontakt.io beacon with uniqueId %@", beacon.uniqueID);
-                NSString *password;
-                NSString *masterPassword;
-                KTKError *error;
-                [self.kontaktClient beaconPassword:&password andMasterPassword:&masterPassword byUniqueId:beacon.uniqueID withError:&error];
-                if (error) {
-                    return;
-                }
-                
-                if ([self.configsToUpdate.allKeys containsObject:beacon.uniqueID]) {
-                    if ([beacon connectWithPassword:password andError:&error]) {
-                        KTKBeacon *newConfig = self.configsToUpdate[beacon.uniqueID];
-                        NSError *updateError;
-                        [self updateKontaktBeaconDevice:beacon withNewConfig:newConfig error:&updateError];
-                        [beacon disconnect];
-                    }
-                }
-                
-                if ([self.firmwaresToUpdate.allKeys containsObject:beacon.uniqueID]) {
-                    KTKFirmware *newFirmware = self.firmwaresToUpdate[beacon.uniqueID];
-                    if ([beacon connectWithPassword:password andError:&error]) {
-                        NSError *firmwareUpdateError;
-                        [self updateFirmwareForKontaktBeaconDevice:beacon masterPassword:masterPassword newFirmware:newFirmware error:&firmwareUpdateError];
-                        [beacon disconnect];
-                    }
-                }
+    NSMutableArray *devicesToUpdate = [NSMutableArray array];
+    @synchronized(self) {
+        for (KTKBeaconDevice *beacon in devices) {
+            if (beacon.uniqueID && (self.configsToUpdate[beacon.uniqueID] || self.firmwaresToUpdate[beacon.uniqueID])) {
+                [devicesToUpdate addObject:[[BCLKontaktIOBeaconDevice alloc] initWithBeaconDevice:beacon]];
             }
-        }];
+        }
+    }
 
-        self.isUpdatingBeacons = NO;
-    });
+    [self.updateEngine enqueueDevices:devicesToUpdate];
 }
 
 - (BOOL)updateFirmwareForKontaktBeaconDevice:(KTKBeaconDevice *)beaconDevice masterPassword:(NSString *)masterPassword newFirmware:(KTKFirmware *)newFirmware error:(NSError **)error
@@ -223,7 +335,7 @@
         return NO;
     }
     
-    if (self.firmwaresToUpdate[beaconDevice.uniqueID]) {
+    @synchronized(self) {
         [self.firmwaresToUpdate removeObjectForKey:beaconDevice.uniqueID];
     }
     
@@ -306,8 +418,10 @@
         if (!success) {
             *error = updateError;
             NSLog(@"There was an error while trying to update a kontakt.io beacon in kontakt.io panel: %@", updateError);
-        } else if (self.configsToUpdate[beaconDevice.uniqueID]) {
-            [self.configsToUpdate removeObjectForKey:beaconDevice.uniqueID];
+        } else {
+            @synchronized(self) {
+                [self.configsToUpdate removeObjectForKey:beaconDevice.uniqueID];
+            }
         }
     }
     
@@ -67,6 +67,13 @@
     }
 }
 
+- (void)setTriggers:(NSArray *)triggers
+{
+    @synchronized(self) {
+        _triggers = triggers;
+    }
+}
+
 #pragma mark - NSCopying
 
 - (id)copyWithZone:(NSZone *)zone
@@ -12,24 +12,21 @@
 
 - (NSString *) bcl_identifier
 {
-    @synchronized(self) {
-        // Build identifier
-        
-        NSMutableArray *arr = [NSMutableArray arrayWithCapacity:3];
-        if (self.proximityUUID) {
-            [arr addObject:self.proximityUUID.UUIDString];
-        }
-        
-        if (self.major) {
-            [arr addObject:self.major];
-        }
-        
-        if (self.minor) {
-            [arr addObject:self.minor];
-        }
-        
-        return [arr componentsJoinedByString:@"+"];
+    // CLBeacon is immutable, no locking needed
+    NSMutableArray *arr = [NSMutableArray arrayWithCapacity:3];
+    if (self.proximityUUID) {
+        [arr addObject:self.proximityUUID.UUIDString];
     }
+    
+    if (self.major) {
+        [arr addObject:self.major];
+    }
+    
+    if (self.minor) {
+        [arr addObject:self.minor];
+    }
+    
+    return [arr componentsJoinedByString:@"+"];
 }
 
 @end
@@ -39,6 +39,8 @@
         return YES;
     } else if ((eventType == BCLEventTypeRangeImmediate) && [self.eventType isEqualToString:@"immediate"]) {
         return YES;
+    } else if ((eventType == BCLEventTypeDwellTime) && [self.eventType isEqualToString:@"dwell_time"]) {
+        return YES;
     }
     return NO;
 }
@@ -49,6 +51,8 @@
         return YES;
     } else if ((eventType == BCLEventTypeLeave) && [self.eventType isEqualToString:@"leave"]) {
         return YES;
+    } else if ((eventType == BCLEventTypeDwellTime) && [self.eventType isEqualToString:@"dwell_time"]) {
+        return YES;
     }
     
     return NO;
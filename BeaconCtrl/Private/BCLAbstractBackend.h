@@ -11,6 +11,7 @@
 
 #import <Foundation/Foundation.h>
 #import "UNCoding.h"
+#import "BCLHTTPTransport.h"
 
 @interface BCLAbstractBackend : NSObject <UNCoding>
 
@@ -24,7 +25,24 @@
 + (NSString *) baseURLString;
 + (NSString *) authenticationURLString;
 
+/// Sends requests of all backends, queued by priority
+- (BCLHTTPTransport *) transport;
+
 - (void) setupURLRequest:(NSMutableURLRequest *)mutableRequest;
+
+/**
+ *  An authorized request accepting JSON, with a body serialized from a JSON object if there is one
+ */
+- (NSMutableURLRequest *) JSONRequestWithURLString:(NSString *)urlString method:(NSString *)method body:(id)body;
+
+/**
+ *  Sends a JSON request and parses the response. Called back on a background queue.
+ *  @param retry Called instead of the completion once a new token is fetched after a 401, or nil if a 401 is an error
+ *  @param completion Called with the parsed response, nil if it's empty, or with an error if the request failed,
+ *  the status isn't a success or the response isn't valid JSON
+ */
+- (void) sendJSONRequestWithURLString:(NSString *)urlString method:(NSString *)method body:(id)body priority:(BCLHTTPRequestPriority)priority retry:(void (^)(void))retry completion:(void (^)(id responseObject, NSHTTPURLResponse *response, NSError *error))completion;
+
 - (BOOL)shouldFurtherProcessResponse:(NSURLResponse *)response completion:(void(^)(NSError *error))completion;
 - (BOOL) retrySelector:(SEL)selector sender:(id)sender parameters:(NSArray *)parameters;
 - (void) refetchToken:(void(^)(NSString *token, NSError *error))completion;
@@ -77,6 +77,11 @@
     }
 }
 
+- (BCLHTTPTransport *)transport
+{
+    return [BCLHTTPTransport sharedTransport];
+}
+
 - (void) setupURLRequest:(NSMutableURLRequest *)mutableRequest
 {
     if (self.accessToken) {
@@ -84,6 +89,65 @@
     }
 }
 
+- (NSMutableURLRequest *) JSONRequestWithURLString:(NSString *)urlString method:(NSString *)method body:(id)body
+{
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
+    [self setupURLRequest:request];
+    request.HTTPMethod = method ?: @"GET";
+    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
+    
+    if (body) {
+        [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
+        request.HTTPBody = [NSJSONSerialization dataWithJSONObject:body options:0 error:nil];
+    }
+    
+    return request;
+}
+
+- (void) sendJSONRequestWithURLString:(NSString *)urlString method:(NSString *)method body:(id)body priority:(BCLHTTPRequestPriority)priority retry:(void (^)(void))retry completion:(void (^)(id, NSHTTPURLResponse *, NSError *))completion
+{
+    NSMutableURLRequest *request = [self JSONRequestWithURLString:urlString method:method body:body];
+    
+    [self.transport sendRequest:request priority:priority completion:^(NSData *data, NSURLResponse *response, NSError *error) {
+        NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
+        
+        if (retry && [self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
+            if (processingError) {
+                if (completion) completion(nil, httpResponse, processingError);
+                return;
+            }
+            
+            retry();
+        }]) {
+            return;
+        }
+        
+        NSError *jsonError = nil;
+        id responseObject = nil;
+        if (data.length) {
+            responseObject = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
+        }
+        
+        if (error || ![httpResponse isSuccess]) {
+            if (completion) {
+                completion(nil, httpResponse, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description], @"BCLResponseDictionaryKey": responseObject ? : [NSNull null]}]);
+            }
+            return;
+        }
+        
+        if (!responseObject && jsonError) {
+            if (completion) {
+                completion(nil, httpResponse, jsonError);
+            }
+            return;
+        }
+        
+        if (completion) {
+            completion(responseObject, httpResponse, nil);
+        }
+    }];
+}
+
 - (NSDictionary *)authenticationParameters
 {
     NSAssert(NO, @"This method needs to be implemented in a subclass");
@@ -103,59 +167,28 @@
 
 - (void) refetchToken:(void(^)(NSString *token, NSError *error))completion
 {
-    NSString *urlString = [[self class] authenticationURLString];
-    
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"POST";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
-    
     NSDictionary *params = [self authenticationParameters];
     
-    [request setHTTPBody:[NSJSONSerialization dataWithJSONObject:[params copy] options:0 error:nil]];
-    
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description], @"BCLResponseDictionaryKey": responseDictionary ? : [NSNull null]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      NSString *accessToken = responseDictionary[@"access_token"];
-                                      
-                                      if (!accessToken && completion) {
-                                          completion(nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidDataErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Unable to fetch token"}]);
-                                      }
-                                      
-                                      self.accessToken = accessToken;
-                                      
-                                      if (completion) {
-                                          completion(self.accessToken, nil);
-                                      }
-                                  }];
-    
-    [task resume];
+    [self sendJSONRequestWithURLString:[[self class] authenticationURLString] method:@"POST" body:params priority:BCLHTTPRequestPriorityToken retry:nil completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(nil, error);
+            }
+            return;
+        }
+        
+        NSString *accessToken = responseDictionary[@"access_token"];
+        
+        if (!accessToken && completion) {
+            completion(nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidDataErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Unable to fetch token"}]);
+        }
+        
+        self.accessToken = accessToken;
+        
+        if (completion) {
+            completion(self.accessToken, nil);
+        }
+    }];
 }
 
 - (BOOL)shouldFurtherProcessResponse:(NSURLResponse *)response completion:(void(^)(NSError *error))completion
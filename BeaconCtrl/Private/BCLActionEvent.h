@@ -23,8 +23,20 @@
 @property (strong) NSString *actionName;
 @property (nonatomic) BCLEventType eventType;
 
+/// Number of events this one stands for after coalescing, 1 for a single event
+@property (assign) NSUInteger count;
+/// Timestamps of the first and the last coalesced event, both equal to timestamp for a single event
+@property (assign) NSTimeInterval firstTimestamp;
+@property (assign) NSTimeInterval lastTimestamp;
+
+/// Position in the upload outbox, 0 until the event is stored
+@property (assign) NSUInteger sequenceNumber;
+
 - (NSString *) eventTypeName;
 
+/// The event as uploaded to the backend
+- (NSDictionary *) payloadDictionary;
+
 @end
 
 
@@ -11,6 +11,7 @@
 
 #import "BCLActionEvent.h"
 #import "BCLActionEventScheduler.h"
+#import "BCLClock.h"
 #import <UNCodingUtil.h>
 
 @implementation BCLActionEvent
@@ -19,7 +20,10 @@
 {
     if (self = [super init]) {
         _identifier = [[NSUUID UUID] UUIDString];
-        _timestamp = [[NSDate date] timeIntervalSince1970];
+        _timestamp = [BCLClock currentClock].timeIntervalSince1970;
+        _count = 1;
+        _firstTimestamp = _timestamp;
+        _lastTimestamp = _timestamp;
     }
     return self;
 }
@@ -54,6 +58,48 @@
     }
 }
 
+- (NSDictionary *)payloadDictionary
+{
+    NSMutableDictionary *eventDict = [@{@"timestamp": @(self.timestamp)} mutableCopy];
+
+    // Lets the backend drop events it has already accepted when a batch is retried
+    if (self.identifier) {
+        eventDict[@"id"] = self.identifier;
+    }
+
+    if (self.sequenceNumber) {
+        eventDict[@"sequence_number"] = @(self.sequenceNumber);
+    }
+
+    if (self.beaconIdentifier) {
+        eventDict[@"range_id"] = self.beaconIdentifier;
+    }
+
+    if (self.zoneIdentifier) {
+        eventDict[@"zone_id"] = self.zoneIdentifier;
+    }
+
+    if (self.eventTypeName) {
+        eventDict[@"event_type"] = self.eventTypeName;
+    }
+
+    if (self.actionName) {
+        eventDict[@"action_name"] = self.actionName;
+    }
+
+    if (self.actionIdentifier) {
+        eventDict[@"action_id"] = self.actionIdentifier;
+    }
+
+    if (self.count > 1) {
+        eventDict[@"count"] = @(self.count);
+        eventDict[@"first_timestamp"] = @(self.firstTimestamp);
+        eventDict[@"last_timestamp"] = @(self.lastTimestamp);
+    }
+
+    return [eventDict copy];
+}
+
 - (NSString *)description
 {
     return [NSString stringWithFormat:@"Action Event: type: %@ - beacon_id: %@ - zone_id: %@ - timestamp: %f ", self.eventTypeName, self.beaconIdentifier, self.zoneIdentifier, self.timestamp];
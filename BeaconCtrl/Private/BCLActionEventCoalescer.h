@@ -0,0 +1,50 @@
+//
+//  BCLActionEventCoalescer.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BCLActionEvent;
+
+/**
+ *  Sits between event generation and BCLActionEventScheduler and collapses flapping:
+ *  a leave is held back for the coalescing interval and dropped together with an enter of the same beacon or zone
+ *  that follows it, and repeated range events of the same type are merged. A flushed leave stands for count leaves and
+ *  count - 1 enters suppressed between them; a flushed range event stands for count identical range events.
+ *  Enter events are passed through right away.
+ */
+@interface BCLActionEventCoalescer : NSObject
+
+/// How long leave and range events are held back, in seconds. 0 passes all events through. Defaults to 30 seconds.
+@property (nonatomic) NSTimeInterval interval;
+
+/// Number of events added so far
+@property (readonly) NSUInteger receivedEventsCount;
+
+/// Number of events handed over to the event handler so far
+@property (readonly) NSUInteger flushedEventsCount;
+
+/// Fraction of added events that didn't reach the event handler, between 0 and 1
+@property (readonly) double suppressionRatio;
+
+/**
+ *  @param eventHandler called on the main queue with every event that should be stored
+ */
+- (instancetype)initWithEventHandler:(void (^)(BCLActionEvent *event))eventHandler;
+
+- (void)addEvent:(BCLActionEvent *)event;
+
+/**
+ *  Hands over all held back events, and the ones still on their way to the main queue, before returning.
+ *  Called on the main queue when monitoring stops and when the app is about to terminate, so that no leave is lost.
+ */
+- (void)flush;
+
+@end
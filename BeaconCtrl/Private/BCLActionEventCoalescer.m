@@ -0,0 +1,268 @@
+//
+//  BCLActionEventCoalescer.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLActionEventCoalescer.h"
+#import "BCLClock.h"
+#import "BCLActionEvent.h"
+#import <UIKit/UIKit.h>
+
+static NSTimeInterval const BCLActionEventCoalescerDefaultInterval = 30;
+
+@interface BCLActionEventCoalescerEntry : NSObject
+
+/// Leave or range event waiting for the interval to pass
+@property (nonatomic, strong) BCLActionEvent *pendingEvent;
+
+/// Leaves dropped together with an enter that followed them
+@property (nonatomic) NSUInteger suppressedLeavesCount;
+@property (nonatomic) NSTimeInterval firstSuppressedLeaveTimestamp;
+
+@end
+
+@implementation BCLActionEventCoalescerEntry
+
+@end
+
+@interface BCLActionEventCoalescer ()
+
+@property (nonatomic, copy) void (^eventHandler)(BCLActionEvent *event);
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) NSMutableDictionary *entries;
+// Events released by the coalescer that the main queue hasn't handed over yet, in order
+@property (nonatomic, strong) NSMutableArray *undeliveredEvents;
+
+@property (readwrite) NSUInteger receivedEventsCount;
+@property (readwrite) NSUInteger flushedEventsCount;
+
+@end
+
+@implementation BCLActionEventCoalescer
+
+- (instancetype)initWithEventHandler:(void (^)(BCLActionEvent *))eventHandler
+{
+    if (self = [super init]) {
+        _eventHandler = [eventHandler copy];
+        _interval = BCLActionEventCoalescerDefaultInterval;
+        _queue = dispatch_queue_create("com.up-next.BeaconCtrl.events.coalescer", DISPATCH_QUEUE_SERIAL);
+        _entries = [NSMutableDictionary dictionary];
+        _undeliveredEvents = [NSMutableArray array];
+
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(flush) name:UIApplicationWillTerminateNotification object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (double)suppressionRatio
+{
+    NSUInteger receivedEventsCount = self.receivedEventsCount;
+    if (!receivedEventsCount) {
+        return 0;
+    }
+    return 1.0 - (double)self.flushedEventsCount / receivedEventsCount;
+}
+
+- (void)addEvent:(BCLActionEvent *)event
+{
+    dispatch_async(self.queue, ^{
+        self.receivedEventsCount++;
+
+        NSString *key = [self keyForEvent:event];
+        if (self.interval <= 0 || !key) {
+            [self deliverEvent:event];
+            return;
+        }
+
+        switch (event.eventType) {
+            case BCLEventTypeEnter:
+                [self addEnterEvent:event forKey:key];
+                break;
+            case BCLEventTypeLeave:
+                [self addLeaveEvent:event forKey:key];
+                break;
+            default:
+                [self addRangeEvent:event forKey:key];
+                break;
+        }
+    });
+}
+
+- (void)flush
+{
+    NSAssert([NSThread isMainThread], @"Events are handed over on the main queue");
+
+    dispatch_sync(self.queue, ^{
+        NSMutableArray *pendingEvents = [NSMutableArray array];
+        for (BCLActionEventCoalescerEntry *entry in self.entries.allValues) {
+            if (entry.pendingEvent) {
+                [pendingEvents addObject:entry.pendingEvent];
+            }
+        }
+        [self.entries removeAllObjects];
+
+        [pendingEvents sortUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"timestamp" ascending:YES]]];
+        for (BCLActionEvent *event in pendingEvents) {
+            [self deliverEvent:event];
+        }
+    });
+
+    [self handOverUndeliveredEvents];
+}
+
+#pragma mark - Private
+
+/**
+ *  Enters and leaves of a beacon or a zone share a key, as do all range events of it. Events of actions and dwell time
+ *  events are never coalesced.
+ */
+- (NSString *)keyForEvent:(BCLActionEvent *)event
+{
+    if (event.actionIdentifier) {
+        return nil;
+    }
+
+    switch (event.eventType) {
+        case BCLEventTypeEnter:
+        case BCLEventTypeLeave:
+            return [NSString stringWithFormat:@"presence+%@+%@", event.beaconIdentifier, event.zoneIdentifier];
+        case BCLEventTypeRangeImmediate:
+        case BCLEventTypeRangeNear:
+        case BCLEventTypeRangeFar:
+            return [NSString stringWithFormat:@"range+%@+%@", event.beaconIdentifier, event.zoneIdentifier];
+        default:
+            return nil;
+    }
+}
+
+- (void)addEnterEvent:(BCLActionEvent *)event forKey:(NSString *)key
+{
+    BCLActionEventCoalescerEntry *entry = self.entries[key];
+    BCLActionEvent *pendingLeave = entry.pendingEvent;
+
+    if (!pendingLeave) {
+        [self deliverEvent:event];
+        return;
+    }
+
+    // Left and came back within the interval - neither the leave nor this enter is stored
+    entry.suppressedLeavesCount = pendingLeave.count;
+    entry.firstSuppressedLeaveTimestamp = pendingLeave.firstTimestamp;
+    entry.pendingEvent = nil;
+}
+
+- (void)addLeaveEvent:(BCLActionEvent *)event forKey:(NSString *)key
+{
+    BCLActionEventCoalescerEntry *entry = self.entries[key];
+    if (!entry) {
+        entry = [BCLActionEventCoalescerEntry new];
+        self.entries[key] = entry;
+    }
+
+    if (entry.pendingEvent) {
+        [self mergeEvent:event intoEvent:entry.pendingEvent];
+        return;
+    }
+
+    if (entry.suppressedLeavesCount) {
+        event.count = entry.suppressedLeavesCount + 1;
+        event.firstTimestamp = entry.firstSuppressedLeaveTimestamp;
+    }
+
+    entry.pendingEvent = event;
+    [self scheduleFlushOfEvent:event forKey:key];
+}
+
+- (void)addRangeEvent:(BCLActionEvent *)event forKey:(NSString *)key
+{
+    BCLActionEventCoalescerEntry *entry = self.entries[key];
+
+    if (entry.pendingEvent.eventType == event.eventType) {
+        [self mergeEvent:event intoEvent:entry.pendingEvent];
+        return;
+    }
+
+    if (entry.pendingEvent) {
+        [self deliverEvent:entry.pendingEvent];
+    } else {
+        entry = [BCLActionEventCoalescerEntry new];
+        self.entries[key] = entry;
+    }
+
+    entry.pendingEvent = event;
+    [self scheduleFlushOfEvent:event forKey:key];
+}
+
+- (void)mergeEvent:(BCLActionEvent *)event intoEvent:(BCLActionEvent *)pendingEvent
+{
+    pendingEvent.count += event.count;
+    pendingEvent.lastTimestamp = MAX(pendingEvent.lastTimestamp, event.lastTimestamp);
+}
+
+/**
+ *  The interval is counted from the first event, so merging further events doesn't postpone the flush
+ */
+- (void)scheduleFlushOfEvent:(BCLActionEvent *)event forKey:(NSString *)key
+{
+    __weak typeof(self) weakSelf = self;
+    [[BCLClock currentClock] scheduleTimerWithDelay:self.interval queue:self.queue handler:^{
+        BCLActionEventCoalescerEntry *entry = weakSelf.entries[key];
+        // The event might have been already flushed or dropped by an enter
+        if (!entry || entry.pendingEvent != event) {
+            return;
+        }
+
+        [weakSelf.entries removeObjectForKey:key];
+        [weakSelf deliverEvent:event];
+    }];
+}
+
+- (void)deliverEvent:(BCLActionEvent *)event
+{
+    self.flushedEventsCount++;
+
+#ifdef DEBUG
+    if (event.count > 1) {
+        NSLog(@"Coalesced %lu events into %@, suppression ratio: %f", (unsigned long)event.count, event, self.suppressionRatio);
+    }
+#endif
+
+    [self.undeliveredEvents addObject:event];
+
+    __weak typeof(self) weakSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [weakSelf handOverUndeliveredEvents];
+    });
+}
+
+/**
+ *  Called on the main queue. Events flushed synchronously are handed over before those still waiting for the main queue
+ *  would be, so the latter are taken here as well to keep the order.
+ */
+- (void)handOverUndeliveredEvents
+{
+    __block NSArray *events;
+    dispatch_sync(self.queue, ^{
+        events = [self.undeliveredEvents copy];
+        [self.undeliveredEvents removeAllObjects];
+    });
+
+    for (BCLActionEvent *event in events) {
+        if (self.eventHandler) {
+            self.eventHandler(event);
+        }
+    }
+}
+
+@end
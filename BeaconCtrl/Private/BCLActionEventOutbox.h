@@ -0,0 +1,62 @@
+//
+//  BCLActionEventOutbox.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BCLActionEvent, SAMCache;
+
+/**
+ *  Events taken out of the outbox to be uploaded together
+ */
+@interface BCLActionEventOutboxBatch : NSObject
+
+@property (nonatomic, copy, readonly) NSArray *events;
+@property (nonatomic, copy, readonly) NSIndexSet *sequenceNumbers;
+
+@end
+
+/**
+ *  Persistent queue of action events waiting to be uploaded. Every event gets a monotonic sequence number when it's
+ *  appended. Several batches can be uploaded at the same time; only events of acknowledged batches are removed, so
+ *  events appended while uploading are kept and failed batches are retried later.
+ *  Not thread safe, has to be used from a single serial queue.
+ */
+@interface BCLActionEventOutbox : NSObject
+
+/// Defaults to 50
+@property (nonatomic) NSUInteger maxBatchSize;
+
+/// Defaults to 3
+@property (nonatomic) NSUInteger maxInFlightBatchesCount;
+
+/// Events that are neither acknowledged nor being uploaded
+@property (nonatomic, readonly) NSUInteger pendingEventsCount;
+
+- (instancetype)initWithCache:(SAMCache *)cache eventsKey:(NSString *)eventsKey;
+
+- (void)appendEvent:(BCLActionEvent *)event;
+
+/**
+ *  Takes the oldest pending events out of the outbox, nil if there are none or too many batches are already in flight
+ */
+- (BCLActionEventOutboxBatch *)dequeueBatch;
+
+/**
+ *  Removes events of a batch that has been uploaded
+ */
+- (void)acknowledgeBatch:(BCLActionEventOutboxBatch *)batch;
+
+/**
+ *  Puts events of a batch that failed to upload back to the pending ones
+ */
+- (void)releaseBatch:(BCLActionEventOutboxBatch *)batch;
+
+@end
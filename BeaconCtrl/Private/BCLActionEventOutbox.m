@@ -0,0 +1,152 @@
+//
+//  BCLActionEventOutbox.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLActionEventOutbox.h"
+#import "BCLActionEvent.h"
+#import <SAMCache/SAMCache.h>
+
+static NSString * const BCLActionEventOutboxNextSequenceNumberKey = @"nextSequenceNumber";
+
+@interface BCLActionEventOutboxBatch ()
+
+@property (nonatomic, copy, readwrite) NSArray *events;
+@property (nonatomic, copy, readwrite) NSIndexSet *sequenceNumbers;
+
+@end
+
+@implementation BCLActionEventOutboxBatch
+
+@end
+
+@interface BCLActionEventOutbox ()
+
+@property (nonatomic, strong) SAMCache *cache;
+@property (nonatomic, copy) NSString *eventsKey;
+
+@property (nonatomic, strong) NSMutableIndexSet *inFlightSequenceNumbers;
+@property (nonatomic) NSUInteger inFlightBatchesCount;
+
+@end
+
+@implementation BCLActionEventOutbox
+
+- (instancetype)initWithCache:(SAMCache *)cache eventsKey:(NSString *)eventsKey
+{
+    if (self = [super init]) {
+        _cache = cache;
+        _eventsKey = [eventsKey copy];
+        _maxBatchSize = 50;
+        _maxInFlightBatchesCount = 3;
+        _inFlightSequenceNumbers = [NSMutableIndexSet indexSet];
+    }
+    return self;
+}
+
+- (NSUInteger)pendingEventsCount
+{
+    NSUInteger count = 0;
+    for (BCLActionEvent *event in [self storedEvents]) {
+        if (![self.inFlightSequenceNumbers containsIndex:event.sequenceNumber]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+- (void)appendEvent:(BCLActionEvent *)event
+{
+    NSMutableArray *events = [[self storedEvents] mutableCopy];
+    event.sequenceNumber = [self takeNextSequenceNumber];
+    [events addObject:event];
+    [self.cache setObject:[events copy] forKey:self.eventsKey];
+}
+
+- (BCLActionEventOutboxBatch *)dequeueBatch
+{
+    if (self.inFlightBatchesCount >= self.maxInFlightBatchesCount) {
+        return nil;
+    }
+    
+    NSMutableArray *events = [NSMutableArray array];
+    NSMutableIndexSet *sequenceNumbers = [NSMutableIndexSet indexSet];
+    
+    for (BCLActionEvent *event in [self storedEvents]) {
+        if (events.count == self.maxBatchSize) {
+            break;
+        }
+        if (![self.inFlightSequenceNumbers containsIndex:event.sequenceNumber]) {
+            [events addObject:event];
+            [sequenceNumbers addIndex:event.sequenceNumber];
+        }
+    }
+    
+    if (!events.count) {
+        return nil;
+    }
+    
+    [self.inFlightSequenceNumbers addIndexes:sequenceNumbers];
+    self.inFlightBatchesCount++;
+    
+    BCLActionEventOutboxBatch *batch = [[BCLActionEventOutboxBatch alloc] init];
+    batch.events = events;
+    batch.sequenceNumbers = sequenceNumbers;
+    return batch;
+}
+
+- (void)acknowledgeBatch:(BCLActionEventOutboxBatch *)batch
+{
+    NSArray *events = [[self storedEvents] filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(BCLActionEvent *event, NSDictionary *bindings) {
+        return ![batch.sequenceNumbers containsIndex:event.sequenceNumber];
+    }]];
+    [self.cache setObject:events forKey:self.eventsKey];
+    
+    [self releaseBatch:batch];
+}
+
+- (void)releaseBatch:(BCLActionEventOutboxBatch *)batch
+{
+    [self.inFlightSequenceNumbers removeIndexes:batch.sequenceNumbers];
+    if (self.inFlightBatchesCount > 0) {
+        self.inFlightBatchesCount--;
+    }
+}
+
+#pragma mark - Private
+
+/**
+ *  Stored events ordered by sequence numbers. Events stored before sequence numbers were introduced get them here.
+ */
+- (NSArray *)storedEvents
+{
+    NSArray *events = [self.cache objectForKey:self.eventsKey] ?: @[];
+    
+    if ([events indexOfObjectPassingTest:^BOOL(BCLActionEvent *event, NSUInteger idx, BOOL *stop) { return event.sequenceNumber == 0; }] != NSNotFound) {
+        for (BCLActionEvent *event in events) {
+            if (event.sequenceNumber == 0) {
+                event.sequenceNumber = [self takeNextSequenceNumber];
+            }
+        }
+        events = [events sortedArrayUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"sequenceNumber" ascending:YES]]];
+        [self.cache setObject:events forKey:self.eventsKey];
+    }
+    
+    return events;
+}
+
+- (NSUInteger)takeNextSequenceNumber
+{
+    // Numbers start at 1, 0 means that an event has none yet
+    NSUInteger sequenceNumber = MAX([[self.cache objectForKey:BCLActionEventOutboxNextSequenceNumberKey] unsignedIntegerValue], 1);
+    [self.cache setObject:@(sequenceNumber + 1) forKey:BCLActionEventOutboxNextSequenceNumberKey];
+    return sequenceNumber;
+}
+
+@end
@@ -24,6 +24,11 @@ extern NSString * const BCLActionEventSchedulerBackgroundTaskIdentifier;
 
 - (void) storeEvent:(BCLActionEvent *)event;
 
+/**
+ *  Folds an event into visit aggregates, which are uploaded once the hour they're counted in is over
+ */
+- (void) aggregateEvent:(BCLActionEvent *)event;
+
 - (BCLActionEvent *) lastStoredEventWithType:(BCLEventType)type;
 
 + (void)clearCache;
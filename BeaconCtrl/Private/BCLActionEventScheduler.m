@@ -11,8 +11,11 @@
 
 #import "BCLActionEventScheduler.h"
 #import "BCLActionEvent.h"
+#import "BCLActionEventOutbox.h"
+#import "BCLVisitAggregator.h"
 #import "BCLBackend.h"
 #import "SAMCache+BeaconCtrl.h"
+#import "BCLClock.h"
 #import <UIKit/UIKit.h>
 
 static NSTimeInterval BCLActionEventSchedulerMinSendIdleInterval = 15;
@@ -26,9 +29,14 @@ NSString * _cacheKeyForEventType(BCLEventType type) {
 @interface BCLActionEventScheduler ()
 
 @property (weak) BCLBackend *backend;
+@property (nonatomic, strong) BCLActionEventOutbox *outbox;
+@property (nonatomic, strong) BCLVisitAggregator *visitAggregator;
+@property (nonatomic) BOOL isSendingVisitAggregates;
 
-@property (nonatomic, strong) NSTimer *sendEventsTimer;
-@property (nonatomic, strong) NSDate *lastSendDate;
+@property (nonatomic, strong) BCLClockTimer *sendEventsTimer;
+
+/// Clock uptime of the last sending, 0 if nothing has been sent yet
+@property (nonatomic) NSTimeInterval lastSendTime;
 @property (nonatomic, strong) NSNumber *currentBackgroundTaskIdentifierNumber;
 
 @end
@@ -52,6 +60,8 @@ NSString * _cacheKeyForEventType(BCLEventType type) {
 {
     if (self = [self init]) {
         self.backend = backend;
+        self.outbox = [[BCLActionEventOutbox alloc] initWithCache:[SAMCache bcl_actionEventsCache] eventsKey:BCLActionEventSchedulerCachedEventsCacheKey];
+        self.visitAggregator = [[BCLVisitAggregator alloc] initWithCache:[SAMCache bcl_visitAggregatesCache]];
     }
     return self;
 }
@@ -65,17 +75,16 @@ NSString * _cacheKeyForEventType(BCLEventType type) {
         return;
     }
     
-    self.sendEventsTimer = [NSTimer timerWithTimeInterval:delay target:self selector:@selector(sendActionEventsTimerHandler:) userInfo:userInfo repeats:NO];
-    [[NSRunLoop mainRunLoop] addTimer:self.sendEventsTimer forMode:NSDefaultRunLoopMode];
+    self.sendEventsTimer = [[BCLClock currentClock] scheduleTimerWithDelay:delay queue:dispatch_get_main_queue() handler:^{
+        [self sendActionEventsTimerHandlerWithUserInfo:userInfo];
+    }];
 }
 
 /**
  *  Send action events
  */
-- (void) sendActionEventsTimerHandler:(NSTimer *)timer
+- (void) sendActionEventsTimerHandlerWithUserInfo:(NSDictionary *)userInfo
 {
-    NSDictionary *userInfo = timer.userInfo;
-    
     self.sendEventsTimer = nil;
     
     [self sendActionEvents:^(NSError *error) {
@@ -95,30 +104,92 @@ NSString * _cacheKeyForEventType(BCLEventType type) {
 
 - (void)sendActionEvents:(void (^)(NSError *error))completion
 {
-    NSMutableArray *cachedEvents = [[SAMCache bcl_actionEventsCache] objectForKey:BCLActionEventSchedulerCachedEventsCacheKey];
-    
-    if (cachedEvents.count) {
-        self.lastSendDate = [NSDate date];
-    }
+    self.sendEventsTimer = nil;
     
-    [self.backend sendEvents:cachedEvents completion:^(NSError *error) {
-        if (error) {
-            NSLog(@"Unable to send events %@",error);
+    dispatch_async([self eventsDispatchQueue], ^{
+        dispatch_group_t group = dispatch_group_create();
+        NSMutableArray *errors = [NSMutableArray array];
+        
+        [self sendPendingBatchesInGroup:group errors:errors];
+        [self sendVisitAggregatesInGroup:group errors:errors];
+        
+        dispatch_group_notify(group, dispatch_get_main_queue(), ^{
             if (completion) {
-                completion(error);
+                completion(errors.firstObject);
             }
-            return;
-        }
-        
-        // clear storage
-        [self.class clearCache];
+        });
+    });
+}
+
+/**
+ *  Uploads pending events in as many batches as the outbox allows at once, and keeps doing so as batches get
+ *  acknowledged. Has to be called on the events queue.
+ */
+- (void)sendPendingBatchesInGroup:(dispatch_group_t)group errors:(NSMutableArray *)errors
+{
+    BCLBackend *backend = self.backend;
+    if (!backend) {
+        return;
+    }
+    
+    BCLActionEventOutboxBatch *batch;
+    
+    while ((batch = [self.outbox dequeueBatch])) {
+        self.lastSendTime = MAX([BCLClock currentClock].uptime, DBL_MIN);
         
-        if (completion) {
-            completion(nil);
-        }
-    }];
+        dispatch_group_enter(group);
+        [backend sendEvents:batch.events completion:^(NSError *error) {
+            dispatch_async([self eventsDispatchQueue], ^{
+                if (error) {
+                    NSLog(@"Unable to send events %@",error);
+                    [errors addObject:error];
+                    [self.outbox releaseBatch:batch];
+                } else {
+                    [self.outbox acknowledgeBatch:batch];
+                    
+                    // Events stored in the meantime go right away
+                    if (!errors.count) {
+                        [self sendPendingBatchesInGroup:group errors:errors];
+                    }
+                }
+                dispatch_group_leave(group);
+            });
+        }];
+    }
+}
+
+/**
+ *  Uploads aggregates of hours that are over, unless they're already being uploaded. Has to be called on the events queue.
+ */
+- (void)sendVisitAggregatesInGroup:(dispatch_group_t)group errors:(NSMutableArray *)errors
+{
+    BCLBackend *backend = self.backend;
+    if (!backend || self.isSendingVisitAggregates) {
+        return;
+    }
     
-    self.sendEventsTimer = nil;
+    NSDictionary *aggregates = [self.visitAggregator aggregatesOfHoursEndedBefore:[BCLClock currentClock].timeIntervalSince1970];
+    if (!aggregates) {
+        return;
+    }
+    
+    self.isSendingVisitAggregates = YES;
+    self.lastSendTime = MAX([BCLClock currentClock].uptime, DBL_MIN);
+    
+    dispatch_group_enter(group);
+    [backend sendVisitAggregates:aggregates completion:^(NSError *error) {
+        dispatch_async([self eventsDispatchQueue], ^{
+            if (error) {
+                NSLog(@"Unable to send visit aggregates %@",error);
+                [errors addObject:error];
+            } else {
+                // Anything counted for the same hours in the meantime stays for the next upload
+                [self.visitAggregator removeAggregates:aggregates];
+            }
+            self.isSendingVisitAggregates = NO;
+            dispatch_group_leave(group);
+        });
+    }];
 }
 
 - (dispatch_queue_t)eventsDispatchQueue
@@ -144,31 +215,46 @@ NSString * _cacheKeyForEventType(BCLEventType type) {
     dispatch_queue_t queue = [self eventsDispatchQueue];
     dispatch_async(queue, ^{
         // store in cache
-        NSMutableArray *cachedEvents = [[[SAMCache bcl_actionEventsCache] objectForKey:BCLActionEventSchedulerCachedEventsCacheKey] mutableCopy];
-        if (!cachedEvents) {
-            cachedEvents = [NSMutableArray array];
-        }
-        
-        [cachedEvents addObject:event];
-        
-        [[SAMCache bcl_actionEventsCache] setObject:cachedEvents.copy forKey:BCLActionEventSchedulerCachedEventsCacheKey];
+        [self.outbox appendEvent:event];
         
         [[SAMCache bcl_lastActionEventsCache] setObject:event forKey:_cacheKeyForEventType(event.eventType)];
         
-        NSDictionary *userInfo = @{BCLActionEventSchedulerBackgroundTaskIdentifier: self.currentBackgroundTaskIdentifierNumber};
+        [self scheduleSendingStoredEvents];
+    });
+}
+
+- (void) aggregateEvent:(BCLActionEvent *)event
+{
+    dispatch_async([self eventsDispatchQueue], ^{
+        [self.visitAggregator addEvent:event];
         
-        NSTimeInterval intervalSinceLastSendDate = [[NSDate date] timeIntervalSinceDate:self.lastSendDate];
+        [[SAMCache bcl_lastActionEventsCache] setObject:event forKey:_cacheKeyForEventType(event.eventType)];
         
-        if (!self.lastSendDate || (intervalSinceLastSendDate > BCLActionEventSchedulerMinSendIdleInterval)) {
-            NSLog(@"BEACON OS WILL SEND AN ACTION EVENT RIGHT AWAY");
-            [self scheduleSendingActionEventsWithDelay:1 userInfo:userInfo];
-        } else {
-            NSLog(@"BEACON OS WILL SEND AN ACTION EVENT IN %f SECONDS", BCLActionEventSchedulerMinSendIdleInterval - intervalSinceLastSendDate);
-            [self scheduleSendingActionEventsWithDelay:(BCLActionEventSchedulerMinSendIdleInterval - intervalSinceLastSendDate) userInfo:userInfo];
+        // Aggregates wait until their hour is over, so most events don't need any upload
+        if ([self.visitAggregator aggregatesOfHoursEndedBefore:[BCLClock currentClock].timeIntervalSince1970]) {
+            [self scheduleSendingStoredEvents];
         }
     });
 }
 
+/**
+ *  Schedules sending right away, or after the minimal idle interval since the last sending. Has to be called on the events queue.
+ */
+- (void) scheduleSendingStoredEvents
+{
+    NSDictionary *userInfo = self.currentBackgroundTaskIdentifierNumber ? @{BCLActionEventSchedulerBackgroundTaskIdentifier: self.currentBackgroundTaskIdentifierNumber} : nil;
+    
+    NSTimeInterval intervalSinceLastSendDate = [BCLClock currentClock].uptime - self.lastSendTime;
+    
+    if (!self.lastSendTime || (intervalSinceLastSendDate > BCLActionEventSchedulerMinSendIdleInterval)) {
+        NSLog(@"BEACON OS WILL SEND AN ACTION EVENT RIGHT AWAY");
+        [self scheduleSendingActionEventsWithDelay:1 userInfo:userInfo];
+    } else {
+        NSLog(@"BEACON OS WILL SEND AN ACTION EVENT IN %f SECONDS", BCLActionEventSchedulerMinSendIdleInterval - intervalSinceLastSendDate);
+        [self scheduleSendingActionEventsWithDelay:(BCLActionEventSchedulerMinSendIdleInterval - intervalSinceLastSendDate) userInfo:userInfo];
+    }
+}
+
 - (BCLActionEvent *)lastStoredEventWithType:(BCLEventType)type
 {
     return [[SAMCache bcl_lastActionEventsCache] objectForKey:_cacheKeyForEventType(type)];
@@ -177,6 +263,7 @@ NSString * _cacheKeyForEventType(BCLEventType type) {
 + (void)clearCache
 {
     [[SAMCache bcl_actionEventsCache] setObject:nil forKey:BCLActionEventSchedulerCachedEventsCacheKey];
+    [[SAMCache bcl_visitAggregatesCache] removeAllObjects];
 }
 
 @end
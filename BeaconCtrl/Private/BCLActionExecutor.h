@@ -0,0 +1,55 @@
+//
+//  BCLActionExecutor.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import "BCLTypes.h"
+
+@class BCLAction, BCLTrigger;
+
+/**
+ *  Queue of actions to perform, decoupled from beacon processing. Actions are performed asynchronously on the main queue:
+ *  - an action that is already waiting in the queue isn't queued again,
+ *  - an action performed less than actionCooldownInterval ago is dropped,
+ *  - at most maxActionsPerRateLimitInterval actions are performed per rateLimitInterval, the rest waits in the queue,
+ *  - when the queue is full, new actions are dropped.
+ *  Has to be used from the main thread.
+ */
+@interface BCLActionExecutor : NSObject
+
+/// Defaults to 60 seconds
+@property (nonatomic) NSTimeInterval actionCooldownInterval;
+
+/// Defaults to 5 actions per 10 seconds
+@property (nonatomic) NSUInteger maxActionsPerRateLimitInterval;
+@property (nonatomic) NSTimeInterval rateLimitInterval;
+
+/// Defaults to 32
+@property (nonatomic) NSUInteger maxQueueDepth;
+
+/// Returns the current time in seconds. Defaults to the uptime of +[BCLClock currentClock]; can be replaced with a virtual clock.
+@property (nonatomic, copy) NSTimeInterval (^clock)(void);
+
+@property (nonatomic, readonly) NSUInteger queueDepth;
+@property (nonatomic, readonly) NSUInteger performedActionsCount;
+@property (nonatomic, readonly) NSUInteger coalescedActionsCount;
+@property (nonatomic, readonly) NSUInteger droppedActionsCount;
+
+- (instancetype)initWithPerformer:(void (^)(BCLAction *action, BCLTrigger *trigger, BCLEventType eventType))performer;
+
+- (void)enqueueAction:(BCLAction *)action trigger:(BCLTrigger *)trigger eventType:(BCLEventType)eventType;
+
+/**
+ *  Performs queued actions that can be performed at the current time. Called automatically by a timer of the current
+ *  BCLClock, which a BCLVirtualClock fires as it's advanced.
+ */
+- (void)processQueuedActions;
+
+@end
@@ -0,0 +1,181 @@
+//
+//  BCLActionExecutor.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLActionExecutor.h"
+#import "BCLClock.h"
+#import "BCLAction.h"
+
+static NSTimeInterval const BCLActionExecutorDefaultCooldownInterval = 60;
+static NSUInteger const BCLActionExecutorDefaultMaxActionsPerRateLimitInterval = 5;
+static NSTimeInterval const BCLActionExecutorDefaultRateLimitInterval = 10;
+static NSUInteger const BCLActionExecutorDefaultMaxQueueDepth = 32;
+
+@interface BCLActionExecutorItem : NSObject
+
+@property (nonatomic, strong) BCLAction *action;
+@property (nonatomic, strong) BCLTrigger *trigger;
+@property (nonatomic) BCLEventType eventType;
+
+@end
+
+@implementation BCLActionExecutorItem
+
+@end
+
+@interface BCLActionExecutor ()
+
+@property (nonatomic, copy) void (^performer)(BCLAction *action, BCLTrigger *trigger, BCLEventType eventType);
+
+@property (nonatomic, strong) NSMutableArray *queue;
+/// Action identifier -> time it was last performed at
+@property (nonatomic, strong) NSMutableDictionary *lastPerformTimes;
+/// Times of actions performed within the last rate limit interval, oldest first
+@property (nonatomic, strong) NSMutableArray *recentPerformTimes;
+
+/// Time of the earliest scheduled processing, 0 if none is scheduled
+@property (nonatomic) NSTimeInterval scheduledProcessingTime;
+
+@property (nonatomic, readwrite) NSUInteger performedActionsCount;
+@property (nonatomic, readwrite) NSUInteger coalescedActionsCount;
+@property (nonatomic, readwrite) NSUInteger droppedActionsCount;
+
+@end
+
+@implementation BCLActionExecutor
+
+- (instancetype)initWithPerformer:(void (^)(BCLAction *, BCLTrigger *, BCLEventType))performer
+{
+    if (self = [super init]) {
+        _performer = [performer copy];
+        _actionCooldownInterval = BCLActionExecutorDefaultCooldownInterval;
+        _maxActionsPerRateLimitInterval = BCLActionExecutorDefaultMaxActionsPerRateLimitInterval;
+        _rateLimitInterval = BCLActionExecutorDefaultRateLimitInterval;
+        _maxQueueDepth = BCLActionExecutorDefaultMaxQueueDepth;
+        _clock = ^NSTimeInterval {
+            return [BCLClock currentClock].uptime;
+        };
+        _queue = [NSMutableArray array];
+        _lastPerformTimes = [NSMutableDictionary dictionary];
+        _recentPerformTimes = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (NSUInteger)queueDepth
+{
+    return self.queue.count;
+}
+
+- (void)enqueueAction:(BCLAction *)action trigger:(BCLTrigger *)trigger eventType:(BCLEventType)eventType
+{
+    if ([self isActionQueued:action]) {
+        self.coalescedActionsCount++;
+        return;
+    }
+
+    if ([self isActionCoolingDown:action] || self.queue.count >= self.maxQueueDepth) {
+        self.droppedActionsCount++;
+#ifdef DEBUG
+        NSLog(@"Dropped action %@, queue depth: %lu, dropped actions: %lu", action.name, (unsigned long)self.queue.count, (unsigned long)self.droppedActionsCount);
+#endif
+        return;
+    }
+
+    BCLActionExecutorItem *item = [BCLActionExecutorItem new];
+    item.action = action;
+    item.trigger = trigger;
+    item.eventType = eventType;
+    [self.queue addObject:item];
+
+    [self scheduleProcessingAfterDelay:0];
+}
+
+- (void)processQueuedActions
+{
+    NSTimeInterval now = self.clock();
+
+    while (self.queue.count) {
+        [self trimRecentPerformTimesAtTime:now];
+
+        if (self.recentPerformTimes.count >= MAX(self.maxActionsPerRateLimitInterval, 1)) {
+            NSTimeInterval delay = [self.recentPerformTimes.firstObject doubleValue] + self.rateLimitInterval - now;
+            [self scheduleProcessingAfterDelay:delay];
+            return;
+        }
+
+        BCLActionExecutorItem *item = self.queue.firstObject;
+        [self.queue removeObjectAtIndex:0];
+
+        // The same action could have been performed since it was queued
+        if ([self isActionCoolingDown:item.action]) {
+            self.droppedActionsCount++;
+            continue;
+        }
+
+        if (item.action.identifier) {
+            self.lastPerformTimes[item.action.identifier] = @(now);
+        }
+        [self.recentPerformTimes addObject:@(now)];
+        self.performedActionsCount++;
+
+        if (self.performer) {
+            self.performer(item.action, item.trigger, item.eventType);
+        }
+    }
+}
+
+#pragma mark - Private
+
+- (BOOL)isActionQueued:(BCLAction *)action
+{
+    for (BCLActionExecutorItem *item in self.queue) {
+        if (item.action == action || (action.identifier && [item.action.identifier isEqual:action.identifier])) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (BOOL)isActionCoolingDown:(BCLAction *)action
+{
+    if (!action.identifier) {
+        return NO;
+    }
+
+    NSNumber *lastPerformTime = self.lastPerformTimes[action.identifier];
+    return lastPerformTime && self.clock() - lastPerformTime.doubleValue < self.actionCooldownInterval;
+}
+
+- (void)trimRecentPerformTimesAtTime:(NSTimeInterval)now
+{
+    while (self.recentPerformTimes.count && now - [self.recentPerformTimes.firstObject doubleValue] >= self.rateLimitInterval) {
+        [self.recentPerformTimes removeObjectAtIndex:0];
+    }
+}
+
+- (void)scheduleProcessingAfterDelay:(NSTimeInterval)delay
+{
+    delay = MAX(delay, 0);
+    NSTimeInterval processingTime = self.clock() + delay;
+
+    if (self.scheduledProcessingTime && self.scheduledProcessingTime <= processingTime) {
+        return;
+    }
+    self.scheduledProcessingTime = processingTime;
+
+    __weak typeof(self) weakSelf = self;
+    [[BCLClock currentClock] scheduleTimerWithDelay:delay queue:dispatch_get_main_queue() handler:^{
+        weakSelf.scheduledProcessingTime = 0;
+        [weakSelf processQueuedActions];
+    }];
+}
+
+@end
@@ -17,6 +17,13 @@
 
 @interface BCLAdminBackend : BCLAbstractBackend
 
+/// Number of beacons or zones requested per page. Defaults to 50.
+@property (nonatomic) NSUInteger pageSize;
+
+/// Maximum number of pages of a single collection requested at the same time. Defaults to the transport's
+/// limit of concurrent admin requests, pages above it would only wait in the transport queue.
+@property (nonatomic) NSUInteger maxConcurrentPageRequests;
+
 - (void)authenticateUserWithEmail:(NSString *)email password:(NSString *)password completion:(void(^)(BOOL success, NSError *error))completion;
 - (void)registerNewUserWithEmail:(NSString *)email password:(NSString *)password passwordConfirmation:(NSString *)passwordConfirmation completion:(void(^)(BOOL success, NSError *error))completion;
 
@@ -29,10 +36,12 @@
 - (void)fetchVendors:(void (^)(NSArray *vendors, NSError *error))completion;
 
 - (void)fetchBeacons:(void (^)(NSSet *beacons, NSError *error))completion;
+- (void)fetchBeaconsWithPageHandler:(void (^)(NSSet *beacons))pageHandler completion:(void (^)(NSSet *beacons, NSError *error))completion;
 
 - (void)syncBeacon:(BCLBeacon *)beacon completion:(void (^)(NSError *error))completion;
 
 - (void)fetchZones:(NSSet *)beacons completion:(void (^)(NSSet *zones, NSError *error))completion;
+- (void)fetchZones:(NSSet *)beacons pageHandler:(void (^)(NSSet *zones))pageHandler completion:(void (^)(NSSet *zones, NSError *error))completion;
 
 - (void)fetchZoneColors:(void (^)(NSArray *zoneColors, NSError *error))completion;
 
@@ -14,9 +14,39 @@
 #import "BCLBeacon.h"
 #import "BCLZone.h"
 #import "BCLLocation.h"
-#import "NSHTTPURLResponse+BCLHTTPCodes.h"
 #import "UIColor+Hex.h"
 
+static NSUInteger const BCLAdminDefaultPageSize = 50;
+
+/**
+ *  State of a single paginated fetch. Accessed on its own serial queue only.
+ */
+@interface BCLAdminPagedFetch : NSObject
+
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, copy) NSString *key;
+@property (nonatomic, copy) id (^objectBuilder)(NSDictionary *dictionary);
+@property (nonatomic, copy) void (^pageHandler)(NSSet *objects);
+@property (nonatomic, copy) void (^completion)(NSSet *objects, NSError *error);
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic) NSUInteger pageSize;
+@property (nonatomic) NSUInteger nextPage;
+@property (nonatomic) NSUInteger lastPage;
+@property (nonatomic) NSUInteger inFlightCount;
+/// Set once the backend reports the number of pages or a second page brings new objects
+@property (nonatomic) BOOL isPaginationConfirmed;
+@property (nonatomic) BOOL isFinished;
+
+@property (nonatomic, strong) NSMutableSet *objects;
+@property (nonatomic, strong) NSMutableSet *identifiers;
+
+@end
+
+@implementation BCLAdminPagedFetch
+
+@end
+
 @interface BCLAdminBackend ()
 
 @property (nonatomic, copy) NSString *email;
@@ -74,12 +104,6 @@
     
     NSString *urlString = [NSString stringWithFormat:@"%@/admins", [[self class] baseURLString]];
     
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"POST";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
-    
     NSDictionary *params = @{
                              @"client_id": self.clientId,
                              @"client_secret": self.clientSecret,
@@ -89,43 +113,22 @@
                                      }
                              };
     
-    [request setHTTPBody:[NSJSONSerialization dataWithJSONObject:[params copy] options:0 error:nil]];
-    
     __weak typeof(self) weakSelf = self;
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description], @"BCLResponseDictionaryKey": responseDictionary}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      [weakSelf refetchToken:^(NSString *token, NSError *authenticationError) {
-                                          if (completion) {
-                                              completion(token != nil, authenticationError);
-                                          }
-                                      }];
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"POST" body:params priority:BCLHTTPRequestPriorityAdmin retry:nil completion:^(id responseObject, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(nil, error);
+            }
+            return;
+        }
+        
+        [weakSelf refetchToken:^(NSString *token, NSError *authenticationError) {
+            if (completion) {
+                completion(token != nil, authenticationError);
+            }
+        }];
+    }];
 }
 
 - (void)fetchTestApplicationCredentials:(void (^)(NSString *, NSString *, NSError *))completion
@@ -138,123 +141,57 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/applications", [[self class] baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, nil, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          __block NSDictionary *testAppDict;
-                                          
-                                          [responseDictionary[@"applications"] enumerateObjectsUsingBlock:^(NSDictionary *appDict, NSUInteger idx, BOOL *stop) {
-                                              if ([appDict[@"test"] isEqualToNumber:@1]) {
-                                                  testAppDict = appDict;
-                                                  *stop = YES;
-                                              }
-                                          }];
-                                          
-                                          NSString *applicationClientId = testAppDict[@"uid"];
-                                          NSString *applicationClientSecret = testAppDict[@"secret"];
-                                          
-                                          completion(applicationClientId, applicationClientSecret, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"GET" body:nil priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+    } completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(nil, nil, error);
+            }
+            return;
+        }
+        
+        if (completion) {
+            __block NSDictionary *testAppDict;
+            
+            [responseDictionary[@"applications"] enumerateObjectsUsingBlock:^(NSDictionary *appDict, NSUInteger idx, BOOL *stop) {
+                if ([appDict[@"test"] isEqualToNumber:@1]) {
+                    testAppDict = appDict;
+                    *stop = YES;
+                }
+            }];
+            
+            NSString *applicationClientId = testAppDict[@"uid"];
+            NSString *applicationClientSecret = testAppDict[@"secret"];
+            
+            completion(applicationClientId, applicationClientSecret, nil);
+        }
+    }];
 }
 
 - (void)fetchVendors:(void (^)(NSArray *vendors, NSError *error))completion
 {
     NSString *urlString = [NSString stringWithFormat:@"%@/vendors", [[self class] baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, processingError);
-                                              return;
-                                          }
-                                          
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          NSArray *vendors;
-                                          if ([responseDictionary respondsToSelector:@selector(objectForKey:)]) {
-                                              vendors = responseDictionary[@"vendors"];
-                                          }
-                                          
-                                          completion(vendors, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"GET" body:nil priority:BCLHTTPRequestPriorityAdmin retry:^{
+    } completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(nil, error);
+            }
+            return;
+        }
+        
+        if (completion) {
+            NSArray *vendors;
+            if ([responseDictionary respondsToSelector:@selector(objectForKey:)]) {
+                vendors = responseDictionary[@"vendors"];
+            }
+            
+            completion(vendors, nil);
+        }
+    }];
 }
 
 - (void)createBeacon:(BCLBeacon *)beacon testActionName:(NSString *)testActionName testActionTrigger:(BCLEventType)trigger testActionAttributes:(NSArray *)testActionAttributes completion:(void (^)(BCLBeacon *, NSError *))completion
@@ -267,11 +204,6 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/beacons", [[self class] baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"POST";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
     NSMutableDictionary *params = [@{
                                      @"client_id": self.clientId,
@@ -313,57 +245,23 @@
     
     params[@"beacon"] = beaconDict.copy;
     
-    [request setHTTPBody:[NSJSONSerialization dataWithJSONObject:[params copy] options:0 error:nil]];
-    
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      NSLog(@"Response dictionary: %@", responseDictionary);
-                                      NSLog(@"Is success: %lu", httpResponse.isSuccess);
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description], @"BCLResponseDictionaryKey": responseDictionary}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          BCLBeacon *newBeacon = [[BCLBeacon alloc] init];
-                                          [newBeacon updatePropertiesFromDictionary:responseDictionary[@"range"]];
-                                          
-                                          completion(newBeacon, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"POST" body:params priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+    } completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(nil, error);
+            }
+            return;
+        }
+        
+        if (completion) {
+            BCLBeacon *newBeacon = [[BCLBeacon alloc] init];
+            [newBeacon updatePropertiesFromDictionary:responseDictionary[@"range"]];
+            
+            completion(newBeacon, nil);
+        }
+    }];
 }
 
 - (void)updateBeacon:(BCLBeacon *)beacon testActionName:(NSString *)testActionName testActionTrigger:(BCLEventType)trigger testActionAttributes:(NSArray *)testActionAttributes completion:(void (^)(BOOL, NSError *))completion
@@ -376,11 +274,6 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/beacons/%@", [[self class] baseURLString], beacon.beaconIdentifier];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    request.HTTPMethod = @"PUT";
-    [self setupURLRequest:request];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
     NSMutableDictionary *params = [@{
                                      @"client_id": self.clientId,
@@ -424,38 +317,20 @@
     
     params[@"beacon"] = beaconDict.copy;
     
-    [request setHTTPBody:[NSJSONSerialization dataWithJSONObject:[params copy] options:0 error:nil]];
-    
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(NO, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(NO, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (httpResponse.statusCode == 204 && completion) {
-                                          completion(YES, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"PUT" body:params priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+    } completion:^(id responseObject, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(NO, error);
+            }
+            return;
+        }
+        
+        if (response.statusCode == 204 && completion) {
+            completion(YES, nil);
+        }
+    }];
     
 }
 
@@ -469,110 +344,29 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/beacons/%@", [[self class] baseURLString], beacon.beaconIdentifier];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    request.HTTPMethod = @"DELETE";
-    [self setupURLRequest:request];
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(NO, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(NO, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          completion(YES, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"DELETE" body:nil priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+    } completion:^(id responseObject, NSHTTPURLResponse *response, NSError *error) {
+        if (completion) {
+            completion(error == nil, error);
+        }
+    }];
     
 }
 
 - (void)fetchBeacons:(void (^)(NSSet *beacons, NSError *error))completion
 {
-    if (!self.clientId || !self.clientSecret) {
-        if (completion) {
-            completion(nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Invalid backend integration"}]);
-        }
-        return;
-    }
-    
-    NSString *urlString = [NSString stringWithFormat:@"%@/beacons", [[self class] baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"GET";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
-    
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          NSMutableSet *beaconsSet = [NSMutableSet set];
-                                          
-                                          for (NSDictionary *beaconDictionary in responseDictionary[@"ranges"]) {
-                                              BCLBeacon *beacon = [[BCLBeacon alloc] init];
-                                              [beacon updatePropertiesFromDictionary:beaconDictionary];
-                                              [beaconsSet addObject:beacon];
-                                          }
-                                          
-                                          completion([beaconsSet copy], nil);
-                                      }
-                                  }];
-    [task resume];
+    [self fetchBeaconsWithPageHandler:nil completion:completion];
+}
+
+- (void)fetchBeaconsWithPageHandler:(void (^)(NSSet *beacons))pageHandler completion:(void (^)(NSSet *beacons, NSError *error))completion
+{
+    [self fetchPagedCollectionWithPath:@"beacons" key:@"ranges" objectBuilder:^id(NSDictionary *beaconDictionary) {
+        BCLBeacon *beacon = [[BCLBeacon alloc] init];
+        [beacon updatePropertiesFromDictionary:beaconDictionary];
+        return beacon;
+    } pageHandler:pageHandler completion:completion];
 }
 
 - (void)syncBeacon:(BCLBeacon *)beacon completion:(void (^)(NSError *))completion
@@ -585,125 +379,37 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/beacons/%@/sync", [BCLAdminBackend baseURLString], beacon.beaconIdentifier];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"PUT";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(syncBeacon:completion:) sender:self parameters:@[beacon, completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      [beacon updatePropertiesFromDictionary:responseDictionary[@"range"]];
-                                      
-                                      if (completion) {
-                                          completion(nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"PUT" body:nil priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(syncBeacon:completion:) sender:self parameters:@[beacon, completion]];
+    } completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(error);
+            }
+            return;
+        }
+        
+        [beacon updatePropertiesFromDictionary:responseDictionary[@"range"]];
+        
+        if (completion) {
+            completion(nil);
+        }
+    }];
 }
 
 - (void)fetchZones:(NSSet *)beacons completion:(void (^)(NSSet *zones, NSError *error))completion
 {
-    if (!self.clientId || !self.clientSecret) {
-        if (completion) {
-            completion(nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Invalid backend integration"}]);
-        }
-        return;
-    }
-    
-    NSString *urlString = [NSString stringWithFormat:@"%@/zones", [[self class] baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"GET";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
-    
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          NSMutableSet *zonesSet = [NSMutableSet set];
-                                          
-                                          for (NSDictionary *zoneDictionary in responseDictionary[@"zones"]) {
-                                              BCLZone *zone = [[BCLZone alloc] init];
-                                              [zone updatePropertiesFromDictionary:zoneDictionary beacons:beacons];
-                                              [zonesSet addObject:zone];
-                                          }
-                                          
-                                          completion([zonesSet copy], nil);
-                                      }
-                                  }];
-    [task resume];
+    [self fetchZones:beacons pageHandler:nil completion:completion];
+}
+
+- (void)fetchZones:(NSSet *)beacons pageHandler:(void (^)(NSSet *zones))pageHandler completion:(void (^)(NSSet *zones, NSError *error))completion
+{
+    [self fetchPagedCollectionWithPath:@"zones" key:@"zones" objectBuilder:^id(NSDictionary *zoneDictionary) {
+        BCLZone *zone = [[BCLZone alloc] init];
+        [zone updatePropertiesFromDictionary:zoneDictionary beacons:beacons];
+        return zone;
+    } pageHandler:pageHandler completion:completion];
 }
 
 - (void)fetchZoneColors:(void (^)(NSArray *zoneColors, NSError *error))completion
@@ -716,61 +422,27 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/zone_colors", [[self class] baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"GET";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          NSMutableArray *mutableColors = @[].mutableCopy;
-                                          
-                                          [responseDictionary[@"colors"] enumerateObjectsUsingBlock:^(NSDictionary *colorDict, NSUInteger idx, BOOL *stop) {
-                                              [mutableColors addObject:colorDict[@"color"]];
-                                          }];
-                                          
-                                          completion(mutableColors.copy, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"GET" body:nil priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+    } completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(nil, error);
+            }
+            return;
+        }
+        
+        if (completion) {
+            NSMutableArray *mutableColors = @[].mutableCopy;
+            
+            [responseDictionary[@"colors"] enumerateObjectsUsingBlock:^(NSDictionary *colorDict, NSUInteger idx, BOOL *stop) {
+                [mutableColors addObject:colorDict[@"color"]];
+            }];
+            
+            completion(mutableColors.copy, nil);
+        }
+    }];
     
 }
 
@@ -784,11 +456,6 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/zones", [[self class] baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"POST";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
     NSMutableDictionary *params = [@{
                                      @"client_id": self.clientId,
@@ -814,63 +481,31 @@
     
     params[@"zone"] = zoneDict.copy;
     
-    [request setHTTPBody:[NSJSONSerialization dataWithJSONObject:[params copy] options:0 error:nil]];
-    
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description], @"BCLResponseDictionaryKey": responseDictionary}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          NSMutableSet *beaconsSet = [NSMutableSet set];
-                                          
-                                          for (NSDictionary *beaconDictionary in responseDictionary[@"zone"][@"beacons"]) {
-                                              BCLBeacon *beacon = [[BCLBeacon alloc] init];
-                                              [beacon updatePropertiesFromDictionary:beaconDictionary];
-                                              [beaconsSet addObject:beacon];
-                                          }
-                                          
-                                          BCLZone *newZone = [[BCLZone alloc] init];
-                                          [newZone updatePropertiesFromDictionary:responseDictionary[@"zone"] beacons:beaconsSet];
-                                          
-                                          completion(newZone, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"POST" body:params priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+    } completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(nil, error);
+            }
+            return;
+        }
+        
+        if (completion) {
+            NSMutableSet *beaconsSet = [NSMutableSet set];
+            
+            for (NSDictionary *beaconDictionary in responseDictionary[@"zone"][@"beacons"]) {
+                BCLBeacon *beacon = [[BCLBeacon alloc] init];
+                [beacon updatePropertiesFromDictionary:beaconDictionary];
+                [beaconsSet addObject:beacon];
+            }
+            
+            BCLZone *newZone = [[BCLZone alloc] init];
+            [newZone updatePropertiesFromDictionary:responseDictionary[@"zone"] beacons:beaconsSet];
+            
+            completion(newZone, nil);
+        }
+    }];
     
 }
 
@@ -884,11 +519,6 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/zones/%@", [[self class] baseURLString], zone.zoneIdentifier];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"PUT";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
     NSMutableDictionary *params = [@{
                                      @"client_id": self.clientId,
@@ -913,44 +543,20 @@
     
     params[@"zone"] = zoneDict.copy;
     
-    [request setHTTPBody:[NSJSONSerialization dataWithJSONObject:[params copy] options:0 error:nil]];
-    
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(NO, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(NO, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description], @"BCLResponseDictionaryKey": responseDictionary}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (httpResponse.statusCode == 204 && completion) {
-                                          completion(YES, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"PUT" body:params priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+    } completion:^(id responseObject, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(NO, error);
+            }
+            return;
+        }
+        
+        if (response.statusCode == 204 && completion) {
+            completion(YES, nil);
+        }
+    }];
     
 }
 
@@ -964,43 +570,175 @@
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/zones/%@", [[self class] baseURLString], zone.zoneIdentifier];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    request.HTTPMethod = @"DELETE";
-    [self setupURLRequest:request];
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(NO, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(NO, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          completion(YES, nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"DELETE" body:nil priority:BCLHTTPRequestPriorityAdmin retry:^{
+        [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+    } completion:^(id responseObject, NSHTTPURLResponse *response, NSError *error) {
+        if (completion) {
+            completion(error == nil, error);
+        }
+    }];
+}
+
+- (NSUInteger)pageSize
+{
+    return _pageSize ? : BCLAdminDefaultPageSize;
+}
+
+- (NSUInteger)maxConcurrentPageRequests
+{
+    return _maxConcurrentPageRequests ? : [self.transport maxConcurrentRequestsCountForPriority:BCLHTTPRequestPriorityAdmin];
 }
 
 #pragma mark - Private
 
+/**
+ *  Fetches a collection page by page. Pages are requested one at a time until the backend proves it paginates the
+ *  collection, by reporting the number of pages in "meta" or by returning new objects on the second page. Since then,
+ *  up to maxConcurrentPageRequests next pages are requested at a time until a page shorter than pageSize (or the last
+ *  one reported in "meta") comes back. Each page is parsed into model objects as soon as it arrives, so the whole
+ *  document is never held in memory at once.
+ */
+- (void)fetchPagedCollectionWithPath:(NSString *)path key:(NSString *)key objectBuilder:(id (^)(NSDictionary *dictionary))objectBuilder pageHandler:(void (^)(NSSet *objects))pageHandler completion:(void (^)(NSSet *objects, NSError *error))completion
+{
+    if (!self.clientId || !self.clientSecret) {
+        if (completion) {
+            completion(nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Invalid backend integration"}]);
+        }
+        return;
+    }
+
+    BCLAdminPagedFetch *fetch = [BCLAdminPagedFetch new];
+    fetch.path = path;
+    fetch.key = key;
+    fetch.objectBuilder = objectBuilder;
+    fetch.pageHandler = pageHandler;
+    fetch.completion = completion;
+    fetch.queue = dispatch_queue_create("com.up-next.BeaconCtrl.admin.pages", DISPATCH_QUEUE_SERIAL);
+    fetch.pageSize = self.pageSize;
+    fetch.nextPage = 1;
+    fetch.lastPage = NSNotFound;
+    fetch.objects = [NSMutableSet set];
+    fetch.identifiers = [NSMutableSet set];
+
+    dispatch_async(fetch.queue, ^{
+        [self requestPagesOfFetch:fetch];
+    });
+}
+
+- (void)requestPagesOfFetch:(BCLAdminPagedFetch *)fetch
+{
+    if (fetch.isFinished) {
+        return;
+    }
+
+    // A backend ignoring the page parameter would return the same full page to every speculative request
+    NSUInteger maxInFlightCount = fetch.isPaginationConfirmed ? self.maxConcurrentPageRequests : 1;
+
+    while (fetch.inFlightCount < maxInFlightCount && (fetch.lastPage == NSNotFound || fetch.nextPage <= fetch.lastPage)) {
+        NSUInteger page = fetch.nextPage++;
+        fetch.inFlightCount++;
+
+        NSString *urlString = [NSString stringWithFormat:@"%@/%@?page=%lu&per_page=%lu", [[self class] baseURLString], fetch.path, (unsigned long)page, (unsigned long)fetch.pageSize];
+        [self fetchPageWithURLString:urlString completion:^(NSDictionary *responseDictionary, NSError *error) {
+            dispatch_async(fetch.queue, ^{
+                [self fetch:fetch didReceivePage:page responseDictionary:responseDictionary error:error];
+            });
+        }];
+    }
+
+    if (!fetch.inFlightCount) {
+        fetch.isFinished = YES;
+        if (fetch.completion) {
+            fetch.completion([fetch.objects copy], nil);
+        }
+    }
+}
+
+- (void)fetch:(BCLAdminPagedFetch *)fetch didReceivePage:(NSUInteger)page responseDictionary:(NSDictionary *)responseDictionary error:(NSError *)error
+{
+    fetch.inFlightCount--;
+
+    if (fetch.isFinished) {
+        return;
+    }
+
+    if (error) {
+        fetch.isFinished = YES;
+        if (fetch.completion) {
+            fetch.completion(nil, error);
+        }
+        return;
+    }
+
+    NSArray *items = responseDictionary[fetch.key];
+    if (![items isKindOfClass:[NSArray class]]) {
+        items = @[];
+    }
+
+    NSNumber *totalPages = responseDictionary[@"meta"][@"total_pages"];
+    if ([totalPages isKindOfClass:[NSNumber class]]) {
+        fetch.lastPage = MIN(fetch.lastPage, MAX(totalPages.unsignedIntegerValue, 1));
+        fetch.isPaginationConfirmed = YES;
+    }
+
+    if (items.count < fetch.pageSize) {
+        fetch.lastPage = MIN(fetch.lastPage, page);
+    }
+
+    // Pages requested ahead of time past the end of the collection are dropped
+    if (page > fetch.lastPage) {
+        [self requestPagesOfFetch:fetch];
+        return;
+    }
+
+    NSMutableSet *pageObjects = [NSMutableSet setWithCapacity:items.count];
+
+    for (NSDictionary *dictionary in items) {
+        NSString *identifier = [dictionary[@"id"] description];
+        if (identifier && [fetch.identifiers containsObject:identifier]) {
+            continue;
+        }
+        if (identifier) {
+            [fetch.identifiers addObject:identifier];
+        }
+
+        id object = fetch.objectBuilder(dictionary);
+        if (object) {
+            [pageObjects addObject:object];
+        }
+    }
+
+    // A full page with nothing new means the backend doesn't paginate this collection
+    if (items.count && !pageObjects.count) {
+        fetch.lastPage = MIN(fetch.lastPage, page);
+    }
+
+    if (pageObjects.count) {
+        if (page > 1) {
+            fetch.isPaginationConfirmed = YES;
+        }
+
+        [fetch.objects unionSet:pageObjects];
+        if (fetch.pageHandler) {
+            fetch.pageHandler([pageObjects copy]);
+        }
+    }
+
+    [self requestPagesOfFetch:fetch];
+}
+
+- (void)fetchPageWithURLString:(NSString *)urlString completion:(void (^)(NSDictionary *responseDictionary, NSError *error))completion
+{
+    [self sendJSONRequestWithURLString:urlString method:@"GET" body:nil priority:BCLHTTPRequestPriorityAdmin retry:^{
+        if (![self retrySelector:@selector(fetchPageWithURLString:completion:) sender:self parameters:@[urlString, completion]]) {
+            completion(nil, [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: @"Unauthorized"}]);
+        }
+    } completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        completion(error ? nil : responseDictionary, error);
+    }];
+}
+
 - (NSString *)triggerNameForEventType:(BCLEventType)eventType
 {
     switch (eventType) {
@@ -0,0 +1,40 @@
+//
+//  BCLAdminBulkExecutor.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BCLAdminBackend;
+
+/**
+ *  Runs BCLAdminBulkOperation objects against the admin backend keeping up to maxConcurrentOperations
+ *  requests in flight. A failed operation is put at the end of the pipeline and retried until it
+ *  has been attempted maxAttempts times, so that it doesn't hold up the remaining operations. Creates are
+ *  retried only when the request failed before reaching the backend, any other failed create is reported as failed
+ *  so that it isn't duplicated.
+ */
+@interface BCLAdminBulkExecutor : NSObject
+
+/// Defaults to the transport's limit of concurrent admin requests. A higher value doesn't send more requests
+/// at a time, operations above the limit only wait in the transport queue.
+@property (nonatomic) NSUInteger maxConcurrentOperations;
+
+/// Defaults to 2
+@property (nonatomic) NSUInteger maxAttempts;
+
+- (instancetype)initWithBackend:(BCLAdminBackend *)backend;
+
+/**
+ *  Performs operations and calls the completion on the main queue with an array of BCLAdminBulkOperationResult
+ *  objects, in the same order as the operations.
+ */
+- (void)performOperations:(NSArray *)operations completion:(void (^)(NSArray *results))completion;
+
+@end
@@ -0,0 +1,209 @@
+//
+//  BCLAdminBulkExecutor.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLAdminBulkExecutor.h"
+#import "BCLAdminBulkOperation.h"
+#import "BCLAdminBackend.h"
+#import "BCLBeaconCtrl.h"
+
+static NSUInteger const BCLAdminBulkDefaultMaxAttempts = 2;
+
+@interface BCLAdminBulkRun : NSObject
+
+@property (nonatomic, copy) NSArray *operations;
+@property (nonatomic, copy) void (^completion)(NSArray *results);
+
+// Indexes of operations waiting to be sent, in order
+@property (nonatomic, strong) NSMutableArray *pendingIndexes;
+@property (nonatomic, strong) NSMutableArray *results;
+@property (nonatomic, strong) NSMutableArray *attempts;
+@property (nonatomic) NSUInteger inFlightCount;
+
+@end
+
+@implementation BCLAdminBulkRun
+
+@end
+
+@interface BCLAdminBulkExecutor ()
+
+@property (nonatomic, weak) BCLAdminBackend *backend;
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+@end
+
+@implementation BCLAdminBulkExecutor
+
+- (instancetype)initWithBackend:(BCLAdminBackend *)backend
+{
+    if (self = [super init]) {
+        _backend = backend;
+        _maxConcurrentOperations = [backend.transport maxConcurrentRequestsCountForPriority:BCLHTTPRequestPriorityAdmin];
+        _maxAttempts = BCLAdminBulkDefaultMaxAttempts;
+        _queue = dispatch_queue_create("com.up-next.BeaconCtrl.admin.bulk", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)performOperations:(NSArray *)operations completion:(void (^)(NSArray *))completion
+{
+    BCLAdminBulkRun *run = [BCLAdminBulkRun new];
+    run.operations = operations;
+    run.completion = completion;
+    run.pendingIndexes = [NSMutableArray arrayWithCapacity:operations.count];
+    run.results = [NSMutableArray arrayWithCapacity:operations.count];
+    run.attempts = [NSMutableArray arrayWithCapacity:operations.count];
+
+    for (NSUInteger idx = 0; idx < operations.count; idx++) {
+        [run.pendingIndexes addObject:@(idx)];
+        [run.results addObject:[NSNull null]];
+        [run.attempts addObject:@0];
+    }
+
+    dispatch_async(self.queue, ^{
+        [self pumpRun:run];
+    });
+}
+
+#pragma mark - Private
+
+- (void)pumpRun:(BCLAdminBulkRun *)run
+{
+    while (run.inFlightCount < MAX(self.maxConcurrentOperations, 1) && run.pendingIndexes.count) {
+        NSUInteger idx = [run.pendingIndexes.firstObject unsignedIntegerValue];
+        [run.pendingIndexes removeObjectAtIndex:0];
+
+        run.inFlightCount++;
+        run.attempts[idx] = @([run.attempts[idx] unsignedIntegerValue] + 1);
+
+        [self performOperation:run.operations[idx] completion:^(BOOL success, id object, NSError *error) {
+            dispatch_async(self.queue, ^{
+                [self finishOperationAtIndex:idx ofRun:run success:success object:object error:error];
+            });
+        }];
+    }
+
+    if (!run.inFlightCount && !run.pendingIndexes.count) {
+        NSArray *results = [run.results copy];
+        void (^completion)(NSArray *) = run.completion;
+        run.completion = nil;
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(results);
+            });
+        }
+    }
+}
+
+- (void)finishOperationAtIndex:(NSUInteger)idx ofRun:(BCLAdminBulkRun *)run success:(BOOL)success object:(id)object error:(NSError *)error
+{
+    run.inFlightCount--;
+
+    NSUInteger attempts = [run.attempts[idx] unsignedIntegerValue];
+
+    if (!success && attempts < self.maxAttempts && [self canRetryOperation:run.operations[idx] afterError:error]) {
+        [run.pendingIndexes addObject:@(idx)];
+    } else {
+        run.results[idx] = [[BCLAdminBulkOperationResult alloc] initWithOperation:run.operations[idx] success:success object:object error:error attempts:attempts];
+    }
+
+    [self pumpRun:run];
+}
+
+- (BOOL)canRetryOperation:(BCLAdminBulkOperation *)operation afterError:(NSError *)error
+{
+    // Invalid parameters won't get any better when sent again
+    if ([error.domain isEqualToString:BCLErrorDomain] && error.code == BCLInvalidParametersErrorCode) {
+        return NO;
+    }
+
+    switch (operation.type) {
+        case BCLAdminBulkOperationTypeCreateBeacon:
+        case BCLAdminBulkOperationTypeCreateZone:
+            // Creates aren't idempotent, a create that might have reached the backend would be duplicated by a retry
+            return [self isErrorBeforeSendingRequest:error];
+        default:
+            return YES;
+    }
+}
+
+/**
+ *  Whether the request certainly failed before any of it was sent to the backend
+ */
+- (BOOL)isErrorBeforeSendingRequest:(NSError *)error
+{
+    if (![error.domain isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+
+    switch (error.code) {
+        case NSURLErrorNotConnectedToInternet:
+        case NSURLErrorCannotFindHost:
+        case NSURLErrorDNSLookupFailed:
+        case NSURLErrorCannotConnectToHost:
+        case NSURLErrorSecureConnectionFailed:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+- (void)performOperation:(BCLAdminBulkOperation *)operation completion:(void (^)(BOOL success, id object, NSError *error))completion
+{
+    BCLAdminBackend *backend = self.backend;
+
+    if (!backend) {
+        completion(NO, nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Invalid backend integration"}]);
+        return;
+    }
+
+    void (^boolCompletion)(BOOL, NSError *) = ^(BOOL success, NSError *error) {
+        completion(success && !error, nil, error);
+    };
+
+    switch (operation.type) {
+        case BCLAdminBulkOperationTypeCreateBeacon:
+        {
+            [backend createBeacon:operation.beacon testActionName:operation.testActionName testActionTrigger:operation.testActionTrigger testActionAttributes:operation.testActionAttributes completion:^(BCLBeacon *newBeacon, NSError *error) {
+                completion(newBeacon && !error, newBeacon, error);
+            }];
+            break;
+        }
+        case BCLAdminBulkOperationTypeUpdateBeacon:
+            [backend updateBeacon:operation.beacon testActionName:operation.testActionName testActionTrigger:operation.testActionTrigger testActionAttributes:operation.testActionAttributes completion:boolCompletion];
+            break;
+        case BCLAdminBulkOperationTypeDeleteBeacon:
+            [backend deleteBeacon:operation.beacon completion:boolCompletion];
+            break;
+        case BCLAdminBulkOperationTypeSyncBeacon:
+        {
+            [backend syncBeacon:operation.beacon completion:^(NSError *error) {
+                completion(!error, nil, error);
+            }];
+            break;
+        }
+        case BCLAdminBulkOperationTypeCreateZone:
+        {
+            [backend createZone:operation.zone completion:^(BCLZone *newZone, NSError *error) {
+                completion(newZone && !error, newZone, error);
+            }];
+            break;
+        }
+        case BCLAdminBulkOperationTypeUpdateZone:
+            [backend updateZone:operation.zone completion:boolCompletion];
+            break;
+        case BCLAdminBulkOperationTypeDeleteZone:
+            [backend deleteZone:operation.zone completion:boolCompletion];
+            break;
+    }
+}
+
+@end
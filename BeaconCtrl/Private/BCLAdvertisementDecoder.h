@@ -0,0 +1,100 @@
+//
+//  BCLAdvertisementDecoder.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import "BCLBeaconIdentity.h"
+
+@class BCLBeacon;
+
+/// Service UUID Eddystone frames are advertised under
+extern NSString * const BCLEddystoneServiceUUIDString;
+
+/// Long enough for the longest Eddystone-URL: "https://www." followed by 17 expanded bytes, NUL terminated
+#define BCLEddystoneURLMaxLength 128
+
+typedef NS_ENUM(uint8_t, BCLAdvertisementFrameType) {
+    BCLAdvertisementFrameTypeUnknown = 0,
+    BCLAdvertisementFrameTypeIBeacon,
+    BCLAdvertisementFrameTypeEddystoneUID,
+    BCLAdvertisementFrameTypeEddystoneURL,
+    BCLAdvertisementFrameTypeEddystoneTLM
+};
+
+typedef NS_ENUM(uint8_t, BCLAdvertisementPayloadKind) {
+    /// Service data advertised for the Eddystone service UUID
+    BCLAdvertisementPayloadKindEddystoneServiceData,
+    /// Manufacturer specific data, starting with the little endian company identifier
+    BCLAdvertisementPayloadKindManufacturerData
+};
+
+typedef struct {
+    uint8_t version;
+    /// Battery voltage in mV, 0 if not supported
+    uint16_t batteryVoltage;
+    /// Signed 8.8 fixed point temperature in degrees Celsius, INT16_MIN if not supported
+    int16_t temperature;
+    uint32_t advertisingCount;
+    /// Time since power-on in 0.1 s units
+    uint32_t uptime;
+} BCLEddystoneTelemetry;
+
+typedef struct {
+    BCLAdvertisementFrameType type;
+    /// Calibrated power: at 1 m for iBeacon, at 0 m for Eddystone
+    int8_t txPower;
+    int16_t rssi;
+    union {
+        /// iBeacon and Eddystone-UID frames
+        BCLBeaconIdentity identity;
+        /// Eddystone-TLM frames
+        BCLEddystoneTelemetry telemetry;
+        /// Eddystone-URL frames, NUL terminated
+        char url[BCLEddystoneURLMaxLength];
+    };
+} BCLAdvertisementReading;
+
+typedef struct {
+    BCLAdvertisementPayloadKind kind;
+    int16_t rssi;
+    const uint8_t *bytes;
+    size_t length;
+} BCLAdvertisementFrame;
+
+/**
+ *  Decodes a single frame. Returns NO for malformed frames and for frames of other formats.
+ */
+BOOL BCLAdvertisementDecode(const BCLAdvertisementFrame *frame, BCLAdvertisementReading *reading);
+
+/**
+ *  Decodes count frames, writing readings of the valid ones next to each other. Returns the number of readings written;
+ *  readings has to have room for count elements.
+ */
+NSUInteger BCLAdvertisementDecodeBatch(const BCLAdvertisementFrame *frames, NSUInteger count, BCLAdvertisementReading *readings);
+
+/**
+ *  Estimated distance in meters basing on the RSSI and calibrated power of an iBeacon or Eddystone-UID reading,
+ *  or a negative value if it cannot be estimated.
+ */
+double BCLAdvertisementReadingEstimatedDistance(const BCLAdvertisementReading *reading);
+
+/**
+ *  Maps iBeacon and Eddystone-UID readings to configured beacons using their packed identities.
+ */
+@interface BCLAdvertisementResolver : NSObject
+
+/// Number of configured beacons that can only be detected by scanning, i.e. Eddystone ones
+@property (nonatomic, readonly) NSUInteger eddystoneBeaconsCount;
+
+- (instancetype)initWithBeacons:(NSSet *)beacons;
+
+- (BCLBeacon *)beaconForReading:(const BCLAdvertisementReading *)reading;
+
+@end
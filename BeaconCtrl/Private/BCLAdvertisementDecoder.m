@@ -0,0 +1,313 @@
+//
+//  BCLAdvertisementDecoder.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLAdvertisementDecoder.h"
+#import "BCLBeacon.h"
+
+NSString * const BCLEddystoneServiceUUIDString = @"FEAA";
+
+static uint8_t const BCLEddystoneFrameTypeUID = 0x00;
+static uint8_t const BCLEddystoneFrameTypeURL = 0x10;
+static uint8_t const BCLEddystoneFrameTypeTLM = 0x20;
+
+static size_t const BCLEddystoneUIDMinLength = 18;
+static size_t const BCLEddystoneURLMinLength = 3;
+static size_t const BCLEddystoneURLMaxEncodedLength = 20;
+static size_t const BCLEddystoneTLMLength = 14;
+
+// Apple company id (little endian), iBeacon type and remaining length
+static uint8_t const BCLIBeaconPrefix[] = {0x4c, 0x00, 0x02, 0x15};
+static size_t const BCLIBeaconLength = 25;
+
+// Eddystone-UID calibrated power is measured at 0 m, the one of iBeacon at 1 m
+static int const BCLEddystoneTxPowerLossAt1m = 41;
+
+static const char * const BCLEddystoneURLSchemes[] = {
+    "http://www.",
+    "https://www.",
+    "http://",
+    "https://"
+};
+
+static const char * const BCLEddystoneURLExpansions[] = {
+    ".com/", ".org/", ".edu/", ".net/", ".info/", ".biz/", ".gov/",
+    ".com", ".org", ".edu", ".net", ".info", ".biz", ".gov"
+};
+
+static inline uint16_t BCLReadUInt16BE(const uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] << 8 | bytes[1]);
+}
+
+static inline uint32_t BCLReadUInt32BE(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | (uint32_t)bytes[3];
+}
+
+static BOOL BCLAppendString(char *output, size_t *length, const char *string)
+{
+    size_t stringLength = strlen(string);
+    if (*length + stringLength >= BCLEddystoneURLMaxLength) {
+        return NO;
+    }
+    memcpy(output + *length, string, stringLength);
+    *length += stringLength;
+    return YES;
+}
+
+static BOOL BCLDecodeEddystoneURL(const uint8_t *bytes, size_t length, char *output)
+{
+    if (bytes[0] >= sizeof(BCLEddystoneURLSchemes) / sizeof(BCLEddystoneURLSchemes[0])) {
+        return NO;
+    }
+
+    size_t outputLength = 0;
+    BCLAppendString(output, &outputLength, BCLEddystoneURLSchemes[bytes[0]]);
+
+    for (size_t idx = 1; idx < length; idx++) {
+        uint8_t byte = bytes[idx];
+        if (byte < sizeof(BCLEddystoneURLExpansions) / sizeof(BCLEddystoneURLExpansions[0])) {
+            if (!BCLAppendString(output, &outputLength, BCLEddystoneURLExpansions[byte])) {
+                return NO;
+            }
+        } else if (byte > 0x20 && byte < 0x7f) {
+            if (outputLength + 1 >= BCLEddystoneURLMaxLength) {
+                return NO;
+            }
+            output[outputLength++] = (char)byte;
+        } else {
+            return NO;
+        }
+    }
+
+    output[outputLength] = '\0';
+    return YES;
+}
+
+static BOOL BCLDecodeEddystone(const uint8_t *bytes, size_t length, BCLAdvertisementReading *reading)
+{
+    if (length < 1) {
+        return NO;
+    }
+
+    switch (bytes[0]) {
+        case BCLEddystoneFrameTypeUID:
+        {
+            if (length < BCLEddystoneUIDMinLength) {
+                return NO;
+            }
+            reading->type = BCLAdvertisementFrameTypeEddystoneUID;
+            reading->txPower = (int8_t)bytes[1];
+            reading->identity.type = BCLBeaconIdentityTypeEddystone;
+            memcpy(reading->identity.namespaceId, bytes + 2, sizeof(reading->identity.namespaceId));
+            memcpy(reading->identity.instanceId, bytes + 12, sizeof(reading->identity.instanceId));
+            return YES;
+        }
+        case BCLEddystoneFrameTypeURL:
+        {
+            if (length < BCLEddystoneURLMinLength || length > BCLEddystoneURLMaxEncodedLength) {
+                return NO;
+            }
+            reading->type = BCLAdvertisementFrameTypeEddystoneURL;
+            reading->txPower = (int8_t)bytes[1];
+            return BCLDecodeEddystoneURL(bytes + 2, length - 2, reading->url);
+        }
+        case BCLEddystoneFrameTypeTLM:
+        {
+            // Only the unencrypted version 0 is supported
+            if (length < BCLEddystoneTLMLength || bytes[1] != 0) {
+                return NO;
+            }
+            reading->type = BCLAdvertisementFrameTypeEddystoneTLM;
+            reading->telemetry.version = bytes[1];
+            reading->telemetry.batteryVoltage = BCLReadUInt16BE(bytes + 2);
+            reading->telemetry.temperature = (int16_t)BCLReadUInt16BE(bytes + 4);
+            reading->telemetry.advertisingCount = BCLReadUInt32BE(bytes + 6);
+            reading->telemetry.uptime = BCLReadUInt32BE(bytes + 10);
+            return YES;
+        }
+        default:
+            return NO;
+    }
+}
+
+static BOOL BCLDecodeIBeacon(const uint8_t *bytes, size_t length, BCLAdvertisementReading *reading)
+{
+    if (length != BCLIBeaconLength || memcmp(bytes, BCLIBeaconPrefix, sizeof(BCLIBeaconPrefix)) != 0) {
+        return NO;
+    }
+
+    reading->type = BCLAdvertisementFrameTypeIBeacon;
+    reading->identity.type = BCLBeaconIdentityTypeIBeacon;
+    reading->identity.fields = BCLBeaconIdentityFieldUUID | BCLBeaconIdentityFieldMajor | BCLBeaconIdentityFieldMinor;
+    memcpy(reading->identity.uuid, bytes + 4, sizeof(reading->identity.uuid));
+    reading->identity.major = BCLReadUInt16BE(bytes + 20);
+    reading->identity.minor = BCLReadUInt16BE(bytes + 22);
+    reading->txPower = (int8_t)bytes[24];
+    return YES;
+}
+
+BOOL BCLAdvertisementDecode(const BCLAdvertisementFrame *frame, BCLAdvertisementReading *reading)
+{
+    memset(reading, 0, sizeof(BCLAdvertisementReading));
+
+    if (!frame->bytes) {
+        return NO;
+    }
+
+    reading->rssi = frame->rssi;
+
+    BOOL success = NO;
+    switch (frame->kind) {
+        case BCLAdvertisementPayloadKindEddystoneServiceData:
+            success = BCLDecodeEddystone(frame->bytes, frame->length, reading);
+            break;
+        case BCLAdvertisementPayloadKindManufacturerData:
+            success = BCLDecodeIBeacon(frame->bytes, frame->length, reading);
+            break;
+    }
+
+    if (!success) {
+        memset(reading, 0, sizeof(BCLAdvertisementReading));
+    }
+
+    return success;
+}
+
+NSUInteger BCLAdvertisementDecodeBatch(const BCLAdvertisementFrame *frames, NSUInteger count, BCLAdvertisementReading *readings)
+{
+    NSUInteger decodedCount = 0;
+
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        if (BCLAdvertisementDecode(&frames[idx], &readings[decodedCount])) {
+            decodedCount++;
+        }
+    }
+
+    return decodedCount;
+}
+
+double BCLAdvertisementReadingEstimatedDistance(const BCLAdvertisementReading *reading)
+{
+    // CoreBluetooth reports 127 when the RSSI is not available
+    if (reading->rssi >= 0) {
+        return -1;
+    }
+
+    int txPowerAt1m;
+    switch (reading->type) {
+        case BCLAdvertisementFrameTypeIBeacon:
+            txPowerAt1m = reading->txPower;
+            break;
+        case BCLAdvertisementFrameTypeEddystoneUID:
+            txPowerAt1m = reading->txPower - BCLEddystoneTxPowerLossAt1m;
+            break;
+        default:
+            return -1;
+    }
+
+    // Free space path loss
+    return pow(10.0, (txPowerAt1m - reading->rssi) / 20.0);
+}
+
+#pragma mark - BCLAdvertisementResolver
+
+static Boolean BCLIdentityEqual(const void *value, const void *otherValue)
+{
+    return BCLBeaconIdentityEqual(value, otherValue);
+}
+
+static CFHashCode BCLIdentityHash(const void *value)
+{
+    return BCLBeaconIdentityHash(value);
+}
+
+@interface BCLAdvertisementResolver ()
+
+// Keys point into identities, which are owned by the resolver
+@property (nonatomic) BCLBeaconIdentity *identities;
+@property (nonatomic) CFMutableDictionaryRef beaconsByIdentity;
+@property (nonatomic, readwrite) NSUInteger eddystoneBeaconsCount;
+
+@end
+
+@implementation BCLAdvertisementResolver
+
+- (instancetype)initWithBeacons:(NSSet *)beacons
+{
+    if (self = [super init]) {
+        CFDictionaryKeyCallBacks keyCallbacks = {0, NULL, NULL, NULL, BCLIdentityEqual, BCLIdentityHash};
+        _beaconsByIdentity = CFDictionaryCreateMutable(kCFAllocatorDefault, beacons.count, &keyCallbacks, &kCFTypeDictionaryValueCallBacks);
+        _identities = calloc(MAX(beacons.count, 1), sizeof(BCLBeaconIdentity));
+
+        NSUInteger count = 0;
+        for (BCLBeacon *beacon in beacons) {
+            BCLBeaconIdentity *identity = &_identities[count];
+            if (![self getIdentity:identity forBeacon:beacon]) {
+                continue;
+            }
+
+            if (identity->type == BCLBeaconIdentityTypeEddystone) {
+                _eddystoneBeaconsCount++;
+            }
+
+            CFDictionarySetValue(_beaconsByIdentity, identity, (__bridge const void *)beacon);
+            count++;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_beaconsByIdentity) {
+        CFRelease(_beaconsByIdentity);
+    }
+    free(_identities);
+}
+
+- (BCLBeacon *)beaconForReading:(const BCLAdvertisementReading *)reading
+{
+    if (reading->type != BCLAdvertisementFrameTypeIBeacon && reading->type != BCLAdvertisementFrameTypeEddystoneUID) {
+        return nil;
+    }
+
+    return (__bridge BCLBeacon *)CFDictionaryGetValue(self.beaconsByIdentity, &reading->identity);
+}
+
+#pragma mark - Private
+
+/**
+ *  Builds an identity in the same form the decoder produces: UUID, major and minor for iBeacons,
+ *  namespace and instance only for Eddystone beacons.
+ */
+- (BOOL)getIdentity:(BCLBeaconIdentity *)identity forBeacon:(BCLBeacon *)beacon
+{
+    memset(identity, 0, sizeof(BCLBeaconIdentity));
+
+    if (beacon.namespaceId && beacon.instanceId) {
+        NSString *idString = [NSString stringWithFormat:@"%@+%@", beacon.namespaceId, beacon.instanceId];
+        return BCLBeaconIdentityParseString(idString, BCLBeaconIdentityTypeEddystone, identity);
+    }
+
+    if (beacon.proximityUUID && beacon.major && beacon.minor) {
+        identity->type = BCLBeaconIdentityTypeIBeacon;
+        identity->fields = BCLBeaconIdentityFieldUUID | BCLBeaconIdentityFieldMajor | BCLBeaconIdentityFieldMinor;
+        [beacon.proximityUUID getUUIDBytes:identity->uuid];
+        identity->major = beacon.major.unsignedShortValue;
+        identity->minor = beacon.minor.unsignedShortValue;
+        return YES;
+    }
+
+    return NO;
+}
+
+@end
@@ -24,6 +24,8 @@
 
 - (void) fetchConfiguration:(void(^)(BCLConfiguration *configuration, NSError *error))completion;
 - (void) sendEvents:(NSArray *)events completion:(void(^)(NSError *error))completion;
+- (void) sendVisitAggregates:(NSDictionary *)aggregates completion:(void(^)(NSError *error))completion;
 - (void) fetchUsersInRangesOfBeacons:(NSSet *)beacons zones:(NSSet *)zones completion:(void (^)(NSDictionary *result, NSError *error))completion;
+- (void) fetchPresenceForRangeIdentifiers:(NSArray *)rangeIdentifiers zoneIdentifiers:(NSArray *)zoneIdentifiers completion:(void (^)(NSDictionary *ranges, NSDictionary *zones, NSError *error))completion;
 
 @end
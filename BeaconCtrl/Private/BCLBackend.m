@@ -12,6 +12,7 @@
 #import "BCLBackend.h"
 
 #import "BCLActionEvent.h"
+#import "BCLVisitAggregator.h"
 #import "BCLBeaconCtrl.h"
 #import "BCLBeacon.h"
 #import "NSHTTPURLResponse+BCLHTTPCodes.h"
@@ -107,58 +108,44 @@ static NSString * const BeaconCtrlUserIdKey = @"BeaconCtrlUserId";
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/configurations", [BCLBackend baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
+    NSMutableURLRequest *request = [self JSONRequestWithURLString:urlString method:@"GET" body:nil];
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      BCLConfiguration *configuration = [[BCLConfiguration alloc] initWithJSON:data];
-                                      if (!configuration) {
-                                          if (completion) {
-                                              completion(nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidDataErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Unable to fetch configuration"}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      
-                                      if (completion) {
-                                          completion(configuration, nil);
-                                      }
-                                  }];
-    [task resume];
+    // The configuration is decoded straight from the response data, not through sendJSONRequestWithURLString:
+    [self.transport sendRequest:request priority:BCLHTTPRequestPriorityConfiguration completion:^(NSData *data, NSURLResponse *response, NSError *error) {
+        NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
+        
+        if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
+            if (processingError) {
+                if(completion) completion(nil, processingError);
+                return;
+            }
+            
+            [self retrySelector:@selector(fetchConfiguration:) sender:self parameters:@[completion]];
+        }]) {
+            return;
+        }
+        
+        if (error || ![httpResponse isSuccess]) {
+            if (completion) {
+                completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
+            }
+            return;
+        }
+        
+        NSError *decodingError = nil;
+        BCLConfiguration *configuration = [[BCLConfiguration alloc] initWithJSON:data error:&decodingError];
+        if (!configuration) {
+            if (completion) {
+                completion(nil, decodingError ?: [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidDataErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Unable to fetch configuration"}]);
+            }
+            return;
+        }
+        
+        
+        if (completion) {
+            completion(configuration, nil);
+        }
+    }];
 }
 
 - (void) sendEvents:(NSArray *)events completion:(void(^)(NSError *error))completion
@@ -178,186 +165,169 @@ static NSString * const BeaconCtrlUserIdKey = @"BeaconCtrlUserId";
     }
     
     NSString *urlString = [NSString stringWithFormat:@"%@/events", [BCLBackend baseURLString]];
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    request.HTTPMethod = @"POST";
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
     
     NSMutableDictionary *payload = [NSMutableDictionary dictionary];
     payload[@"events"] = [NSMutableArray arrayWithCapacity:events.count];
     for (BCLActionEvent *event in events) {
-        NSMutableDictionary *eventDict = [NSMutableDictionary dictionary];
-        
-        eventDict = [@{@"timestamp": @(event.timestamp)} mutableCopy];
-        
-        if (event.beaconIdentifier) {
-            eventDict[@"range_id"] = event.beaconIdentifier;
-        }
-        
-        if (event.zoneIdentifier) {
-            eventDict[@"zone_id"] = event.zoneIdentifier;
-        }
-        
-        if (event.eventTypeName) {
-            eventDict[@"event_type"] = event.eventTypeName;
+        [payload[@"events"] addObject:[event payloadDictionary]];
+    }
+    
+#ifdef DEBUG
+    NSLog(@"sendEvents\n%@", payload);
+#endif
+    
+    [self sendJSONRequestWithURLString:urlString method:@"POST" body:payload priority:BCLHTTPRequestPriorityEvents retry:^{
+        [self retrySelector:@selector(sendEvents:completion:) sender:self parameters:@[events, completion]];
+    } completion:^(id responseObject, NSHTTPURLResponse *response, NSError *error) {
+        if (completion) {
+            completion(error);
         }
-        
-        if (event.actionName) {
-            eventDict[@"action_name"] = event.actionName;
+    }];
+}
+
+/**
+ *  Uploads visit aggregates in the form kept by BCLVisitAggregator, one entry per zone and hour. Counts are deltas
+ *  the backend has to add to what it already has for the same zone and hour.
+ */
+- (void) sendVisitAggregates:(NSDictionary *)aggregates completion:(void(^)(NSError *error))completion
+{
+    if (!self.clientId || !self.clientSecret) {
+        if (completion) {
+            completion([NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Invalid backend integration"}]);
         }
-        
-        if (event.actionIdentifier) {
-            eventDict[@"action_id"] = event.actionIdentifier;
+        return;
+    }
+    
+    if (!aggregates.count) {
+        if (completion) {
+            completion(nil);
         }
-        
-        [payload[@"events"] addObject:[eventDict copy]];
+        return;
     }
     
-    request.HTTPBody = [NSJSONSerialization dataWithJSONObject:payload options:NSJSONWritingPrettyPrinted error:nil];
+    NSString *urlString = [NSString stringWithFormat:@"%@/visits", [BCLBackend baseURLString]];
+    
+    NSMutableArray *visits = [NSMutableArray array];
+    [aggregates enumerateKeysAndObjectsUsingBlock:^(NSString *hourKey, NSDictionary *zones, BOOL *stop) {
+        [zones enumerateKeysAndObjectsUsingBlock:^(NSString *zoneIdentifier, NSDictionary *counts, BOOL *zoneStop) {
+            NSMutableDictionary *visitDict = [@{@"hour": @(hourKey.longLongValue), @"zone_id": zoneIdentifier} mutableCopy];
+            
+            visitDict[@"visits"] = counts[@"visits"] ?: @0;
+            
+            if (counts[@"dwell_histogram"]) {
+                visitDict[@"dwell_histogram"] = counts[@"dwell_histogram"];
+            }
+            
+            NSMutableArray *transitions = [NSMutableArray array];
+            [counts[@"transitions"] enumerateKeysAndObjectsUsingBlock:^(NSString *toZoneIdentifier, NSNumber *count, BOOL *transitionStop) {
+                [transitions addObject:@{@"zone_id": toZoneIdentifier, @"count": count}];
+            }];
+            
+            if (transitions.count) {
+                visitDict[@"transitions"] = [transitions copy];
+            }
+            
+            [visits addObject:[visitDict copy]];
+        }];
+    }];
+    
+    NSDictionary *payload = @{@"dwell_histogram_bounds": BCLVisitAggregatorDwellHistogramBounds(),
+                              @"visits": visits};
     
 #ifdef DEBUG
-    NSLog(@"sendEvents\n%@",[[NSString alloc] initWithData:request.HTTPBody encoding:NSUTF8StringEncoding]);
+    NSLog(@"sendVisitAggregates\n%@", payload);
 #endif
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(sendEvents:completion:) sender:self parameters:@[events, completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          completion(nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"POST" body:payload priority:BCLHTTPRequestPriorityEvents retry:^{
+        [self retrySelector:@selector(sendVisitAggregates:completion:) sender:self parameters:@[aggregates, completion]];
+    } completion:^(id responseObject, NSHTTPURLResponse *response, NSError *error) {
+        if (completion) {
+            completion(error);
+        }
+    }];
 }
 
 #pragma mark - Backend IntegrationPresence
 
 - (void)fetchUsersInRangesOfBeacons:(NSSet *)beacons zones:(NSSet *)zones completion:(void (^)(NSDictionary *, NSError *))completion
 {
-    if (!self.clientId || !self.clientSecret) {
-        if (completion) {
-            completion(nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Invalid backend integration"}]);
-        }
-        return;
-    }
-    
-    NSMutableArray *beaconIdList = [NSMutableArray array];
+    NSMutableArray *beaconIdList = [NSMutableArray arrayWithCapacity:beacons.count];
     [beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, BOOL *stop) {
         [beaconIdList addObject:[NSString stringWithFormat:@"%@", beacon.beaconIdentifier]];
     }];
     
-    NSMutableArray *zoneIdList = [NSMutableArray array];
+    NSMutableArray *zoneIdList = [NSMutableArray arrayWithCapacity:zones.count];
     [zones enumerateObjectsUsingBlock:^(BCLZone *zone, BOOL *stop) {
         [zoneIdList addObject:[NSString stringWithFormat:@"%@", zone.zoneIdentifier]];
     }];
     
-    NSString *pathString = [NSString stringWithFormat:@"%@/presence", [BCLBackend baseURLString]];
-    
-    NSMutableString *queryString = [NSMutableString string];
-    if (beacons.count || zones.count) {
-        if (beacons.count) {
-            [beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, BOOL *stop) {
-                [queryString appendFormat:@"&ranges[]=%@", beacon.beaconIdentifier];
-            }];
-            
-            [queryString deleteCharactersInRange:NSMakeRange(0, 1)];
+    [self fetchPresenceForRangeIdentifiers:beaconIdList zoneIdentifiers:zoneIdList completion:^(NSDictionary *ranges, NSDictionary *zonesDictionary, NSError *error) {
+        if (!completion) {
+            return;
         }
         
-        if (zones.count) {
-            [zones enumerateObjectsUsingBlock:^(BCLZone *zone, BOOL *stop) {
-                [queryString appendFormat:@"&zones[]=%@", zone.zoneIdentifier];
-            }];
-            
-            if (!beacons.count) {
-                [queryString deleteCharactersInRange:NSMakeRange(0, 1)];
+        if (error) {
+            completion(nil, error);
+            return;
+        }
+        
+        NSMutableDictionary *resultDictionary = [NSMutableDictionary dictionary];
+        resultDictionary[@"ranges"] = [NSMutableDictionary dictionary];
+        resultDictionary[@"zones"] = [NSMutableDictionary dictionary];
+        [beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, BOOL *stop) {
+            if (ranges[beacon.beaconIdentifier]) {
+                resultDictionary[@"ranges"][beacon] = ranges[beacon.beaconIdentifier];
+            }
+        }];
+        
+        [zones enumerateObjectsUsingBlock:^(BCLZone *zone, BOOL *stop) {
+            if (zonesDictionary[zone.zoneIdentifier]) {
+                resultDictionary[@"zones"][zone] = zonesDictionary[zone.zoneIdentifier];
             }
+        }];
+        
+        completion([resultDictionary copy], nil);
+    }];
+}
+
+- (void)fetchPresenceForRangeIdentifiers:(NSArray *)rangeIdentifiers zoneIdentifiers:(NSArray *)zoneIdentifiers completion:(void (^)(NSDictionary *ranges, NSDictionary *zones, NSError *error))completion
+{
+    if (!self.clientId || !self.clientSecret) {
+        if (completion) {
+            completion(nil, nil, [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Invalid backend integration"}]);
         }
+        return;
     }
     
-    NSString *urlString = [NSString stringWithFormat:@"%@?%@", pathString, queryString];
+    NSString *pathString = [NSString stringWithFormat:@"%@/presence", [BCLBackend baseURLString]];
+    
+    NSMutableArray *queryItems = [NSMutableArray arrayWithCapacity:rangeIdentifiers.count + zoneIdentifiers.count];
+    for (NSString *rangeIdentifier in rangeIdentifiers) {
+        [queryItems addObject:[NSString stringWithFormat:@"ranges[]=%@", rangeIdentifier]];
+    }
     
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:urlString]];
-    [self setupURLRequest:request];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-    [request addValue:@"application/json" forHTTPHeaderField:@"Accept"];
+    for (NSString *zoneIdentifier in zoneIdentifiers) {
+        [queryItems addObject:[NSString stringWithFormat:@"zones[]=%@", zoneIdentifier]];
+    }
+    
+    NSString *urlString = [NSString stringWithFormat:@"%@?%@", pathString, [queryItems componentsJoinedByString:@"&"]];
     
-    NSURLSession *session = [NSURLSession sharedSession];
-    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
-                                            completionHandler:
-                                  ^(NSData *data, NSURLResponse *response, NSError *error) {
-                                      NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-                                      
-                                      if ([self shouldFurtherProcessResponse:response completion:^(NSError *processingError) {
-                                          if (processingError) {
-                                              if(completion) completion(nil, processingError);
-                                              return;
-                                          }
-                                          
-                                          [self retrySelector:@selector(fetchUsersInRangesOfBeacons:zones:completion:) sender:self parameters:@[beacons ? : [NSNull null], zones ? : [NSNull null], completion]];
-                                      }]) {
-                                          return;
-                                      }
-                                      
-                                      if (error || ![httpResponse isSuccess]) {
-                                          if (completion) {
-                                              completion(nil, error ?: [NSError errorWithDomain:BCLErrorDomain code:BCLErrorHTTPError userInfo:@{NSLocalizedDescriptionKey: [httpResponse description]}]);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      NSError *jsonError = nil;
-                                      NSDictionary *responseDictionary = nil;
-                                      if (data) {
-                                          responseDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:&jsonError];
-                                      }
-                                      if (!responseDictionary && jsonError) {
-                                          if (completion) {
-                                              completion(nil, jsonError);
-                                          }
-                                          return;
-                                      }
-                                      
-                                      if (completion) {
-                                          NSMutableDictionary *resultDictionary = [NSMutableDictionary dictionary];
-                                          resultDictionary[@"ranges"] = [NSMutableDictionary dictionary];
-                                          resultDictionary[@"zones"] = [NSMutableDictionary dictionary];
-                                          [beacons enumerateObjectsUsingBlock:^(BCLBeacon *beacon, BOOL *stop) {
-                                              if (responseDictionary[@"ranges"][beacon.beaconIdentifier]) {
-                                                  resultDictionary[@"ranges"][beacon] = responseDictionary[@"ranges"][beacon.beaconIdentifier];
-                                              }
-                                          }];
-                                          
-                                          [zones enumerateObjectsUsingBlock:^(BCLZone *zone, BOOL *stop) {
-                                              if (responseDictionary[@"zones"][zone.zoneIdentifier]) {
-                                                  resultDictionary[@"zones"][zone] = responseDictionary[@"zones"][zone.zoneIdentifier];
-                                              }
-                                          }];
-                                          
-                                          completion([resultDictionary copy], nil);
-                                      }
-                                  }];
-    [task resume];
+    [self sendJSONRequestWithURLString:urlString method:@"GET" body:nil priority:BCLHTTPRequestPriorityPresence retry:^{
+        [self retrySelector:@selector(fetchPresenceForRangeIdentifiers:zoneIdentifiers:completion:) sender:self parameters:@[rangeIdentifiers ? : [NSNull null], zoneIdentifiers ? : [NSNull null], completion]];
+    } completion:^(NSDictionary *responseDictionary, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (completion) {
+                completion(nil, nil, error);
+            }
+            return;
+        }
+        
+        if (completion) {
+            NSDictionary *ranges = [responseDictionary[@"ranges"] isKindOfClass:[NSDictionary class]] ? responseDictionary[@"ranges"] : @{};
+            NSDictionary *zones = [responseDictionary[@"zones"] isKindOfClass:[NSDictionary class]] ? responseDictionary[@"zones"] : @{};
+            completion(ranges, zones, nil);
+        }
+    }];
 }
 
 @end
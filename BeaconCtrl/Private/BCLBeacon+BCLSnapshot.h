@@ -0,0 +1,23 @@
+//
+//  BCLBeacon+BCLSnapshot.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLBeacon.h"
+
+@interface BCLBeacon (BCLSnapshot)
+
+/**
+ *  A detached copy of the beacon's current state, for code reading it off the main thread while ranging keeps
+ *  updating the beacon. Has to be taken on the main thread. Unlike -copy, the snapshot has no stays timer, so it never
+ *  fires events of its own.
+ */
+- (BCLBeacon *)bcl_snapshot;
+
+@end
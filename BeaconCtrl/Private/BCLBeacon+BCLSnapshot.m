@@ -0,0 +1,57 @@
+//
+//  BCLBeacon+BCLSnapshot.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLBeacon+BCLSnapshot.h"
+
+@implementation BCLBeacon (BCLSnapshot)
+
+- (BCLBeacon *)bcl_snapshot
+{
+    return [[BCLBeacon alloc] bcl_initWithSnapshotOfBeacon:self];
+}
+
+/**
+ *  Skips -[BCLBeacon init], which schedules the stays timer
+ */
+- (instancetype)bcl_initWithSnapshotOfBeacon:(BCLBeacon *)beacon
+{
+    if (self = [super init]) {
+        // Taken on the main thread, the only one updating readings of the beacon
+        self.protocol = beacon.protocol;
+        self.proximityUUID = beacon.proximityUUID;
+        self.major = beacon.major;
+        self.minor = beacon.minor;
+        self.namespaceId = beacon.namespaceId;
+        self.instanceId = beacon.instanceId;
+        self.beaconIdentifier = beacon.beaconIdentifier;
+        self.name = beacon.name;
+        self.location = beacon.location;
+        self.zone = beacon.zone;
+        self.triggers = beacon.triggers;
+        self.vendor = beacon.vendor;
+        self.vendorIdentifier = beacon.vendorIdentifier;
+        self.vendorFirmwareVersion = beacon.vendorFirmwareVersion;
+        self.transmissionPower = beacon.transmissionPower;
+        self.transmissionInterval = beacon.transmissionInterval;
+        self.batteryLevel = beacon.batteryLevel;
+        
+        // Setting the proximity and accuracy has side effects, which the fields set after them override
+        self.proximity = beacon.proximity;
+        self.accuracy = beacon.accuracy;
+        self.estimatedDistance = beacon.estimatedDistance;
+        self.rssi = beacon.rssi;
+        self.lastEnteredDate = beacon.lastEnteredDate;
+        self.lastLeftDate = beacon.lastLeftDate;
+    }
+    return self;
+}
+
+@end
@@ -0,0 +1,51 @@
+//
+//  BCLBeaconDistanceIndex.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BCLBeacon;
+
+/**
+ *  Keeps a set of beacons ordered by estimatedDistance in an indexed binary min-heap. The order is only updated
+ *  for beacons passed to -updateBeacon:, so it has to be called every time a beacon's estimated distance changes.
+ *  Beacons are compared by identity, not by -isEqual:.
+ */
+@interface BCLBeaconDistanceIndex : NSObject
+
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ *  Replaces indexed beacons with given ones in O(n)
+ */
+- (void)setBeacons:(NSSet *)beacons;
+
+/**
+ *  Moves a beacon to its place after its estimated distance has changed, in O(log n). Beacons that are not indexed
+ *  are ignored.
+ */
+- (void)updateBeacon:(BCLBeacon *)beacon;
+
+/**
+ *  The beacon with the smallest estimated distance, in O(1)
+ */
+- (BCLBeacon *)closestBeacon;
+
+/**
+ *  Up to count beacons with the smallest estimated distances, closest first, in O(count log count)
+ */
+- (NSArray *)closestBeacons:(NSUInteger)count;
+
+/**
+ *  Enumerates beacons closest first. Stopping after k beacons costs O(k log k).
+ */
+- (void)enumerateBeaconsByDistanceUsingBlock:(void (^)(BCLBeacon *beacon, BOOL *stop))block;
+
+@end
@@ -0,0 +1,224 @@
+//
+//  BCLBeaconDistanceIndex.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLBeaconDistanceIndex.h"
+#import "BCLBeacon.h"
+
+/**
+ *  Adds a heap position to a heap of positions ordered by their distances
+ */
+static void BCLCandidatesPush(NSUInteger *candidates, NSUInteger *count, NSUInteger position, const double *distances)
+{
+    NSUInteger idx = (*count)++;
+    candidates[idx] = position;
+
+    while (idx > 0) {
+        NSUInteger parent = (idx - 1) / 2;
+        if (distances[candidates[parent]] <= distances[candidates[idx]]) {
+            break;
+        }
+        NSUInteger tmp = candidates[parent];
+        candidates[parent] = candidates[idx];
+        candidates[idx] = tmp;
+        idx = parent;
+    }
+}
+
+static NSUInteger BCLCandidatesPop(NSUInteger *candidates, NSUInteger *count, const double *distances)
+{
+    NSUInteger result = candidates[0];
+    candidates[0] = candidates[--(*count)];
+
+    NSUInteger idx = 0;
+    while (YES) {
+        NSUInteger smallest = idx;
+        NSUInteger left = 2 * idx + 1;
+        NSUInteger right = left + 1;
+        if (left < *count && distances[candidates[left]] < distances[candidates[smallest]]) {
+            smallest = left;
+        }
+        if (right < *count && distances[candidates[right]] < distances[candidates[smallest]]) {
+            smallest = right;
+        }
+        if (smallest == idx) {
+            break;
+        }
+        NSUInteger tmp = candidates[smallest];
+        candidates[smallest] = candidates[idx];
+        candidates[idx] = tmp;
+        idx = smallest;
+    }
+
+    return result;
+}
+
+@interface BCLBeaconDistanceIndex ()
+
+@property (nonatomic, strong) NSMutableArray *heap;
+/// Distances the heap is ordered by, parallel to heap
+@property (nonatomic) double *distances;
+@property (nonatomic, strong) NSMapTable *positions;
+
+@end
+
+@implementation BCLBeaconDistanceIndex
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _heap = [NSMutableArray array];
+        _positions = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_distances);
+}
+
+- (NSUInteger)count
+{
+    return self.heap.count;
+}
+
+- (void)setBeacons:(NSSet *)beacons
+{
+    self.heap = [beacons.allObjects mutableCopy] ?: [NSMutableArray array];
+    [self.positions removeAllObjects];
+
+    free(_distances);
+    _distances = malloc(sizeof(double) * MAX(self.heap.count, 1));
+
+    NSUInteger count = self.heap.count;
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        BCLBeacon *beacon = self.heap[idx];
+        _distances[idx] = beacon.estimatedDistance;
+        [self.positions setObject:@(idx) forKey:beacon];
+    }
+
+    for (NSUInteger idx = count / 2; idx > 0; idx--) {
+        [self siftDownFromPosition:idx - 1];
+    }
+}
+
+- (void)updateBeacon:(BCLBeacon *)beacon
+{
+    NSNumber *positionNumber = [self.positions objectForKey:beacon];
+    if (!positionNumber) {
+        return;
+    }
+
+    NSUInteger position = positionNumber.unsignedIntegerValue;
+    double previousDistance = _distances[position];
+    _distances[position] = beacon.estimatedDistance;
+
+    if (_distances[position] < previousDistance) {
+        [self siftUpFromPosition:position];
+    } else if (_distances[position] > previousDistance) {
+        [self siftDownFromPosition:position];
+    }
+}
+
+- (BCLBeacon *)closestBeacon
+{
+    return self.heap.firstObject;
+}
+
+- (NSArray *)closestBeacons:(NSUInteger)count
+{
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity:MIN(count, self.heap.count)];
+
+    [self enumerateBeaconsByDistanceUsingBlock:^(BCLBeacon *beacon, BOOL *stop) {
+        [result addObject:beacon];
+        *stop = result.count >= count;
+    }];
+
+    return [result copy];
+}
+
+- (void)enumerateBeaconsByDistanceUsingBlock:(void (^)(BCLBeacon *, BOOL *))block
+{
+    NSUInteger heapCount = self.heap.count;
+    if (!heapCount) {
+        return;
+    }
+
+    // A position is pushed only after its parent has been visited, so every position is pushed at most once
+    NSUInteger *candidates = malloc(sizeof(NSUInteger) * heapCount);
+    NSUInteger candidatesCount = 0;
+    BCLCandidatesPush(candidates, &candidatesCount, 0, _distances);
+
+    BOOL stop = NO;
+    while (candidatesCount && !stop) {
+        NSUInteger position = BCLCandidatesPop(candidates, &candidatesCount, _distances);
+        block(self.heap[position], &stop);
+
+        if (2 * position + 1 < heapCount) {
+            BCLCandidatesPush(candidates, &candidatesCount, 2 * position + 1, _distances);
+        }
+        if (2 * position + 2 < heapCount) {
+            BCLCandidatesPush(candidates, &candidatesCount, 2 * position + 2, _distances);
+        }
+    }
+
+    free(candidates);
+}
+
+#pragma mark - Private
+
+- (void)swapPosition:(NSUInteger)position withPosition:(NSUInteger)otherPosition
+{
+    [self.heap exchangeObjectAtIndex:position withObjectAtIndex:otherPosition];
+
+    double distance = _distances[position];
+    _distances[position] = _distances[otherPosition];
+    _distances[otherPosition] = distance;
+
+    [self.positions setObject:@(position) forKey:self.heap[position]];
+    [self.positions setObject:@(otherPosition) forKey:self.heap[otherPosition]];
+}
+
+- (void)siftUpFromPosition:(NSUInteger)position
+{
+    while (position > 0) {
+        NSUInteger parent = (position - 1) / 2;
+        if (_distances[parent] <= _distances[position]) {
+            break;
+        }
+        [self swapPosition:parent withPosition:position];
+        position = parent;
+    }
+}
+
+- (void)siftDownFromPosition:(NSUInteger)position
+{
+    NSUInteger count = self.heap.count;
+
+    while (YES) {
+        NSUInteger smallest = position;
+        NSUInteger left = 2 * position + 1;
+        NSUInteger right = left + 1;
+        if (left < count && _distances[left] < _distances[smallest]) {
+            smallest = left;
+        }
+        if (right < count && _distances[right] < _distances[smallest]) {
+            smallest = right;
+        }
+        if (smallest == position) {
+            break;
+        }
+        [self swapPosition:position withPosition:smallest];
+        position = smallest;
+    }
+}
+
+@end
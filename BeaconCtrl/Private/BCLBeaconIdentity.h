@@ -0,0 +1,66 @@
+//
+//  BCLBeaconIdentity.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(uint8_t, BCLBeaconIdentityType) {
+    BCLBeaconIdentityTypeInvalid = 0,
+    BCLBeaconIdentityTypeIBeacon,
+    BCLBeaconIdentityTypeEddystone
+};
+
+typedef NS_OPTIONS(uint8_t, BCLBeaconIdentityFields) {
+    BCLBeaconIdentityFieldUUID = 1 << 0,
+    BCLBeaconIdentityFieldMajor = 1 << 1,
+    BCLBeaconIdentityFieldMinor = 1 << 2
+};
+
+/**
+ *  Packed binary identity of a beacon. Unused bytes are always zeroed, so two identities can be
+ *  compared and hashed bytewise.
+ */
+typedef struct {
+    BCLBeaconIdentityType type;
+    BCLBeaconIdentityFields fields;
+    uint16_t major;
+    uint16_t minor;
+    uint8_t uuid[16];
+    uint8_t namespaceId[10];
+    uint8_t instanceId[6];
+} BCLBeaconIdentity;
+
+/**
+ *  Parses an iBeacon proximity_id: "UUID", "UUID+major" or "UUID+major+minor". The UUID has to be in the canonical
+ *  8-4-4-4-12 hex form, major and minor have to be decimal numbers not greater than 65535.
+ *  Doesn't allocate. Returns NO and leaves identity zeroed if the input is malformed.
+ */
+BOOL BCLBeaconIdentityParseIBeacon(const char *bytes, size_t length, BCLBeaconIdentity *identity);
+
+/**
+ *  Parses an Eddystone proximity_id: "namespace+instance" or "UUID+namespace+instance", where namespace is
+ *  20 and instance is 12 hex digits. Doesn't allocate. Returns NO and leaves identity zeroed if the input is malformed.
+ */
+BOOL BCLBeaconIdentityParseEddystone(const char *bytes, size_t length, BCLBeaconIdentity *identity);
+
+/**
+ *  Parses a proximity_id string of a given type. Uses the string's ASCII buffer directly when available and
+ *  a stack buffer otherwise.
+ */
+BOOL BCLBeaconIdentityParseString(NSString *string, BCLBeaconIdentityType type, BCLBeaconIdentity *identity);
+
+BOOL BCLBeaconIdentityEqual(const BCLBeaconIdentity *identity, const BCLBeaconIdentity *otherIdentity);
+
+NSUInteger BCLBeaconIdentityHash(const BCLBeaconIdentity *identity);
+
+/**
+ *  Writes lowercase hex digits of bytes followed by a NUL terminator; output has to fit 2 * length + 1 characters.
+ */
+void BCLBeaconIdentityHexString(const uint8_t *bytes, size_t length, char *output);
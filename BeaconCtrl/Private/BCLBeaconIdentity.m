@@ -0,0 +1,246 @@
+//
+//  BCLBeaconIdentity.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLBeaconIdentity.h"
+
+// Longest valid input is "UUID+namespace+instance": 36 + 1 + 20 + 1 + 12
+static size_t const BCLBeaconIdentityMaxLength = 70;
+
+static size_t const BCLBeaconIdentityUUIDLength = 36;
+
+static inline int BCLHexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ *  Reads exactly 2 * count hex digits into output.
+ */
+static BOOL BCLParseHexBytes(const char *bytes, size_t count, uint8_t *output)
+{
+    for (size_t idx = 0; idx < count; idx++) {
+        int high = BCLHexValue(bytes[2 * idx]);
+        int low = BCLHexValue(bytes[2 * idx + 1]);
+        if (high < 0 || low < 0) {
+            return NO;
+        }
+        output[idx] = (uint8_t)(high << 4 | low);
+    }
+    return YES;
+}
+
+/**
+ *  Reads a canonical 8-4-4-4-12 UUID; length has to be exactly 36.
+ */
+static BOOL BCLParseUUID(const char *bytes, size_t length, uint8_t *output)
+{
+    if (length != BCLBeaconIdentityUUIDLength || bytes[8] != '-' || bytes[13] != '-' || bytes[18] != '-' || bytes[23] != '-') {
+        return NO;
+    }
+
+    return BCLParseHexBytes(bytes, 4, output) &&
+           BCLParseHexBytes(bytes + 9, 2, output + 4) &&
+           BCLParseHexBytes(bytes + 14, 2, output + 6) &&
+           BCLParseHexBytes(bytes + 19, 2, output + 8) &&
+           BCLParseHexBytes(bytes + 24, 6, output + 10);
+}
+
+/**
+ *  Reads a non-empty decimal number not greater than 65535.
+ */
+static BOOL BCLParseUInt16(const char *bytes, size_t length, uint16_t *output)
+{
+    if (length == 0 || length > 5) {
+        return NO;
+    }
+
+    uint32_t value = 0;
+    for (size_t idx = 0; idx < length; idx++) {
+        if (bytes[idx] < '0' || bytes[idx] > '9') {
+            return NO;
+        }
+        value = value * 10 + (uint32_t)(bytes[idx] - '0');
+    }
+
+    if (value > UINT16_MAX) {
+        return NO;
+    }
+
+    *output = (uint16_t)value;
+    return YES;
+}
+
+/**
+ *  Splits input on '+' into at most maxComponents components. Returns the number of components,
+ *  or 0 if there are more than maxComponents of them.
+ */
+static size_t BCLSplitComponents(const char *bytes, size_t length, size_t maxComponents, size_t *starts, size_t *lengths)
+{
+    size_t count = 0;
+    size_t start = 0;
+
+    for (size_t idx = 0; idx <= length; idx++) {
+        if (idx == length || bytes[idx] == '+') {
+            if (count == maxComponents) {
+                return 0;
+            }
+            starts[count] = start;
+            lengths[count] = idx - start;
+            count++;
+            start = idx + 1;
+        }
+    }
+
+    return count;
+}
+
+BOOL BCLBeaconIdentityParseIBeacon(const char *bytes, size_t length, BCLBeaconIdentity *identity)
+{
+    memset(identity, 0, sizeof(BCLBeaconIdentity));
+
+    size_t starts[3];
+    size_t lengths[3];
+    size_t count = BCLSplitComponents(bytes, length, 3, starts, lengths);
+
+    BCLBeaconIdentity result;
+    memset(&result, 0, sizeof(BCLBeaconIdentity));
+    result.type = BCLBeaconIdentityTypeIBeacon;
+
+    if (count == 0 || !BCLParseUUID(bytes + starts[0], lengths[0], result.uuid)) {
+        return NO;
+    }
+    result.fields |= BCLBeaconIdentityFieldUUID;
+
+    if (count > 1) {
+        if (!BCLParseUInt16(bytes + starts[1], lengths[1], &result.major)) {
+            return NO;
+        }
+        result.fields |= BCLBeaconIdentityFieldMajor;
+    }
+
+    if (count > 2) {
+        if (!BCLParseUInt16(bytes + starts[2], lengths[2], &result.minor)) {
+            return NO;
+        }
+        result.fields |= BCLBeaconIdentityFieldMinor;
+    }
+
+    *identity = result;
+    return YES;
+}
+
+BOOL BCLBeaconIdentityParseEddystone(const char *bytes, size_t length, BCLBeaconIdentity *identity)
+{
+    memset(identity, 0, sizeof(BCLBeaconIdentity));
+
+    size_t starts[3];
+    size_t lengths[3];
+    size_t count = BCLSplitComponents(bytes, length, 3, starts, lengths);
+
+    if (count < 2) {
+        return NO;
+    }
+
+    BCLBeaconIdentity result;
+    memset(&result, 0, sizeof(BCLBeaconIdentity));
+    result.type = BCLBeaconIdentityTypeEddystone;
+
+    size_t namespaceIdx = count - 2;
+    size_t instanceIdx = count - 1;
+
+    if (count == 3) {
+        if (!BCLParseUUID(bytes + starts[0], lengths[0], result.uuid)) {
+            return NO;
+        }
+        result.fields |= BCLBeaconIdentityFieldUUID;
+    }
+
+    if (lengths[namespaceIdx] != 2 * sizeof(result.namespaceId) || !BCLParseHexBytes(bytes + starts[namespaceIdx], sizeof(result.namespaceId), result.namespaceId)) {
+        return NO;
+    }
+
+    if (lengths[instanceIdx] != 2 * sizeof(result.instanceId) || !BCLParseHexBytes(bytes + starts[instanceIdx], sizeof(result.instanceId), result.instanceId)) {
+        return NO;
+    }
+
+    *identity = result;
+    return YES;
+}
+
+BOOL BCLBeaconIdentityParseString(NSString *string, BCLBeaconIdentityType type, BCLBeaconIdentity *identity)
+{
+    memset(identity, 0, sizeof(BCLBeaconIdentity));
+
+    if (![string isKindOfClass:[NSString class]]) {
+        return NO;
+    }
+
+    size_t length = (size_t)CFStringGetLength((__bridge CFStringRef)string);
+    if (length > BCLBeaconIdentityMaxLength) {
+        return NO;
+    }
+
+    char buffer[BCLBeaconIdentityMaxLength + 1];
+    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingASCII);
+    if (!bytes) {
+        if (!CFStringGetCString((__bridge CFStringRef)string, buffer, sizeof(buffer), kCFStringEncodingASCII)) {
+            return NO;
+        }
+        bytes = buffer;
+    }
+
+    switch (type) {
+        case BCLBeaconIdentityTypeIBeacon:
+            return BCLBeaconIdentityParseIBeacon(bytes, length, identity);
+        case BCLBeaconIdentityTypeEddystone:
+            return BCLBeaconIdentityParseEddystone(bytes, length, identity);
+        case BCLBeaconIdentityTypeInvalid:
+            return NO;
+    }
+
+    return NO;
+}
+
+BOOL BCLBeaconIdentityEqual(const BCLBeaconIdentity *identity, const BCLBeaconIdentity *otherIdentity)
+{
+    return memcmp(identity, otherIdentity, sizeof(BCLBeaconIdentity)) == 0;
+}
+
+NSUInteger BCLBeaconIdentityHash(const BCLBeaconIdentity *identity)
+{
+    // FNV-1a over the packed bytes
+    const uint8_t *bytes = (const uint8_t *)identity;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t idx = 0; idx < sizeof(BCLBeaconIdentity); idx++) {
+        hash ^= bytes[idx];
+        hash *= 1099511628211ULL;
+    }
+    return (NSUInteger)hash;
+}
+
+void BCLBeaconIdentityHexString(const uint8_t *bytes, size_t length, char *output)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (size_t idx = 0; idx < length; idx++) {
+        output[2 * idx] = digits[bytes[idx] >> 4];
+        output[2 * idx + 1] = digits[bytes[idx] & 0x0f];
+    }
+    output[2 * length] = '\0';
+}
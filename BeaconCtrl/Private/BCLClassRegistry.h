@@ -0,0 +1,30 @@
+//
+//  BCLClassRegistry.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Maps names used in the configuration to classes implementing extensions and conditions.
+ *  Classes are looked up among registered ones first; classes that weren't registered are found by scanning
+ *  the runtime once per protocol, the results of which are cached. Safe to use from any thread.
+ */
+@interface BCLClassRegistry : NSObject
+
++ (instancetype)sharedRegistry;
+
+- (void)registerClass:(Class)aClass forName:(NSString *)name protocol:(Protocol *)protocol;
+
+/**
+ *  @param nameSelector A class method returning the name a class should be found by; used only by the fallback scan
+ */
+- (Class)classForName:(NSString *)name protocol:(Protocol *)protocol selector:(SEL)nameSelector;
+
+@end
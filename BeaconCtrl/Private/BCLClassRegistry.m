@@ -0,0 +1,129 @@
+//
+//  BCLClassRegistry.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLClassRegistry.h"
+#import "BCLCondition.h"
+#import "BCLConditionEvent.h"
+
+#import <objc/runtime.h>
+
+@interface BCLClassRegistry ()
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+// Protocol name -> name -> class
+@property (nonatomic, strong) NSMutableDictionary *registeredClasses;
+@property (nonatomic, strong) NSMutableDictionary *scannedClasses;
+
+@end
+
+@implementation BCLClassRegistry
+
++ (instancetype)sharedRegistry
+{
+    static BCLClassRegistry *sharedRegistry;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedRegistry = [[BCLClassRegistry alloc] init];
+
+        // Built-in conditions
+        [sharedRegistry registerClass:[BCLConditionEvent class] forName:[BCLConditionEvent bcl_conditionType] protocol:@protocol(BCLCondition)];
+    });
+    return sharedRegistry;
+}
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _queue = dispatch_queue_create("com.up-next.BeaconCtrl.classRegistry", DISPATCH_QUEUE_CONCURRENT);
+        _registeredClasses = [NSMutableDictionary dictionary];
+        _scannedClasses = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)registerClass:(Class)aClass forName:(NSString *)name protocol:(Protocol *)protocol
+{
+    if (!aClass || !name || !protocol) {
+        return;
+    }
+
+    NSString *protocolName = NSStringFromProtocol(protocol);
+    dispatch_barrier_sync(self.queue, ^{
+        if (!self.registeredClasses[protocolName]) {
+            self.registeredClasses[protocolName] = [NSMutableDictionary dictionary];
+        }
+        self.registeredClasses[protocolName][name] = aClass;
+    });
+}
+
+- (Class)classForName:(NSString *)name protocol:(Protocol *)protocol selector:(SEL)nameSelector
+{
+    if (!name || !protocol) {
+        return nil;
+    }
+
+    NSString *protocolName = NSStringFromProtocol(protocol);
+
+    __block Class result;
+    __block BOOL isScanned = NO;
+    dispatch_sync(self.queue, ^{
+        result = self.registeredClasses[protocolName][name];
+        NSDictionary *scannedClasses = self.scannedClasses[protocolName];
+        isScanned = scannedClasses != nil;
+        if (!result) {
+            result = scannedClasses[name];
+        }
+    });
+
+    if (result || isScanned) {
+        return result;
+    }
+
+    dispatch_barrier_sync(self.queue, ^{
+        // Another thread might have scanned in the meantime
+        if (!self.scannedClasses[protocolName]) {
+            self.scannedClasses[protocolName] = [self scanClassesConformingToProtocol:protocol selector:nameSelector];
+        }
+        result = self.scannedClasses[protocolName][name];
+    });
+
+    return result;
+}
+
+#pragma mark - Private
+
+- (NSDictionary *)scanClassesConformingToProtocol:(Protocol *)protocol selector:(SEL)nameSelector
+{
+    NSMutableDictionary *classes = [NSMutableDictionary dictionary];
+
+    unsigned int numberOfClasses = 0;
+    Class *classList = objc_copyClassList(&numberOfClasses);
+
+    for (unsigned int idx = 0; idx < numberOfClasses; idx++) {
+        Class class = classList[idx];
+        if (class_getClassMethod(class, @selector(conformsToProtocol:)) && [class conformsToProtocol:protocol] && [class respondsToSelector:nameSelector]) {
+#ifdef DEBUG
+            NSLog(@"Found class %@ (%@)", NSStringFromClass(class), NSStringFromProtocol(protocol));
+#endif
+            NSString *name = [class performSelector:nameSelector];
+            if ([name isKindOfClass:[NSString class]] && !classes[name]) {
+                classes[name] = class;
+            }
+        }
+    }
+
+    free(classList);
+
+    return [classes copy];
+}
+
+@end
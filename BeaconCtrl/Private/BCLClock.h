@@ -0,0 +1,79 @@
+//
+//  BCLClock.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  A timer scheduled with a clock. It fires once, unless invalidated before.
+ */
+@interface BCLClockTimer : NSObject
+
+/// The clock's uptime the timer fires at
+@property (nonatomic, readonly) NSTimeInterval fireTime;
+
+- (BOOL)isValid;
+- (void)invalidate;
+
+/// The wall time the timer fires at, according to its clock
+- (NSDate *)fireDate;
+
+@end
+
+/**
+ *  The source of time of the SDK. Intervals are measured with a monotonic clock, so they're not thrown off when the
+ *  system clock is changed, and timers are scheduled with it, so they can be run in virtual time. Reading the time
+ *  doesn't allocate anything.
+ */
+@interface BCLClock : NSObject
+
+/// The clock used throughout the SDK. Defaults to the system clock; set it before starting BCLBeaconCtrl. Safe to read
+/// and set from any thread, but timers already scheduled stay with the clock they were scheduled with.
++ (BCLClock *)currentClock;
+
+/// @param clock A clock to use, or nil to go back to the system clock
++ (void)setCurrentClock:(BCLClock *)clock;
+
++ (BCLClock *)systemClock;
+
+/// Monotonic time in nanoseconds. The system clock doesn't count the time the device is asleep.
+- (uint64_t)nanoseconds;
+
+/// Monotonic time in seconds
+- (NSTimeInterval)uptime;
+
+/// Wall time in seconds since 1970, for timestamps that are stored or sent
+- (NSTimeInterval)timeIntervalSince1970;
+
+- (NSDate *)date;
+
+/**
+ *  Calls a handler once, after a delay measured by this clock
+ *  @param queue A queue the handler is called on by the system clock
+ */
+- (BCLClockTimer *)scheduleTimerWithDelay:(NSTimeInterval)delay queue:(dispatch_queue_t)queue handler:(dispatch_block_t)handler;
+
+@end
+
+/**
+ *  A clock that only moves when told to, so a day of ranging can be simulated in moments. Its timers fire while it's
+ *  advanced, on the thread advancing it, in order of their fire times, with the clock set to the fire time of each.
+ */
+@interface BCLVirtualClock : BCLClock
+
+/// Starts with an uptime of 0 at the given wall time
+- (instancetype)initWithTimeIntervalSince1970:(NSTimeInterval)timeIntervalSince1970;
+
+/**
+ *  Moves the clock forward, firing timers due in the meantime, including ones scheduled by handlers it fires
+ */
+- (void)advanceBy:(NSTimeInterval)interval;
+
+@end
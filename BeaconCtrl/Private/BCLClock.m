@@ -0,0 +1,260 @@
+//
+//  BCLClock.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLClock.h"
+#import <mach/mach_time.h>
+#import <pthread.h>
+
+/// Timers may fire up to this fraction of their delay late, at most a second, so the system can coalesce wake-ups
+static double const BCLClockTimerLeewayRatio = 0.1;
+
+static BCLClock *BCLCurrentClock;
+/// Guards BCLCurrentClock, which is read from any queue. Readers retain the clock before it's unlocked, so a clock swapped
+/// in the meantime isn't released under them.
+static pthread_mutex_t BCLCurrentClockMutex = PTHREAD_MUTEX_INITIALIZER;
+
+@interface BCLClockTimer ()
+
+@property (nonatomic, weak) BCLClock *clock;
+@property (nonatomic, readwrite) NSTimeInterval fireTime;
+@property (nonatomic, copy) dispatch_block_t handler;
+@property (getter=isValid) BOOL valid;
+
+/// Only used by the system clock. Its handler retains the timer until it fires or is invalidated.
+@property (nonatomic, strong) dispatch_source_t source;
+
+@end
+
+@implementation BCLClockTimer
+
+- (void)invalidate
+{
+    @synchronized(self) {
+        if (!self.isValid) {
+            return;
+        }
+        
+        self.valid = NO;
+        self.handler = nil;
+        
+        if (self.source) {
+            dispatch_source_cancel(self.source);
+            self.source = nil;
+        }
+    }
+}
+
+- (NSDate *)fireDate
+{
+    BCLClock *clock = self.clock;
+    if (!self.isValid || !clock) {
+        return nil;
+    }
+    
+    return [NSDate dateWithTimeIntervalSince1970:clock.timeIntervalSince1970 + self.fireTime - clock.uptime];
+}
+
+- (void)fire
+{
+    dispatch_block_t handler;
+    
+    @synchronized(self) {
+        if (!self.isValid) {
+            return;
+        }
+        handler = self.handler;
+        [self invalidate];
+    }
+    
+    if (handler) {
+        handler();
+    }
+}
+
+@end
+
+@implementation BCLClock
+
++ (BCLClock *)currentClock
+{
+    // Read on every ranging reading, so it's a plain mutex rather than @synchronized
+    pthread_mutex_lock(&BCLCurrentClockMutex);
+    BCLClock *clock = BCLCurrentClock;
+    pthread_mutex_unlock(&BCLCurrentClockMutex);
+    
+    return clock ?: [self systemClock];
+}
+
++ (void)setCurrentClock:(BCLClock *)clock
+{
+    BCLClock *previousClock;
+    
+    pthread_mutex_lock(&BCLCurrentClockMutex);
+    previousClock = BCLCurrentClock;
+    BCLCurrentClock = clock;
+    pthread_mutex_unlock(&BCLCurrentClockMutex);
+    
+    // The previous clock is released outside of the lock, as its dealloc may read the current clock
+    previousClock = nil;
+}
+
++ (BCLClock *)systemClock
+{
+    static BCLClock *systemClock;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        systemClock = [[BCLClock alloc] init];
+    });
+    return systemClock;
+}
+
+- (uint64_t)nanoseconds
+{
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+- (NSTimeInterval)uptime
+{
+    return (NSTimeInterval)[self nanoseconds] / NSEC_PER_SEC;
+}
+
+- (NSTimeInterval)timeIntervalSince1970
+{
+    return CFAbsoluteTimeGetCurrent() + kCFAbsoluteTimeIntervalSince1970;
+}
+
+- (NSDate *)date
+{
+    return [NSDate dateWithTimeIntervalSince1970:[self timeIntervalSince1970]];
+}
+
+- (BCLClockTimer *)scheduleTimerWithDelay:(NSTimeInterval)delay queue:(dispatch_queue_t)queue handler:(dispatch_block_t)handler
+{
+    delay = MAX(delay, 0);
+    
+    BCLClockTimer *timer = [[BCLClockTimer alloc] init];
+    timer.clock = self;
+    timer.fireTime = [self uptime] + delay;
+    timer.handler = handler;
+    timer.valid = YES;
+    
+    timer.source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue ?: dispatch_get_main_queue());
+    dispatch_source_set_event_handler(timer.source, ^{
+        [timer fire];
+    });
+    
+    uint64_t leeway = (uint64_t)(MIN(delay * BCLClockTimerLeewayRatio, 1) * NSEC_PER_SEC);
+    dispatch_source_set_timer(timer.source, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, leeway);
+    dispatch_resume(timer.source);
+    
+    return timer;
+}
+
+@end
+
+@interface BCLVirtualClock ()
+
+@property (nonatomic) NSTimeInterval currentUptime;
+@property (nonatomic) NSTimeInterval startTimeIntervalSince1970;
+@property (nonatomic, strong) NSMutableArray *timers;
+
+@end
+
+@implementation BCLVirtualClock
+
+- (instancetype)init
+{
+    return [self initWithTimeIntervalSince1970:CFAbsoluteTimeGetCurrent() + kCFAbsoluteTimeIntervalSince1970];
+}
+
+- (instancetype)initWithTimeIntervalSince1970:(NSTimeInterval)timeIntervalSince1970
+{
+    if (self = [super init]) {
+        _startTimeIntervalSince1970 = timeIntervalSince1970;
+        _timers = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (uint64_t)nanoseconds
+{
+    return (uint64_t)([self uptime] * NSEC_PER_SEC);
+}
+
+- (NSTimeInterval)uptime
+{
+    @synchronized(self) {
+        return self.currentUptime;
+    }
+}
+
+- (NSTimeInterval)timeIntervalSince1970
+{
+    return self.startTimeIntervalSince1970 + [self uptime];
+}
+
+- (BCLClockTimer *)scheduleTimerWithDelay:(NSTimeInterval)delay queue:(dispatch_queue_t)queue handler:(dispatch_block_t)handler
+{
+    BCLClockTimer *timer = [[BCLClockTimer alloc] init];
+    timer.clock = self;
+    timer.handler = handler;
+    timer.valid = YES;
+    
+    @synchronized(self) {
+        timer.fireTime = self.currentUptime + MAX(delay, 0);
+        [self.timers addObject:timer];
+    }
+    
+    return timer;
+}
+
+- (void)advanceBy:(NSTimeInterval)interval
+{
+    NSTimeInterval targetUptime;
+    
+    @synchronized(self) {
+        targetUptime = self.currentUptime + MAX(interval, 0);
+        [self.timers filterUsingPredicate:[NSPredicate predicateWithFormat:@"valid == YES"]];
+    }
+    
+    while (YES) {
+        BCLClockTimer *nextTimer = nil;
+        
+        @synchronized(self) {
+            // Timers due at the same time fire in the order they were scheduled
+            for (BCLClockTimer *timer in self.timers) {
+                if (timer.isValid && timer.fireTime <= targetUptime && (!nextTimer || timer.fireTime < nextTimer.fireTime)) {
+                    nextTimer = timer;
+                }
+            }
+            
+            if (nextTimer) {
+                [self.timers removeObject:nextTimer];
+                self.currentUptime = MAX(self.currentUptime, nextTimer.fireTime);
+            } else {
+                self.currentUptime = targetUptime;
+            }
+        }
+        
+        if (!nextTimer) {
+            break;
+        }
+        [nextTimer fire];
+    }
+}
+
+@end
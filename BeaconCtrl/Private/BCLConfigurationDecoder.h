@@ -0,0 +1,40 @@
+//
+//  BCLConfigurationDecoder.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+/// Byte offset in the decoded data at which decoding failed, in the user info of decoding errors
+extern NSString * const BCLConfigurationDecoderErrorOffsetKey;
+
+/**
+ *  Decodes a configuration fetched from the backend in a single pass over its JSON bytes. Only a single range, zone or
+ *  trigger at a time is turned into Foundation objects, right before it's mapped to a model object, and values that
+ *  aren't used are skipped without building anything, so no tree of the whole configuration is ever built.
+ *  Zones and triggers are linked to beacons by identifier, whatever order the sections come in.
+ */
+@interface BCLConfigurationDecoder : NSObject
+
+@property (nonatomic, copy, readonly) NSSet *beacons;
+@property (nonatomic, copy, readonly) NSSet *zones;
+
+/// Parameters of extensions keyed by extension names
+@property (nonatomic, copy, readonly) NSDictionary *extensionsParameters;
+
+/// nil if the kontakt.io add-on is not switched on
+@property (nonatomic, copy, readonly) NSString *kontaktIOAPIKey;
+
+/**
+ *  @return NO if data is not a valid configuration, with an error in BCLErrorDomain holding the offset at which it's
+ *          invalid under BCLConfigurationDecoderErrorOffsetKey
+ */
+- (BOOL)decodeData:(NSData *)data error:(NSError **)error;
+
+@end
@@ -0,0 +1,760 @@
+//
+//  BCLConfigurationDecoder.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLConfigurationDecoder.h"
+#import "BCLBeaconCtrl.h"
+#import "BCLBeacon.h"
+#import "BCLZone.h"
+#import "BCLTrigger.h"
+
+NSString * const BCLConfigurationDecoderErrorOffsetKey = @"BCLConfigurationDecoderErrorOffsetKey";
+
+// Deeper documents are rejected rather than risking the stack
+static NSUInteger const BCLJSONMaxDepth = 256;
+
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t position;
+    /// Static string describing the first error, NULL while there is none
+    const char *error;
+} BCLJSONScanner;
+
+#pragma mark - Scanning
+
+static BOOL BCLJSONFail(BCLJSONScanner *scanner, const char *error)
+{
+    if (!scanner->error) {
+        scanner->error = error;
+    }
+    return NO;
+}
+
+static void BCLJSONSkipWhitespace(BCLJSONScanner *scanner)
+{
+    while (scanner->position < scanner->length) {
+        uint8_t byte = scanner->bytes[scanner->position];
+        if (byte != ' ' && byte != '\t' && byte != '\n' && byte != '\r') {
+            return;
+        }
+        scanner->position++;
+    }
+}
+
+/**
+ *  Next non-whitespace byte, without consuming it, or 0 at the end
+ */
+static uint8_t BCLJSONPeek(BCLJSONScanner *scanner)
+{
+    BCLJSONSkipWhitespace(scanner);
+    return scanner->position < scanner->length ? scanner->bytes[scanner->position] : 0;
+}
+
+static BOOL BCLJSONScanByte(BCLJSONScanner *scanner, uint8_t byte, const char *error)
+{
+    if (BCLJSONPeek(scanner) != byte) {
+        return BCLJSONFail(scanner, error);
+    }
+    scanner->position++;
+    return YES;
+}
+
+static BOOL BCLJSONScanLiteral(BCLJSONScanner *scanner, const char *literal)
+{
+    size_t length = strlen(literal);
+    if (scanner->length - scanner->position < length || memcmp(scanner->bytes + scanner->position, literal, length) != 0) {
+        return BCLJSONFail(scanner, "Invalid literal");
+    }
+    scanner->position += length;
+    return YES;
+}
+
+static int BCLJSONHexValue(uint8_t byte)
+{
+    if (byte >= '0' && byte <= '9') return byte - '0';
+    if (byte >= 'a' && byte <= 'f') return byte - 'a' + 10;
+    if (byte >= 'A' && byte <= 'F') return byte - 'A' + 10;
+    return -1;
+}
+
+static BOOL BCLJSONReadHex4(const uint8_t *bytes, uint32_t *value)
+{
+    *value = 0;
+    for (int idx = 0; idx < 4; idx++) {
+        int digit = BCLJSONHexValue(bytes[idx]);
+        if (digit < 0) {
+            return NO;
+        }
+        *value = *value << 4 | (uint32_t)digit;
+    }
+    return YES;
+}
+
+/**
+ *  Scans a string starting at its opening quote and validates its escapes. The contents, still escaped, are
+ *  between start and end; the scanner is left after the closing quote.
+ */
+static BOOL BCLJSONScanStringSpan(BCLJSONScanner *scanner, size_t *start, size_t *end, BOOL *hasEscapes)
+{
+    if (!BCLJSONScanByte(scanner, '"', "Expected a string")) {
+        return NO;
+    }
+
+    *start = scanner->position;
+    *hasEscapes = NO;
+
+    while (scanner->position < scanner->length) {
+        uint8_t byte = scanner->bytes[scanner->position];
+
+        if (byte == '"') {
+            *end = scanner->position++;
+            return YES;
+        }
+
+        if (byte < 0x20) {
+            return BCLJSONFail(scanner, "Control character in a string");
+        }
+
+        if (byte == '\\') {
+            *hasEscapes = YES;
+            if (scanner->position + 1 >= scanner->length) {
+                break;
+            }
+
+            uint8_t escaped = scanner->bytes[scanner->position + 1];
+            if (escaped == 'u') {
+                uint32_t codeUnit;
+                if (scanner->length - scanner->position < 6 || !BCLJSONReadHex4(scanner->bytes + scanner->position + 2, &codeUnit)) {
+                    return BCLJSONFail(scanner, "Invalid unicode escape");
+                }
+                scanner->position += 6;
+            } else if (escaped != 0 && strchr("\"\\/bfnrt", escaped)) {
+                scanner->position += 2;
+            } else {
+                return BCLJSONFail(scanner, "Invalid escape");
+            }
+            continue;
+        }
+
+        scanner->position++;
+    }
+
+    return BCLJSONFail(scanner, "Unterminated string");
+}
+
+static size_t BCLJSONAppendUTF8(uint8_t *output, uint32_t codePoint)
+{
+    if (codePoint < 0x80) {
+        output[0] = (uint8_t)codePoint;
+        return 1;
+    } else if (codePoint < 0x800) {
+        output[0] = (uint8_t)(0xc0 | codePoint >> 6);
+        output[1] = (uint8_t)(0x80 | (codePoint & 0x3f));
+        return 2;
+    } else if (codePoint < 0x10000) {
+        output[0] = (uint8_t)(0xe0 | codePoint >> 12);
+        output[1] = (uint8_t)(0x80 | (codePoint >> 6 & 0x3f));
+        output[2] = (uint8_t)(0x80 | (codePoint & 0x3f));
+        return 3;
+    }
+    output[0] = (uint8_t)(0xf0 | codePoint >> 18);
+    output[1] = (uint8_t)(0x80 | (codePoint >> 12 & 0x3f));
+    output[2] = (uint8_t)(0x80 | (codePoint >> 6 & 0x3f));
+    output[3] = (uint8_t)(0x80 | (codePoint & 0x3f));
+    return 4;
+}
+
+/**
+ *  Unescapes contents of a string validated by BCLJSONScanStringSpan. Output is never longer than the input.
+ *  Unpaired surrogates are replaced with U+FFFD.
+ */
+static size_t BCLJSONUnescape(const uint8_t *bytes, size_t length, uint8_t *output)
+{
+    size_t outputLength = 0;
+    size_t idx = 0;
+
+    while (idx < length) {
+        if (bytes[idx] != '\\') {
+            output[outputLength++] = bytes[idx++];
+            continue;
+        }
+
+        uint8_t escaped = bytes[idx + 1];
+        idx += 2;
+
+        switch (escaped) {
+            case 'b': output[outputLength++] = '\b'; break;
+            case 'f': output[outputLength++] = '\f'; break;
+            case 'n': output[outputLength++] = '\n'; break;
+            case 'r': output[outputLength++] = '\r'; break;
+            case 't': output[outputLength++] = '\t'; break;
+            case 'u':
+            {
+                uint32_t codePoint;
+                BCLJSONReadHex4(bytes + idx, &codePoint);
+                idx += 4;
+
+                if (codePoint >= 0xd800 && codePoint <= 0xdbff) {
+                    uint32_t lowSurrogate;
+                    if (idx + 6 <= length && bytes[idx] == '\\' && bytes[idx + 1] == 'u' && BCLJSONReadHex4(bytes + idx + 2, &lowSurrogate) && lowSurrogate >= 0xdc00 && lowSurrogate <= 0xdfff) {
+                        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (lowSurrogate - 0xdc00);
+                        idx += 6;
+                    } else {
+                        codePoint = 0xfffd;
+                    }
+                } else if (codePoint >= 0xdc00 && codePoint <= 0xdfff) {
+                    codePoint = 0xfffd;
+                }
+
+                outputLength += BCLJSONAppendUTF8(output + outputLength, codePoint);
+                break;
+            }
+            default:
+                output[outputLength++] = escaped;
+                break;
+        }
+    }
+
+    return outputLength;
+}
+
+/**
+ *  Scans a number in JSON grammar. isInteger is YES if it has neither a fraction nor an exponent.
+ */
+static BOOL BCLJSONScanNumberSpan(BCLJSONScanner *scanner, size_t *start, size_t *end, BOOL *isInteger)
+{
+    BCLJSONSkipWhitespace(scanner);
+
+    const uint8_t *bytes = scanner->bytes;
+    size_t length = scanner->length;
+    size_t position = scanner->position;
+
+    *start = position;
+    *isInteger = YES;
+
+    if (position < length && bytes[position] == '-') {
+        position++;
+    }
+
+    if (position < length && bytes[position] == '0') {
+        position++;
+    } else if (position < length && bytes[position] >= '1' && bytes[position] <= '9') {
+        while (position < length && bytes[position] >= '0' && bytes[position] <= '9') position++;
+    } else {
+        scanner->position = position;
+        return BCLJSONFail(scanner, "Invalid number");
+    }
+
+    if (position < length && bytes[position] == '.') {
+        *isInteger = NO;
+        position++;
+        if (position >= length || bytes[position] < '0' || bytes[position] > '9') {
+            scanner->position = position;
+            return BCLJSONFail(scanner, "Invalid number");
+        }
+        while (position < length && bytes[position] >= '0' && bytes[position] <= '9') position++;
+    }
+
+    if (position < length && (bytes[position] == 'e' || bytes[position] == 'E')) {
+        *isInteger = NO;
+        position++;
+        if (position < length && (bytes[position] == '+' || bytes[position] == '-')) {
+            position++;
+        }
+        if (position >= length || bytes[position] < '0' || bytes[position] > '9') {
+            scanner->position = position;
+            return BCLJSONFail(scanner, "Invalid number");
+        }
+        while (position < length && bytes[position] >= '0' && bytes[position] <= '9') position++;
+    }
+
+    scanner->position = *end = position;
+    return YES;
+}
+
+/**
+ *  Moves on to the next member of an object whose opening brace has been scanned, scanning its key and the colon.
+ *  hasMember is NO once the closing brace has been scanned.
+ */
+static BOOL BCLJSONScanNextMember(BCLJSONScanner *scanner, BOOL isFirst, size_t *keyStart, size_t *keyEnd, BOOL *keyHasEscapes, BOOL *hasMember)
+{
+    uint8_t byte = BCLJSONPeek(scanner);
+
+    if (byte == '}') {
+        scanner->position++;
+        *hasMember = NO;
+        return YES;
+    }
+
+    if (!isFirst && !BCLJSONScanByte(scanner, ',', "Expected ',' or '}'")) {
+        return NO;
+    }
+
+    *hasMember = YES;
+    return BCLJSONScanStringSpan(scanner, keyStart, keyEnd, keyHasEscapes) && BCLJSONScanByte(scanner, ':', "Expected ':'");
+}
+
+/**
+ *  Moves on to the next element of an array whose opening bracket has been scanned. hasElement is NO once the
+ *  closing bracket has been scanned.
+ */
+static BOOL BCLJSONScanNextElement(BCLJSONScanner *scanner, BOOL isFirst, BOOL *hasElement)
+{
+    if (BCLJSONPeek(scanner) == ']') {
+        scanner->position++;
+        *hasElement = NO;
+        return YES;
+    }
+
+    *hasElement = YES;
+    return isFirst || BCLJSONScanByte(scanner, ',', "Expected ',' or ']'");
+}
+
+/**
+ *  Skips a value of any type without building anything
+ */
+static BOOL BCLJSONSkipValue(BCLJSONScanner *scanner, NSUInteger depth)
+{
+    if (depth > BCLJSONMaxDepth) {
+        return BCLJSONFail(scanner, "Nested too deeply");
+    }
+
+    size_t start, end;
+    BOOL flag;
+
+    switch (BCLJSONPeek(scanner)) {
+        case '{':
+        {
+            scanner->position++;
+            BOOL hasMember = YES;
+            for (BOOL isFirst = YES; ; isFirst = NO) {
+                if (!BCLJSONScanNextMember(scanner, isFirst, &start, &end, &flag, &hasMember)) {
+                    return NO;
+                }
+                if (!hasMember) {
+                    return YES;
+                }
+                if (!BCLJSONSkipValue(scanner, depth + 1)) {
+                    return NO;
+                }
+            }
+        }
+        case '[':
+        {
+            scanner->position++;
+            BOOL hasElement = YES;
+            for (BOOL isFirst = YES; ; isFirst = NO) {
+                if (!BCLJSONScanNextElement(scanner, isFirst, &hasElement)) {
+                    return NO;
+                }
+                if (!hasElement) {
+                    return YES;
+                }
+                if (!BCLJSONSkipValue(scanner, depth + 1)) {
+                    return NO;
+                }
+            }
+        }
+        case '"':
+            return BCLJSONScanStringSpan(scanner, &start, &end, &flag);
+        case 't':
+            return BCLJSONScanLiteral(scanner, "true");
+        case 'f':
+            return BCLJSONScanLiteral(scanner, "false");
+        case 'n':
+            return BCLJSONScanLiteral(scanner, "null");
+        case 0:
+            return BCLJSONFail(scanner, "Unexpected end of data");
+        default:
+            return BCLJSONScanNumberSpan(scanner, &start, &end, &flag);
+    }
+}
+
+#pragma mark - Building
+
+static NSString *BCLJSONStringWithSpan(BCLJSONScanner *scanner, size_t start, size_t end, BOOL hasEscapes)
+{
+    NSString *string;
+
+    if (!hasEscapes) {
+        string = [[NSString alloc] initWithBytes:scanner->bytes + start length:end - start encoding:NSUTF8StringEncoding];
+    } else {
+        uint8_t *buffer = malloc(MAX(end - start, 1));
+        size_t length = BCLJSONUnescape(scanner->bytes + start, end - start, buffer);
+        string = [[NSString alloc] initWithBytes:buffer length:length encoding:NSUTF8StringEncoding];
+        free(buffer);
+    }
+
+    if (!string) {
+        scanner->position = start;
+        BCLJSONFail(scanner, "Invalid UTF-8 in a string");
+    }
+
+    return string;
+}
+
+static NSNumber *BCLJSONNumberWithSpan(BCLJSONScanner *scanner, size_t start, size_t end, BOOL isInteger)
+{
+    const uint8_t *bytes = scanner->bytes + start;
+    size_t length = end - start;
+
+    if (isInteger) {
+        BOOL isNegative = bytes[0] == '-';
+        unsigned long long magnitude = 0;
+        BOOL overflows = NO;
+        for (size_t idx = isNegative ? 1 : 0; idx < length && !overflows; idx++) {
+            unsigned digit = bytes[idx] - '0';
+            overflows = magnitude > (ULLONG_MAX - digit) / 10;
+            magnitude = magnitude * 10 + digit;
+        }
+
+        if (!overflows && !isNegative && magnitude <= LLONG_MAX) {
+            return @((long long)magnitude);
+        }
+        if (!overflows && isNegative && magnitude <= (unsigned long long)LLONG_MAX + 1) {
+            return @((long long)(0 - magnitude));
+        }
+    }
+
+    // Numbers are short, a copy makes it NUL terminated for strtod
+    char buffer[64];
+    if (length >= sizeof(buffer)) {
+        NSString *string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSASCIIStringEncoding];
+        return @(string.doubleValue);
+    }
+    memcpy(buffer, bytes, length);
+    buffer[length] = '\0';
+    return @(strtod(buffer, NULL));
+}
+
+/**
+ *  Builds Foundation objects out of a value, like NSJSONSerialization does, but only of the value itself
+ */
+static id BCLJSONScanValue(BCLJSONScanner *scanner, NSUInteger depth)
+{
+    if (depth > BCLJSONMaxDepth) {
+        BCLJSONFail(scanner, "Nested too deeply");
+        return nil;
+    }
+
+    size_t start, end;
+    BOOL flag;
+
+    switch (BCLJSONPeek(scanner)) {
+        case '{':
+        {
+            scanner->position++;
+            NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+            BOOL hasMember = YES;
+            for (BOOL isFirst = YES; ; isFirst = NO) {
+                if (!BCLJSONScanNextMember(scanner, isFirst, &start, &end, &flag, &hasMember)) {
+                    return nil;
+                }
+                if (!hasMember) {
+                    return dictionary;
+                }
+                NSString *key = BCLJSONStringWithSpan(scanner, start, end, flag);
+                id value = key ? BCLJSONScanValue(scanner, depth + 1) : nil;
+                if (!value) {
+                    return nil;
+                }
+                dictionary[key] = value;
+            }
+        }
+        case '[':
+        {
+            scanner->position++;
+            NSMutableArray *array = [NSMutableArray array];
+            BOOL hasElement = YES;
+            for (BOOL isFirst = YES; ; isFirst = NO) {
+                if (!BCLJSONScanNextElement(scanner, isFirst, &hasElement)) {
+                    return nil;
+                }
+                if (!hasElement) {
+                    return array;
+                }
+                id value = BCLJSONScanValue(scanner, depth + 1);
+                if (!value) {
+                    return nil;
+                }
+                [array addObject:value];
+            }
+        }
+        case '"':
+            return BCLJSONScanStringSpan(scanner, &start, &end, &flag) ? BCLJSONStringWithSpan(scanner, start, end, flag) : nil;
+        case 't':
+            return BCLJSONScanLiteral(scanner, "true") ? @YES : nil;
+        case 'f':
+            return BCLJSONScanLiteral(scanner, "false") ? @NO : nil;
+        case 'n':
+            return BCLJSONScanLiteral(scanner, "null") ? [NSNull null] : nil;
+        case 0:
+            BCLJSONFail(scanner, "Unexpected end of data");
+            return nil;
+        default:
+            return BCLJSONScanNumberSpan(scanner, &start, &end, &flag) ? BCLJSONNumberWithSpan(scanner, start, end, flag) : nil;
+    }
+}
+
+#pragma mark - BCLConfigurationDecoder
+
+@interface BCLConfigurationDecoder ()
+
+@property (nonatomic, copy, readwrite) NSSet *beacons;
+@property (nonatomic, copy, readwrite) NSSet *zones;
+@property (nonatomic, copy, readwrite) NSDictionary *extensionsParameters;
+@property (nonatomic, copy, readwrite) NSString *kontaktIOAPIKey;
+
+@property (nonatomic, strong) NSMutableSet *decodedBeacons;
+@property (nonatomic, strong) NSMutableSet *decodedZones;
+@property (nonatomic, strong) NSMutableDictionary *beaconsByIdentifier;
+@property (nonatomic, strong) NSMutableDictionary *zonesByIdentifier;
+
+// Zones and triggers that came before the beacons and zones they refer to
+@property (nonatomic, strong) NSMutableArray *pendingZoneDictionaries;
+@property (nonatomic, strong) NSMutableArray *pendingTriggerDictionaries;
+@property (nonatomic) BOOL didDecodeBeacons;
+@property (nonatomic) BOOL didDecodeZones;
+
+@end
+
+@implementation BCLConfigurationDecoder
+
+- (BOOL)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    self.decodedBeacons = [NSMutableSet set];
+    self.decodedZones = [NSMutableSet set];
+    self.beaconsByIdentifier = [NSMutableDictionary dictionary];
+    self.zonesByIdentifier = [NSMutableDictionary dictionary];
+    self.pendingZoneDictionaries = [NSMutableArray array];
+    self.pendingTriggerDictionaries = [NSMutableArray array];
+    self.didDecodeBeacons = NO;
+    self.didDecodeZones = NO;
+    self.extensionsParameters = nil;
+    self.kontaktIOAPIKey = nil;
+
+    BCLJSONScanner scanner = {data.bytes, data.length, 0, NULL};
+
+    if (![self scanConfiguration:&scanner]) {
+        if (error) {
+            NSString *description = [NSString stringWithFormat:@"Invalid configuration at byte %lu: %s", (unsigned long)scanner.position, scanner.error ?: "Invalid value"];
+            *error = [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidDataErrorCode userInfo:@{NSLocalizedDescriptionKey: description,
+                                                                                                        BCLConfigurationDecoderErrorOffsetKey: @(scanner.position)}];
+        }
+        return NO;
+    }
+
+    self.didDecodeBeacons = self.didDecodeZones = YES;
+
+    for (NSDictionary *zoneDictionary in self.pendingZoneDictionaries) {
+        [self addZoneWithDictionary:zoneDictionary];
+    }
+
+    for (NSDictionary *triggerDictionary in self.pendingTriggerDictionaries) {
+        [self addTriggersWithDictionary:triggerDictionary];
+    }
+
+    self.beacons = self.decodedBeacons;
+    self.zones = self.decodedZones;
+
+    self.decodedBeacons = nil;
+    self.decodedZones = nil;
+    self.beaconsByIdentifier = nil;
+    self.zonesByIdentifier = nil;
+    self.pendingZoneDictionaries = nil;
+    self.pendingTriggerDictionaries = nil;
+
+    return YES;
+}
+
+#pragma mark - Private
+
+- (BOOL)scanConfiguration:(BCLJSONScanner *)scanner
+{
+    if (!BCLJSONScanByte(scanner, '{', "Expected a configuration object")) {
+        return NO;
+    }
+
+    size_t keyStart, keyEnd;
+    BOOL keyHasEscapes;
+    BOOL hasMember = YES;
+
+    for (BOOL isFirst = YES; ; isFirst = NO) {
+        if (!BCLJSONScanNextMember(scanner, isFirst, &keyStart, &keyEnd, &keyHasEscapes, &hasMember)) {
+            return NO;
+        }
+        if (!hasMember) {
+            break;
+        }
+
+        NSString *key = BCLJSONStringWithSpan(scanner, keyStart, keyEnd, keyHasEscapes);
+        if (!key) {
+            return NO;
+        }
+
+        BOOL success;
+        if ([key isEqualToString:@"ranges"]) {
+            success = [self scanObjectsInArray:scanner handler:^(NSDictionary *beaconDictionary) {
+                [self addBeaconWithDictionary:beaconDictionary];
+            }];
+            self.didDecodeBeacons = YES;
+        } else if ([key isEqualToString:@"zones"]) {
+            success = [self scanObjectsInArray:scanner handler:^(NSDictionary *zoneDictionary) {
+                if (self.didDecodeBeacons) {
+                    [self addZoneWithDictionary:zoneDictionary];
+                } else {
+                    [self.pendingZoneDictionaries addObject:zoneDictionary];
+                }
+            }];
+            self.didDecodeZones = YES;
+        } else if ([key isEqualToString:@"triggers"]) {
+            success = [self scanObjectsInArray:scanner handler:^(NSDictionary *triggerDictionary) {
+                if (self.didDecodeBeacons && self.didDecodeZones) {
+                    [self addTriggersWithDictionary:triggerDictionary];
+                } else {
+                    [self.pendingTriggerDictionaries addObject:triggerDictionary];
+                }
+            }];
+        } else if ([key isEqualToString:@"extensions"]) {
+            size_t valueStart = scanner->position;
+            id extensions = BCLJSONScanValue(scanner, 1);
+            success = extensions != nil;
+            if ([extensions isKindOfClass:[NSDictionary class]]) {
+                self.extensionsParameters = extensions;
+            } else if (success && extensions != [NSNull null]) {
+                scanner->position = valueStart;
+                success = BCLJSONFail(scanner, "Expected an object of extensions");
+            }
+        } else if ([key isEqualToString:@"kontakt_api_key"]) {
+            id apiKey = BCLJSONScanValue(scanner, 1);
+            success = apiKey != nil;
+            if ([apiKey isKindOfClass:[NSString class]] && [apiKey length]) {
+                self.kontaktIOAPIKey = apiKey;
+            }
+        } else {
+            success = BCLJSONSkipValue(scanner, 1);
+        }
+
+        if (!success) {
+            return NO;
+        }
+    }
+
+    BCLJSONSkipWhitespace(scanner);
+    if (scanner->position != scanner->length) {
+        return BCLJSONFail(scanner, "Unexpected data after the configuration");
+    }
+
+    return YES;
+}
+
+/**
+ *  Scans an array of objects, or null, building one object at a time
+ */
+- (BOOL)scanObjectsInArray:(BCLJSONScanner *)scanner handler:(void (^)(NSDictionary *dictionary))handler
+{
+    if (BCLJSONPeek(scanner) == 'n') {
+        return BCLJSONScanLiteral(scanner, "null");
+    }
+
+    if (!BCLJSONScanByte(scanner, '[', "Expected an array")) {
+        return NO;
+    }
+
+    BOOL hasElement = YES;
+    for (BOOL isFirst = YES; ; isFirst = NO) {
+        if (!BCLJSONScanNextElement(scanner, isFirst, &hasElement)) {
+            return NO;
+        }
+        if (!hasElement) {
+            return YES;
+        }
+
+        @autoreleasepool {
+            BCLJSONSkipWhitespace(scanner);
+            size_t elementStart = scanner->position;
+
+            id element = BCLJSONScanValue(scanner, 2);
+            if (!element) {
+                return NO;
+            }
+            if (![element isKindOfClass:[NSDictionary class]]) {
+                scanner->position = elementStart;
+                return BCLJSONFail(scanner, "Expected an object");
+            }
+
+            handler(element);
+        }
+    }
+}
+
+- (void)addBeaconWithDictionary:(NSDictionary *)beaconDictionary
+{
+    BCLBeacon *beacon = [[BCLBeacon alloc] init];
+    [beacon updatePropertiesFromDictionary:beaconDictionary];
+    [self.decodedBeacons addObject:beacon];
+
+    if (beacon.beaconIdentifier) {
+        self.beaconsByIdentifier[beacon.beaconIdentifier] = [(self.beaconsByIdentifier[beacon.beaconIdentifier] ?: @[]) arrayByAddingObject:beacon];
+    }
+}
+
+- (void)addZoneWithDictionary:(NSDictionary *)zoneDictionary
+{
+    // Only beacons of the zone are handed over, so that it doesn't have to search all of them
+    NSMutableSet *zoneBeacons = [NSMutableSet set];
+    id beaconIds = zoneDictionary[@"beacon_ids"];
+    if ([beaconIds isKindOfClass:[NSArray class]]) {
+        for (id beaconId in beaconIds) {
+            NSArray *beacons = self.beaconsByIdentifier[[beaconId description]];
+            if (beacons) {
+                [zoneBeacons addObjectsFromArray:beacons];
+            }
+        }
+    }
+
+    BCLZone *zone = [[BCLZone alloc] init];
+    [zone updatePropertiesFromDictionary:zoneDictionary beacons:zoneBeacons];
+    [self.decodedZones addObject:zone];
+
+    if (zone.zoneIdentifier) {
+        self.zonesByIdentifier[zone.zoneIdentifier] = [(self.zonesByIdentifier[zone.zoneIdentifier] ?: @[]) arrayByAddingObject:zone];
+    }
+}
+
+- (void)addTriggersWithDictionary:(NSDictionary *)triggerDictionary
+{
+    id beaconIds = triggerDictionary[@"range_ids"];
+    if ([beaconIds isKindOfClass:[NSArray class]]) {
+        for (id beaconId in beaconIds) {
+            BCLTrigger *trigger = [[BCLTrigger alloc] init];
+            for (BCLBeacon *beacon in self.beaconsByIdentifier[[beaconId description]]) {
+                trigger.beacon = beacon; //FIXME: fix strong cross reference
+                [trigger updatePropertiesFromDictionary:triggerDictionary];
+                beacon.triggers = [beacon.triggers arrayByAddingObject:trigger];
+            }
+        }
+    }
+
+    id zoneIds = triggerDictionary[@"zone_ids"];
+    if ([zoneIds isKindOfClass:[NSArray class]]) {
+        for (id zoneId in zoneIds) {
+            BCLTrigger *trigger = [[BCLTrigger alloc] init];
+            for (BCLZone *zone in self.zonesByIdentifier[[zoneId description]]) {
+                trigger.zone = zone; //FIXME: fix strong cross reference
+                [trigger updatePropertiesFromDictionary:triggerDictionary];
+                zone.triggers = [zone.triggers arrayByAddingObject:trigger];
+            }
+        }
+    }
+}
+
+@end
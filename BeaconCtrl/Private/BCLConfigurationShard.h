@@ -0,0 +1,55 @@
+//
+//  BCLConfigurationShard.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+#import "BCLEncodableObject.h"
+
+/**
+ *  Lightweight description of a shard that stays in memory while the shard itself is on disk:
+ *  its geofence and the identifiers of actions defined for its beacons and zones.
+ */
+@interface BCLConfigurationShardDescriptor : BCLEncodableObject
+
+@property (nonatomic, copy) NSString *shardIdentifier;
+
+/// Bounding box of the shard's beacons, already padded
+@property (nonatomic) double minLatitude;
+@property (nonatomic) double maxLatitude;
+@property (nonatomic) double minLongitude;
+@property (nonatomic) double maxLongitude;
+
+@property (nonatomic, copy) NSSet *actionIdentifiers;
+
+/**
+ *  Distance in meters from a location to the geofence, 0 if the location is inside it
+ */
+- (CLLocationDistance)distanceFromLocation:(CLLocation *)location;
+
+@end
+
+/**
+ *  Beacons and zones of a single venue, together with their triggers
+ */
+@interface BCLConfigurationShard : BCLEncodableObject
+
+@property (nonatomic, strong) BCLConfigurationShardDescriptor *descriptor;
+@property (nonatomic, strong) NSSet *beacons;
+@property (nonatomic, strong) NSSet *zones;
+
+/**
+ *  Groups beacons into per-venue shards. A zone goes to the venue of its beacons' center together with all its beacons;
+ *  beacons outside zones go to the venue of their own location. Beacons and zones that have no location at all
+ *  can't be placed in any venue and are returned in residentBeacons and residentZones.
+ */
++ (NSArray *)shardsWithBeacons:(NSSet *)beacons zones:(NSSet *)zones residentBeacons:(NSSet **)residentBeacons residentZones:(NSSet **)residentZones;
+
+@end
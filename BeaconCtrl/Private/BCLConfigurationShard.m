@@ -0,0 +1,186 @@
+//
+//  BCLConfigurationShard.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLConfigurationShard.h"
+#import "BCLBeacon.h"
+#import "BCLZone.h"
+#import "BCLTrigger.h"
+#import "BCLAction.h"
+
+/// Size of a venue cell in degrees, about 1.1 km of latitude
+static double const BCLConfigurationShardCellSize = 0.01;
+
+/// How far outside of its beacons a shard's geofence reaches, in meters
+static double const BCLConfigurationShardGeofencePadding = 200;
+
+static double const BCLMetersPerDegreeOfLatitude = 111320;
+
+@implementation BCLConfigurationShardDescriptor
+
+- (CLLocationDistance)distanceFromLocation:(CLLocation *)location
+{
+    CLLocationCoordinate2D coordinate = location.coordinate;
+    CLLocationCoordinate2D closestCoordinate = CLLocationCoordinate2DMake(MIN(MAX(coordinate.latitude, self.minLatitude), self.maxLatitude),
+                                                                          MIN(MAX(coordinate.longitude, self.minLongitude), self.maxLongitude));
+
+    if (closestCoordinate.latitude == coordinate.latitude && closestCoordinate.longitude == coordinate.longitude) {
+        return 0;
+    }
+
+    CLLocation *closestLocation = [[CLLocation alloc] initWithLatitude:closestCoordinate.latitude longitude:closestCoordinate.longitude];
+    return [location distanceFromLocation:closestLocation];
+}
+
+- (NSArray *)propertiesToExcludeFromEncoding
+{
+    return @[];
+}
+
+@end
+
+@implementation BCLConfigurationShard
+
++ (NSArray *)shardsWithBeacons:(NSSet *)beacons zones:(NSSet *)zones residentBeacons:(NSSet **)residentBeacons residentZones:(NSSet **)residentZones
+{
+    NSMutableDictionary *beaconsByCell = [NSMutableDictionary dictionary];
+    NSMutableDictionary *zonesByCell = [NSMutableDictionary dictionary];
+    NSMutableSet *placedBeacons = [NSMutableSet setWithCapacity:beacons.count];
+    NSMutableSet *unplacedZones = [NSMutableSet set];
+
+    for (BCLZone *zone in zones) {
+        double latitudeSum = 0;
+        double longitudeSum = 0;
+        NSUInteger locatedBeaconsCount = 0;
+        for (BCLBeacon *beacon in zone.beacons) {
+            if (beacon.location.location) {
+                latitudeSum += beacon.location.location.coordinate.latitude;
+                longitudeSum += beacon.location.location.coordinate.longitude;
+                locatedBeaconsCount++;
+            }
+        }
+
+        if (!locatedBeaconsCount) {
+            [unplacedZones addObject:zone];
+            continue;
+        }
+
+        NSString *cell = [self cellForLatitude:latitudeSum / locatedBeaconsCount longitude:longitudeSum / locatedBeaconsCount];
+        [self addObject:zone toSetForKey:cell inDictionary:zonesByCell];
+        for (BCLBeacon *beacon in zone.beacons) {
+            [self addObject:beacon toSetForKey:cell inDictionary:beaconsByCell];
+            [placedBeacons addObject:beacon];
+        }
+    }
+
+    NSMutableSet *unplacedBeacons = [NSMutableSet set];
+    for (BCLBeacon *beacon in beacons) {
+        if ([placedBeacons containsObject:beacon]) {
+            continue;
+        }
+
+        if (!beacon.location.location) {
+            [unplacedBeacons addObject:beacon];
+            continue;
+        }
+
+        NSString *cell = [self cellForLatitude:beacon.location.location.coordinate.latitude longitude:beacon.location.location.coordinate.longitude];
+        [self addObject:beacon toSetForKey:cell inDictionary:beaconsByCell];
+    }
+
+    NSMutableArray *shards = [NSMutableArray arrayWithCapacity:beaconsByCell.count];
+    [beaconsByCell enumerateKeysAndObjectsUsingBlock:^(NSString *cell, NSSet *cellBeacons, BOOL *stop) {
+        BCLConfigurationShard *shard = [[BCLConfigurationShard alloc] init];
+        shard.beacons = [cellBeacons copy];
+        shard.zones = [zonesByCell[cell] copy] ?: [NSSet set];
+        shard.descriptor = [self descriptorForShard:shard identifier:cell];
+        [shards addObject:shard];
+    }];
+
+    if (residentBeacons) {
+        *residentBeacons = [unplacedBeacons copy];
+    }
+
+    if (residentZones) {
+        *residentZones = [unplacedZones copy];
+    }
+
+    return [shards copy];
+}
+
+#pragma mark - Private
+
++ (NSString *)cellForLatitude:(double)latitude longitude:(double)longitude
+{
+    return [NSString stringWithFormat:@"%ld_%ld", (long)floor(latitude / BCLConfigurationShardCellSize), (long)floor(longitude / BCLConfigurationShardCellSize)];
+}
+
++ (void)addObject:(id)object toSetForKey:(NSString *)key inDictionary:(NSMutableDictionary *)dictionary
+{
+    if (!dictionary[key]) {
+        dictionary[key] = [NSMutableSet set];
+    }
+    [dictionary[key] addObject:object];
+}
+
++ (BCLConfigurationShardDescriptor *)descriptorForShard:(BCLConfigurationShard *)shard identifier:(NSString *)identifier
+{
+    double minLatitude = 90;
+    double maxLatitude = -90;
+    double minLongitude = 180;
+    double maxLongitude = -180;
+
+    NSMutableSet *actionIdentifiers = [NSMutableSet set];
+    NSMutableArray *triggers = [NSMutableArray array];
+
+    for (BCLBeacon *beacon in shard.beacons) {
+        [triggers addObjectsFromArray:beacon.triggers];
+
+        if (!beacon.location.location) {
+            continue;
+        }
+        CLLocationCoordinate2D coordinate = beacon.location.location.coordinate;
+        minLatitude = MIN(minLatitude, coordinate.latitude);
+        maxLatitude = MAX(maxLatitude, coordinate.latitude);
+        minLongitude = MIN(minLongitude, coordinate.longitude);
+        maxLongitude = MAX(maxLongitude, coordinate.longitude);
+    }
+
+    for (BCLZone *zone in shard.zones) {
+        [triggers addObjectsFromArray:zone.triggers];
+    }
+
+    for (BCLTrigger *trigger in triggers) {
+        for (BCLAction *action in trigger.actions) {
+            if (action.identifier) {
+                [actionIdentifiers addObject:action.identifier];
+            }
+        }
+    }
+
+    double latitudePadding = BCLConfigurationShardGeofencePadding / BCLMetersPerDegreeOfLatitude;
+    double longitudePadding = latitudePadding / MAX(cos((minLatitude + maxLatitude) / 2 * M_PI / 180), 0.01);
+
+    BCLConfigurationShardDescriptor *descriptor = [[BCLConfigurationShardDescriptor alloc] init];
+    descriptor.shardIdentifier = identifier;
+    descriptor.minLatitude = minLatitude - latitudePadding;
+    descriptor.maxLatitude = maxLatitude + latitudePadding;
+    descriptor.minLongitude = minLongitude - longitudePadding;
+    descriptor.maxLongitude = maxLongitude + longitudePadding;
+    descriptor.actionIdentifiers = actionIdentifiers;
+    return descriptor;
+}
+
+- (NSArray *)propertiesToExcludeFromEncoding
+{
+    return @[];
+}
+
+@end
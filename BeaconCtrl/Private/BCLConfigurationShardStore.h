@@ -0,0 +1,63 @@
+//
+//  BCLConfigurationShardStore.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BCLConfigurationShard, BCLConfigurationShardDescriptor;
+
+/**
+ *  Keeps configuration shards archived on disk, one file per shard, and at most maxLoadedShardsCount of them
+ *  in memory, evicting the least recently used ones. A shard read again after it was evicted reuses the beacons
+ *  and zones that are still alive, so that they keep their runtime state.
+ */
+@interface BCLConfigurationShardStore : NSObject
+
+/// Defaults to 8
+@property (nonatomic) NSUInteger maxLoadedShardsCount;
+
+/// Shards currently in memory, most recently used first
+@property (nonatomic, copy, readonly) NSArray *loadedShards;
+
+/// Directory keeping shards of this store's configuration
+@property (nonatomic, copy, readonly) NSString *directoryPath;
+
+/// Directory containing shard directories of all configurations
++ (NSString *)defaultDirectoryPath;
+
+/**
+ *  Removes shards of all configurations but the one kept in a given directory. Shard files right in the default
+ *  directory, archived before shards were versioned, are kept only if it is the given directory.
+ */
++ (void)removeAllShardsExceptInDirectoryPath:(NSString *)directoryPath;
+
+- (instancetype)initWithDirectoryPath:(NSString *)directoryPath;
+
+/**
+ *  Replaces all shards on disk with given ones and drops loaded shards
+ */
+- (BOOL)storeShards:(NSArray *)shards;
+
+/**
+ *  Returns a loaded shard or reads it from disk, marking it as the most recently used one
+ */
+- (BCLConfigurationShard *)shardWithDescriptor:(BCLConfigurationShardDescriptor *)descriptor;
+
+/**
+ *  Uses already unarchived shards as the loaded ones, most recently used first
+ */
+- (void)restoreLoadedShards:(NSArray *)shards;
+
+/**
+ *  Removes all shards from memory and disk
+ */
+- (void)removeAllShards;
+
+@end
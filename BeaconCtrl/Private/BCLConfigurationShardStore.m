@@ -0,0 +1,187 @@
+//
+//  BCLConfigurationShardStore.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLConfigurationShardStore.h"
+#import "BCLConfigurationShard.h"
+#import "BCLBeacon.h"
+#import "BCLZone.h"
+
+static NSString * const BCLConfigurationShardStoreDirectoryName = @"BeaconCtrl/ConfigurationShards";
+static NSUInteger const BCLConfigurationShardStoreDefaultMaxLoadedShardsCount = 8;
+
+@interface BCLConfigurationShardStore ()
+
+@property (nonatomic, copy, readwrite) NSString *directoryPath;
+@property (nonatomic, strong) NSMutableArray *mutableLoadedShards;
+
+// Beacons and zones of shards read so far, by identifier, for as long as anything else holds them
+@property (nonatomic, strong) NSMapTable *liveBeacons;
+@property (nonatomic, strong) NSMapTable *liveZones;
+
+@end
+
+@implementation BCLConfigurationShardStore
+
++ (NSString *)defaultDirectoryPath
+{
+    NSArray *paths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+    return [paths[0] stringByAppendingPathComponent:BCLConfigurationShardStoreDirectoryName];
+}
+
++ (void)removeAllShardsExceptInDirectoryPath:(NSString *)directoryPath
+{
+    NSString *defaultDirectoryPath = [self defaultDirectoryPath];
+    BOOL keepsLegacyShards = [directoryPath.stringByStandardizingPath isEqualToString:defaultDirectoryPath.stringByStandardizingPath];
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+
+    for (NSString *name in [fileManager contentsOfDirectoryAtPath:defaultDirectoryPath error:nil]) {
+        NSString *path = [defaultDirectoryPath stringByAppendingPathComponent:name];
+        if ([path.stringByStandardizingPath isEqualToString:directoryPath.stringByStandardizingPath]) {
+            continue;
+        }
+
+        BOOL isDirectory = NO;
+        if (keepsLegacyShards && [fileManager fileExistsAtPath:path isDirectory:&isDirectory] && !isDirectory) {
+            continue;
+        }
+
+        [fileManager removeItemAtPath:path error:nil];
+    }
+}
+
+- (instancetype)initWithDirectoryPath:(NSString *)directoryPath
+{
+    if (self = [super init]) {
+        _directoryPath = [directoryPath copy];
+        _maxLoadedShardsCount = BCLConfigurationShardStoreDefaultMaxLoadedShardsCount;
+        _mutableLoadedShards = [NSMutableArray array];
+        _liveBeacons = [NSMapTable strongToWeakObjectsMapTable];
+        _liveZones = [NSMapTable strongToWeakObjectsMapTable];
+    }
+    return self;
+}
+
+- (NSArray *)loadedShards
+{
+    return [self.mutableLoadedShards copy];
+}
+
+- (BOOL)storeShards:(NSArray *)shards
+{
+    [self removeAllShards];
+
+    if (![[NSFileManager defaultManager] createDirectoryAtPath:self.directoryPath withIntermediateDirectories:YES attributes:nil error:nil]) {
+        return NO;
+    }
+
+    for (BCLConfigurationShard *shard in shards) {
+        if (![NSKeyedArchiver archiveRootObject:shard toFile:[self pathForShardIdentifier:shard.descriptor.shardIdentifier]]) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+- (BCLConfigurationShard *)shardWithDescriptor:(BCLConfigurationShardDescriptor *)descriptor
+{
+    for (BCLConfigurationShard *shard in self.mutableLoadedShards) {
+        if ([shard.descriptor.shardIdentifier isEqualToString:descriptor.shardIdentifier]) {
+            [self.mutableLoadedShards removeObject:shard];
+            [self.mutableLoadedShards insertObject:shard atIndex:0];
+            return shard;
+        }
+    }
+
+    BCLConfigurationShard *shard = [NSKeyedUnarchiver unarchiveObjectWithFile:[self pathForShardIdentifier:descriptor.shardIdentifier]];
+    if (![shard isKindOfClass:[BCLConfigurationShard class]]) {
+        return nil;
+    }
+
+    [self mergeShardIntoLiveObjects:shard];
+
+    [self.mutableLoadedShards insertObject:shard atIndex:0];
+    while (self.mutableLoadedShards.count > MAX(self.maxLoadedShardsCount, 1)) {
+        [self.mutableLoadedShards removeLastObject];
+    }
+
+    return shard;
+}
+
+- (void)restoreLoadedShards:(NSArray *)shards
+{
+    self.mutableLoadedShards = [shards mutableCopy] ?: [NSMutableArray array];
+
+    for (BCLConfigurationShard *shard in self.mutableLoadedShards) {
+        [self mergeShardIntoLiveObjects:shard];
+    }
+}
+
+- (void)removeAllShards
+{
+    [self.mutableLoadedShards removeAllObjects];
+    [self.liveBeacons removeAllObjects];
+    [self.liveZones removeAllObjects];
+    [[NSFileManager defaultManager] removeItemAtPath:self.directoryPath error:nil];
+}
+
+#pragma mark - Private
+
+/**
+ *  Swaps beacons and zones of a shard read from disk for the instances still alive since the shard was last loaded,
+ *  so that beacons referenced by pending events or observed beacons stay the same objects
+ */
+- (void)mergeShardIntoLiveObjects:(BCLConfigurationShard *)shard
+{
+    NSMutableSet *beacons = [NSMutableSet setWithCapacity:shard.beacons.count];
+    for (BCLBeacon *beacon in shard.beacons) {
+        [beacons addObject:[self liveObjectForObject:beacon identifier:beacon.identifier inTable:self.liveBeacons]];
+    }
+
+    NSMutableSet *zones = [NSMutableSet setWithCapacity:shard.zones.count];
+    for (BCLZone *zone in shard.zones) {
+        BCLZone *liveZone = [self liveObjectForObject:zone identifier:zone.zoneIdentifier inTable:self.liveZones];
+
+        NSHashTable *zoneBeacons = [NSHashTable weakObjectsHashTable];
+        for (BCLBeacon *beacon in zone.beacons) {
+            BCLBeacon *liveBeacon = [self liveObjectForObject:beacon identifier:beacon.identifier inTable:self.liveBeacons];
+            liveBeacon.zone = liveZone;
+            [zoneBeacons addObject:liveBeacon];
+        }
+        liveZone.beacons = zoneBeacons;
+
+        [zones addObject:liveZone];
+    }
+
+    shard.beacons = beacons;
+    shard.zones = zones;
+}
+
+- (id)liveObjectForObject:(id)object identifier:(NSString *)identifier inTable:(NSMapTable *)table
+{
+    if (!identifier) {
+        return object;
+    }
+
+    id liveObject = [table objectForKey:identifier];
+    if (!liveObject) {
+        [table setObject:object forKey:identifier];
+        liveObject = object;
+    }
+    return liveObject;
+}
+
+- (NSString *)pathForShardIdentifier:(NSString *)shardIdentifier
+{
+    return [self.directoryPath stringByAppendingPathComponent:[shardIdentifier stringByAppendingPathExtension:@"data"]];
+}
+
+@end
@@ -0,0 +1,43 @@
+//
+//  BCLDwellTracker.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class SAMCache;
+
+/**
+ *  Tracks how long the device has been staying in range of beacons and zones, identified by arbitrary keys, and calls
+ *  the handler once for each threshold a stay crosses. All stays share a single timer armed for the earliest threshold.
+ *  Enter times are checkpointed to a cache as one small dictionary, so stays survive relaunches.
+ *  Has to be used from the main thread.
+ */
+@interface BCLDwellTracker : NSObject
+
+/// Dwell times in seconds to report, ascending. Defaults to 1, 5 and 15 minutes.
+@property (nonatomic, copy) NSArray *thresholds;
+
+- (instancetype)initWithCheckpointCache:(SAMCache *)cache handler:(void (^)(NSString *key, NSTimeInterval threshold))handler;
+
+/**
+ *  Starts tracking a stay, unless it's already tracked
+ */
+- (void)beginDwellForKey:(NSString *)key;
+
+- (void)endDwellForKey:(NSString *)key;
+
+- (void)endAllDwells;
+
+/**
+ *  How long the stay has lasted so far, 0 if it isn't tracked
+ */
+- (NSTimeInterval)dwellTimeForKey:(NSString *)key;
+
+@end
@@ -0,0 +1,174 @@
+//
+//  BCLDwellTracker.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLDwellTracker.h"
+#import <SAMCache/SAMCache.h>
+#import "BCLClock.h"
+
+static NSString * const BCLDwellTrackerCheckpointKey = @"dwells";
+
+/// Checkpointed stays older than this are considered stale when restored
+static NSTimeInterval const BCLDwellTrackerMaxRestoredDwellTime = 24 * 60 * 60;
+
+@interface BCLDwellTracker ()
+
+@property (nonatomic, strong) SAMCache *cache;
+@property (nonatomic, copy) void (^handler)(NSString *key, NSTimeInterval threshold);
+
+/// Key -> @[enter time, number of thresholds already reported]
+@property (nonatomic, strong) NSMutableDictionary *dwells;
+
+@property (nonatomic, strong) BCLClockTimer *timer;
+
+@end
+
+@implementation BCLDwellTracker
+
+- (instancetype)initWithCheckpointCache:(SAMCache *)cache handler:(void (^)(NSString *, NSTimeInterval))handler
+{
+    if (self = [super init]) {
+        _cache = cache;
+        _handler = [handler copy];
+        _thresholds = @[@60, @300, @900];
+        _dwells = [NSMutableDictionary dictionary];
+
+        NSTimeInterval now = [BCLClock currentClock].timeIntervalSince1970;
+        NSMutableDictionary *dwells = _dwells;
+        NSDictionary *checkpoint = [cache objectForKey:BCLDwellTrackerCheckpointKey];
+        [checkpoint enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSArray *dwell, BOOL *stop) {
+            if ([dwell isKindOfClass:[NSArray class]] && dwell.count == 2 && now - [dwell[0] doubleValue] < BCLDwellTrackerMaxRestoredDwellTime) {
+                dwells[key] = dwell;
+            }
+        }];
+
+        // Thresholds crossed while the app wasn't running are reported as soon as the timer fires
+        [self rescheduleTimer];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_timer invalidate];
+}
+
+- (void)setThresholds:(NSArray *)thresholds
+{
+    _thresholds = [[thresholds sortedArrayUsingSelector:@selector(compare:)] copy];
+    [self rescheduleTimer];
+}
+
+- (void)beginDwellForKey:(NSString *)key
+{
+    if (!key || self.dwells[key]) {
+        return;
+    }
+
+    self.dwells[key] = @[@([BCLClock currentClock].timeIntervalSince1970), @0];
+    [self saveCheckpoint];
+    [self rescheduleTimer];
+}
+
+- (void)endDwellForKey:(NSString *)key
+{
+    if (!key || !self.dwells[key]) {
+        return;
+    }
+
+    [self.dwells removeObjectForKey:key];
+    [self saveCheckpoint];
+    [self rescheduleTimer];
+}
+
+- (void)endAllDwells
+{
+    [self.dwells removeAllObjects];
+    [self saveCheckpoint];
+    [self rescheduleTimer];
+}
+
+- (NSTimeInterval)dwellTimeForKey:(NSString *)key
+{
+    NSArray *dwell = key ? self.dwells[key] : nil;
+    if (!dwell) {
+        return 0;
+    }
+    return [BCLClock currentClock].timeIntervalSince1970 - [dwell[0] doubleValue];
+}
+
+#pragma mark - Private
+
+- (void)timerDidFire
+{
+    NSTimeInterval now = [BCLClock currentClock].timeIntervalSince1970;
+    NSMutableArray *crossedDwells = [NSMutableArray array];
+
+    for (NSString *key in self.dwells.allKeys) {
+        NSArray *dwell = self.dwells[key];
+        NSTimeInterval enterTime = [dwell[0] doubleValue];
+        NSUInteger reportedCount = [dwell[1] unsignedIntegerValue];
+        NSUInteger crossedCount = reportedCount;
+
+        while (crossedCount < self.thresholds.count && now - enterTime >= [self.thresholds[crossedCount] doubleValue]) {
+            [crossedDwells addObject:@[key, self.thresholds[crossedCount]]];
+            crossedCount++;
+        }
+
+        if (crossedCount != reportedCount) {
+            self.dwells[key] = @[dwell[0], @(crossedCount)];
+        }
+    }
+
+    if (crossedDwells.count) {
+        [self saveCheckpoint];
+    }
+
+    [self rescheduleTimer];
+
+    // Handlers are called last, as they may begin or end stays
+    for (NSArray *crossedDwell in crossedDwells) {
+        if (self.handler) {
+            self.handler(crossedDwell[0], [crossedDwell[1] doubleValue]);
+        }
+    }
+}
+
+- (void)rescheduleTimer
+{
+    NSTimeInterval now = [BCLClock currentClock].timeIntervalSince1970;
+    NSTimeInterval nextFireTime = DBL_MAX;
+
+    for (NSArray *dwell in self.dwells.allValues) {
+        NSUInteger reportedCount = [dwell[1] unsignedIntegerValue];
+        if (reportedCount < self.thresholds.count) {
+            nextFireTime = MIN(nextFireTime, [dwell[0] doubleValue] + [self.thresholds[reportedCount] doubleValue]);
+        }
+    }
+
+    [self.timer invalidate];
+    self.timer = nil;
+
+    if (nextFireTime == DBL_MAX) {
+        return;
+    }
+
+    __weak typeof(self) weakSelf = self;
+    self.timer = [[BCLClock currentClock] scheduleTimerWithDelay:nextFireTime - now queue:dispatch_get_main_queue() handler:^{
+        [weakSelf timerDidFire];
+    }];
+}
+
+- (void)saveCheckpoint
+{
+    [self.cache setObject:[self.dwells copy] forKey:BCLDwellTrackerCheckpointKey];
+}
+
+@end
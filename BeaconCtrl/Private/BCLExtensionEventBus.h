@@ -0,0 +1,39 @@
+//
+//  BCLExtensionEventBus.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import "BCLTypes.h"
+
+@class BCLBeacon;
+
+/**
+ *  Delivers beacon events to extensions according to their subscriptions. Subscribers are indexed by event type, so
+ *  publishing only looks at extensions interested in the event. Each extension gets events asynchronously, through a
+ *  bounded buffer, on the main queue or the one its subscription gives. Publishing never waits for an extension.
+ */
+@interface BCLExtensionEventBus : NSObject
+
+@property (nonatomic, copy, readonly) NSSet *extensions;
+
+- (instancetype)initWithExtensions:(NSSet *)extensions;
+
+/**
+ *  Queues the event, with a snapshot of the beacon, for extensions subscribed to it
+ *  @return NO if an extension's buffer was full and its policy is to drop new events
+ */
+- (BOOL)publishEvent:(BCLEventType)eventType forBeacon:(BCLBeacon *)beacon;
+
+/**
+ *  Delivery metrics keyed by extension names, see BCLExtensionSubscription.h for keys of the metrics
+ */
+- (NSDictionary *)metrics;
+
+@end
@@ -0,0 +1,240 @@
+//
+//  BCLExtensionEventBus.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLExtensionEventBus.h"
+#import "BCLExtension.h"
+#import "BCLBeacon.h"
+#import "BCLBeacon+BCLSnapshot.h"
+#import "BCLZone.h"
+#import "BCLClock.h"
+
+static NSUInteger const BCLExtensionEventBusEventTypesCount = BCLEventTypeTimer + 1;
+
+@interface BCLExtensionEvent : NSObject
+
+@property (nonatomic) BCLEventType eventType;
+/// A snapshot, ranging keeps updating the beacon itself on the main thread
+@property (nonatomic, strong) BCLBeacon *beacon;
+@property (nonatomic) NSTimeInterval publishTime;
+
+@end
+
+@implementation BCLExtensionEvent
+
+@end
+
+/**
+ *  An extension with its subscription and the buffer of events waiting for it
+ */
+@interface BCLExtensionSubscriber : NSObject
+
+@property (nonatomic, strong, readonly) id <BCLExtension> extension;
+@property (nonatomic, strong, readonly) BCLExtensionSubscription *subscription;
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+// Guards everything below
+@property (nonatomic, strong) NSLock *lock;
+@property (nonatomic, strong) NSMutableArray *pendingEvents;
+@property (nonatomic) BOOL isDraining;
+
+@property (nonatomic) NSUInteger deliveredEventsCount;
+@property (nonatomic) NSUInteger droppedEventsCount;
+@property (nonatomic) NSTimeInterval lastEventLag;
+@property (nonatomic) NSTimeInterval maxEventLag;
+
+@end
+
+@implementation BCLExtensionSubscriber
+
+- (instancetype)initWithExtension:(id <BCLExtension>)extension
+{
+    if (self = [super init]) {
+        _extension = extension;
+        _subscription = [extension respondsToSelector:@selector(bcl_subscription)] ? [extension bcl_subscription] : nil;
+        if (!_subscription) {
+            _subscription = [[BCLExtensionSubscription alloc] init];
+        }
+        
+        // Extensions used to be called on the main thread, so that's where events go unless they ask otherwise
+        _queue = _subscription.deliveryQueue ?: dispatch_get_main_queue();
+        _lock = [[NSLock alloc] init];
+        _pendingEvents = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (BOOL)matchesBeacon:(BCLBeacon *)beacon
+{
+    NSSet *beaconIdentifiers = self.subscription.beaconIdentifiers;
+    NSSet *zoneIdentifiers = self.subscription.zoneIdentifiers;
+    
+    if (!beaconIdentifiers && !zoneIdentifiers) {
+        return YES;
+    }
+    
+    return (beacon.beaconIdentifier && [beaconIdentifiers containsObject:beacon.beaconIdentifier]) ||
+           (beacon.zone.zoneIdentifier && [zoneIdentifiers containsObject:beacon.zone.zoneIdentifier]);
+}
+
+/**
+ *  Never waits for the extension
+ *  @return NO if the buffer is full and the policy is to drop new events
+ */
+- (BOOL)enqueueEvent:(BCLExtensionEvent *)event
+{
+    NSUInteger capacity = MAX(self.subscription.queueCapacity, 1);
+    
+    [self.lock lock];
+    
+    if (self.pendingEvents.count >= capacity) {
+        self.droppedEventsCount++;
+        
+        if (self.subscription.overflowPolicy == BCLExtensionOverflowPolicyDropNewest) {
+            [self.lock unlock];
+            return NO;
+        }
+        
+        [self.pendingEvents removeObjectAtIndex:0];
+    }
+    
+    [self.pendingEvents addObject:event];
+    
+    BOOL shouldStartDraining = !self.isDraining;
+    self.isDraining = YES;
+    
+    [self.lock unlock];
+    
+    if (shouldStartDraining) {
+        dispatch_async(self.queue, ^{
+            [self drainEvents];
+        });
+    }
+    
+    return YES;
+}
+
+/**
+ *  Delivers events until the buffer is empty. Runs on the subscriber's queue.
+ */
+- (void)drainEvents
+{
+    while (YES) {
+        [self.lock lock];
+        
+        BCLExtensionEvent *event = self.pendingEvents.firstObject;
+        if (!event) {
+            self.isDraining = NO;
+            [self.lock unlock];
+            return;
+        }
+        
+        [self.pendingEvents removeObjectAtIndex:0];
+        [self.lock unlock];
+        
+        NSTimeInterval lag = [BCLClock currentClock].uptime - event.publishTime;
+        
+        [self.extension event:event.eventType forBeacon:event.beacon];
+        
+        [self.lock lock];
+        self.deliveredEventsCount++;
+        self.lastEventLag = lag;
+        self.maxEventLag = MAX(self.maxEventLag, lag);
+        [self.lock unlock];
+    }
+}
+
+- (NSDictionary *)metrics
+{
+    [self.lock lock];
+    NSDictionary *metrics = @{BCLExtensionPendingEventsCountKey: @(self.pendingEvents.count),
+                              BCLExtensionDeliveredEventsCountKey: @(self.deliveredEventsCount),
+                              BCLExtensionDroppedEventsCountKey: @(self.droppedEventsCount),
+                              BCLExtensionLastEventLagKey: @(self.lastEventLag),
+                              BCLExtensionMaxEventLagKey: @(self.maxEventLag)};
+    [self.lock unlock];
+    return metrics;
+}
+
+@end
+
+@interface BCLExtensionEventBus ()
+
+@property (nonatomic, copy, readwrite) NSSet *extensions;
+@property (nonatomic, copy) NSArray *subscribers;
+// Arrays of subscribers interested in each event type, indexed by event type
+@property (nonatomic, copy) NSArray *subscribersByEventType;
+
+@end
+
+@implementation BCLExtensionEventBus
+
+- (instancetype)initWithExtensions:(NSSet *)extensions
+{
+    if (self = [super init]) {
+        _extensions = extensions;
+        
+        NSMutableArray *subscribers = [NSMutableArray arrayWithCapacity:extensions.count];
+        for (id <BCLExtension> extension in extensions) {
+            [subscribers addObject:[[BCLExtensionSubscriber alloc] initWithExtension:extension]];
+        }
+        _subscribers = [subscribers copy];
+        
+        NSMutableArray *subscribersByEventType = [NSMutableArray arrayWithCapacity:BCLExtensionEventBusEventTypesCount];
+        for (NSUInteger eventType = 0; eventType < BCLExtensionEventBusEventTypesCount; eventType++) {
+            [subscribersByEventType addObject:[subscribers filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(BCLExtensionSubscriber *subscriber, NSDictionary *bindings) {
+                return (subscriber.subscription.eventTypes & ((BCLEventTypeMask)1 << eventType)) != 0;
+            }]]];
+        }
+        _subscribersByEventType = [subscribersByEventType copy];
+    }
+    return self;
+}
+
+- (BOOL)publishEvent:(BCLEventType)eventType forBeacon:(BCLBeacon *)beacon
+{
+    if (eventType < 0 || (NSUInteger)eventType >= BCLExtensionEventBusEventTypesCount || !beacon) {
+        return NO;
+    }
+    
+    BCLExtensionEvent *event;
+    BOOL isPublished = YES;
+    
+    for (BCLExtensionSubscriber *subscriber in self.subscribersByEventType[eventType]) {
+        if (![subscriber matchesBeacon:beacon]) {
+            continue;
+        }
+        
+        if (!event) {
+            event = [[BCLExtensionEvent alloc] init];
+            event.eventType = eventType;
+            event.beacon = [beacon bcl_snapshot];
+            event.publishTime = [BCLClock currentClock].uptime;
+        }
+        
+        isPublished = [subscriber enqueueEvent:event] && isPublished;
+    }
+    
+    return isPublished;
+}
+
+- (NSDictionary *)metrics
+{
+    NSMutableDictionary *metrics = [NSMutableDictionary dictionaryWithCapacity:self.subscribers.count];
+    for (BCLExtensionSubscriber *subscriber in self.subscribers) {
+        NSString *name = [[subscriber.extension class] bcl_extensionName];
+        if (name) {
+            metrics[name] = [subscriber metrics];
+        }
+    }
+    return [metrics copy];
+}
+
+@end
@@ -0,0 +1,63 @@
+//
+//  BCLHTTPTransport.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Classes of requests, from the most to the least important
+ */
+typedef NS_ENUM(NSUInteger, BCLHTTPRequestPriority) {
+    BCLHTTPRequestPriorityToken,
+    BCLHTTPRequestPriorityConfiguration,
+    BCLHTTPRequestPriorityEvents,
+    BCLHTTPRequestPriorityPresence,
+    BCLHTTPRequestPriorityAdmin
+};
+
+#define BCLHTTPRequestPrioritiesCount (BCLHTTPRequestPriorityAdmin + 1)
+
+/**
+ *  Sends the SDK's requests through its own session, so they reuse connections and don't compete with the host app's
+ *  requests. Requests wait in a queue per priority and are started most important first, within a cap of concurrent
+ *  requests overall and per priority. The last slot is kept for tokens and configurations, so a backlog of events or
+ *  admin calls can't hold them up. Completion handlers are called on a background queue.
+ */
+@interface BCLHTTPTransport : NSObject
+
+/// Maximum number of requests running at the same time, overall, and of connections per host. Defaults to 4.
+@property (nonatomic) NSUInteger maxConcurrentRequestsCount;
+
++ (instancetype)sharedTransport;
+
+- (instancetype)initWithSessionConfiguration:(NSURLSessionConfiguration *)configuration;
+
+/**
+ *  Maximum number of requests of a priority running at the same time. Defaults to 1 for tokens and configurations and
+ *  to 2 for the rest.
+ */
+- (NSUInteger)maxConcurrentRequestsCountForPriority:(BCLHTTPRequestPriority)priority;
+- (void)setMaxConcurrentRequestsCount:(NSUInteger)count forPriority:(BCLHTTPRequestPriority)priority;
+
+- (void)sendRequest:(NSURLRequest *)request priority:(BCLHTTPRequestPriority)priority completion:(void (^)(NSData *data, NSURLResponse *response, NSError *error))completion;
+
+/**
+ *  Cancels pending and running requests of a priority, which complete with NSURLErrorCancelled unless they have
+ *  already completed
+ */
+- (void)cancelAllRequestsWithPriority:(BCLHTTPRequestPriority)priority;
+
+/**
+ *  Timing metrics of requests, with times in seconds
+ *  @return A dictionary keyed by priority names, with dictionaries of numbers keyed by BCLNetwork…Key constants
+ */
+- (NSDictionary *)metrics;
+
+@end
@@ -0,0 +1,343 @@
+//
+//  BCLHTTPTransport.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLHTTPTransport.h"
+#import "BCLBeaconCtrl.h"
+#import "NSHTTPURLResponse+BCLHTTPCodes.h"
+#import "BCLClock.h"
+
+static NSTimeInterval const BCLHTTPTransportRequestTimeout = 30;
+
+/// Durations of this many recent requests of each priority are kept to compute the tail duration
+#define BCLHTTPTransportRecentDurationsCount 128
+
+/// Percentile of recent durations reported as the tail duration
+static double const BCLHTTPTransportTailPercentile = 0.95;
+
+typedef struct {
+    NSUInteger maxConcurrentCount;
+    NSUInteger runningCount;
+    NSUInteger completedCount;
+    NSUInteger failedCount;
+    NSUInteger cancelledCount;
+    NSTimeInterval totalQueueTime;
+    NSTimeInterval totalDuration;
+    NSTimeInterval maxDuration;
+    NSTimeInterval recentDurations[BCLHTTPTransportRecentDurationsCount];
+    NSUInteger recentDurationsCount;
+    NSUInteger nextRecentDurationIndex;
+} BCLHTTPTransportPriorityState;
+
+static int BCLCompareDurations(const void *duration1, const void *duration2)
+{
+    NSTimeInterval value1 = *(const NSTimeInterval *)duration1;
+    NSTimeInterval value2 = *(const NSTimeInterval *)duration2;
+    return value1 < value2 ? -1 : (value1 > value2 ? 1 : 0);
+}
+
+static NSString *BCLHTTPRequestPriorityName(BCLHTTPRequestPriority priority)
+{
+    switch (priority) {
+        case BCLHTTPRequestPriorityToken:
+            return @"token";
+        case BCLHTTPRequestPriorityConfiguration:
+            return @"configuration";
+        case BCLHTTPRequestPriorityEvents:
+            return @"events";
+        case BCLHTTPRequestPriorityPresence:
+            return @"presence";
+        case BCLHTTPRequestPriorityAdmin:
+            return @"admin";
+    }
+    return nil;
+}
+
+/// A sent request, from being queued until it completes
+@interface BCLHTTPRequestHandle : NSObject
+
+@property (nonatomic, strong) NSURLRequest *request;
+@property (nonatomic) BCLHTTPRequestPriority priority;
+@property (nonatomic, copy) void (^completion)(NSData *data, NSURLResponse *response, NSError *error);
+
+@property (nonatomic, strong) NSURLSessionDataTask *task;
+@property (nonatomic) NSTimeInterval enqueueTime;
+@property (nonatomic) NSTimeInterval startTime;
+@property (nonatomic, getter=isCancelled) BOOL cancelled;
+
+@end
+
+@implementation BCLHTTPRequestHandle
+@end
+
+@interface BCLHTTPTransport () {
+    BCLHTTPTransportPriorityState _states[BCLHTTPRequestPrioritiesCount];
+}
+
+@property (nonatomic, strong) NSURLSession *session;
+
+/// Guards the pending requests and the states
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+/// Priority -> requests waiting to be started, oldest first
+@property (nonatomic, strong) NSArray *pendingRequests;
+
+/// Priority -> started requests that haven't completed yet
+@property (nonatomic, strong) NSArray *runningRequests;
+
+@property (nonatomic) NSUInteger runningCount;
+
+@end
+
+@implementation BCLHTTPTransport
+
++ (instancetype)sharedTransport
+{
+    static BCLHTTPTransport *sharedTransport;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+        configuration.timeoutIntervalForRequest = BCLHTTPTransportRequestTimeout;
+        sharedTransport = [[self alloc] initWithSessionConfiguration:configuration];
+    });
+    return sharedTransport;
+}
+
+- (instancetype)initWithSessionConfiguration:(NSURLSessionConfiguration *)configuration
+{
+    if (self = [super init]) {
+        _maxConcurrentRequestsCount = 4;
+        
+        // Requests beyond the caps wait here rather than in the session, so one connection per slot is enough
+        configuration.HTTPMaximumConnectionsPerHost = _maxConcurrentRequestsCount;
+        _session = [NSURLSession sessionWithConfiguration:configuration];
+        _queue = dispatch_queue_create("com.up-next.BeaconCtrl.httpTransport", DISPATCH_QUEUE_SERIAL);
+        
+        NSMutableArray *pendingRequests = [NSMutableArray arrayWithCapacity:BCLHTTPRequestPrioritiesCount];
+        NSMutableArray *runningRequests = [NSMutableArray arrayWithCapacity:BCLHTTPRequestPrioritiesCount];
+        for (NSUInteger priority = 0; priority < BCLHTTPRequestPrioritiesCount; priority++) {
+            [pendingRequests addObject:[NSMutableArray array]];
+            [runningRequests addObject:[NSMutableArray array]];
+            _states[priority].maxConcurrentCount = priority <= BCLHTTPRequestPriorityConfiguration ? 1 : 2;
+        }
+        _pendingRequests = [pendingRequests copy];
+        _runningRequests = [runningRequests copy];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_session invalidateAndCancel];
+}
+
+- (void)setMaxConcurrentRequestsCount:(NSUInteger)maxConcurrentRequestsCount
+{
+    dispatch_async(self.queue, ^{
+        NSUInteger count = MAX(maxConcurrentRequestsCount, 1);
+        if (count == _maxConcurrentRequestsCount) {
+            return;
+        }
+        _maxConcurrentRequestsCount = count;
+        
+        // A session's configuration can't change, so following requests go through a new session with as many
+        // connections per host as there are slots. Running requests complete in the old one.
+        NSURLSessionConfiguration *configuration = self.session.configuration;
+        configuration.HTTPMaximumConnectionsPerHost = count;
+        [self.session finishTasksAndInvalidate];
+        self.session = [NSURLSession sessionWithConfiguration:configuration];
+        
+        [self startPendingRequests];
+    });
+}
+
+- (NSUInteger)maxConcurrentRequestsCountForPriority:(BCLHTTPRequestPriority)priority
+{
+    __block NSUInteger count = 0;
+    dispatch_sync(self.queue, ^{
+        count = _states[priority].maxConcurrentCount;
+    });
+    return count;
+}
+
+- (void)setMaxConcurrentRequestsCount:(NSUInteger)count forPriority:(BCLHTTPRequestPriority)priority
+{
+    dispatch_async(self.queue, ^{
+        _states[priority].maxConcurrentCount = MAX(count, 1);
+        [self startPendingRequests];
+    });
+}
+
+- (void)sendRequest:(NSURLRequest *)request priority:(BCLHTTPRequestPriority)priority completion:(void (^)(NSData *, NSURLResponse *, NSError *))completion
+{
+    BCLHTTPRequestHandle *handle = [[BCLHTTPRequestHandle alloc] init];
+    handle.request = [request copy];
+    handle.priority = MIN(priority, BCLHTTPRequestPriorityAdmin);
+    handle.completion = completion;
+    handle.enqueueTime = [BCLClock currentClock].uptime;
+    
+    dispatch_async(self.queue, ^{
+        [self.pendingRequests[handle.priority] addObject:handle];
+        [self startPendingRequests];
+    });
+}
+
+- (void)cancelAllRequestsWithPriority:(BCLHTTPRequestPriority)priority
+{
+    dispatch_async(self.queue, ^{
+        for (BCLHTTPRequestHandle *handle in [self.runningRequests[priority] copy]) {
+            [self cancelHandle:handle];
+        }
+        for (BCLHTTPRequestHandle *handle in [self.pendingRequests[priority] copy]) {
+            [self cancelHandle:handle];
+        }
+    });
+}
+
+- (NSDictionary *)metrics
+{
+    NSMutableDictionary *metrics = [NSMutableDictionary dictionaryWithCapacity:BCLHTTPRequestPrioritiesCount];
+    
+    dispatch_sync(self.queue, ^{
+        for (NSUInteger priority = 0; priority < BCLHTTPRequestPrioritiesCount; priority++) {
+            BCLHTTPTransportPriorityState *state = &_states[priority];
+            NSUInteger finishedCount = state->completedCount + state->failedCount;
+            
+            NSTimeInterval tailDuration = 0;
+            if (state->recentDurationsCount) {
+                NSTimeInterval durations[BCLHTTPTransportRecentDurationsCount];
+                memcpy(durations, state->recentDurations, state->recentDurationsCount * sizeof(NSTimeInterval));
+                qsort(durations, state->recentDurationsCount, sizeof(NSTimeInterval), BCLCompareDurations);
+                NSUInteger idx = (NSUInteger)ceil(BCLHTTPTransportTailPercentile * state->recentDurationsCount) - 1;
+                tailDuration = durations[MIN(idx, state->recentDurationsCount - 1)];
+            }
+            
+            metrics[BCLHTTPRequestPriorityName(priority)] = @{BCLNetworkPendingRequestsCountKey: @([self.pendingRequests[priority] count]),
+                                                               BCLNetworkRunningRequestsCountKey: @([self.runningRequests[priority] count]),
+                                                               BCLNetworkCompletedRequestsCountKey: @(state->completedCount),
+                                                               BCLNetworkFailedRequestsCountKey: @(state->failedCount),
+                                                               BCLNetworkCancelledRequestsCountKey: @(state->cancelledCount),
+                                                               BCLNetworkMeanQueueTimeKey: @(finishedCount ? state->totalQueueTime / finishedCount : 0),
+                                                               BCLNetworkMeanDurationKey: @(finishedCount ? state->totalDuration / finishedCount : 0),
+                                                               BCLNetworkTailDurationKey: @(tailDuration),
+                                                               BCLNetworkMaxDurationKey: @(state->maxDuration)};
+        }
+    });
+    
+    return [metrics copy];
+}
+
+#pragma mark - Private
+
+/**
+ *  Starts pending requests, most important first, while there are free slots. Has to be called on the queue.
+ */
+- (void)startPendingRequests
+{
+    for (NSUInteger priority = 0; priority < BCLHTTPRequestPrioritiesCount; priority++) {
+        NSMutableArray *pendingRequests = self.pendingRequests[priority];
+        BCLHTTPTransportPriorityState *state = &_states[priority];
+        
+        // The last slot is kept for tokens and configurations
+        NSUInteger maxRunningCount = priority <= BCLHTTPRequestPriorityConfiguration ? self.maxConcurrentRequestsCount : MAX(self.maxConcurrentRequestsCount, 2) - 1;
+        
+        while (pendingRequests.count && self.runningCount < maxRunningCount && state->runningCount < state->maxConcurrentCount) {
+            BCLHTTPRequestHandle *handle = pendingRequests.firstObject;
+            [pendingRequests removeObjectAtIndex:0];
+            [self startHandle:handle];
+        }
+    }
+}
+
+- (void)startHandle:(BCLHTTPRequestHandle *)handle
+{
+    _states[handle.priority].runningCount++;
+    self.runningCount++;
+    [self.runningRequests[handle.priority] addObject:handle];
+    
+    handle.startTime = [BCLClock currentClock].uptime;
+    
+    __weak typeof(self) weakSelf = self;
+    handle.task = [self.session dataTaskWithRequest:handle.request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        [weakSelf didCompleteRequest:handle withResponse:response error:error];
+        
+        if (handle.completion) {
+            handle.completion(data, response, error);
+        }
+    }];
+    [handle.task resume];
+}
+
+- (void)didCompleteRequest:(BCLHTTPRequestHandle *)handle withResponse:(NSURLResponse *)response error:(NSError *)error
+{
+    NSTimeInterval now = [BCLClock currentClock].uptime;
+    
+    dispatch_async(self.queue, ^{
+        BCLHTTPTransportPriorityState *state = &_states[handle.priority];
+        state->runningCount--;
+        self.runningCount--;
+        [self.runningRequests[handle.priority] removeObject:handle];
+        
+        if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled) {
+            state->cancelledCount++;
+        } else {
+            BOOL isSuccess = !error && [response isKindOfClass:[NSHTTPURLResponse class]] && [(NSHTTPURLResponse *)response isSuccess];
+            if (isSuccess) {
+                state->completedCount++;
+            } else {
+                state->failedCount++;
+            }
+            
+            NSTimeInterval duration = MAX(now - handle.startTime, 0);
+            state->totalQueueTime += MAX(handle.startTime - handle.enqueueTime, 0);
+            state->totalDuration += duration;
+            state->maxDuration = MAX(state->maxDuration, duration);
+            state->recentDurations[state->nextRecentDurationIndex] = duration;
+            state->nextRecentDurationIndex = (state->nextRecentDurationIndex + 1) % BCLHTTPTransportRecentDurationsCount;
+            state->recentDurationsCount = MIN(state->recentDurationsCount + 1, BCLHTTPTransportRecentDurationsCount);
+        }
+        
+        [self startPendingRequests];
+    });
+}
+
+/**
+ *  Has to be called on the queue
+ */
+- (void)cancelHandle:(BCLHTTPRequestHandle *)handle
+{
+    if (handle.isCancelled) {
+        return;
+    }
+    handle.cancelled = YES;
+    
+    if (handle.task) {
+        // Completes with NSURLErrorCancelled
+        [handle.task cancel];
+        return;
+    }
+    
+    NSMutableArray *pendingRequests = self.pendingRequests[handle.priority];
+    if (![pendingRequests containsObject:handle]) {
+        return;
+    }
+    [pendingRequests removeObject:handle];
+    _states[handle.priority].cancelledCount++;
+    
+    if (handle.completion) {
+        void (^completion)(NSData *, NSURLResponse *, NSError *) = handle.completion;
+        NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+        [self.session.delegateQueue addOperationWithBlock:^{
+            completion(nil, nil, error);
+        }];
+    }
+}
+
+@end
@@ -0,0 +1,86 @@
+//
+//  BCLKontaktIODeviceUpdateEngine.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import "BCLKontaktIOBeaconConfigManager.h"
+
+@class BCLKontaktIODeviceUpdateEngine;
+
+/**
+ *  A beacon device the update engine can connect to. Implemented by a thin wrapper around KTKBeaconDevice
+ *  and by fake devices in tests.
+ */
+@protocol BCLKontaktIODevice <NSObject>
+
+@property (nonatomic, readonly) NSString *uniqueID;
+
+/// Last known RSSI of the device or nil if unknown
+@property (nonatomic, readonly) NSNumber *RSSI;
+
+/// Battery level in percent
+@property (nonatomic, readonly) NSUInteger batteryLevel;
+
+- (BOOL)connectWithPassword:(NSString *)password error:(NSError **)error;
+
+- (void)disconnect;
+
+@end
+
+@protocol BCLKontaktIODeviceUpdateEngineDelegate <NSObject>
+
+/**
+ *  Connects to a device. Called on a worker queue, may block.
+ */
+- (BOOL)updateEngine:(BCLKontaktIODeviceUpdateEngine *)engine connectDevice:(id <BCLKontaktIODevice>)device error:(NSError **)error;
+
+/**
+ *  Writes the new configuration and / or firmware to a connected device. Called on a worker queue, may block.
+ */
+- (BOOL)updateEngine:(BCLKontaktIODeviceUpdateEngine *)engine updateDevice:(id <BCLKontaktIODevice>)device error:(NSError **)error;
+
+/**
+ *  Called on the main queue each time a device changes its update state.
+ */
+- (void)updateEngine:(BCLKontaktIODeviceUpdateEngine *)engine device:(id <BCLKontaktIODevice>)device didChangeState:(BCLKontaktIOBeaconUpdateState)state;
+
+/**
+ *  Called on the main queue each time a device is done or has failed.
+ */
+- (void)updateEngine:(BCLKontaktIODeviceUpdateEngine *)engine didUpdateProgressWithFinishedCount:(NSUInteger)finishedCount failedCount:(NSUInteger)failedCount totalCount:(NSUInteger)totalCount;
+
+@end
+
+/**
+ *  Updates beacon devices using a bounded pool of concurrent workers. Each device goes through
+ *  queued -> connecting -> updating -> done states; a failed attempt puts the device back in the queue
+ *  with an exponential backoff until maxAttempts is reached and the device ends up in the failed state.
+ *  Devices with a stronger signal and a higher battery level are updated first.
+ */
+@interface BCLKontaktIODeviceUpdateEngine : NSObject
+
+@property (nonatomic, weak) id <BCLKontaktIODeviceUpdateEngineDelegate> delegate;
+
+/// Defaults to 3
+@property (nonatomic) NSUInteger maxConcurrentUpdates;
+
+/// Defaults to 3
+@property (nonatomic) NSUInteger maxAttempts;
+
+/// Delay before the first retry, doubled with every next one. Defaults to 2 seconds.
+@property (nonatomic) NSTimeInterval retryInterval;
+
+/**
+ *  Adds devices to the queue. Devices that are already queued or being updated only get their signal
+ *  and battery readings refreshed; devices that are done or failed before are queued again.
+ */
+- (void)enqueueDevices:(NSArray *)devices;
+
+@end
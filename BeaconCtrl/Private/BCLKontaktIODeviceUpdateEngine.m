@@ -0,0 +1,254 @@
+//
+//  BCLKontaktIODeviceUpdateEngine.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLKontaktIODeviceUpdateEngine.h"
+#import "BCLClock.h"
+
+static NSUInteger const BCLKontaktIODefaultMaxConcurrentUpdates = 3;
+static NSUInteger const BCLKontaktIODefaultMaxAttempts = 3;
+static NSTimeInterval const BCLKontaktIODefaultRetryInterval = 2;
+
+@interface BCLKontaktIODeviceUpdateTask : NSObject
+
+@property (nonatomic, strong) id <BCLKontaktIODevice> device;
+@property (nonatomic) BCLKontaktIOBeaconUpdateState state;
+@property (nonatomic) NSUInteger attempts;
+/// Clock uptime before which the task isn't retried
+@property (nonatomic) NSTimeInterval notBefore;
+
+@end
+
+@implementation BCLKontaktIODeviceUpdateTask
+
+@end
+
+/**
+ *  RSSI used for prioritization. CoreBluetooth reports 127 when the RSSI is not available,
+ *  so any non-negative value is treated as unknown and goes to the end of the queue.
+ */
+static NSInteger BCLKontaktIODevicePriorityRSSI(id <BCLKontaktIODevice> device)
+{
+    if (!device.RSSI || device.RSSI.integerValue >= 0) {
+        return NSIntegerMin;
+    }
+    return device.RSSI.integerValue;
+}
+
+static BOOL BCLKontaktIODeviceHasHigherPriority(id <BCLKontaktIODevice> device, id <BCLKontaktIODevice> otherDevice)
+{
+    NSInteger rssi = BCLKontaktIODevicePriorityRSSI(device);
+    NSInteger otherRSSI = BCLKontaktIODevicePriorityRSSI(otherDevice);
+    if (rssi != otherRSSI) {
+        return rssi > otherRSSI;
+    }
+    return device.batteryLevel > otherDevice.batteryLevel;
+}
+
+@interface BCLKontaktIODeviceUpdateEngine ()
+
+// All the fields below are accessed on the state queue only
+@property (nonatomic, strong) dispatch_queue_t stateQueue;
+@property (nonatomic, strong) dispatch_queue_t workQueue;
+@property (nonatomic, strong) NSMutableDictionary *tasks;
+@property (nonatomic, strong) NSMutableArray *queuedTasks;
+@property (nonatomic) NSUInteger activeWorkersCount;
+@property (nonatomic) NSUInteger finishedCount;
+@property (nonatomic) NSUInteger failedCount;
+@property (nonatomic) BOOL isRetryScheduled;
+
+@end
+
+@implementation BCLKontaktIODeviceUpdateEngine
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _maxConcurrentUpdates = BCLKontaktIODefaultMaxConcurrentUpdates;
+        _maxAttempts = BCLKontaktIODefaultMaxAttempts;
+        _retryInterval = BCLKontaktIODefaultRetryInterval;
+        _stateQueue = dispatch_queue_create("com.up-next.BeaconCtrl.kontaktio.state", DISPATCH_QUEUE_SERIAL);
+        _workQueue = dispatch_queue_create("com.up-next.BeaconCtrl.kontaktio.work", DISPATCH_QUEUE_CONCURRENT);
+        dispatch_set_target_queue(_workQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+        _tasks = [NSMutableDictionary dictionary];
+        _queuedTasks = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)enqueueDevices:(NSArray *)devices
+{
+    dispatch_async(self.stateQueue, ^{
+        for (id <BCLKontaktIODevice> device in devices) {
+            if (!device.uniqueID) {
+                continue;
+            }
+
+            BCLKontaktIODeviceUpdateTask *task = self.tasks[device.uniqueID];
+
+            if (task) {
+                switch (task.state) {
+                    case BCLKontaktIOBeaconUpdateStateQueued:
+                    case BCLKontaktIOBeaconUpdateStateConnecting:
+                    case BCLKontaktIOBeaconUpdateStateUpdating:
+                        // Workers keep their own reference, so it's safe to swap the device for fresh readings
+                        task.device = device;
+                        continue;
+                    case BCLKontaktIOBeaconUpdateStateDone:
+                        // The device got a new configuration or firmware since it was updated
+                        self.finishedCount--;
+                        break;
+                    case BCLKontaktIOBeaconUpdateStateFailed:
+                        self.failedCount--;
+                        break;
+                }
+            } else {
+                task = [[BCLKontaktIODeviceUpdateTask alloc] init];
+                self.tasks[device.uniqueID] = task;
+            }
+
+            task.device = device;
+            task.attempts = 0;
+            task.notBefore = 0;
+            [self queueTask:task];
+        }
+
+        [self startWorkers];
+    });
+}
+
+#pragma mark - Private
+
+- (void)queueTask:(BCLKontaktIODeviceUpdateTask *)task
+{
+    [self.queuedTasks addObject:task];
+    [self setState:BCLKontaktIOBeaconUpdateStateQueued forTask:task];
+}
+
+- (void)setState:(BCLKontaktIOBeaconUpdateState)state forTask:(BCLKontaktIODeviceUpdateTask *)task
+{
+    task.state = state;
+
+    id <BCLKontaktIODevice> device = task.device;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self.delegate updateEngine:self device:device didChangeState:state];
+    });
+}
+
+/**
+ *  Picks the queued task with the highest priority among those whose backoff has already passed.
+ *  Returns the earliest moment another task becomes ready in nextReadyTime, or 0 if there is none.
+ */
+- (BCLKontaktIODeviceUpdateTask *)dequeueReadyTaskAt:(NSTimeInterval)now nextReadyTime:(NSTimeInterval *)nextReadyTime
+{
+    BCLKontaktIODeviceUpdateTask *bestTask;
+    *nextReadyTime = 0;
+
+    for (BCLKontaktIODeviceUpdateTask *task in self.queuedTasks) {
+        if (task.notBefore > now) {
+            if (*nextReadyTime == 0 || task.notBefore < *nextReadyTime) {
+                *nextReadyTime = task.notBefore;
+            }
+            continue;
+        }
+
+        if (!bestTask || BCLKontaktIODeviceHasHigherPriority(task.device, bestTask.device)) {
+            bestTask = task;
+        }
+    }
+
+    if (bestTask) {
+        [self.queuedTasks removeObjectIdenticalTo:bestTask];
+    }
+
+    return bestTask;
+}
+
+- (void)startWorkers
+{
+    NSTimeInterval now = [BCLClock currentClock].uptime;
+    NSTimeInterval nextReadyTime = 0;
+
+    while (self.activeWorkersCount < MAX(self.maxConcurrentUpdates, 1)) {
+        BCLKontaktIODeviceUpdateTask *task = [self dequeueReadyTaskAt:now nextReadyTime:&nextReadyTime];
+        if (!task) {
+            break;
+        }
+        [self runTask:task];
+    }
+
+    if (nextReadyTime > 0 && !self.isRetryScheduled) {
+        self.isRetryScheduled = YES;
+        [[BCLClock currentClock] scheduleTimerWithDelay:nextReadyTime - now queue:self.stateQueue handler:^{
+            self.isRetryScheduled = NO;
+            [self startWorkers];
+        }];
+    }
+}
+
+- (void)runTask:(BCLKontaktIODeviceUpdateTask *)task
+{
+    self.activeWorkersCount++;
+    task.attempts++;
+    [self setState:BCLKontaktIOBeaconUpdateStateConnecting forTask:task];
+
+    id <BCLKontaktIODevice> device = task.device;
+
+    dispatch_async(self.workQueue, ^{
+        NSError *error;
+        BOOL success = [self.delegate updateEngine:self connectDevice:device error:&error];
+
+        if (success) {
+            dispatch_async(self.stateQueue, ^{
+                [self setState:BCLKontaktIOBeaconUpdateStateUpdating forTask:task];
+            });
+
+            success = [self.delegate updateEngine:self updateDevice:device error:&error];
+            [device disconnect];
+        }
+
+        if (!success) {
+            NSLog(@"Kontakt.io beacon with uniqueId %@ failed to update: %@", device.uniqueID, error);
+        }
+
+        dispatch_async(self.stateQueue, ^{
+            [self finishTask:task success:success];
+        });
+    });
+}
+
+- (void)finishTask:(BCLKontaktIODeviceUpdateTask *)task success:(BOOL)success
+{
+    self.activeWorkersCount--;
+
+    if (success) {
+        self.finishedCount++;
+        [self setState:BCLKontaktIOBeaconUpdateStateDone forTask:task];
+    } else if (task.attempts < self.maxAttempts) {
+        task.notBefore = [BCLClock currentClock].uptime + self.retryInterval * pow(2, task.attempts - 1);
+        [self queueTask:task];
+    } else {
+        self.failedCount++;
+        [self setState:BCLKontaktIOBeaconUpdateStateFailed forTask:task];
+    }
+
+    if (task.state != BCLKontaktIOBeaconUpdateStateQueued) {
+        NSUInteger finishedCount = self.finishedCount;
+        NSUInteger failedCount = self.failedCount;
+        NSUInteger totalCount = self.tasks.count;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self.delegate updateEngine:self didUpdateProgressWithFinishedCount:finishedCount failedCount:failedCount totalCount:totalCount];
+        });
+    }
+
+    [self startWorkers];
+}
+
+@end
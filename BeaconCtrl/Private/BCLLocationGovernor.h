@@ -0,0 +1,70 @@
+//
+//  BCLLocationGovernor.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+
+typedef NS_ENUM(NSUInteger, BCLLocationGovernorTier) {
+    /// No location updates: stopped, or suspended while beacons are in range
+    BCLLocationGovernorTierIdle,
+    /// Far from beacons: significant location changes and visits only
+    BCLLocationGovernorTierDistant,
+    /// Getting closer: also geofences around the nearest beacon areas and occasional coarse fixes
+    BCLLocationGovernorTierApproaching,
+    /// Next to beacons: short bursts of precise fixes
+    BCLLocationGovernorTierNearby
+};
+
+/**
+ *  Decides how much location the device needs to pick beacons to observe, by the distance to the nearest beacon area.
+ *  Precise updates only run in short bursts, and only next to beacons, or after a geofence or a visit says the device
+ *  got there. Locations are passed to the handler only once the device has moved further than their accuracy.
+ *  Has to be used from the main thread.
+ */
+@interface BCLLocationGovernor : NSObject <CLLocationManagerDelegate>
+
+/// Areas with beacons, CLCircularRegion objects
+@property (nonatomic, copy) NSArray *beaconAreas;
+
+/// Location is not needed while suspended, e.g. when beacons are in range. Resuming starts a burst of precise fixes.
+@property (nonatomic, getter=isSuspended) BOOL suspended;
+
+@property (nonatomic, readonly) BCLLocationGovernorTier tier;
+
+/// The last location passed to the handler
+@property (nonatomic, strong, readonly) CLLocation *lastLocation;
+
+/// How long bursts of location updates have been running in total, in seconds
+@property (nonatomic, readonly) NSTimeInterval locationUpdatesDuration;
+
+/// Returns the current time in seconds. Defaults to the uptime of +[BCLClock currentClock]; can be replaced when replaying traces.
+@property (nonatomic, copy) NSTimeInterval (^clock)(void);
+
+/**
+ *  @param locationManager A location manager to use, the governor becomes its delegate. A manager replaying recorded
+ *                         locations can be passed to measure how long location updates run.
+ *  @param handler         Called with locations the device moved to
+ */
+- (instancetype)initWithLocationManager:(CLLocationManager *)locationManager handler:(void (^)(CLLocation *location))handler;
+
+- (void)start;
+
+/**
+ *  Starts a burst of fixes right away, e.g. once location services get authorized, unless suspended
+ */
+- (void)refreshLocation;
+
+/**
+ *  Stops all location updates and removes geofences
+ */
+- (void)stop;
+
+@end
@@ -0,0 +1,442 @@
+//
+//  BCLLocationGovernor.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLLocationGovernor.h"
+#import "BCLClock.h"
+
+/// Distances from the edge of the nearest beacon area the tiers start at, in meters
+static CLLocationDistance const BCLLocationGovernorApproachingDistance = 2000;
+static CLLocationDistance const BCLLocationGovernorNearbyDistance = 200;
+
+/// Beacon regions need most of the 20 regions an app can monitor
+static NSUInteger const BCLLocationGovernorMaxGeofencesCount = 3;
+static NSString * const BCLLocationGovernorGeofenceIdentifierPrefix = @"com.up-next.BeaconCtrl.area.";
+
+/// A burst ends after this long, or as soon as a fix is accurate enough
+static NSTimeInterval const BCLLocationGovernorBurstDuration = 15;
+static NSTimeInterval const BCLLocationGovernorNearbyBurstInterval = 60;
+static NSTimeInterval const BCLLocationGovernorApproachingBurstInterval = 5 * 60;
+static CLLocationAccuracy const BCLLocationGovernorNearbyBurstAccuracy = 20;
+static CLLocationAccuracy const BCLLocationGovernorApproachingBurstAccuracy = 200;
+
+/// Locations closer than this to the last one passed to the handler, or than their accuracy, aren't passed
+static CLLocationDistance const BCLLocationGovernorMinimumDistanceChange = 25;
+
+/// Cached locations older than this, delivered when updates start, are ignored
+static NSTimeInterval const BCLLocationGovernorMaxLocationAge = 60;
+
+@interface BCLLocationGovernor ()
+
+@property (nonatomic, strong) CLLocationManager *locationManager;
+@property (nonatomic, copy) void (^handler)(CLLocation *location);
+
+@property (nonatomic, readwrite) BCLLocationGovernorTier tier;
+@property (nonatomic, strong, readwrite) CLLocation *lastLocation;
+@property (nonatomic, readwrite) NSTimeInterval locationUpdatesDuration;
+
+@property (nonatomic, getter=isRunning) BOOL running;
+
+/// The most recent location, whether passed to the handler or not
+@property (nonatomic, strong) CLLocation *currentLocation;
+@property (nonatomic) BOOL shouldPassNextLocation;
+
+@property (nonatomic) BOOL isMonitoringInBackground;
+
+@property (nonatomic, getter=isBursting) BOOL bursting;
+@property (nonatomic) CLLocationAccuracy burstAccuracy;
+@property (nonatomic) NSTimeInterval burstStartTime;
+
+/// Ends bursts and starts the next ones
+@property (nonatomic, strong) dispatch_source_t timer;
+
+@property (nonatomic, copy) NSSet *geofenceIdentifiers;
+
+@end
+
+@implementation BCLLocationGovernor
+
+- (instancetype)initWithLocationManager:(CLLocationManager *)locationManager handler:(void (^)(CLLocation *))handler
+{
+    if (self = [super init]) {
+        _locationManager = locationManager;
+        _locationManager.delegate = self;
+        _handler = [handler copy];
+        _tier = BCLLocationGovernorTierIdle;
+        _geofenceIdentifiers = [NSSet set];
+        _clock = ^NSTimeInterval {
+            return [BCLClock currentClock].uptime;
+        };
+        
+        __weak typeof(self) weakSelf = self;
+        _timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+        dispatch_source_set_event_handler(_timer, ^{
+            [weakSelf timerDidFire];
+        });
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_resume(_timer);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    dispatch_source_cancel(_timer);
+}
+
+- (void)start
+{
+    if (self.isRunning) {
+        return;
+    }
+    
+    self.running = YES;
+    self.shouldPassNextLocation = YES;
+    [self updateTier];
+    
+    if (!self.isSuspended && !self.isBursting) {
+        [self beginBurst];
+    }
+}
+
+- (void)refreshLocation
+{
+    if (!self.isRunning || self.isSuspended) {
+        return;
+    }
+    
+    self.shouldPassNextLocation = YES;
+    [self beginBurst];
+}
+
+- (void)stop
+{
+    if (!self.isRunning) {
+        return;
+    }
+    
+    self.running = NO;
+    [self updateTier];
+    [self updateGeofences];
+}
+
+- (void)setSuspended:(BOOL)suspended
+{
+    if (_suspended == suspended) {
+        return;
+    }
+    
+    _suspended = suspended;
+    
+    if (!self.isRunning) {
+        return;
+    }
+    
+    [self updateTier];
+    
+    // Beacons are no longer in range, so the device is somewhere else than it was last known to be
+    if (!suspended) {
+        self.shouldPassNextLocation = YES;
+        if (!self.isBursting) {
+            [self beginBurst];
+        }
+    }
+}
+
+- (void)setBeaconAreas:(NSArray *)beaconAreas
+{
+    _beaconAreas = [beaconAreas copy];
+    
+    if (self.isRunning) {
+        [self updateTier];
+    }
+}
+
+#pragma mark - Private
+
+- (BCLLocationGovernorTier)tierForLocation:(CLLocation *)location
+{
+    if (!self.isRunning || self.isSuspended) {
+        return BCLLocationGovernorTierIdle;
+    }
+    
+    // Precise fixes are what tell where the device is
+    if (!location) {
+        return BCLLocationGovernorTierNearby;
+    }
+    
+    CLLocationDistance distance = [self distanceToNearestBeaconAreaFromLocation:location];
+    if (distance <= BCLLocationGovernorNearbyDistance) {
+        return BCLLocationGovernorTierNearby;
+    } else if (distance <= BCLLocationGovernorApproachingDistance) {
+        return BCLLocationGovernorTierApproaching;
+    }
+    return BCLLocationGovernorTierDistant;
+}
+
+- (CLLocationDistance)distanceToNearestBeaconAreaFromLocation:(CLLocation *)location
+{
+    CLLocationDistance minDistance = INFINITY;
+    for (CLCircularRegion *area in self.beaconAreas) {
+        CLLocation *center = [[CLLocation alloc] initWithLatitude:area.center.latitude longitude:area.center.longitude];
+        minDistance = MIN(minDistance, MAX([location distanceFromLocation:center] - area.radius, 0));
+    }
+    return minDistance;
+}
+
+- (void)updateTier
+{
+    BCLLocationGovernorTier previousTier = self.tier;
+    self.tier = [self tierForLocation:self.currentLocation];
+    
+    [self updateBackgroundMonitoring];
+    
+    if (self.tier != BCLLocationGovernorTierIdle) {
+        [self updateGeofences];
+    }
+    
+    if (self.tier == previousTier) {
+        return;
+    }
+    
+    BOOL isLocationAccurateEnough = self.currentLocation && self.currentLocation.horizontalAccuracy <= [self burstAccuracyForTier:self.tier];
+    
+    if (self.tier > previousTier && self.tier != BCLLocationGovernorTierDistant && !isLocationAccurateEnough) {
+        // Getting closer, find out how close right away
+        [self beginBurst];
+    } else if (self.isBursting) {
+        [self endBurst];
+    } else {
+        [self scheduleNextBurst];
+    }
+}
+
+/**
+ *  Significant location changes and visits are cheap and relaunch the app, so they run whenever location is needed
+ */
+- (void)updateBackgroundMonitoring
+{
+    BOOL shouldMonitor = self.tier != BCLLocationGovernorTierIdle;
+    if (shouldMonitor == self.isMonitoringInBackground) {
+        return;
+    }
+    self.isMonitoringInBackground = shouldMonitor;
+    
+    if ([CLLocationManager significantLocationChangeMonitoringAvailable]) {
+        if (shouldMonitor) {
+            [self.locationManager startMonitoringSignificantLocationChanges];
+        } else {
+            [self.locationManager stopMonitoringSignificantLocationChanges];
+        }
+    }
+    
+    if ([self.locationManager respondsToSelector:@selector(startMonitoringVisits)]) {
+        if (shouldMonitor) {
+            [self.locationManager startMonitoringVisits];
+        } else {
+            [self.locationManager stopMonitoringVisits];
+        }
+    }
+}
+
+/**
+ *  Keeps geofences around the nearest beacon areas, grown by the nearby distance, so entering one means a burst is due
+ */
+- (void)updateGeofences
+{
+    NSMutableDictionary *geofences = [NSMutableDictionary dictionary];
+    
+    if (self.isRunning && self.currentLocation && [CLLocationManager isMonitoringAvailableForClass:[CLCircularRegion class]]) {
+        CLLocation *location = self.currentLocation;
+        NSArray *nearestAreas = [self.beaconAreas sortedArrayUsingComparator:^NSComparisonResult(CLCircularRegion *area1, CLCircularRegion *area2) {
+            CLLocationDistance distance1 = [location distanceFromLocation:[[CLLocation alloc] initWithLatitude:area1.center.latitude longitude:area1.center.longitude]] - area1.radius;
+            CLLocationDistance distance2 = [location distanceFromLocation:[[CLLocation alloc] initWithLatitude:area2.center.latitude longitude:area2.center.longitude]] - area2.radius;
+            return distance1 < distance2 ? NSOrderedAscending : (distance1 > distance2 ? NSOrderedDescending : NSOrderedSame);
+        }];
+        
+        for (CLCircularRegion *area in [nearestAreas subarrayWithRange:NSMakeRange(0, MIN(nearestAreas.count, BCLLocationGovernorMaxGeofencesCount))]) {
+            NSString *identifier = [BCLLocationGovernorGeofenceIdentifierPrefix stringByAppendingString:area.identifier];
+            CLLocationDistance radius = MIN(area.radius + BCLLocationGovernorNearbyDistance, self.locationManager.maximumRegionMonitoringDistance);
+            CLCircularRegion *geofence = [[CLCircularRegion alloc] initWithCenter:area.center radius:radius identifier:identifier];
+            geofence.notifyOnEntry = YES;
+            geofence.notifyOnExit = NO;
+            geofences[identifier] = geofence;
+        }
+    }
+    
+    NSSet *geofenceIdentifiers = [NSSet setWithArray:geofences.allKeys];
+    if ([geofenceIdentifiers isEqualToSet:self.geofenceIdentifiers]) {
+        return;
+    }
+    
+    // Also removes geofences left over from previous launches
+    for (CLRegion *region in self.locationManager.monitoredRegions) {
+        if ([region.identifier hasPrefix:BCLLocationGovernorGeofenceIdentifierPrefix] && ![geofenceIdentifiers containsObject:region.identifier]) {
+            [self.locationManager stopMonitoringForRegion:region];
+        }
+    }
+    
+    for (NSString *identifier in geofenceIdentifiers) {
+        if (![self.geofenceIdentifiers containsObject:identifier]) {
+            [self.locationManager startMonitoringForRegion:geofences[identifier]];
+        }
+    }
+    
+    self.geofenceIdentifiers = geofenceIdentifiers;
+}
+
+- (CLLocationAccuracy)burstAccuracyForTier:(BCLLocationGovernorTier)tier
+{
+    return tier == BCLLocationGovernorTierNearby ? BCLLocationGovernorNearbyBurstAccuracy : BCLLocationGovernorApproachingBurstAccuracy;
+}
+
+- (void)beginBurst
+{
+    [self beginBurstWithAccuracy:[self burstAccuracyForTier:self.tier]];
+}
+
+- (void)beginBurstWithAccuracy:(CLLocationAccuracy)accuracy
+{
+    if (self.tier == BCLLocationGovernorTierIdle) {
+        return;
+    }
+    
+    if (!self.isBursting) {
+        self.bursting = YES;
+        self.burstStartTime = self.clock();
+    }
+    
+    self.burstAccuracy = accuracy;
+    self.locationManager.desiredAccuracy = accuracy <= BCLLocationGovernorNearbyBurstAccuracy ? kCLLocationAccuracyNearestTenMeters : kCLLocationAccuracyHundredMeters;
+    self.locationManager.distanceFilter = kCLDistanceFilterNone;
+    [self.locationManager startUpdatingLocation];
+    
+    dispatch_source_set_timer(self.timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(BCLLocationGovernorBurstDuration * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, 1 * NSEC_PER_SEC);
+}
+
+- (void)endBurst
+{
+    if (self.isBursting) {
+        [self.locationManager stopUpdatingLocation];
+        self.locationUpdatesDuration += MAX(self.clock() - self.burstStartTime, 0);
+        self.bursting = NO;
+    }
+    
+    [self scheduleNextBurst];
+}
+
+- (void)scheduleNextBurst
+{
+    NSTimeInterval interval;
+    switch (self.tier) {
+        case BCLLocationGovernorTierNearby:
+            interval = BCLLocationGovernorNearbyBurstInterval;
+            break;
+        case BCLLocationGovernorTierApproaching:
+            interval = BCLLocationGovernorApproachingBurstInterval;
+            break;
+        default:
+            dispatch_source_set_timer(self.timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+            return;
+    }
+    
+    dispatch_source_set_timer(self.timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, 5 * NSEC_PER_SEC);
+}
+
+- (void)timerDidFire
+{
+    if (self.isBursting) {
+        [self endBurst];
+    } else {
+        [self beginBurst];
+    }
+}
+
+/**
+ *  CLLocation has floors since iOS 8
+ */
+- (NSNumber *)floorOfLocation:(CLLocation *)location
+{
+    if ([location respondsToSelector:@selector(floor)]) {
+        if ([location performSelector:@selector(floor)]) {
+            return @(location.floor.level);
+        }
+    }
+    return nil;
+}
+
+- (BOOL)floorOfLocation:(CLLocation *)location isEqualToFloorOfLocation:(CLLocation *)otherLocation
+{
+    NSNumber *floor = [self floorOfLocation:location];
+    NSNumber *otherFloor = [self floorOfLocation:otherLocation];
+    return floor == otherFloor || [floor isEqual:otherFloor];
+}
+
+- (void)processLocation:(CLLocation *)location
+{
+    // Aged on the SDK's clock, which replayed locations are timestamped by
+    NSTimeInterval age = [BCLClock currentClock].timeIntervalSince1970 - [location.timestamp timeIntervalSince1970];
+    if (!self.isRunning || location.horizontalAccuracy < 0 || age > BCLLocationGovernorMaxLocationAge) {
+        return;
+    }
+    
+    self.currentLocation = location;
+    
+    BOOL didFloorChange = ![self floorOfLocation:location isEqualToFloorOfLocation:self.lastLocation];
+    if (self.shouldPassNextLocation || !self.lastLocation || didFloorChange || [location distanceFromLocation:self.lastLocation] >= MAX(BCLLocationGovernorMinimumDistanceChange, location.horizontalAccuracy)) {
+        self.shouldPassNextLocation = NO;
+        self.lastLocation = location;
+        if (self.handler) {
+            self.handler(location);
+        }
+    }
+    
+    // Checked after calling the handler, which may suspend the governor
+    if (self.isBursting && location.horizontalAccuracy <= self.burstAccuracy) {
+        [self endBurst];
+    }
+    
+    [self updateTier];
+}
+
+#pragma mark - CLLocationManagerDelegate
+
+- (void)locationManager:(CLLocationManager *)manager didUpdateLocations:(NSArray *)locations
+{
+    [self processLocation:locations.lastObject];
+}
+
+- (void)locationManager:(CLLocationManager *)manager didVisit:(CLVisit *)visit
+{
+    // Only arrivals matter, departures come with significant location changes anyway
+    if (![visit.departureDate isEqualToDate:[NSDate distantFuture]]) {
+        return;
+    }
+    
+    CLLocation *location = [[CLLocation alloc] initWithCoordinate:visit.coordinate altitude:0 horizontalAccuracy:visit.horizontalAccuracy verticalAccuracy:-1 timestamp:[NSDate date]];
+    [self processLocation:location];
+}
+
+- (void)locationManager:(CLLocationManager *)manager didEnterRegion:(CLRegion *)region
+{
+    if (!self.isRunning || ![region.identifier hasPrefix:BCLLocationGovernorGeofenceIdentifierPrefix]) {
+        return;
+    }
+    
+    // Close to beacons, even if the last location says otherwise
+    [self beginBurstWithAccuracy:BCLLocationGovernorNearbyBurstAccuracy];
+}
+
+- (void)locationManager:(CLLocationManager *)manager didFailWithError:(NSError *)error
+{
+    NSLog(@"location governor did fail with error: %@", error);
+}
+
+@end
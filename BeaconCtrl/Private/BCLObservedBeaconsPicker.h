@@ -13,8 +13,29 @@
 #import "BCLLocation.h"
 #import "BCLEncodableObject.h"
 
+/**
+ *  Picks beacons whose regions are worth monitoring within the limited number of regions iOS allows. Candidates from
+ *  the location's floor and its adjacent floors are scored by a weighted sum of:
+ *  - closeness to the location,
+ *  - number of triggers of the beacon and its zone, scaled by closeness,
+ *  - contribution to covering zones, scaled by closeness, which diminishes with every beacon of the zone already picked,
+ *  - recent activity, i.e. being in range or having been left recently, so that coming back gets noticed.
+ *  Beacons are picked greedily by score, after the best one of each adjacent floor, so that floor changes get noticed.
+ */
 @interface BCLObservedBeaconsPicker : BCLEncodableObject
 
+/// Defaults to 1
+@property (nonatomic) double distanceWeight;
+
+/// Defaults to 0.5
+@property (nonatomic) double triggersWeight;
+
+/// Defaults to 0.5
+@property (nonatomic) double zoneCoverageWeight;
+
+/// Defaults to 1
+@property (nonatomic) double activityWeight;
+
 - (instancetype)initWithBeacons:(NSSet *)beacons andZones:(NSSet *)zones;
 
 - (NSSet *)observedBeaconsWithLocation:(BCLLocation *)location beaconsDidChange:(BOOL *)didChange;
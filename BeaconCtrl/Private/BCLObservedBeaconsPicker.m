@@ -10,12 +10,39 @@
 //
 
 #import "BCLObservedBeaconsPicker.h"
+#import "BCLClock.h"
 #import "BCLBeacon.h"
 #import "BCLZone.h"
 
 static NSUInteger const BCLObservedBeaconsPickerMaxObservedBeaconsCount = 16;
 static CGFloat const BCLMinimumDistanceChangeForRecalculation = 6.0;
 
+// Distance, in meters, at which closeness drops to a half
+static CLLocationDistance const BCLObservedBeaconsPickerDistanceScale = 10.0;
+// Closeness of beacons on adjacent floors is lowered, since they're separated by a ceiling
+static double const BCLObservedBeaconsPickerAdjacentFloorClosenessFactor = 0.5;
+static NSUInteger const BCLObservedBeaconsPickerMaxScoredTriggersCount = 3;
+// Time after which activity of a beacon that has been left drops to about a third
+static NSTimeInterval const BCLObservedBeaconsPickerActivityTimeScale = 15 * 60;
+
+typedef struct {
+    __unsafe_unretained BCLBeacon *beacon;
+    double closeness;
+    /// Score without the zone coverage contribution
+    double baseScore;
+    /// Score with the full zone coverage contribution, which is the highest score the beacon can get
+    double maxScore;
+    BOOL isOnAdjacentFloor;
+    BOOL isPicked;
+} BCLObservedBeaconCandidate;
+
+static int BCLCompareCandidatesByMaxScore(const void *candidate1, const void *candidate2)
+{
+    double score1 = ((const BCLObservedBeaconCandidate *)candidate1)->maxScore;
+    double score2 = ((const BCLObservedBeaconCandidate *)candidate2)->maxScore;
+    return score1 < score2 ? 1 : (score1 > score2 ? -1 : 0);
+}
+
 @interface BCLObservedBeaconsPicker ()
 
 @property (nonatomic, copy) NSDictionary *allBeaconsDictionary; // dictionary of sets
@@ -54,6 +81,10 @@ static CGFloat const BCLMinimumDistanceChangeForRecalculation = 6.0;
         _allBeaconsDictionary = [allBeaconsMutableDictionary copy];
         _allZones = zones;
         _shouldZonesBeRecalculated = YES;
+        _distanceWeight = 1;
+        _triggersWeight = 0.5;
+        _zoneCoverageWeight = 0.5;
+        _activityWeight = 1;
     }
     
     return self;
@@ -62,11 +93,11 @@ static CGFloat const BCLMinimumDistanceChangeForRecalculation = 6.0;
 - (NSSet *)observedBeaconsWithLocation:(BCLLocation *)location beaconsDidChange:(BOOL *)didChange
 {
     /*
-     Returns a set that contains closest beacons from the given location's floor
-     plus at least one closest beacon from each adjacent florr (well... there are at most two
-     adjacent floors ;))
+     Returns a set that contains the best scored beacons from the given location's floor
+     and adjacent floors, with at least the best one from each adjacent floor (there are at most two
+     adjacent floors)
      
-     If the floor is not given, it returns the nearest beacons, without checking up their floors
+     If the floor is not given, it picks from all beacons, without checking up their floors
      */
     
     // Return last computed beacons is given location doesn't differ significantly
@@ -110,27 +141,17 @@ static CGFloat const BCLMinimumDistanceChangeForRecalculation = 6.0;
         }];
     }
     
-    // Get the observed beacons for the requested location's floor
-    NSNumber *adjacentFloorsCapacity;
-    if (adjacentFloorNumbersSet.count == 0) {
-        adjacentFloorsCapacity = @0;
-    } else if (adjacentFloorNumbersSet.count == 1) {
-        adjacentFloorsCapacity = @(3);
+    NSMutableArray *candidateFloors = [NSMutableArray array];
+    if (location.floor) {
+        if (self.allBeaconsDictionary[location.floor]) {
+            [candidateFloors addObject:location.floor];
+        }
+        [candidateFloors addObjectsFromArray:adjacentFloorNumbersSet.allObjects];
     } else {
-        adjacentFloorsCapacity = @(2);
+        [candidateFloors addObjectsFromArray:self.allBeaconsDictionary.allKeys];
     }
     
-    NSUInteger givenFloorBeaconsCapacity = BCLObservedBeaconsPickerMaxObservedBeaconsCount - (adjacentFloorsCapacity.integerValue * adjacentFloorNumbersSet.count);
-    
-    NSMutableArray *observedBeacons = [[self sortedBeaconsWithLocation:location floor:location.floor capacityNumber:@(givenFloorBeaconsCapacity)] mutableCopy];
-    
-    // Get at least one closest beacon from each of the adjacent floors
-    __block NSArray *otherFloorFirstBeaconArray;
-    
-    [adjacentFloorNumbersSet enumerateObjectsUsingBlock:^(id floorNumber, BOOL *stop) {
-        otherFloorFirstBeaconArray = [self sortedBeaconsWithLocation:location floor:floorNumber capacityNumber:adjacentFloorsCapacity];
-        [observedBeacons addObjectsFromArray:otherFloorFirstBeaconArray];
-    }];
+    NSArray *observedBeacons = [self pickedBeaconsWithLocation:location candidateFloors:candidateFloors adjacentFloors:adjacentFloorNumbersSet];
     
     NSSet *observedBeaconsSet = [NSSet setWithArray:observedBeacons];
     
@@ -176,58 +197,128 @@ static CGFloat const BCLMinimumDistanceChangeForRecalculation = 6.0;
 
 #pragma mark - Private
 
-- (NSArray *)sortedBeaconsWithLocation:(BCLLocation *)location floor:(NSNumber *)floor capacityNumber:(NSNumber *)capacity
+/**
+ *  Picks up to the maximum number of beacons from the given floors, the best beacon of each adjacent floor first
+ */
+- (NSArray *)pickedBeaconsWithLocation:(BCLLocation *)location candidateFloors:(NSArray *)candidateFloors adjacentFloors:(NSSet *)adjacentFloors
 {
-    NSArray *observedBeacons;
+    NSUInteger candidatesCount = 0;
+    for (NSNumber *floor in candidateFloors) {
+        candidatesCount += [self.allBeaconsDictionary[floor] count];
+    }
     
-    // If no floor is specified, we're looking on all floors
-    if (floor) {
-        observedBeacons = [self.allBeaconsDictionary[floor] copy];
-    } else {
-        NSMutableArray *mutableObservedBeacons = [NSMutableArray array];
-        
-        [self.allBeaconsDictionary.allKeys enumerateObjectsUsingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
-            NSAssert([self.allBeaconsDictionary[obj] isKindOfClass:[NSSet class]], @"Invalid object class");
-            [mutableObservedBeacons addObjectsFromArray:[self.allBeaconsDictionary[obj] allObjects]];
-        }];
-        
-        observedBeacons = [mutableObservedBeacons copy];
+    if (candidatesCount == 0) {
+        return @[];
     }
-
-    __block BCLBeacon *beacon1;
-    __block BCLBeacon *beacon2;
-    __block CLLocationDistance beacon1Distance;
-    __block CLLocationDistance beacon2Distance;
-
-    observedBeacons = [observedBeacons sortedArrayUsingComparator:^NSComparisonResult(id obj1, id obj2) {
-        beacon1 = (BCLBeacon *)obj1;
-        beacon2 = (BCLBeacon *)obj2;
-
-        if (!beacon1.location || !beacon2.location) {
-            NSLog(@"");
+    
+    BCLObservedBeaconCandidate *candidates = calloc(candidatesCount, sizeof(BCLObservedBeaconCandidate));
+    NSTimeInterval now = [BCLClock currentClock].timeIntervalSince1970;
+    
+    NSUInteger idx = 0;
+    for (NSNumber *floor in candidateFloors) {
+        BOOL isAdjacentFloor = [adjacentFloors containsObject:floor];
+        for (BCLBeacon *beacon in self.allBeaconsDictionary[floor]) {
+            BCLObservedBeaconCandidate *candidate = &candidates[idx++];
+            candidate->beacon = beacon;
+            candidate->isOnAdjacentFloor = isAdjacentFloor;
+            [self scoreCandidate:candidate location:location now:now];
+        }
+    }
+    
+    qsort(candidates, candidatesCount, sizeof(BCLObservedBeaconCandidate), BCLCompareCandidatesByMaxScore);
+    
+    NSUInteger slotsCount = MIN(BCLObservedBeaconsPickerMaxObservedBeaconsCount, candidatesCount);
+    NSMutableArray *pickedBeacons = [NSMutableArray arrayWithCapacity:slotsCount];
+    NSCountedSet *pickedZones = [NSCountedSet set];
+    
+    // Sorted, so the first candidate of each adjacent floor is its best one
+    NSMutableSet *floorsToReserve = [adjacentFloors mutableCopy];
+    for (idx = 0; idx < candidatesCount && floorsToReserve.count && pickedBeacons.count < slotsCount; idx++) {
+        NSNumber *floor = candidates[idx].beacon.location.floor ?: @-1;
+        if (candidates[idx].isOnAdjacentFloor && [floorsToReserve containsObject:floor]) {
+            [floorsToReserve removeObject:floor];
+            [self pickCandidate:&candidates[idx] beacons:pickedBeacons zones:pickedZones];
+        }
+    }
+    
+    while (pickedBeacons.count < slotsCount) {
+        BCLObservedBeaconCandidate *bestCandidate = NULL;
+        double bestScore = -INFINITY;
+        
+        for (idx = 0; idx < candidatesCount; idx++) {
+            BCLObservedBeaconCandidate *candidate = &candidates[idx];
+            
+            // Sorted by the highest possible score, so none of the remaining candidates can beat the best one anymore.
+            // In large venues, only the few candidates around the location are scored against picked zones.
+            if (candidate->maxScore <= bestScore) {
+                break;
+            }
+            
+            if (candidate->isPicked) {
+                continue;
+            }
+            
+            double score = candidate->baseScore;
+            BCLZone *zone = candidate->beacon.zone;
+            if (zone) {
+                score += self.zoneCoverageWeight * candidate->closeness / (1 + [pickedZones countForObject:zone]);
+            }
+            
+            if (score > bestScore) {
+                bestScore = score;
+                bestCandidate = candidate;
+            }
         }
         
-        beacon1Distance = [beacon1.location.location distanceFromLocation:location.location];
-        beacon2Distance = [beacon2.location.location distanceFromLocation:location.location];
-
-        if (!beacon1.location && beacon2.location) {
-            return NSOrderedDescending;
-        } else if (!beacon2.location && beacon1.location) {
-            return NSOrderedAscending;
-        } if (beacon1Distance > beacon2Distance) {
-            return NSOrderedDescending;
-        } else if (beacon1Distance < beacon2Distance) {
-            return NSOrderedAscending;
-        } else {
-            return NSOrderedSame;
+        if (!bestCandidate) {
+            break;
         }
-    }];
+        
+        [self pickCandidate:bestCandidate beacons:pickedBeacons zones:pickedZones];
+    }
+    
+    free(candidates);
+    
+    return [pickedBeacons copy];
+}
 
-    if (capacity && observedBeacons.count > capacity.integerValue) {
-        observedBeacons = [observedBeacons subarrayWithRange:NSMakeRange(0, capacity.integerValue)];
+- (void)scoreCandidate:(BCLObservedBeaconCandidate *)candidate location:(BCLLocation *)location now:(NSTimeInterval)now
+{
+    BCLBeacon *beacon = candidate->beacon;
+    
+    // Beacons without a location are picked last, as before
+    double closeness = 0;
+    if (beacon.location.location && location.location) {
+        CLLocationDistance distance = [beacon.location.location distanceFromLocation:location.location];
+        closeness = 1 / (1 + distance / BCLObservedBeaconsPickerDistanceScale);
+        if (candidate->isOnAdjacentFloor) {
+            closeness *= BCLObservedBeaconsPickerAdjacentFloorClosenessFactor;
+        }
     }
     
-    return observedBeacons;
+    NSUInteger triggersCount = MIN(beacon.triggers.count + beacon.zone.triggers.count, BCLObservedBeaconsPickerMaxScoredTriggersCount);
+    
+    double activity = 0;
+    if (beacon.proximity != CLProximityUnknown) {
+        activity = 1;
+    } else if (beacon.lastLeftDate) {
+        activity = exp(-MAX(now - [beacon.lastLeftDate timeIntervalSince1970], 0) / BCLObservedBeaconsPickerActivityTimeScale);
+    }
+    
+    candidate->closeness = closeness;
+    candidate->baseScore = self.distanceWeight * closeness
+                         + self.triggersWeight * closeness * triggersCount / BCLObservedBeaconsPickerMaxScoredTriggersCount
+                         + self.activityWeight * activity;
+    candidate->maxScore = candidate->baseScore + (beacon.zone ? self.zoneCoverageWeight * closeness : 0);
+}
+
+- (void)pickCandidate:(BCLObservedBeaconCandidate *)candidate beacons:(NSMutableArray *)pickedBeacons zones:(NSCountedSet *)pickedZones
+{
+    candidate->isPicked = YES;
+    [pickedBeacons addObject:candidate->beacon];
+    if (candidate->beacon.zone) {
+        [pickedZones addObject:candidate->beacon.zone];
+    }
 }
 
 @end
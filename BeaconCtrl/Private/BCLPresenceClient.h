@@ -0,0 +1,42 @@
+//
+//  BCLPresenceClient.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BCLBackend;
+
+/**
+ *  Presence Add-on client. Keeps a short-lived cache of users in range per beacon and per zone,
+ *  lets concurrent callers share requests for the same identifiers and fetches only the identifiers
+ *  that are missing from the cache.
+ */
+@interface BCLPresenceClient : NSObject
+
+/// How long a fetched presence entry stays valid, in seconds, expired entries are dropped from the cache. Defaults to 10 seconds.
+@property (nonatomic) NSTimeInterval timeToLive;
+
+/// Maximum number of range and zone identifiers sent in a single request. Defaults to 50.
+@property (nonatomic) NSUInteger maxIdentifiersPerRequest;
+
+- (instancetype)initWithBackend:(BCLBackend *)backend;
+
+/**
+ *  Fetches users in range of given beacons and zones. The result has the same format as the one of
+ *  -[BCLBackend fetchUsersInRangesOfBeacons:zones:completion:]
+ */
+- (void)fetchUsersInRangesOfBeacons:(NSSet *)beacons zones:(NSSet *)zones completion:(void (^)(NSDictionary *result, NSError *error))completion;
+
+/**
+ *  Drops all cached presence entries. Requests that are already in flight are not cancelled.
+ */
+- (void)invalidateCache;
+
+@end
@@ -0,0 +1,264 @@
+//
+//  BCLPresenceClient.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLPresenceClient.h"
+#import "BCLBackend.h"
+#import "BCLBeaconCtrl.h"
+#import "BCLBeacon.h"
+#import "BCLZone.h"
+#import "BCLClock.h"
+
+static NSString * const BCLPresenceRangesKey = @"ranges";
+static NSString * const BCLPresenceZonesKey = @"zones";
+
+static NSTimeInterval const BCLPresenceDefaultTimeToLive = 10;
+static NSUInteger const BCLPresenceDefaultMaxIdentifiersPerRequest = 50;
+
+@interface BCLPresenceEntry : NSObject
+
+@property (nonatomic, strong) id users;
+/// Clock uptime of the fetch
+@property (nonatomic) NSTimeInterval fetchDate;
+
+@end
+
+@implementation BCLPresenceEntry
+
+@end
+
+@interface BCLPresenceClient ()
+
+@property (weak) BCLBackend *backend;
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+// kind (ranges/zones) -> identifier -> BCLPresenceEntry
+@property (nonatomic, strong) NSDictionary *cache;
+
+// kind (ranges/zones) -> identifier -> array of blocks waiting for the identifier to be fetched
+@property (nonatomic, strong) NSDictionary *inFlight;
+
+/// Clock uptime of the last removal of expired entries from the cache
+@property (nonatomic) NSTimeInterval purgeDate;
+
+@end
+
+@implementation BCLPresenceClient
+
+- (instancetype)initWithBackend:(BCLBackend *)backend
+{
+    if (self = [super init]) {
+        _backend = backend;
+        _timeToLive = BCLPresenceDefaultTimeToLive;
+        _maxIdentifiersPerRequest = BCLPresenceDefaultMaxIdentifiersPerRequest;
+        _queue = dispatch_queue_create("com.up-next.BeaconCtrl.presence", DISPATCH_QUEUE_SERIAL);
+        _cache = @{BCLPresenceRangesKey: [NSMutableDictionary dictionary], BCLPresenceZonesKey: [NSMutableDictionary dictionary]};
+        _inFlight = @{BCLPresenceRangesKey: [NSMutableDictionary dictionary], BCLPresenceZonesKey: [NSMutableDictionary dictionary]};
+    }
+    return self;
+}
+
+- (void)fetchUsersInRangesOfBeacons:(NSSet *)beacons zones:(NSSet *)zones completion:(void (^)(NSDictionary *, NSError *))completion
+{
+    NSMutableArray *beaconIdList = [NSMutableArray arrayWithCapacity:beacons.count];
+    for (BCLBeacon *beacon in beacons) {
+        if (beacon.beaconIdentifier) {
+            [beaconIdList addObject:beacon.beaconIdentifier];
+        }
+    }
+
+    NSMutableArray *zoneIdList = [NSMutableArray arrayWithCapacity:zones.count];
+    for (BCLZone *zone in zones) {
+        if (zone.zoneIdentifier) {
+            [zoneIdList addObject:zone.zoneIdentifier];
+        }
+    }
+
+    NSDictionary *requestedIdentifiers = @{BCLPresenceRangesKey: beaconIdList, BCLPresenceZonesKey: zoneIdList};
+
+    dispatch_async(self.queue, ^{
+        dispatch_group_t group = dispatch_group_create();
+        __block NSError *fetchError;
+
+        // The result is built from entries resolved for this fetch, the cache may drop them before it completes
+        NSDictionary *entries = @{BCLPresenceRangesKey: [NSMutableDictionary dictionary], BCLPresenceZonesKey: [NSMutableDictionary dictionary]};
+        NSDictionary *missingIdentifiers = @{BCLPresenceRangesKey: [NSMutableArray array], BCLPresenceZonesKey: [NSMutableArray array]};
+        NSTimeInterval now = [BCLClock currentClock].uptime;
+
+        [self purgeExpiredEntriesAtUptime:now];
+
+        for (NSString *kind in requestedIdentifiers) {
+            for (NSString *identifier in requestedIdentifiers[kind]) {
+                BCLPresenceEntry *entry = self.cache[kind][identifier];
+                if (entry && now - entry.fetchDate < self.timeToLive) {
+                    entries[kind][identifier] = entry;
+                    continue;
+                }
+
+                // Either join a request that is already in flight or start a new one for this identifier
+                NSMutableArray *waiters = self.inFlight[kind][identifier];
+                if (!waiters) {
+                    waiters = [NSMutableArray array];
+                    self.inFlight[kind][identifier] = waiters;
+                    [missingIdentifiers[kind] addObject:identifier];
+                }
+
+                dispatch_group_enter(group);
+                [waiters addObject:[^(BCLPresenceEntry *fetchedEntry, NSError *error) {
+                    if (error) {
+                        fetchError = error;
+                    } else {
+                        entries[kind][identifier] = fetchedEntry;
+                    }
+                    dispatch_group_leave(group);
+                } copy]];
+            }
+        }
+
+        [self requestIdentifiers:missingIdentifiers];
+
+        dispatch_group_notify(group, self.queue, ^{
+            if (!completion) {
+                return;
+            }
+
+            if (fetchError) {
+                completion(nil, fetchError);
+                return;
+            }
+
+            NSMutableDictionary *resultDictionary = [NSMutableDictionary dictionary];
+            resultDictionary[BCLPresenceRangesKey] = [NSMutableDictionary dictionary];
+            resultDictionary[BCLPresenceZonesKey] = [NSMutableDictionary dictionary];
+
+            for (BCLBeacon *beacon in beacons) {
+                id users = [entries[BCLPresenceRangesKey][beacon.beaconIdentifier] users];
+                if (users && users != [NSNull null]) {
+                    resultDictionary[BCLPresenceRangesKey][beacon] = users;
+                }
+            }
+
+            for (BCLZone *zone in zones) {
+                id users = [entries[BCLPresenceZonesKey][zone.zoneIdentifier] users];
+                if (users && users != [NSNull null]) {
+                    resultDictionary[BCLPresenceZonesKey][zone] = users;
+                }
+            }
+
+            completion([resultDictionary copy], nil);
+        });
+    });
+}
+
+- (void)invalidateCache
+{
+    dispatch_async(self.queue, ^{
+        [self.cache[BCLPresenceRangesKey] removeAllObjects];
+        [self.cache[BCLPresenceZonesKey] removeAllObjects];
+    });
+}
+
+#pragma mark - Private
+
+/**
+ *  Removes entries older than timeToLive from the cache, so that it doesn't keep every beacon and zone ever asked for.
+ *  Walks the cache at most once per timeToLive. Has to be called on the presence queue.
+ */
+- (void)purgeExpiredEntriesAtUptime:(NSTimeInterval)now
+{
+    if (now - self.purgeDate < self.timeToLive) {
+        return;
+    }
+    self.purgeDate = now;
+
+    for (NSString *kind in self.cache) {
+        NSMutableDictionary *kindCache = self.cache[kind];
+        NSSet *expiredIdentifiers = [kindCache keysOfEntriesPassingTest:^BOOL(NSString *identifier, BCLPresenceEntry *entry, BOOL *stop) {
+            return now - entry.fetchDate >= self.timeToLive;
+        }];
+        [kindCache removeObjectsForKeys:expiredIdentifiers.allObjects];
+    }
+}
+
+/**
+ *  Splits identifiers into chunks of at most maxIdentifiersPerRequest and sends a presence request for each chunk.
+ *  Has to be called on the presence queue.
+ */
+- (void)requestIdentifiers:(NSDictionary *)identifiers
+{
+    NSUInteger chunkSize = MAX(self.maxIdentifiersPerRequest, 1);
+
+    NSMutableArray *rangeChunk = [NSMutableArray array];
+    NSMutableArray *zoneChunk = [NSMutableArray array];
+
+    for (NSString *kind in @[BCLPresenceRangesKey, BCLPresenceZonesKey]) {
+        NSMutableArray *chunk = [kind isEqualToString:BCLPresenceRangesKey] ? rangeChunk : zoneChunk;
+        for (NSString *identifier in identifiers[kind]) {
+            [chunk addObject:identifier];
+            if (rangeChunk.count + zoneChunk.count == chunkSize) {
+                [self requestChunkWithRangeIdentifiers:[rangeChunk copy] zoneIdentifiers:[zoneChunk copy]];
+                [rangeChunk removeAllObjects];
+                [zoneChunk removeAllObjects];
+            }
+        }
+    }
+
+    if (rangeChunk.count + zoneChunk.count) {
+        [self requestChunkWithRangeIdentifiers:[rangeChunk copy] zoneIdentifiers:[zoneChunk copy]];
+    }
+}
+
+- (void)requestChunkWithRangeIdentifiers:(NSArray *)rangeIdentifiers zoneIdentifiers:(NSArray *)zoneIdentifiers
+{
+    BCLBackend *backend = self.backend;
+
+    if (!backend) {
+        NSError *error = [NSError errorWithDomain:BCLErrorDomain code:BCLInvalidParametersErrorCode userInfo:@{NSLocalizedDescriptionKey: @"Invalid backend integration"}];
+        [self finishChunkWithRangeIdentifiers:rangeIdentifiers zoneIdentifiers:zoneIdentifiers ranges:nil zones:nil error:error];
+        return;
+    }
+
+    [backend fetchPresenceForRangeIdentifiers:rangeIdentifiers zoneIdentifiers:zoneIdentifiers completion:^(NSDictionary *ranges, NSDictionary *zones, NSError *error) {
+        dispatch_async(self.queue, ^{
+            [self finishChunkWithRangeIdentifiers:rangeIdentifiers zoneIdentifiers:zoneIdentifiers ranges:ranges zones:zones error:error];
+        });
+    }];
+}
+
+- (void)finishChunkWithRangeIdentifiers:(NSArray *)rangeIdentifiers zoneIdentifiers:(NSArray *)zoneIdentifiers ranges:(NSDictionary *)ranges zones:(NSDictionary *)zones error:(NSError *)error
+{
+    NSTimeInterval now = [BCLClock currentClock].uptime;
+
+    NSDictionary *chunkIdentifiers = @{BCLPresenceRangesKey: rangeIdentifiers, BCLPresenceZonesKey: zoneIdentifiers};
+    NSDictionary *responses = @{BCLPresenceRangesKey: ranges ? : @{}, BCLPresenceZonesKey: zones ? : @{}};
+
+    for (NSString *kind in chunkIdentifiers) {
+        for (NSString *identifier in chunkIdentifiers[kind]) {
+            BCLPresenceEntry *entry;
+            if (!error) {
+                // An identifier missing from the response has no users in range; it's cached as well
+                entry = [[BCLPresenceEntry alloc] init];
+                entry.users = responses[kind][identifier] ? : [NSNull null];
+                entry.fetchDate = now;
+                self.cache[kind][identifier] = entry;
+            }
+
+            NSArray *waiters = self.inFlight[kind][identifier];
+            [self.inFlight[kind] removeObjectForKey:identifier];
+
+            for (void (^waiter)(BCLPresenceEntry *, NSError *) in waiters) {
+                waiter(entry, error);
+            }
+        }
+    }
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+//  BCLRangingHistory.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+extern NSString * const BCLRangingHistoryTimestampKey;
+extern NSString * const BCLRangingHistoryRSSIKey;
+extern NSString * const BCLRangingHistoryAccuracyKey;
+
+/**
+ *  Bounded store of rssi and accuracy readings of beacons. Readings of each beacon are appended to a chunk of at most
+ *  maxChunkReadingsCount readings, with timestamps (in ms) encoded as zigzag varint deltas of deltas and rssi and
+ *  accuracy (in cm) as zigzag varint deltas, which takes 3 to 4 bytes per reading when ranging at a steady rate.
+ *  Chunks over memoryBudget are moved to segment files on disk, oldest first, and the oldest segment files are
+ *  deleted to stay within diskBudget. Everything kept in memory is moved to disk when the app enters the background or
+ *  terminates.
+ *  Thread safe; readings are stored on a private serial queue.
+ */
+@interface BCLRangingHistory : NSObject
+
+/// In bytes, defaults to 256 KB
+@property (nonatomic) NSUInteger memoryBudget;
+
+/// In bytes, defaults to 2 MB. With 0 readings are only kept in memory.
+@property (nonatomic) NSUInteger diskBudget;
+
+/// Defaults to 256
+@property (nonatomic) NSUInteger maxChunkReadingsCount;
+
+/// Number of readings kept in memory and on disk
+@property (nonatomic, readonly) NSUInteger readingsCount;
+
+/// Number of bytes taken by readings kept in memory and on disk
+@property (nonatomic, readonly) NSUInteger storedBytesCount;
+
++ (NSString *)defaultDirectoryPath;
+
+- (instancetype)initWithDirectoryPath:(NSString *)directoryPath;
+
+/**
+ *  @param timestamp Seconds since 1970
+ *  @param accuracy Distance in meters, negative if unknown
+ */
+- (void)recordReadingForBeaconIdentifier:(NSString *)beaconIdentifier rssi:(NSInteger)rssi accuracy:(double)accuracy timestamp:(NSTimeInterval)timestamp;
+
+/**
+ *  Readings of a beacon taken in a time window, oldest first, as dictionaries with BCLRangingHistoryTimestampKey
+ *  (seconds since 1970), BCLRangingHistoryRSSIKey and BCLRangingHistoryAccuracyKey (meters) values
+ */
+- (NSArray *)readingsForBeaconIdentifier:(NSString *)beaconIdentifier fromTimestamp:(NSTimeInterval)fromTimestamp toTimestamp:(NSTimeInterval)toTimestamp;
+
+/**
+ *  Writes all stored readings to a file, in the same compressed format as the segment files
+ */
+- (BOOL)exportToFile:(NSString *)path error:(NSError **)error;
+
+/**
+ *  Moves all readings kept in memory to segment files, chunks still being appended to included. Readings recorded
+ *  afterwards start new chunks. Does nothing without a disk budget.
+ */
+- (void)flushToDisk;
+
+- (void)removeAllReadings;
+
+@end
@@ -0,0 +1,564 @@
+//
+//  BCLRangingHistory.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLRangingHistory.h"
+#import <UIKit/UIKit.h>
+
+NSString * const BCLRangingHistoryTimestampKey = @"timestamp";
+NSString * const BCLRangingHistoryRSSIKey = @"rssi";
+NSString * const BCLRangingHistoryAccuracyKey = @"accuracy";
+
+static NSString * const BCLRangingHistoryDirectoryName = @"BeaconCtrl/RangingHistory";
+static NSString * const BCLRangingHistorySegmentExtension = @"bclh";
+
+static NSUInteger const BCLRangingHistoryDefaultMemoryBudget = 256 * 1024;
+static NSUInteger const BCLRangingHistoryDefaultDiskBudget = 2 * 1024 * 1024;
+static NSUInteger const BCLRangingHistoryDefaultMaxChunkReadingsCount = 256;
+
+/// Segment files are started anew after reaching this fraction of the disk budget, so that eviction frees little at a time
+static NSUInteger const BCLRangingHistorySegmentsPerDiskBudget = 8;
+
+static uint8_t const BCLRangingHistoryFileHeader[] = {'B', 'C', 'L', 'H', 1};
+
+/// Accuracy of readings with unknown distance, in cm
+static int64_t const BCLRangingHistoryUnknownAccuracy = -1;
+
+#pragma mark - Encoding
+
+static void BCLAppendVarint(NSMutableData *data, uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t length = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bytes[length++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    [data appendBytes:bytes length:length];
+}
+
+static BOOL BCLReadVarint(const uint8_t *bytes, size_t length, size_t *offset, uint64_t *value)
+{
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64 && *offset < length; shift += 7) {
+        uint8_t byte = bytes[(*offset)++];
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static inline uint64_t BCLZigZagEncode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t BCLZigZagDecode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+typedef struct {
+    const uint8_t *beaconIdentifier;
+    size_t beaconIdentifierLength;
+    uint64_t count;
+    int64_t firstTimestamp;
+    int64_t lastTimestamp;
+    const uint8_t *payload;
+    size_t payloadLength;
+} BCLRangingHistoryChunkHeader;
+
+/**
+ *  Reads a serialized chunk: identifier length and bytes, readings count, first and last timestamps, payload length
+ *  and payload. Advances offset past the chunk.
+ */
+static BOOL BCLReadChunk(const uint8_t *bytes, size_t length, size_t *offset, BCLRangingHistoryChunkHeader *header)
+{
+    uint64_t identifierLength, firstTimestamp, lastTimestamp, payloadLength;
+
+    if (!BCLReadVarint(bytes, length, offset, &identifierLength) || identifierLength > length - *offset) {
+        return NO;
+    }
+    header->beaconIdentifier = bytes + *offset;
+    header->beaconIdentifierLength = (size_t)identifierLength;
+    *offset += (size_t)identifierLength;
+
+    if (!BCLReadVarint(bytes, length, offset, &header->count) ||
+        !BCLReadVarint(bytes, length, offset, &firstTimestamp) ||
+        !BCLReadVarint(bytes, length, offset, &lastTimestamp) ||
+        !BCLReadVarint(bytes, length, offset, &payloadLength) ||
+        payloadLength > length - *offset) {
+        return NO;
+    }
+    header->firstTimestamp = (int64_t)firstTimestamp;
+    header->lastTimestamp = (int64_t)lastTimestamp;
+    header->payload = bytes + *offset;
+    header->payloadLength = (size_t)payloadLength;
+    *offset += (size_t)payloadLength;
+
+    return YES;
+}
+
+/**
+ *  Decodes readings of a chunk, stopping at the first malformed one
+ */
+static void BCLDecodeChunk(const BCLRangingHistoryChunkHeader *header, void (^block)(int64_t timestamp, int64_t rssi, int64_t accuracy))
+{
+    size_t offset = 0;
+    int64_t timestamp = header->firstTimestamp;
+    int64_t delta = 0;
+    int64_t rssi = 0;
+    int64_t accuracy = 0;
+
+    for (uint64_t idx = 0; idx < header->count; idx++) {
+        uint64_t value;
+
+        if (idx > 0) {
+            if (!BCLReadVarint(header->payload, header->payloadLength, &offset, &value)) {
+                return;
+            }
+            delta += BCLZigZagDecode(value);
+            timestamp += delta;
+        }
+
+        if (!BCLReadVarint(header->payload, header->payloadLength, &offset, &value)) {
+            return;
+        }
+        rssi += BCLZigZagDecode(value);
+
+        if (!BCLReadVarint(header->payload, header->payloadLength, &offset, &value)) {
+            return;
+        }
+        accuracy += BCLZigZagDecode(value);
+
+        block(timestamp, rssi, accuracy);
+    }
+}
+
+#pragma mark - BCLRangingHistoryChunk
+
+/**
+ *  Readings of a single beacon being appended to
+ */
+@interface BCLRangingHistoryChunk : NSObject
+
+@property (nonatomic, copy, readonly) NSString *beaconIdentifier;
+@property (nonatomic, readonly) NSUInteger count;
+@property (nonatomic, readonly) int64_t firstTimestamp;
+@property (nonatomic, readonly) int64_t lastTimestamp;
+@property (nonatomic, strong, readonly) NSMutableData *payload;
+
+@end
+
+@implementation BCLRangingHistoryChunk {
+    int64_t _previousDelta;
+    int64_t _previousRSSI;
+    int64_t _previousAccuracy;
+}
+
+- (instancetype)initWithBeaconIdentifier:(NSString *)beaconIdentifier
+{
+    if (self = [super init]) {
+        _beaconIdentifier = [beaconIdentifier copy];
+        _payload = [NSMutableData data];
+    }
+    return self;
+}
+
+- (void)appendTimestamp:(int64_t)timestamp rssi:(int64_t)rssi accuracy:(int64_t)accuracy
+{
+    if (_count == 0) {
+        _firstTimestamp = timestamp;
+    } else {
+        int64_t delta = timestamp - _lastTimestamp;
+        BCLAppendVarint(_payload, BCLZigZagEncode(delta - _previousDelta));
+        _previousDelta = delta;
+    }
+
+    BCLAppendVarint(_payload, BCLZigZagEncode(rssi - _previousRSSI));
+    BCLAppendVarint(_payload, BCLZigZagEncode(accuracy - _previousAccuracy));
+
+    _lastTimestamp = timestamp;
+    _previousRSSI = rssi;
+    _previousAccuracy = accuracy;
+    _count++;
+}
+
+- (NSData *)serializedData
+{
+    NSData *identifierData = [self.beaconIdentifier dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableData *data = [NSMutableData dataWithCapacity:identifierData.length + self.payload.length + 24];
+
+    BCLAppendVarint(data, identifierData.length);
+    [data appendData:identifierData];
+    BCLAppendVarint(data, self.count);
+    BCLAppendVarint(data, (uint64_t)self.firstTimestamp);
+    BCLAppendVarint(data, (uint64_t)self.lastTimestamp);
+    BCLAppendVarint(data, self.payload.length);
+    [data appendData:self.payload];
+
+    return data;
+}
+
+@end
+
+#pragma mark - BCLRangingHistorySegment
+
+/**
+ *  A file of serialized chunks
+ */
+@interface BCLRangingHistorySegment : NSObject
+
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic) NSUInteger bytesCount;
+@property (nonatomic) NSUInteger readingsCount;
+
+@end
+
+@implementation BCLRangingHistorySegment
+
+@end
+
+#pragma mark - BCLRangingHistory
+
+@interface BCLRangingHistory ()
+
+@property (nonatomic, copy) NSString *directoryPath;
+@property (nonatomic, strong) dispatch_queue_t queue;
+
+/// Beacon identifier -> chunk being appended to
+@property (nonatomic, strong) NSMutableDictionary *openChunks;
+/// Full chunks kept in memory, oldest first
+@property (nonatomic, strong) NSMutableArray *sealedChunks;
+@property (nonatomic) NSUInteger memoryBytesCount;
+@property (nonatomic) NSUInteger memoryReadingsCount;
+
+/// Oldest first
+@property (nonatomic, strong) NSMutableArray *segments;
+@property (nonatomic) uint64_t nextSegmentNumber;
+
+@end
+
+@implementation BCLRangingHistory
+
++ (NSString *)defaultDirectoryPath
+{
+    NSArray *paths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+    return [paths[0] stringByAppendingPathComponent:BCLRangingHistoryDirectoryName];
+}
+
+- (instancetype)initWithDirectoryPath:(NSString *)directoryPath
+{
+    if (self = [super init]) {
+        _directoryPath = [directoryPath copy];
+        _queue = dispatch_queue_create("com.up-next.BeaconCtrl.rangingHistory", DISPATCH_QUEUE_SERIAL);
+        _memoryBudget = BCLRangingHistoryDefaultMemoryBudget;
+        _diskBudget = BCLRangingHistoryDefaultDiskBudget;
+        _maxChunkReadingsCount = BCLRangingHistoryDefaultMaxChunkReadingsCount;
+        _openChunks = [NSMutableDictionary dictionary];
+        _sealedChunks = [NSMutableArray array];
+        _segments = [NSMutableArray array];
+
+        [self loadSegments];
+
+        // The app may not be woken up again before it's killed, which would lose readings kept in memory
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(flushToDisk) name:UIApplicationDidEnterBackgroundNotification object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(flushToDisk) name:UIApplicationWillTerminateNotification object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (NSUInteger)readingsCount
+{
+    __block NSUInteger count;
+    dispatch_sync(self.queue, ^{
+        count = self.memoryReadingsCount;
+        for (BCLRangingHistorySegment *segment in self.segments) {
+            count += segment.readingsCount;
+        }
+    });
+    return count;
+}
+
+- (NSUInteger)storedBytesCount
+{
+    __block NSUInteger count;
+    dispatch_sync(self.queue, ^{
+        count = self.memoryBytesCount;
+        for (BCLRangingHistorySegment *segment in self.segments) {
+            count += segment.bytesCount;
+        }
+    });
+    return count;
+}
+
+- (void)recordReadingForBeaconIdentifier:(NSString *)beaconIdentifier rssi:(NSInteger)rssi accuracy:(double)accuracy timestamp:(NSTimeInterval)timestamp
+{
+    if (!beaconIdentifier) {
+        return;
+    }
+
+    int64_t timestampMs = (int64_t)llround(timestamp * 1000);
+    int64_t accuracyCm = accuracy < 0 ? BCLRangingHistoryUnknownAccuracy : (int64_t)llround(accuracy * 100);
+
+    dispatch_async(self.queue, ^{
+        BCLRangingHistoryChunk *chunk = self.openChunks[beaconIdentifier];
+        if (!chunk) {
+            chunk = [[BCLRangingHistoryChunk alloc] initWithBeaconIdentifier:beaconIdentifier];
+            self.openChunks[beaconIdentifier] = chunk;
+        }
+
+        NSUInteger previousLength = chunk.payload.length;
+        [chunk appendTimestamp:timestampMs rssi:rssi accuracy:accuracyCm];
+        self.memoryBytesCount += chunk.payload.length - previousLength;
+        self.memoryReadingsCount++;
+
+        if (chunk.count >= self.maxChunkReadingsCount) {
+            [self.openChunks removeObjectForKey:beaconIdentifier];
+            [self.sealedChunks addObject:chunk];
+        }
+
+        [self evictChunksOverMemoryBudget];
+    });
+}
+
+- (NSArray *)readingsForBeaconIdentifier:(NSString *)beaconIdentifier fromTimestamp:(NSTimeInterval)fromTimestamp toTimestamp:(NSTimeInterval)toTimestamp
+{
+    NSMutableArray *readings = [NSMutableArray array];
+    NSData *identifierData = [beaconIdentifier dataUsingEncoding:NSUTF8StringEncoding];
+    int64_t fromTimestampMs = (int64_t)floor(fromTimestamp * 1000);
+    int64_t toTimestampMs = (int64_t)ceil(toTimestamp * 1000);
+
+    if (!identifierData) {
+        return readings;
+    }
+
+    void (^readChunk)(const BCLRangingHistoryChunkHeader *) = ^(const BCLRangingHistoryChunkHeader *header) {
+        if (header->lastTimestamp < fromTimestampMs || header->firstTimestamp > toTimestampMs ||
+            header->beaconIdentifierLength != identifierData.length ||
+            memcmp(header->beaconIdentifier, identifierData.bytes, identifierData.length) != 0) {
+            return;
+        }
+
+        BCLDecodeChunk(header, ^(int64_t timestamp, int64_t rssi, int64_t accuracy) {
+            if (timestamp >= fromTimestampMs && timestamp <= toTimestampMs) {
+                [readings addObject:@{BCLRangingHistoryTimestampKey: @(timestamp / 1000.0),
+                                      BCLRangingHistoryRSSIKey: @(rssi),
+                                      BCLRangingHistoryAccuracyKey: @(accuracy == BCLRangingHistoryUnknownAccuracy ? -1.0 : accuracy / 100.0)}];
+            }
+        });
+    };
+
+    dispatch_sync(self.queue, ^{
+        for (BCLRangingHistorySegment *segment in self.segments) {
+            [self enumerateChunksInSegment:segment usingBlock:readChunk];
+        }
+
+        NSMutableArray *chunks = [[self.sealedChunks filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"beaconIdentifier == %@", beaconIdentifier]] mutableCopy];
+        if (self.openChunks[beaconIdentifier]) {
+            [chunks addObject:self.openChunks[beaconIdentifier]];
+        }
+
+        for (BCLRangingHistoryChunk *chunk in chunks) {
+            NSData *data = [chunk serializedData];
+            size_t offset = 0;
+            BCLRangingHistoryChunkHeader header;
+            if (BCLReadChunk(data.bytes, data.length, &offset, &header)) {
+                readChunk(&header);
+            }
+        }
+    });
+
+    return readings;
+}
+
+- (BOOL)exportToFile:(NSString *)path error:(NSError *__autoreleasing *)error
+{
+    NSMutableData *data = [NSMutableData dataWithBytes:BCLRangingHistoryFileHeader length:sizeof(BCLRangingHistoryFileHeader)];
+
+    dispatch_sync(self.queue, ^{
+        for (BCLRangingHistorySegment *segment in self.segments) {
+            NSData *segmentData = [NSData dataWithContentsOfFile:segment.path];
+            if (segmentData.length > sizeof(BCLRangingHistoryFileHeader)) {
+                [data appendData:[segmentData subdataWithRange:NSMakeRange(sizeof(BCLRangingHistoryFileHeader), segmentData.length - sizeof(BCLRangingHistoryFileHeader))]];
+            }
+        }
+
+        for (BCLRangingHistoryChunk *chunk in [self.sealedChunks arrayByAddingObjectsFromArray:self.openChunks.allValues]) {
+            [data appendData:[chunk serializedData]];
+        }
+    });
+
+    return [data writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+- (void)flushToDisk
+{
+    dispatch_sync(self.queue, ^{
+        if (!self.diskBudget) {
+            return;
+        }
+
+        // Open chunks were started after sealed ones
+        [self.sealedChunks addObjectsFromArray:self.openChunks.allValues];
+        [self.openChunks removeAllObjects];
+
+        for (BCLRangingHistoryChunk *chunk in self.sealedChunks) {
+            [self writeChunkToDisk:chunk];
+        }
+        [self.sealedChunks removeAllObjects];
+        self.memoryBytesCount = 0;
+        self.memoryReadingsCount = 0;
+    });
+}
+
+- (void)removeAllReadings
+{
+    dispatch_sync(self.queue, ^{
+        [self.openChunks removeAllObjects];
+        [self.sealedChunks removeAllObjects];
+        self.memoryBytesCount = 0;
+        self.memoryReadingsCount = 0;
+
+        for (BCLRangingHistorySegment *segment in self.segments) {
+            [[NSFileManager defaultManager] removeItemAtPath:segment.path error:nil];
+        }
+        [self.segments removeAllObjects];
+    });
+}
+
+#pragma mark - Private
+
+/**
+ *  Moves the oldest chunks to disk, or drops them without a disk budget. Has to be called on the queue.
+ */
+- (void)evictChunksOverMemoryBudget
+{
+    while (self.memoryBytesCount > self.memoryBudget) {
+        if (!self.sealedChunks.count) {
+            // Every beacon has a chunk being appended to; seal the one started first
+            BCLRangingHistoryChunk *oldestChunk;
+            for (BCLRangingHistoryChunk *chunk in self.openChunks.allValues) {
+                if (!oldestChunk || chunk.firstTimestamp < oldestChunk.firstTimestamp) {
+                    oldestChunk = chunk;
+                }
+            }
+            if (!oldestChunk) {
+                return;
+            }
+            [self.openChunks removeObjectForKey:oldestChunk.beaconIdentifier];
+            [self.sealedChunks addObject:oldestChunk];
+        }
+
+        BCLRangingHistoryChunk *chunk = self.sealedChunks.firstObject;
+        [self.sealedChunks removeObjectAtIndex:0];
+        self.memoryBytesCount -= chunk.payload.length;
+        self.memoryReadingsCount -= chunk.count;
+
+        if (self.diskBudget > 0) {
+            [self writeChunkToDisk:chunk];
+        }
+    }
+}
+
+- (void)writeChunkToDisk:(BCLRangingHistoryChunk *)chunk
+{
+    NSData *data = [chunk serializedData];
+    BCLRangingHistorySegment *segment = self.segments.lastObject;
+
+    if (!segment || segment.bytesCount + data.length > self.diskBudget / BCLRangingHistorySegmentsPerDiskBudget) {
+        [[NSFileManager defaultManager] createDirectoryAtPath:self.directoryPath withIntermediateDirectories:YES attributes:nil error:nil];
+
+        segment = [[BCLRangingHistorySegment alloc] init];
+        segment.path = [self.directoryPath stringByAppendingPathComponent:[NSString stringWithFormat:@"%020llu.%@", self.nextSegmentNumber++, BCLRangingHistorySegmentExtension]];
+
+        NSData *header = [NSData dataWithBytes:BCLRangingHistoryFileHeader length:sizeof(BCLRangingHistoryFileHeader)];
+        if (![header writeToFile:segment.path atomically:NO]) {
+            return;
+        }
+        segment.bytesCount = header.length;
+        [self.segments addObject:segment];
+    }
+
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:segment.path];
+    if (!fileHandle) {
+        return;
+    }
+    [fileHandle seekToEndOfFile];
+    [fileHandle writeData:data];
+    [fileHandle closeFile];
+
+    segment.bytesCount += data.length;
+    segment.readingsCount += chunk.count;
+
+    NSUInteger diskBytesCount = 0;
+    for (BCLRangingHistorySegment *existingSegment in self.segments) {
+        diskBytesCount += existingSegment.bytesCount;
+    }
+
+    while (diskBytesCount > self.diskBudget && self.segments.count) {
+        BCLRangingHistorySegment *oldestSegment = self.segments.firstObject;
+        [[NSFileManager defaultManager] removeItemAtPath:oldestSegment.path error:nil];
+        [self.segments removeObjectAtIndex:0];
+        diskBytesCount -= oldestSegment.bytesCount;
+    }
+}
+
+- (void)enumerateChunksInSegment:(BCLRangingHistorySegment *)segment usingBlock:(void (^)(const BCLRangingHistoryChunkHeader *header))block
+{
+    NSData *data = [NSData dataWithContentsOfFile:segment.path options:NSDataReadingMappedIfSafe error:nil];
+    if (data.length < sizeof(BCLRangingHistoryFileHeader) || memcmp(data.bytes, BCLRangingHistoryFileHeader, sizeof(BCLRangingHistoryFileHeader)) != 0) {
+        return;
+    }
+
+    size_t offset = sizeof(BCLRangingHistoryFileHeader);
+    BCLRangingHistoryChunkHeader header;
+    while (offset < data.length && BCLReadChunk(data.bytes, data.length, &offset, &header)) {
+        block(&header);
+    }
+}
+
+/**
+ *  Picks up segment files written before the app was relaunched
+ */
+- (void)loadSegments
+{
+    NSArray *fileNames = [[[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.directoryPath error:nil] sortedArrayUsingSelector:@selector(compare:)];
+
+    for (NSString *fileName in fileNames) {
+        if (![fileName.pathExtension isEqualToString:BCLRangingHistorySegmentExtension]) {
+            continue;
+        }
+
+        BCLRangingHistorySegment *segment = [[BCLRangingHistorySegment alloc] init];
+        segment.path = [self.directoryPath stringByAppendingPathComponent:fileName];
+        segment.bytesCount = (NSUInteger)[[[NSFileManager defaultManager] attributesOfItemAtPath:segment.path error:nil] fileSize];
+
+        __block NSUInteger readingsCount = 0;
+        [self enumerateChunksInSegment:segment usingBlock:^(const BCLRangingHistoryChunkHeader *header) {
+            readingsCount += (NSUInteger)header->count;
+        }];
+        segment.readingsCount = readingsCount;
+
+        [self.segments addObject:segment];
+        self.nextSegmentNumber = MAX(self.nextSegmentNumber, strtoull(fileName.stringByDeletingPathExtension.UTF8String, NULL, 10) + 1);
+    }
+}
+
+@end
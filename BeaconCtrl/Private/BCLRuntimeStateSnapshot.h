@@ -0,0 +1,90 @@
+//
+//  BCLRuntimeStateSnapshot.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+
+@class SAMCache;
+@class BCLLocation;
+
+/// Snapshots older than this are not restored at all
+extern NSTimeInterval const BCLRuntimeStateSnapshotMaxAge;
+
+/// Distances and RSSI readouts older than this are not restored, the same interval beacons reset their readouts after
+extern NSTimeInterval const BCLRuntimeStateSnapshotMaxReadoutAge;
+
+/// Transient state of a beacon. Times are seconds since 1970, as they have to survive relaunches.
+typedef struct {
+    CLProximity proximity;
+    /// Filtered distance, NSNotFound if unknown
+    double estimatedDistance;
+    NSInteger rssi;
+    /// When the beacon was entered, 0 if unknown
+    NSTimeInterval enterTime;
+    /// When a pending leave of the beacon is due, 0 if none
+    NSTimeInterval leaveTime;
+} BCLRuntimeBeaconState;
+
+/**
+ *  A compact snapshot of what BCLBeaconCtrl only keeps in memory: beacons in range with their distances, pending
+ *  leaves, the zone events were last fired for, the zone estimate and the location observed beacons are picked around.
+ *  Stored as one small dictionary of numbers and strings, so it's cheap enough to take on every backgrounding and
+ *  periodically. Restored state decays with the snapshot's age: readouts are dropped after a minute and everything
+ *  after BCLRuntimeStateSnapshotMaxAge.
+ */
+@interface BCLRuntimeStateSnapshot : NSObject
+
+/// When the snapshot was taken, in seconds since 1970
+@property (nonatomic, readonly) NSTimeInterval timestamp;
+
+/// The zone events were last fired for
+@property (nonatomic, copy) NSString *zoneIdentifier;
+
+/// The estimated zone and its probability, nil identifier if outside of any zone
+@property (nonatomic, copy) NSString *estimatedZoneIdentifier;
+@property (nonatomic) double estimatedZoneConfidence;
+
+@property (nonatomic, strong) BCLLocation *estimatedUserLocation;
+
+@property (nonatomic, readonly) NSArray *beaconIdentifiers;
+
+- (instancetype)initWithTimestamp:(NSTimeInterval)timestamp;
+
+/**
+ *  Reads the snapshot stored in a cache
+ *  @return nil if there is none or it can't be read
+ */
++ (instancetype)snapshotFromCache:(SAMCache *)cache;
+
+- (void)storeInCache:(SAMCache *)cache;
+
++ (void)removeFromCache:(SAMCache *)cache;
+
+/**
+ *  Age of the snapshot at a time
+ *  @return A negative value if the clock went back since the snapshot was taken
+ */
+- (NSTimeInterval)ageAtTime:(NSTimeInterval)time;
+
+/**
+ *  @return YES if the snapshot is too old to restore anything from, or comes from the future
+ */
+- (BOOL)isExpiredAtTime:(NSTimeInterval)time;
+
+- (void)setState:(BCLRuntimeBeaconState)state forBeaconIdentifier:(NSString *)identifier;
+
+/**
+ *  Gets the state of a beacon as it should be restored at a time, with readouts dropped once they're too old
+ *  @return NO if there is no state for the beacon
+ */
+- (BOOL)getState:(BCLRuntimeBeaconState *)state forBeaconIdentifier:(NSString *)identifier atTime:(NSTimeInterval)time;
+
+@end
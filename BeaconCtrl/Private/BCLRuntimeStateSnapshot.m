@@ -0,0 +1,159 @@
+//
+//  BCLRuntimeStateSnapshot.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLRuntimeStateSnapshot.h"
+#import "BCLLocation.h"
+#import <SAMCache/SAMCache.h>
+
+NSTimeInterval const BCLRuntimeStateSnapshotMaxAge = 15 * 60;
+NSTimeInterval const BCLRuntimeStateSnapshotMaxReadoutAge = 60;
+
+static NSString * const BCLRuntimeStateSnapshotCacheKey = @"runtimeState";
+
+static NSUInteger const BCLRuntimeStateSnapshotVersion = 1;
+
+static NSString * const BCLRuntimeStateSnapshotVersionKey = @"version";
+static NSString * const BCLRuntimeStateSnapshotTimestampKey = @"timestamp";
+static NSString * const BCLRuntimeStateSnapshotZoneKey = @"zone";
+static NSString * const BCLRuntimeStateSnapshotEstimatedZoneKey = @"estimatedZone";
+static NSString * const BCLRuntimeStateSnapshotConfidenceKey = @"confidence";
+static NSString * const BCLRuntimeStateSnapshotLocationKey = @"location";
+static NSString * const BCLRuntimeStateSnapshotBeaconsKey = @"beacons";
+
+/// Number of fields a beacon state is stored as
+static NSUInteger const BCLRuntimeBeaconStateFieldsCount = 5;
+
+@interface BCLRuntimeStateSnapshot ()
+
+@property (nonatomic, readwrite) NSTimeInterval timestamp;
+
+/// Beacon identifier -> @[proximity, estimated distance, RSSI, enter time, leave time]
+@property (nonatomic, strong) NSMutableDictionary *beaconStates;
+
+@end
+
+@implementation BCLRuntimeStateSnapshot
+
+- (instancetype)initWithTimestamp:(NSTimeInterval)timestamp
+{
+    if (self = [super init]) {
+        _timestamp = timestamp;
+        _beaconStates = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
++ (instancetype)snapshotFromCache:(SAMCache *)cache
+{
+    NSDictionary *dictionary = [cache objectForKey:BCLRuntimeStateSnapshotCacheKey];
+    if (![dictionary isKindOfClass:[NSDictionary class]] || [dictionary[BCLRuntimeStateSnapshotVersionKey] unsignedIntegerValue] != BCLRuntimeStateSnapshotVersion) {
+        return nil;
+    }
+    
+    BCLRuntimeStateSnapshot *snapshot = [[self alloc] initWithTimestamp:[dictionary[BCLRuntimeStateSnapshotTimestampKey] doubleValue]];
+    snapshot.zoneIdentifier = dictionary[BCLRuntimeStateSnapshotZoneKey];
+    snapshot.estimatedZoneIdentifier = dictionary[BCLRuntimeStateSnapshotEstimatedZoneKey];
+    snapshot.estimatedZoneConfidence = [dictionary[BCLRuntimeStateSnapshotConfidenceKey] doubleValue];
+    
+    NSArray *location = dictionary[BCLRuntimeStateSnapshotLocationKey];
+    if ([location isKindOfClass:[NSArray class]] && location.count >= 2) {
+        CLLocation *coordinate = [[CLLocation alloc] initWithLatitude:[location[0] doubleValue] longitude:[location[1] doubleValue]];
+        snapshot.estimatedUserLocation = [[BCLLocation alloc] initWithLocation:coordinate floor:location.count > 2 ? location[2] : nil];
+    }
+    
+    NSDictionary *beaconStates = dictionary[BCLRuntimeStateSnapshotBeaconsKey];
+    if ([beaconStates isKindOfClass:[NSDictionary class]]) {
+        [beaconStates enumerateKeysAndObjectsUsingBlock:^(NSString *identifier, NSArray *state, BOOL *stop) {
+            if ([state isKindOfClass:[NSArray class]] && state.count == BCLRuntimeBeaconStateFieldsCount) {
+                snapshot.beaconStates[identifier] = state;
+            }
+        }];
+    }
+    
+    return snapshot;
+}
+
+- (void)storeInCache:(SAMCache *)cache
+{
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    dictionary[BCLRuntimeStateSnapshotVersionKey] = @(BCLRuntimeStateSnapshotVersion);
+    dictionary[BCLRuntimeStateSnapshotTimestampKey] = @(self.timestamp);
+    dictionary[BCLRuntimeStateSnapshotZoneKey] = self.zoneIdentifier;
+    dictionary[BCLRuntimeStateSnapshotEstimatedZoneKey] = self.estimatedZoneIdentifier;
+    dictionary[BCLRuntimeStateSnapshotConfidenceKey] = @(self.estimatedZoneConfidence);
+    
+    CLLocation *location = self.estimatedUserLocation.location;
+    if (location) {
+        NSMutableArray *locationArray = [@[@(location.coordinate.latitude), @(location.coordinate.longitude)] mutableCopy];
+        if (self.estimatedUserLocation.floor) {
+            [locationArray addObject:self.estimatedUserLocation.floor];
+        }
+        dictionary[BCLRuntimeStateSnapshotLocationKey] = locationArray;
+    }
+    
+    dictionary[BCLRuntimeStateSnapshotBeaconsKey] = [self.beaconStates copy];
+    
+    [cache setObject:dictionary forKey:BCLRuntimeStateSnapshotCacheKey];
+}
+
++ (void)removeFromCache:(SAMCache *)cache
+{
+    [cache removeObjectForKey:BCLRuntimeStateSnapshotCacheKey];
+}
+
+- (NSArray *)beaconIdentifiers
+{
+    return self.beaconStates.allKeys;
+}
+
+- (NSTimeInterval)ageAtTime:(NSTimeInterval)time
+{
+    return time - self.timestamp;
+}
+
+- (BOOL)isExpiredAtTime:(NSTimeInterval)time
+{
+    NSTimeInterval age = [self ageAtTime:time];
+    return age < 0 || age >= BCLRuntimeStateSnapshotMaxAge;
+}
+
+- (void)setState:(BCLRuntimeBeaconState)state forBeaconIdentifier:(NSString *)identifier
+{
+    if (!identifier) {
+        return;
+    }
+    
+    self.beaconStates[identifier] = @[@(state.proximity), @(state.estimatedDistance), @(state.rssi), @(state.enterTime), @(state.leaveTime)];
+}
+
+- (BOOL)getState:(BCLRuntimeBeaconState *)state forBeaconIdentifier:(NSString *)identifier atTime:(NSTimeInterval)time
+{
+    NSArray *fields = identifier ? self.beaconStates[identifier] : nil;
+    if (!fields || [self isExpiredAtTime:time]) {
+        return NO;
+    }
+    
+    state->proximity = [fields[0] integerValue];
+    state->estimatedDistance = [fields[1] doubleValue];
+    state->rssi = [fields[2] integerValue];
+    state->enterTime = [fields[3] doubleValue];
+    state->leaveTime = [fields[4] doubleValue];
+    
+    // The beacon is still in range unless a leave was reported, but where exactly has to be measured again
+    if ([self ageAtTime:time] > BCLRuntimeStateSnapshotMaxReadoutAge) {
+        state->estimatedDistance = NSNotFound;
+        state->rssi = 0;
+    }
+    
+    return YES;
+}
+
+@end
@@ -0,0 +1,58 @@
+//
+//  BCLVisitAggregator.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BCLActionEvent, SAMCache;
+
+/// Upper bounds, in seconds, of dwell histogram buckets. The histogram has one more bucket for longer visits.
+extern NSArray *BCLVisitAggregatorDwellHistogramBounds(void);
+
+/**
+ *  Folds zone enter and leave events into visit counts, dwell time histograms and zone to zone transition counts,
+ *  per zone and hour. Aggregates are kept as nested dictionaries:
+ *
+ *      { "<hour start>": { "<zone id>": { "visits": n, "dwell_histogram": [n, ...], "transitions": { "<zone id>": n } } } }
+ *
+ *  Visits, their dwell times and transitions into a zone are counted in the hour the visit started. Counts only ever
+ *  add up, so uploaded aggregates are subtracted from the stored ones rather than removed, and whatever is counted
+ *  in the meantime, also for hours that have already been uploaded, goes with the next upload.
+ *  Aggregates and visits in progress are stored in a cache, so they're carried over relaunches.
+ *  Not thread safe, has to be used from a single serial queue.
+ */
+@interface BCLVisitAggregator : NSObject
+
+/// Longest time, in seconds, between leaving a zone and entering another one that is counted as a transition. Defaults to 5 minutes.
+@property (nonatomic) NSTimeInterval transitionInterval;
+
+- (instancetype)initWithCache:(SAMCache *)cache;
+
+/**
+ *  Counts a zone enter or leave event, other events are ignored
+ */
+- (void)addEvent:(BCLActionEvent *)event;
+
+/**
+ *  Aggregates of hours that ended before a given time, nil if there are none
+ */
+- (NSDictionary *)aggregatesOfHoursEndedBefore:(NSTimeInterval)timestamp;
+
+/**
+ *  Subtracts aggregates that have been uploaded
+ */
+- (void)removeAggregates:(NSDictionary *)aggregates;
+
+/**
+ *  Drops all aggregates and visits in progress
+ */
+- (void)removeAllAggregates;
+
+@end
@@ -0,0 +1,220 @@
+//
+//  BCLVisitAggregator.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLVisitAggregator.h"
+#import "BCLActionEvent.h"
+#import <SAMCache/SAMCache.h>
+
+static NSString * const BCLVisitAggregatorAggregatesKey = @"aggregates";
+static NSString * const BCLVisitAggregatorOpenVisitsKey = @"openVisits";
+static NSString * const BCLVisitAggregatorLastLeaveKey = @"lastLeave";
+
+static NSString * const BCLVisitAggregatorVisitsKey = @"visits";
+static NSString * const BCLVisitAggregatorDwellHistogramKey = @"dwell_histogram";
+static NSString * const BCLVisitAggregatorTransitionsKey = @"transitions";
+
+static NSTimeInterval const BCLVisitAggregatorHourInterval = 60 * 60;
+
+// Visits that were never left, e.g. because the app got killed inside a zone, are forgotten after a day
+static NSTimeInterval const BCLVisitAggregatorMaxVisitDuration = 24 * 60 * 60;
+
+NSArray *BCLVisitAggregatorDwellHistogramBounds(void)
+{
+    return @[@60, @300, @900, @1800, @3600];
+}
+
+/**
+ *  Adds, or subtracts for a negative sign, counts kept as nested dictionaries and arrays of numbers.
+ *  Returns nil if all the resulting counts are 0, so emptied entries disappear.
+ */
+static id BCLAddCounts(id counts, id otherCounts, NSInteger sign)
+{
+    if (!otherCounts) {
+        return counts;
+    }
+    
+    if ([otherCounts isKindOfClass:[NSDictionary class]]) {
+        NSMutableSet *keys = [NSMutableSet setWithArray:[otherCounts allKeys]];
+        [keys addObjectsFromArray:[counts allKeys] ?: @[]];
+        
+        NSMutableDictionary *result = [NSMutableDictionary dictionaryWithCapacity:keys.count];
+        for (id key in keys) {
+            id value = BCLAddCounts(counts[key], otherCounts[key], sign);
+            if (value) {
+                result[key] = value;
+            }
+        }
+        return result.count ? [result copy] : nil;
+    }
+    
+    if ([otherCounts isKindOfClass:[NSArray class]]) {
+        NSUInteger count = MAX([counts count], [otherCounts count]);
+        NSMutableArray *result = [NSMutableArray arrayWithCapacity:count];
+        BOOL hasCounts = NO;
+        for (NSUInteger idx = 0; idx < count; idx++) {
+            NSInteger value = (idx < [counts count] ? [counts[idx] integerValue] : 0) + sign * (idx < [otherCounts count] ? [otherCounts[idx] integerValue] : 0);
+            hasCounts = hasCounts || value != 0;
+            [result addObject:@(value)];
+        }
+        return hasCounts ? [result copy] : nil;
+    }
+    
+    NSInteger value = [counts integerValue] + sign * [otherCounts integerValue];
+    return value != 0 ? @(value) : nil;
+}
+
+@interface BCLVisitAggregator ()
+
+@property (nonatomic, strong) SAMCache *cache;
+
+@end
+
+@implementation BCLVisitAggregator
+
+- (instancetype)initWithCache:(SAMCache *)cache
+{
+    if (self = [super init]) {
+        _cache = cache;
+        _transitionInterval = 5 * 60;
+    }
+    return self;
+}
+
+- (void)addEvent:(BCLActionEvent *)event
+{
+    if (!event.zoneIdentifier) {
+        return;
+    }
+    
+    // A coalesced leave stands for several flapping ones, the visit has lasted until the last of them
+    switch (event.eventType) {
+        case BCLEventTypeEnter:
+            [self enterZone:event.zoneIdentifier timestamp:event.firstTimestamp];
+            break;
+        case BCLEventTypeLeave:
+            [self leaveZone:event.zoneIdentifier timestamp:event.lastTimestamp];
+            break;
+        default:
+            break;
+    }
+}
+
+- (NSDictionary *)aggregatesOfHoursEndedBefore:(NSTimeInterval)timestamp
+{
+    NSDictionary *aggregates = [self.cache objectForKey:BCLVisitAggregatorAggregatesKey];
+    NSMutableDictionary *endedAggregates = [NSMutableDictionary dictionary];
+    
+    [aggregates enumerateKeysAndObjectsUsingBlock:^(NSString *hourKey, NSDictionary *zones, BOOL *stop) {
+        if (hourKey.doubleValue + BCLVisitAggregatorHourInterval <= timestamp) {
+            endedAggregates[hourKey] = zones;
+        }
+    }];
+    
+    return endedAggregates.count ? [endedAggregates copy] : nil;
+}
+
+- (void)removeAggregates:(NSDictionary *)aggregates
+{
+    [self setObject:BCLAddCounts([self.cache objectForKey:BCLVisitAggregatorAggregatesKey], aggregates, -1) forKey:BCLVisitAggregatorAggregatesKey];
+}
+
+- (void)removeAllAggregates
+{
+    [self.cache removeObjectForKey:BCLVisitAggregatorAggregatesKey];
+    [self.cache removeObjectForKey:BCLVisitAggregatorOpenVisitsKey];
+    [self.cache removeObjectForKey:BCLVisitAggregatorLastLeaveKey];
+}
+
+#pragma mark - Private
+
+- (void)enterZone:(NSString *)zoneIdentifier timestamp:(NSTimeInterval)timestamp
+{
+    NSMutableDictionary *openVisits = [self openVisitsAtTimestamp:timestamp];
+    if (openVisits[zoneIdentifier]) {
+        return;
+    }
+    
+    openVisits[zoneIdentifier] = @(timestamp);
+    [self setObject:[openVisits copy] forKey:BCLVisitAggregatorOpenVisitsKey];
+    
+    [self addCounts:@{BCLVisitAggregatorVisitsKey: @1} forZone:zoneIdentifier visitStartedAt:timestamp];
+    
+    NSDictionary *lastLeave = [self.cache objectForKey:BCLVisitAggregatorLastLeaveKey];
+    NSString *previousZoneIdentifier = lastLeave[@"zone"];
+    NSTimeInterval leaveTimestamp = [lastLeave[@"timestamp"] doubleValue];
+    
+    if (previousZoneIdentifier && ![previousZoneIdentifier isEqualToString:zoneIdentifier] && timestamp - leaveTimestamp <= self.transitionInterval) {
+        [self addCounts:@{BCLVisitAggregatorTransitionsKey: @{zoneIdentifier: @1}} forZone:previousZoneIdentifier visitStartedAt:timestamp];
+    }
+    
+    [self.cache removeObjectForKey:BCLVisitAggregatorLastLeaveKey];
+}
+
+- (void)leaveZone:(NSString *)zoneIdentifier timestamp:(NSTimeInterval)timestamp
+{
+    NSMutableDictionary *openVisits = [self openVisitsAtTimestamp:timestamp];
+    NSNumber *enterTimestamp = openVisits[zoneIdentifier];
+    if (!enterTimestamp) {
+        return;
+    }
+    
+    [openVisits removeObjectForKey:zoneIdentifier];
+    [self setObject:[openVisits copy] forKey:BCLVisitAggregatorOpenVisitsKey];
+    
+    NSTimeInterval dwellTime = MAX(timestamp - enterTimestamp.doubleValue, 0);
+    NSArray *bounds = BCLVisitAggregatorDwellHistogramBounds();
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:bounds.count + 1];
+    BOOL counted = NO;
+    for (NSNumber *bound in bounds) {
+        [histogram addObject:@(!counted && dwellTime < bound.doubleValue ? 1 : 0)];
+        counted = counted || dwellTime < bound.doubleValue;
+    }
+    [histogram addObject:@(counted ? 0 : 1)];
+    
+    [self addCounts:@{BCLVisitAggregatorDwellHistogramKey: histogram} forZone:zoneIdentifier visitStartedAt:enterTimestamp.doubleValue];
+    
+    [self setObject:@{@"zone": zoneIdentifier, @"timestamp": @(timestamp)} forKey:BCLVisitAggregatorLastLeaveKey];
+}
+
+/**
+ *  Visits in progress, without the ones that are too old to be ever left
+ */
+- (NSMutableDictionary *)openVisitsAtTimestamp:(NSTimeInterval)timestamp
+{
+    NSDictionary *openVisits = [self.cache objectForKey:BCLVisitAggregatorOpenVisitsKey];
+    NSMutableDictionary *result = [NSMutableDictionary dictionaryWithCapacity:openVisits.count];
+    
+    [openVisits enumerateKeysAndObjectsUsingBlock:^(NSString *zoneIdentifier, NSNumber *enterTimestamp, BOOL *stop) {
+        if (timestamp - enterTimestamp.doubleValue <= BCLVisitAggregatorMaxVisitDuration) {
+            result[zoneIdentifier] = enterTimestamp;
+        }
+    }];
+    
+    return result;
+}
+
+- (void)addCounts:(NSDictionary *)counts forZone:(NSString *)zoneIdentifier visitStartedAt:(NSTimeInterval)timestamp
+{
+    NSString *hourKey = [NSString stringWithFormat:@"%lld", (long long)(floor(timestamp / BCLVisitAggregatorHourInterval) * BCLVisitAggregatorHourInterval)];
+    NSDictionary *aggregates = BCLAddCounts([self.cache objectForKey:BCLVisitAggregatorAggregatesKey], @{hourKey: @{zoneIdentifier: counts}}, 1);
+    [self setObject:aggregates forKey:BCLVisitAggregatorAggregatesKey];
+}
+
+- (void)setObject:(id)object forKey:(NSString *)key
+{
+    if (object) {
+        [self.cache setObject:object forKey:key];
+    } else {
+        [self.cache removeObjectForKey:key];
+    }
+}
+
+@end
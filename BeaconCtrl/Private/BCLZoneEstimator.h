@@ -0,0 +1,72 @@
+//
+//  BCLZoneEstimator.h
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+@class BCLZone;
+
+/**
+ *  Recursive Bayesian estimate of the zone the device is in, a hidden Markov model over zones of observed beacons and
+ *  an "outside of any zone" state. Every update predicts with the transition model and weighs the prediction with how
+ *  likely the current estimated distances of beacons are in each state. The estimated zone only changes once another
+ *  state's probability reaches the confidence threshold, which keeps it from flipping at zone boundaries. When beacons
+ *  of the estimated zone stop being seen, its probability decays until being outside of any zone reaches the threshold.
+ */
+@interface BCLZoneEstimator : NSObject
+
+/**
+ *  Transition model: the probability of staying in a zone, respectively outside of zones, for a second. The rest is
+ *  spread over all states by transition weights. Both default to 0.9.
+ */
+@property (nonatomic) double zoneStayProbability;
+@property (nonatomic) double outsideStayProbability;
+
+/// Probability another state needs to reach to become the estimated one. Defaults to 0.8.
+@property (nonatomic) double confidenceThreshold;
+
+/// Returns the current time in seconds. Defaults to the uptime of +[BCLClock currentClock]; can be replaced when replaying traces.
+@property (nonatomic, copy) NSTimeInterval (^clock)(void);
+
+/// The estimated zone, nil if the device is estimated to be outside of any zone
+@property (nonatomic, strong, readonly) BCLZone *currentZone;
+
+/// Probability of the estimated zone, or of being outside of any zone
+@property (nonatomic, readonly) double confidence;
+
+/**
+ *  Updates the estimate with the current estimated distances of beacons, in O(number of beacons), or in O(number of
+ *  beacons + squared number of their zones) once transition weights are set
+ *  @return YES if the estimated zone has changed
+ */
+- (BOOL)updateWithBeacons:(NSSet *)beacons;
+
+/**
+ *  Probability of being in a zone, or outside of any zone for nil
+ */
+- (double)probabilityOfZone:(BCLZone *)zone;
+
+- (void)reset;
+
+/**
+ *  Relative weight of landing in a state when leaving another one, nil standing for outside of any zone. Weights
+ *  default to 1, so leaving a state lands in any state, itself included, with the same probability. A weight of 0
+ *  rules a transition out, e.g. between zones that aren't next to each other. Weights are kept across resets.
+ */
+- (void)setTransitionWeight:(double)weight fromZone:(BCLZone *)fromZone toZone:(BCLZone *)toZone;
+- (double)transitionWeightFromZone:(BCLZone *)fromZone toZone:(BCLZone *)toZone;
+
+/**
+ *  Restores an estimate made some time ago, e.g. before a relaunch. The next update predicts over the time that has
+ *  passed since, so the restored probability fades as it would have without the gap.
+ */
+- (void)restoreZone:(BCLZone *)zone confidence:(double)confidence age:(NSTimeInterval)age;
+
+@end
@@ -0,0 +1,281 @@
+//
+//  BCLZoneEstimator.m
+//  BeaconCtrl
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import "BCLZoneEstimator.h"
+#import "BCLClock.h"
+#import "BCLBeacon.h"
+#import "BCLZone.h"
+
+/// Estimated distance, in meters, at which a seen beacon is as likely to be in the device's zone as not
+static double const BCLZoneEstimatorDistanceScale = 3.0;
+
+/// Probability that a beacon of the device's zone isn't seen
+static double const BCLZoneEstimatorMissProbability = 0.5;
+
+/// Keeps a single misleading readout from ruling a state out
+static double const BCLZoneEstimatorMinLikelihood = 0.01;
+
+@interface BCLZoneEstimator ()
+
+@property (nonatomic, strong, readwrite) BCLZone *currentZone;
+
+/// Zone -> probability of being in it
+@property (nonatomic, strong) NSMapTable *zoneProbabilities;
+@property (nonatomic) double outsideProbability;
+
+@property (nonatomic) NSTimeInterval lastUpdateTime;
+
+/// Zone, or NSNull for outside -> zone, or NSNull -> weight, only for weights other than 1
+@property (nonatomic, strong) NSMapTable *transitionWeights;
+
+@end
+
+@implementation BCLZoneEstimator
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _zoneStayProbability = 0.9;
+        _outsideStayProbability = 0.9;
+        _confidenceThreshold = 0.8;
+        _transitionWeights = [NSMapTable strongToStrongObjectsMapTable];
+        _clock = ^NSTimeInterval {
+            return [BCLClock currentClock].uptime;
+        };
+        [self reset];
+    }
+    return self;
+}
+
+- (void)reset
+{
+    self.zoneProbabilities = [NSMapTable strongToStrongObjectsMapTable];
+    self.outsideProbability = 1;
+    self.currentZone = nil;
+    self.lastUpdateTime = 0;
+}
+
+- (void)restoreZone:(BCLZone *)zone confidence:(double)confidence age:(NSTimeInterval)age
+{
+    [self reset];
+    
+    if (zone) {
+        confidence = MIN(MAX(confidence, 0), 1);
+        [self.zoneProbabilities setObject:@(confidence) forKey:zone];
+        self.outsideProbability = 1 - confidence;
+    }
+    
+    self.currentZone = zone;
+    // 0 means there was no update yet
+    self.lastUpdateTime = MAX(self.clock() - MAX(age, 0), DBL_MIN);
+}
+
+- (void)setTransitionWeight:(double)weight fromZone:(BCLZone *)fromZone toZone:(BCLZone *)toZone
+{
+    id fromKey = fromZone ?: [NSNull null];
+    NSMapTable *weights = [self.transitionWeights objectForKey:fromKey];
+    if (!weights) {
+        weights = [NSMapTable strongToStrongObjectsMapTable];
+        [self.transitionWeights setObject:weights forKey:fromKey];
+    }
+    
+    if (weight == 1) {
+        [weights removeObjectForKey:toZone ?: [NSNull null]];
+    } else {
+        [weights setObject:@(MAX(weight, 0)) forKey:toZone ?: [NSNull null]];
+    }
+}
+
+- (double)transitionWeightFromZone:(BCLZone *)fromZone toZone:(BCLZone *)toZone
+{
+    NSNumber *weight = [[self.transitionWeights objectForKey:fromZone ?: [NSNull null]] objectForKey:toZone ?: [NSNull null]];
+    return weight ? weight.doubleValue : 1;
+}
+
+- (double)confidence
+{
+    return [self probabilityOfZone:self.currentZone];
+}
+
+- (double)probabilityOfZone:(BCLZone *)zone
+{
+    if (!zone) {
+        return self.outsideProbability;
+    }
+    return [[self.zoneProbabilities objectForKey:zone] doubleValue];
+}
+
+- (BOOL)updateWithBeacons:(NSSet *)beacons
+{
+    NSTimeInterval now = self.clock();
+    NSTimeInterval elapsedTime = self.lastUpdateTime > 0 ? MAX(now - self.lastUpdateTime, 0) : DBL_MAX;
+    self.lastUpdateTime = now;
+    
+    // Log likelihood of each zone relative to being outside of any zone. Seen beacons of other zones weigh the same
+    // in every state but their own zone's, so only the beacons' own zones need to be updated.
+    NSMapTable *logLikelihoods = [NSMapTable strongToStrongObjectsMapTable];
+    for (BCLBeacon *beacon in beacons) {
+        BCLZone *zone = beacon.zone;
+        if (!zone) {
+            continue;
+        }
+        
+        double logLikelihood = [[logLikelihoods objectForKey:zone] doubleValue];
+        
+        if (beacon.proximity == CLProximityUnknown) {
+            logLikelihood += log(BCLZoneEstimatorMissProbability);
+        } else {
+            double closeness = 0.5;
+            if (beacon.estimatedDistance != NSNotFound && beacon.estimatedDistance > 0) {
+                double relativeDistance = beacon.estimatedDistance / BCLZoneEstimatorDistanceScale;
+                closeness = 1 / (1 + relativeDistance * relativeDistance);
+            }
+            logLikelihood += log(BCLZoneEstimatorMinLikelihood + (1 - BCLZoneEstimatorMinLikelihood) * closeness);
+            logLikelihood -= log(BCLZoneEstimatorMinLikelihood + (1 - BCLZoneEstimatorMinLikelihood) * (1 - closeness));
+        }
+        
+        [logLikelihoods setObject:@(logLikelihood) forKey:zone];
+    }
+    
+    // The current zone stays a state when none of its beacons is seen, weighed as a missed beacon. It fades over a few
+    // updates and is only left once another state reaches the confidence threshold, instead of being dropped at once.
+    BCLZone *previousZone = self.currentZone;
+    if (previousZone && ![logLikelihoods objectForKey:previousZone]) {
+        [logLikelihoods setObject:@(log(BCLZoneEstimatorMissProbability)) forKey:previousZone];
+    }
+    
+    // Prediction. Leaving a state means landing in any state, including the same one, with the same probability
+    // unless transition weights say otherwise. Staying probabilities are per second, so after a long gap between
+    // updates every state is about as likely.
+    NSArray *zones = [[logLikelihoods keyEnumerator] allObjects];
+    NSUInteger statesCount = zones.count + 1;
+    double zonesProbability = 0;
+    for (BCLZone *zone in zones) {
+        zonesProbability += [[self.zoneProbabilities objectForKey:zone] doubleValue];
+    }
+    // Other zones that are no longer observed give their probability to being outside
+    double outsideProbability = MAX(1 - zonesProbability, 0);
+    
+    double zoneStayProbability = elapsedTime == DBL_MAX ? 0 : pow(self.zoneStayProbability, elapsedTime);
+    double outsideStayProbability = elapsedTime == DBL_MAX ? 0 : pow(self.outsideStayProbability, elapsedTime);
+    
+    // States are the zones, in order, and outside of any zone last
+    double *predictions = calloc(statesCount, sizeof(double));
+    double *leavingProbabilities = calloc(statesCount, sizeof(double));
+    for (NSUInteger idx = 0; idx < zones.count; idx++) {
+        double probability = [[self.zoneProbabilities objectForKey:zones[idx]] doubleValue];
+        predictions[idx] = zoneStayProbability * probability;
+        leavingProbabilities[idx] = (1 - zoneStayProbability) * probability;
+    }
+    predictions[zones.count] = outsideStayProbability * outsideProbability;
+    leavingProbabilities[zones.count] = (1 - outsideStayProbability) * outsideProbability;
+    
+    [self spreadLeavingProbabilities:leavingProbabilities ofZones:zones intoPredictions:predictions];
+    
+    NSMapTable *predictedProbabilities = [NSMapTable strongToStrongObjectsMapTable];
+    for (NSUInteger idx = 0; idx < zones.count; idx++) {
+        [predictedProbabilities setObject:@(predictions[idx]) forKey:zones[idx]];
+    }
+    double predictedOutsideProbability = predictions[zones.count];
+    
+    free(predictions);
+    free(leavingProbabilities);
+    
+    // Correction, scaled by the largest likelihood to stay in range of doubles
+    double maxLogLikelihood = 0;
+    for (BCLZone *zone in logLikelihoods) {
+        maxLogLikelihood = MAX(maxLogLikelihood, [[logLikelihoods objectForKey:zone] doubleValue]);
+    }
+    
+    double totalProbability = predictedOutsideProbability * exp(-maxLogLikelihood);
+    for (BCLZone *zone in logLikelihoods) {
+        double probability = [[predictedProbabilities objectForKey:zone] doubleValue] * exp([[logLikelihoods objectForKey:zone] doubleValue] - maxLogLikelihood);
+        [predictedProbabilities setObject:@(probability) forKey:zone];
+        totalProbability += probability;
+    }
+    
+    if (totalProbability <= 0) {
+        [self reset];
+        self.lastUpdateTime = now;
+        return NO;
+    }
+    
+    BCLZone *mostProbableZone = nil;
+    double mostProbableZoneProbability = predictedOutsideProbability * exp(-maxLogLikelihood) / totalProbability;
+    self.outsideProbability = mostProbableZoneProbability;
+    
+    self.zoneProbabilities = [NSMapTable strongToStrongObjectsMapTable];
+    for (BCLZone *zone in predictedProbabilities) {
+        double probability = [[predictedProbabilities objectForKey:zone] doubleValue] / totalProbability;
+        [self.zoneProbabilities setObject:@(probability) forKey:zone];
+        if (probability > mostProbableZoneProbability) {
+            mostProbableZone = zone;
+            mostProbableZoneProbability = probability;
+        }
+    }
+    
+    if (mostProbableZone != self.currentZone && mostProbableZoneProbability >= self.confidenceThreshold) {
+        self.currentZone = mostProbableZone;
+    }
+    
+    return self.currentZone != previousZone;
+}
+
+#pragma mark - Private
+
+/**
+ *  Adds probabilities of leaving each state to the predictions of the states it lands in, in proportion to transition
+ *  weights. Both arrays have a state per zone, in order, and outside of any zone last.
+ */
+- (void)spreadLeavingProbabilities:(const double *)leavingProbabilities ofZones:(NSArray *)zones intoPredictions:(double *)predictions
+{
+    NSUInteger statesCount = zones.count + 1;
+    
+    // Without weights, every state gets the same share of everything that leaves
+    if (!self.transitionWeights.count) {
+        double mixedProbability = 0;
+        for (NSUInteger idx = 0; idx < statesCount; idx++) {
+            mixedProbability += leavingProbabilities[idx];
+        }
+        mixedProbability /= statesCount;
+        
+        for (NSUInteger idx = 0; idx < statesCount; idx++) {
+            predictions[idx] += mixedProbability;
+        }
+        return;
+    }
+    
+    double *weights = calloc(statesCount, sizeof(double));
+    
+    for (NSUInteger fromIdx = 0; fromIdx < statesCount; fromIdx++) {
+        BCLZone *fromZone = fromIdx < zones.count ? zones[fromIdx] : nil;
+        
+        double totalWeight = 0;
+        for (NSUInteger toIdx = 0; toIdx < statesCount; toIdx++) {
+            weights[toIdx] = [self transitionWeightFromZone:fromZone toZone:toIdx < zones.count ? zones[toIdx] : nil];
+            totalWeight += weights[toIdx];
+        }
+        
+        // A state with every transition ruled out keeps what would leave it
+        if (totalWeight <= 0) {
+            predictions[fromIdx] += leavingProbabilities[fromIdx];
+            continue;
+        }
+        
+        for (NSUInteger toIdx = 0; toIdx < statesCount; toIdx++) {
+            predictions[toIdx] += leavingProbabilities[fromIdx] * weights[toIdx] / totalWeight;
+        }
+    }
+    
+    free(weights);
+}
+
+@end
@@ -16,5 +16,8 @@
 + (SAMCache *) bcl_monitoredProximityCache;
 + (SAMCache *) bcl_lastActionEventsCache;
 + (SAMCache *)bcl_actionEventsCache;
++ (SAMCache *)bcl_dwellCheckpointCache;
++ (SAMCache *)bcl_visitAggregatesCache;
++ (SAMCache *)bcl_runtimeStateCache;
 
 @end
@@ -11,6 +11,9 @@
 static SAMCache *bcl_monitoredProximityCache;
 static SAMCache *bcl_lastActionEventsCache;
 static SAMCache *bcl_actionEventsCache;
+static SAMCache *bcl_dwellCheckpointCache;
+static SAMCache *bcl_visitAggregatesCache;
+static SAMCache *bcl_runtimeStateCache;
 
 @implementation SAMCache (BeaconCtrl)
 
@@ -56,4 +59,46 @@ static SAMCache *bcl_actionEventsCache;
     return bcl_actionEventsCache;
 }
 
++ (SAMCache *)bcl_dwellCheckpointCache
+{
+    if (bcl_dwellCheckpointCache != nil) {
+        return bcl_dwellCheckpointCache;
+    }
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        bcl_dwellCheckpointCache = [[SAMCache alloc] initWithName:[NSString stringWithFormat:@"com.up-next.BeaconCtrl.dwellCheckpointCache"]];
+    });
+    
+    return bcl_dwellCheckpointCache;
+}
+
++ (SAMCache *)bcl_visitAggregatesCache
+{
+    if (bcl_visitAggregatesCache != nil) {
+        return bcl_visitAggregatesCache;
+    }
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        bcl_visitAggregatesCache = [[SAMCache alloc] initWithName:[NSString stringWithFormat:@"com.up-next.BeaconCtrl.visitAggregatesCache"]];
+    });
+    
+    return bcl_visitAggregatesCache;
+}
+
++ (SAMCache *)bcl_runtimeStateCache
+{
+    if (bcl_runtimeStateCache != nil) {
+        return bcl_runtimeStateCache;
+    }
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        bcl_runtimeStateCache = [[SAMCache alloc] initWithName:[NSString stringWithFormat:@"com.up-next.BeaconCtrl.runtimeStateCache"]];
+    });
+    
+    return bcl_runtimeStateCache;
+}
+
 @end
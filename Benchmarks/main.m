@@ -0,0 +1,876 @@
+//
+//  main.m
+//  BeaconCtrlBenchmarks
+//
+// Copyright (c) 2015, Upnext Technologies Sp. z o.o.
+// All rights reserved.
+//
+// This source code is licensed under the BSD 3-Clause License found in the
+// LICENSE.txt file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreLocation/CoreLocation.h>
+#import <sys/resource.h>
+#import <malloc/malloc.h>
+#import <stdatomic.h>
+#import <SAMCache/SAMCache.h>
+
+#import "BCLBeacon.h"
+#import "BCLZone.h"
+#import "BCLTrigger.h"
+#import "BCLLocation.h"
+#import "BCLBeaconRangingBatch.h"
+#import "BCLClock.h"
+#import "BCLObservedBeaconsPicker.h"
+#import "BCLZoneEstimator.h"
+#import "BCLConfiguration.h"
+#import "BCLConfigurationDecoder.h"
+#import "BCLConfigurationShardStore.h"
+#import "BCLActionEvent.h"
+#import "BCLActionEventOutbox.h"
+#import "BCLRangingHistory.h"
+
+/// Beacons of the fixture stand along a corridor, every 10 m, 12 per floor, 4 per zone
+static NSUInteger const BCLBenchmarkBeaconsCount = 24;
+static NSUInteger const BCLBenchmarkBeaconsPerFloor = 12;
+static NSUInteger const BCLBenchmarkBeaconsPerZone = 4;
+static double const BCLBenchmarkBeaconSpacing = 10;
+
+static NSUInteger const BCLBenchmarkDefaultRepeatCount = 20;
+
+/// The large venue of the picker benchmark has 10 floors of 40 by 25 beacons, 10 m apart, 4 per zone
+static NSUInteger const BCLBenchmarkLargeVenueBeaconsCount = 10000;
+static NSUInteger const BCLBenchmarkLargeVenueFloorBeaconsCount = 1000;
+static NSUInteger const BCLBenchmarkLargeVenueRowBeaconsCount = 40;
+
+/// Locations the picker is asked for per run in the large venue
+static NSUInteger const BCLBenchmarkLargeVenuePicksCount = 200;
+
+/// The zone estimate is evaluated on walks along floor 0 of the fixture, at 1 m/s, pausing in the middle of every zone
+static NSUInteger const BCLBenchmarkWalksCount = 4;
+static NSUInteger const BCLBenchmarkWalkPauseDuration = 30;
+static long const BCLBenchmarkWalkSeed = 42;
+
+/// Log-distance path loss model of readings on the walks: RSSI at 1 m, path loss exponent, noise and the weakest RSSI
+/// that is still heard
+static double const BCLBenchmarkTxPower = -59;
+static double const BCLBenchmarkPathLossExponent = 2.5;
+static double const BCLBenchmarkRSSINoise = 4;
+static double const BCLBenchmarkMinRSSI = -90;
+
+/// Generated configurations have venues of 100 beacons, about 5 km apart, so that they're sharded
+static NSUInteger const BCLBenchmarkConfigurationBeaconsCount = 1000;
+static NSUInteger const BCLBenchmarkVenueBeaconsCount = 100;
+
+/// Events stored per run, then serialized in batches of the outbox's default size
+static NSUInteger const BCLBenchmarkEventsCount = 500;
+
+/// Ranging history is fed by 50 beacons ranged at 10 Hz, for 5 minutes per run
+static NSUInteger const BCLBenchmarkHistoryBeaconsCount = 50;
+static NSUInteger const BCLBenchmarkHistoryRangingRate = 10;
+static NSUInteger const BCLBenchmarkHistoryDuration = 5 * 60;
+
+/// Writes of each writer and reads of each reader per run of the configuration stress test
+static NSUInteger const BCLBenchmarkStressWritesCount = 2000;
+static NSUInteger const BCLBenchmarkStressReadersCount = 4;
+
+@interface BCLConfiguration (BCLBenchmark)
+
+- (void)setBeacons:(NSSet *)beacons;
+- (void)setZones:(NSSet *)zones;
+
+@end
+
+// Defined in BCLBeaconCtrl.m, which would pull the whole SDK into the benchmark
+NSString * const BCLErrorDomain = @"com.up-next.BCLBeaconCtrl";
+NSInteger const BCLInvalidDataErrorCode = -5;
+
+/// One reading of the trace
+typedef struct {
+    NSUInteger time;
+    NSUInteger beaconIndex;
+    NSInteger rssi;
+    double accuracy;
+} BCLBenchmarkReading;
+
+@interface BCLBenchmarkTrace : NSObject
+
+@property (nonatomic) BCLBenchmarkReading *readings;
+@property (nonatomic) NSUInteger count;
+@property (nonatomic) NSUInteger duration;
+
+@end
+
+@implementation BCLBenchmarkTrace
+
+/**
+ *  Reads a CSV trace of time (whole seconds from the start), beacon index, RSSI and accuracy, one reading per line,
+ *  ordered by time. Lines starting with # are skipped.
+ */
+- (instancetype)initWithContentsOfFile:(NSString *)path
+{
+    NSString *contents = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
+    if (!contents) {
+        return nil;
+    }
+
+    if (self = [super init]) {
+        NSArray *lines = [contents componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]];
+        _readings = calloc(MAX(lines.count, 1), sizeof(BCLBenchmarkReading));
+
+        for (NSString *line in lines) {
+            if (!line.length || [line hasPrefix:@"#"]) {
+                continue;
+            }
+
+            NSArray *fields = [line componentsSeparatedByString:@","];
+            if (fields.count != 4 || (NSUInteger)[fields[1] integerValue] >= BCLBenchmarkBeaconsCount) {
+                continue;
+            }
+
+            BCLBenchmarkReading *reading = &_readings[_count++];
+            reading->time = (NSUInteger)[fields[0] integerValue];
+            reading->beaconIndex = (NSUInteger)[fields[1] integerValue];
+            reading->rssi = [fields[2] integerValue];
+            reading->accuracy = [fields[3] doubleValue];
+            _duration = MAX(_duration, reading->time + 1);
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_readings);
+}
+
+/**
+ *  Calls the block with the readings of every second, in order
+ */
+- (void)enumerateSecondsUsingBlock:(void (^)(NSUInteger time, const BCLBenchmarkReading *readings, NSUInteger count))block
+{
+    NSUInteger start = 0;
+    while (start < self.count) {
+        NSUInteger end = start;
+        while (end < self.count && self.readings[end].time == self.readings[start].time) {
+            end++;
+        }
+        block(self.readings[start].time, &self.readings[start], end - start);
+        start = end;
+    }
+}
+
+@end
+
+#pragma mark - Fixture
+
+static BCLLocation *BCLBenchmarkLocation(double meters, NSUInteger floor)
+{
+    // About 111 km per degree of latitude
+    CLLocation *location = [[CLLocation alloc] initWithLatitude:52.4064 + meters / 111000.0 longitude:16.9252];
+    return [[BCLLocation alloc] initWithLocation:location floor:@(floor)];
+}
+
+static NSArray *BCLBenchmarkMakeBeacons(NSSet **zones)
+{
+    NSUUID *proximityUUID = [[NSUUID alloc] initWithUUIDString:@"F7826DA6-4FA2-4E98-8024-BC5B71E0893E"];
+    NSMutableArray *beacons = [NSMutableArray arrayWithCapacity:BCLBenchmarkBeaconsCount];
+    NSMutableSet *zonesSet = [NSMutableSet set];
+    BCLZone *zone;
+
+    for (NSUInteger idx = 0; idx < BCLBenchmarkBeaconsCount; idx++) {
+        if (idx % BCLBenchmarkBeaconsPerZone == 0) {
+            NSString *zoneIdentifier = [NSString stringWithFormat:@"%lu", (unsigned long)(idx / BCLBenchmarkBeaconsPerZone)];
+            zone = [[BCLZone alloc] initWithIdentifier:zoneIdentifier name:zoneIdentifier];
+            zone.beacons = [NSHashTable weakObjectsHashTable];
+            [zonesSet addObject:zone];
+        }
+
+        NSString *beaconIdentifier = [NSString stringWithFormat:@"%lu", (unsigned long)idx];
+        BCLBeacon *beacon = [[BCLBeacon alloc] initWithIdentifier:beaconIdentifier proximityUUID:proximityUUID major:@1 minor:@(idx)];
+        beacon.name = beaconIdentifier;
+        beacon.location = BCLBenchmarkLocation((idx % BCLBenchmarkBeaconsPerFloor) * BCLBenchmarkBeaconSpacing, idx / BCLBenchmarkBeaconsPerFloor);
+        beacon.zone = zone;
+        [zone.beacons addObject:beacon];
+        [beacons addObject:beacon];
+    }
+
+    *zones = [zonesSet copy];
+    return [beacons copy];
+}
+
+static BCLLocation *BCLBenchmarkLargeVenueLocation(NSUInteger position)
+{
+    NSUInteger floorPosition = position % BCLBenchmarkLargeVenueFloorBeaconsCount;
+    double north = (floorPosition / BCLBenchmarkLargeVenueRowBeaconsCount) * BCLBenchmarkBeaconSpacing;
+    double east = (floorPosition % BCLBenchmarkLargeVenueRowBeaconsCount) * BCLBenchmarkBeaconSpacing;
+
+    // About 68 km per degree of longitude at this latitude
+    CLLocation *location = [[CLLocation alloc] initWithLatitude:52.4064 + north / 111000.0 longitude:16.9252 + east / 68000.0];
+    return [[BCLLocation alloc] initWithLocation:location floor:@(position / BCLBenchmarkLargeVenueFloorBeaconsCount)];
+}
+
+/**
+ *  Beacons of a large venue, for the picker. Every 50th beacon has been in range a while ago and every 500th still is,
+ *  so that activity gets scored as well.
+ */
+static NSSet *BCLBenchmarkMakeLargeVenueBeacons(NSSet **zones)
+{
+    NSUUID *proximityUUID = [[NSUUID alloc] initWithUUIDString:@"F7826DA6-4FA2-4E98-8024-BC5B71E0893E"];
+    NSMutableSet *beacons = [NSMutableSet setWithCapacity:BCLBenchmarkLargeVenueBeaconsCount];
+    NSMutableSet *zonesSet = [NSMutableSet set];
+    BCLZone *zone;
+
+    for (NSUInteger idx = 0; idx < BCLBenchmarkLargeVenueBeaconsCount; idx++) {
+        if (idx % BCLBenchmarkBeaconsPerZone == 0) {
+            NSString *zoneIdentifier = [NSString stringWithFormat:@"%lu", (unsigned long)(idx / BCLBenchmarkBeaconsPerZone)];
+            zone = [[BCLZone alloc] initWithIdentifier:zoneIdentifier name:zoneIdentifier];
+            zone.beacons = [NSHashTable weakObjectsHashTable];
+            [zonesSet addObject:zone];
+        }
+
+        NSString *beaconIdentifier = [NSString stringWithFormat:@"%lu", (unsigned long)idx];
+        BCLBeacon *beacon = [[BCLBeacon alloc] initWithIdentifier:beaconIdentifier proximityUUID:proximityUUID major:@(idx / 1000 + 1) minor:@(idx % 1000)];
+        beacon.location = BCLBenchmarkLargeVenueLocation(idx);
+        beacon.zone = zone;
+        [zone.beacons addObject:beacon];
+        [beacons addObject:beacon];
+
+        if (idx % 50 == 0) {
+            beacon.proximity = CLProximityNear;
+            if (idx % 500) {
+                beacon.proximity = CLProximityUnknown;
+            }
+        }
+    }
+
+    *zones = [zonesSet copy];
+    return [beacons copy];
+}
+
+/**
+ *  Proximity iOS reports with an accuracy, roughly
+ */
+static CLProximity BCLBenchmarkProximity(double accuracy)
+{
+    return accuracy < 0.5 ? CLProximityImmediate : (accuracy < 4 ? CLProximityNear : CLProximityFar);
+}
+
+/**
+ *  Positions on floor 0 of the fixture, one per second, of walks from one end of the corridor to the other and back
+ */
+static NSData *BCLBenchmarkWalk(void)
+{
+    NSMutableData *positions = [NSMutableData data];
+    double corridorLength = (BCLBenchmarkBeaconsPerFloor - 1) * BCLBenchmarkBeaconSpacing;
+    double zoneLength = BCLBenchmarkBeaconsPerZone * BCLBenchmarkBeaconSpacing;
+
+    for (NSUInteger walk = 0; walk < BCLBenchmarkWalksCount; walk++) {
+        for (double meters = 0; meters <= corridorLength; meters++) {
+            double position = walk % 2 ? corridorLength - meters : meters;
+            NSUInteger secondsCount = 1;
+            if (fmod(position, zoneLength) == (zoneLength - BCLBenchmarkBeaconSpacing) / 2) {
+                secondsCount += BCLBenchmarkWalkPauseDuration;
+            }
+            for (NSUInteger second = 0; second < secondsCount; second++) {
+                [positions appendBytes:&position length:sizeof(double)];
+            }
+        }
+    }
+
+    return [positions copy];
+}
+
+/**
+ *  Sets a reading of a beacon at a distance from the device, drawn from the path loss model. A beacon too weak to be
+ *  heard is out of range.
+ */
+static void BCLBenchmarkHearBeacon(BCLBeacon *beacon, double distance)
+{
+    // Gaussian noise, by the Box-Muller transform
+    double noise = sqrt(-2 * log(1 - drand48())) * cos(2 * M_PI * drand48()) * BCLBenchmarkRSSINoise;
+    double rssi = BCLBenchmarkTxPower - 10 * BCLBenchmarkPathLossExponent * log10(MAX(distance, 1)) + noise;
+
+    if (rssi < BCLBenchmarkMinRSSI) {
+        beacon.proximity = CLProximityUnknown;
+        beacon.accuracy = 0;
+        beacon.rssi = 0;
+        return;
+    }
+
+    double accuracy = pow(10, (BCLBenchmarkTxPower - rssi) / (10 * BCLBenchmarkPathLossExponent));
+    beacon.proximity = BCLBenchmarkProximity(accuracy);
+    beacon.accuracy = accuracy;
+    beacon.rssi = lround(rssi);
+}
+
+/**
+ *  Where the device is estimated to be: at the beacon with the shortest accuracy in the second's readings
+ */
+static BCLLocation *BCLBenchmarkDeviceLocation(const BCLBenchmarkReading *readings, NSUInteger count)
+{
+    const BCLBenchmarkReading *closest = &readings[0];
+    for (NSUInteger idx = 1; idx < count; idx++) {
+        if (readings[idx].accuracy < closest->accuracy) {
+            closest = &readings[idx];
+        }
+    }
+    return BCLBenchmarkLocation((closest->beaconIndex % BCLBenchmarkBeaconsPerFloor) * BCLBenchmarkBeaconSpacing, closest->beaconIndex / BCLBenchmarkBeaconsPerFloor);
+}
+
+/**
+ *  A configuration as fetched from the backend, with a zone of every 4 beacons and an enter trigger for every zone
+ */
+static NSData *BCLBenchmarkConfigurationData(NSUInteger beaconsCount)
+{
+    NSMutableArray *ranges = [NSMutableArray arrayWithCapacity:beaconsCount];
+    NSMutableArray *zones = [NSMutableArray array];
+    NSMutableArray *triggers = [NSMutableArray array];
+
+    for (NSUInteger idx = 0; idx < beaconsCount; idx++) {
+        NSUInteger venue = idx / BCLBenchmarkVenueBeaconsCount;
+        NSUInteger position = idx % BCLBenchmarkVenueBeaconsCount;
+        double latitude = 52.4064 + venue * 0.05 + (position % BCLBenchmarkBeaconsPerFloor) * BCLBenchmarkBeaconSpacing / 111000.0;
+
+        [ranges addObject:@{@"id": @(idx + 1),
+                            @"name": [NSString stringWithFormat:@"Beacon %lu", (unsigned long)(idx + 1)],
+                            @"protocol": @"iBeacon",
+                            @"proximity_id": [NSString stringWithFormat:@"F7826DA6-4FA2-4E98-8024-BC5B71E0893E+%lu+%lu", (unsigned long)(venue + 1), (unsigned long)position],
+                            @"location": @{@"lat": @(latitude), @"lng": @16.9252, @"floor": @(position / BCLBenchmarkBeaconsPerFloor)},
+                            @"vendor": @"Kontakt",
+                            @"unique_id": [NSString stringWithFormat:@"b%05lu", (unsigned long)idx]}];
+
+        if (position % BCLBenchmarkBeaconsPerZone == 0) {
+            NSNumber *zoneIdentifier = @(idx / BCLBenchmarkBeaconsPerZone + 1);
+            NSMutableArray *beaconIds = [NSMutableArray arrayWithCapacity:BCLBenchmarkBeaconsPerZone];
+            for (NSUInteger beaconIdx = idx; beaconIdx < MIN(idx + BCLBenchmarkBeaconsPerZone, beaconsCount); beaconIdx++) {
+                [beaconIds addObject:@(beaconIdx + 1)];
+            }
+
+            [zones addObject:@{@"id": zoneIdentifier,
+                               @"name": [NSString stringWithFormat:@"Zone %@", zoneIdentifier],
+                               @"color": @"4a90e2",
+                               @"beacon_ids": beaconIds}];
+            [triggers addObject:@{@"zone_ids": @[zoneIdentifier],
+                                  @"conditions": @[@{@"type": @"event_type", @"event_type": @"enter"}],
+                                  @"action": @{@"id": zoneIdentifier, @"name": @"Welcome", @"type": @"url", @"payload": @{@"url": @"https://example.com"}},
+                                  @"test": @NO}];
+        }
+    }
+
+    NSDictionary *configuration = @{@"ranges": ranges, @"zones": zones, @"triggers": triggers, @"extensions": @{}};
+    return [NSJSONSerialization dataWithJSONObject:configuration options:0 error:nil];
+}
+
+/**
+ *  Decodes a configuration the way it was before BCLConfigurationDecoder: the backend parsed the response with
+ *  NSJSONSerialization to validate it, then the configuration parsed it again into a tree and mapped the tree to
+ *  models, looking up beacons and zones of triggers with predicates
+ *  @return The number of decoded beacons
+ */
+static NSUInteger BCLBenchmarkDecodeConfigurationWithJSONSerialization(NSData *data)
+{
+    if (![NSJSONSerialization JSONObjectWithData:data options:0 error:nil]) {
+        return 0;
+    }
+
+    NSDictionary *configurationDictionary = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+
+    NSMutableSet *beaconsSet = [NSMutableSet set];
+    for (NSDictionary *beaconDictionary in configurationDictionary[@"ranges"]) {
+        BCLBeacon *beacon = [[BCLBeacon alloc] init];
+        [beacon updatePropertiesFromDictionary:beaconDictionary];
+        [beaconsSet addObject:beacon];
+    }
+
+    NSMutableSet *zonesSet = [NSMutableSet set];
+    for (NSDictionary *zoneDictionary in configurationDictionary[@"zones"]) {
+        BCLZone *zone = [[BCLZone alloc] init];
+        [zone updatePropertiesFromDictionary:zoneDictionary beacons:beaconsSet];
+        [zonesSet addObject:zone];
+    }
+
+    for (NSDictionary *triggerDictionary in configurationDictionary[@"triggers"]) {
+        for (NSNumber *beaconId in triggerDictionary[@"range_ids"]) {
+            NSSet *beaconSet = [beaconsSet filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"beaconIdentifier == %@", beaconId.description]];
+            for (BCLBeacon *beacon in beaconSet) {
+                BCLTrigger *trigger = [[BCLTrigger alloc] init];
+                trigger.beacon = beacon;
+                [trigger updatePropertiesFromDictionary:triggerDictionary];
+                beacon.triggers = [beacon.triggers arrayByAddingObject:trigger];
+            }
+        }
+
+        for (NSNumber *zoneId in triggerDictionary[@"zone_ids"]) {
+            NSSet *zoneSet = [zonesSet filteredSetUsingPredicate:[NSPredicate predicateWithFormat:@"zoneIdentifier == %@", zoneId.description]];
+            for (BCLZone *zone in zoneSet) {
+                BCLTrigger *trigger = [[BCLTrigger alloc] init];
+                trigger.zone = zone;
+                [trigger updatePropertiesFromDictionary:triggerDictionary];
+                zone.triggers = [zone.triggers arrayByAddingObject:trigger];
+            }
+        }
+    }
+
+    return beaconsSet.count;
+}
+
+#pragma mark - Measuring
+
+/// Signature of libmalloc's logging hook, the one malloc stack logging sets
+typedef void (BCLBenchmarkMallocLogger)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t numHotFramesToSkip);
+extern BCLBenchmarkMallocLogger *malloc_logger;
+
+/// MALLOC_LOG_TYPE_ALLOCATE of libmalloc, set for malloc, calloc, realloc and valloc
+static uint32_t const BCLBenchmarkMallocLogTypeAllocate = 2;
+
+static atomic_uint_fast64_t BCLBenchmarkAllocationsCount;
+
+/// Largest number of bytes the heap had in use since the counted run started
+static atomic_size_t BCLBenchmarkPeakHeapBytes;
+
+/// Writes of the configuration stress test that didn't survive a concurrent write of the other writer
+static atomic_uint_fast64_t BCLBenchmarkLostUpdatesCount;
+
+static void BCLBenchmarkCountAllocation(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t numHotFramesToSkip)
+{
+    if (type & BCLBenchmarkMallocLogTypeAllocate) {
+        atomic_fetch_add_explicit(&BCLBenchmarkAllocationsCount, 1, memory_order_relaxed);
+
+        // The heap only grows through allocations, so sampling it after each of them catches its peak
+        malloc_statistics_t statistics;
+        malloc_zone_statistics(NULL, &statistics);
+        size_t peakHeapBytes = atomic_load_explicit(&BCLBenchmarkPeakHeapBytes, memory_order_relaxed);
+        while (statistics.size_in_use > peakHeapBytes && !atomic_compare_exchange_weak(&BCLBenchmarkPeakHeapBytes, &peakHeapBytes, statistics.size_in_use)) {
+        }
+    }
+}
+
+static long BCLBenchmarkPeakRSS(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // In bytes on Darwin
+    return usage.ru_maxrss;
+}
+
+/**
+ *  Runs a benchmark and prints one JSON line with its results
+ *  @param block Runs the benchmark once and returns the number of operations it performed
+ */
+static void BCLBenchmarkRun(NSString *name, NSUInteger repeatCount, NSUInteger (^block)(void))
+{
+    // Warm up caches and lazily created state
+    @autoreleasepool {
+        block();
+    }
+
+    NSUInteger operationsCount = 0;
+    uint64_t start = [[BCLClock systemClock] nanoseconds];
+
+    for (NSUInteger idx = 0; idx < repeatCount; idx++) {
+        @autoreleasepool {
+            operationsCount += block();
+        }
+    }
+
+    uint64_t duration = [[BCLClock systemClock] nanoseconds] - start;
+
+    // Allocations are counted in a run of their own, the hook slows every allocation down
+    NSUInteger countedOperationsCount;
+    malloc_statistics_t statistics;
+    malloc_zone_statistics(NULL, &statistics);
+    atomic_store(&BCLBenchmarkAllocationsCount, 0);
+    atomic_store(&BCLBenchmarkPeakHeapBytes, statistics.size_in_use);
+    malloc_logger = BCLBenchmarkCountAllocation;
+    @autoreleasepool {
+        countedOperationsCount = block();
+    }
+    malloc_logger = NULL;
+    uint64_t allocationsCount = atomic_load(&BCLBenchmarkAllocationsCount);
+    size_t peakHeapBytes = atomic_load(&BCLBenchmarkPeakHeapBytes) - statistics.size_in_use;
+
+    NSDictionary *result = @{@"name": name,
+                             @"operations": @(operationsCount),
+                             @"ns_per_op": @(operationsCount ? (double)duration / operationsCount : 0),
+                             @"allocations_per_op": @(countedOperationsCount ? (double)allocationsCount / countedOperationsCount : 0),
+                             @"peak_heap_bytes": @(peakHeapBytes),
+                             @"peak_rss_bytes": @(BCLBenchmarkPeakRSS())};
+    NSData *data = [NSJSONSerialization dataWithJSONObject:result options:0 error:nil];
+    printf("%s\n", [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding].UTF8String);
+}
+
+/**
+ *  Replays the walks through a zone estimate and prints one JSON line with how often the estimated zone changed to one
+ *  the device wasn't in, and how long it took to follow the device into the zone it entered
+ *  @param estimate Called every second with the beacons of floor 0, returns the estimated zone
+ */
+static void BCLBenchmarkEvaluateZones(NSString *name, NSArray *beacons, BCLVirtualClock *clock, BCLZone *(^estimate)(NSSet *beacons))
+{
+    NSData *walk = BCLBenchmarkWalk();
+    const double *positions = walk.bytes;
+    NSUInteger secondsCount = walk.length / sizeof(double);
+    NSArray *floorBeacons = [beacons subarrayWithRange:NSMakeRange(0, BCLBenchmarkBeaconsPerFloor)];
+    NSSet *floorBeaconsSet = [NSSet setWithArray:floorBeacons];
+
+    // Every estimate hears the same readings
+    srand48(BCLBenchmarkWalkSeed);
+
+    BCLZone *zone = nil;
+    BCLZone *estimatedZone = nil;
+    NSUInteger zoneChangeTime = 0;
+    BOOL isZoneChangePending = NO;
+    NSUInteger zoneChangesCount = 0;
+    NSUInteger missedZoneChangesCount = 0;
+    NSUInteger falseChangesCount = 0;
+    NSUInteger totalLatency = 0;
+    NSUInteger maxLatency = 0;
+
+    for (NSUInteger time = 0; time < secondsCount; time++) {
+        for (NSUInteger idx = 0; idx < floorBeacons.count; idx++) {
+            BCLBenchmarkHearBeacon(floorBeacons[idx], fabs(positions[time] - idx * BCLBenchmarkBeaconSpacing));
+        }
+
+        // The zone of the closest beacon is the one the device is in
+        NSUInteger closestBeaconIndex = MIN((NSUInteger)lround(positions[time] / BCLBenchmarkBeaconSpacing), BCLBenchmarkBeaconsPerFloor - 1);
+        BCLZone *currentZone = [floorBeacons[closestBeaconIndex] zone];
+        if (currentZone != zone) {
+            if (isZoneChangePending) {
+                missedZoneChangesCount++;
+            }
+            zone = currentZone;
+            zoneChangeTime = time;
+            isZoneChangePending = YES;
+            zoneChangesCount++;
+        }
+
+        BCLZone *newEstimatedZone = estimate(floorBeaconsSet);
+        if (newEstimatedZone != estimatedZone) {
+            estimatedZone = newEstimatedZone;
+
+            // Coming back to the right zone after a false change is neither
+            if (estimatedZone != zone) {
+                falseChangesCount++;
+            } else if (isZoneChangePending) {
+                isZoneChangePending = NO;
+                totalLatency += time - zoneChangeTime;
+                maxLatency = MAX(maxLatency, time - zoneChangeTime);
+            }
+        }
+
+        [clock advanceBy:1];
+    }
+
+    if (isZoneChangePending) {
+        missedZoneChangesCount++;
+    }
+
+    for (BCLBeacon *beacon in floorBeacons) {
+        beacon.proximity = CLProximityUnknown;
+        beacon.accuracy = 0;
+    }
+
+    NSUInteger detectedZoneChangesCount = zoneChangesCount - missedZoneChangesCount;
+    NSDictionary *result = @{@"name": name,
+                             @"seconds": @(secondsCount),
+                             @"zone_changes": @(zoneChangesCount),
+                             @"missed_zone_changes": @(missedZoneChangesCount),
+                             @"false_changes_per_hour": @(falseChangesCount * 3600.0 / secondsCount),
+                             @"mean_detection_latency_s": @(detectedZoneChangesCount ? (double)totalLatency / detectedZoneChangesCount : 0),
+                             @"max_detection_latency_s": @(maxLatency)};
+    NSData *data = [NSJSONSerialization dataWithJSONObject:result options:0 error:nil];
+    printf("%s\n", [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding].UTF8String);
+}
+
+#pragma mark - Benchmarks
+
+@interface BCLBenchmarkRangingBatchDelegate : NSObject <BCLBeaconRangingBatchDelegate>
+
+@property (nonatomic) NSUInteger processedCount;
+
+@end
+
+@implementation BCLBenchmarkRangingBatchDelegate
+
+- (void)processBeaconBatch:(BCLBeaconRangingBatch *)batch beacons:(NSArray *)rangedBeacons
+{
+    self.processedCount += rangedBeacons.count;
+}
+
+@end
+
+int main(int argc, const char *argv[])
+{
+    int status = 0;
+
+    @autoreleasepool {
+        NSString *tracePath = argc > 1 ? @(argv[1]) : @"Fixtures/ranging-trace.csv";
+        NSUInteger repeatCount = argc > 2 ? (NSUInteger)MAX(atoi(argv[2]), 1) : BCLBenchmarkDefaultRepeatCount;
+
+        BCLBenchmarkTrace *trace = [[BCLBenchmarkTrace alloc] initWithContentsOfFile:tracePath];
+        if (!trace.count) {
+            fprintf(stderr, "Unable to read a trace from %s\n", tracePath.UTF8String);
+            return 1;
+        }
+
+        // Time of the SDK follows the trace, so a recorded day replays in moments
+        BCLVirtualClock *clock = [[BCLVirtualClock alloc] initWithTimeIntervalSince1970:1445212800];
+        [BCLClock setCurrentClock:clock];
+
+        NSSet *zones;
+        NSArray *beacons = BCLBenchmarkMakeBeacons(&zones);
+        NSSet *beaconsSet = [NSSet setWithArray:beacons];
+
+        BCLBenchmarkRun(@"beacon_set_accuracy", repeatCount, ^NSUInteger {
+            for (NSUInteger idx = 0; idx < trace.count; idx++) {
+                const BCLBenchmarkReading *reading = &trace.readings[idx];
+                BCLBeacon *beacon = beacons[reading->beaconIndex];
+                beacon.rssi = reading->rssi;
+                beacon.accuracy = reading->accuracy;
+            }
+            [clock advanceBy:trace.duration];
+            return trace.count;
+        });
+
+        CLBeaconRegion *region = [[CLBeaconRegion alloc] initWithProximityUUID:[beacons[0] proximityUUID] identifier:@"benchmark"];
+        BCLBenchmarkRangingBatchDelegate *batchDelegate = [[BCLBenchmarkRangingBatchDelegate alloc] init];
+        BCLBeaconRangingBatch *rangingBatch = [[BCLBeaconRangingBatch alloc] initWithDelegate:batchDelegate];
+
+        BCLBenchmarkRun(@"ranging_batch_add", repeatCount, ^NSUInteger {
+            __block NSUInteger count = 0;
+            [trace enumerateSecondsUsingBlock:^(NSUInteger time, const BCLBenchmarkReading *readings, NSUInteger readingsCount) {
+                NSMutableArray *rangedBeacons = [NSMutableArray arrayWithCapacity:readingsCount];
+                for (NSUInteger idx = 0; idx < readingsCount; idx++) {
+                    [rangedBeacons addObject:beacons[readings[idx].beaconIndex]];
+                }
+                [rangingBatch add:rangedBeacons forRegion:region];
+                [clock advanceBy:1];
+                count++;
+            }];
+            return count;
+        });
+
+        BCLZoneEstimator *zoneEstimator = [[BCLZoneEstimator alloc] init];
+
+        BCLBenchmarkRun(@"zone_estimator_update", repeatCount, ^NSUInteger {
+            __block NSUInteger count = 0;
+            [zoneEstimator reset];
+            [trace enumerateSecondsUsingBlock:^(NSUInteger time, const BCLBenchmarkReading *readings, NSUInteger readingsCount) {
+                NSMutableSet *observedBeacons = [NSMutableSet setWithCapacity:readingsCount];
+                for (NSUInteger idx = 0; idx < readingsCount; idx++) {
+                    BCLBeacon *beacon = beacons[readings[idx].beaconIndex];
+                    beacon.proximity = BCLBenchmarkProximity(readings[idx].accuracy);
+                    beacon.accuracy = readings[idx].accuracy;
+                    [observedBeacons addObject:beacon];
+                }
+                [zoneEstimator updateWithBeacons:observedBeacons];
+                [clock advanceBy:1];
+                count++;
+            }];
+            return count;
+        });
+
+        BCLObservedBeaconsPicker *picker = [[BCLObservedBeaconsPicker alloc] initWithBeacons:beaconsSet andZones:zones];
+
+        BCLBenchmarkRun(@"picker_observed_beacons", repeatCount, ^NSUInteger {
+            __block NSUInteger count = 0;
+            [trace enumerateSecondsUsingBlock:^(NSUInteger time, const BCLBenchmarkReading *readings, NSUInteger readingsCount) {
+                BOOL didChange;
+                [picker observedBeaconsWithLocation:BCLBenchmarkDeviceLocation(readings, readingsCount) beaconsDidChange:&didChange];
+                [picker observedZones:&didChange];
+                [clock advanceBy:1];
+                count++;
+            }];
+            return count;
+        });
+
+        NSSet *largeVenueZones;
+        NSSet *largeVenueBeacons = BCLBenchmarkMakeLargeVenueBeacons(&largeVenueZones);
+        BCLObservedBeaconsPicker *largeVenuePicker = [[BCLObservedBeaconsPicker alloc] initWithBeacons:largeVenueBeacons andZones:largeVenueZones];
+        __block NSUInteger largeVenuePosition = 0;
+
+        BCLBenchmarkRun(@"picker_large_venue", repeatCount, ^NSUInteger {
+            for (NSUInteger idx = 0; idx < BCLBenchmarkLargeVenuePicksCount; idx++) {
+                // Far enough from the previous location for the picker to pick again, on a floor with two neighbours
+                largeVenuePosition = (largeVenuePosition + 37) % (BCLBenchmarkLargeVenueBeaconsCount - 2 * BCLBenchmarkLargeVenueFloorBeaconsCount);
+                BOOL didChange;
+                [largeVenuePicker observedBeaconsWithLocation:BCLBenchmarkLargeVenueLocation(largeVenuePosition + BCLBenchmarkLargeVenueFloorBeaconsCount) beaconsDidChange:&didChange];
+            }
+            return BCLBenchmarkLargeVenuePicksCount;
+        });
+
+        BCLBenchmarkRun(@"beacon_archive_restore", repeatCount, ^NSUInteger {
+            NSData *data = [NSKeyedArchiver archivedDataWithRootObject:beacons];
+            NSArray *restoredBeacons = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+            return restoredBeacons.count;
+        });
+
+        NSData *configurationData = BCLBenchmarkConfigurationData(BCLBenchmarkConfigurationBeaconsCount);
+
+        BCLBenchmarkRun(@"configuration_decode", repeatCount, ^NSUInteger {
+            BCLConfigurationDecoder *decoder = [[BCLConfigurationDecoder alloc] init];
+            return [decoder decodeData:configurationData error:nil] ? decoder.beacons.count : 0;
+        });
+
+        // The same configuration decoded the way it was before the decoder, to compare parse time and peak heap with
+        BCLBenchmarkRun(@"configuration_decode_nsjson", repeatCount, ^NSUInteger {
+            return BCLBenchmarkDecodeConfigurationWithJSONSerialization(configurationData);
+        });
+
+        // Includes sharding the configuration and writing its shards
+        BCLBenchmarkRun(@"configuration_load_json", repeatCount, ^NSUInteger {
+            BCLConfiguration *configuration = [[BCLConfiguration alloc] initWithJSON:configurationData error:nil];
+            return configuration ? BCLBenchmarkConfigurationBeaconsCount : 0;
+        });
+
+        // Every loaded configuration keeps its shards in a directory of its own
+        [[NSFileManager defaultManager] removeItemAtPath:[BCLConfigurationShardStore defaultDirectoryPath] error:nil];
+
+        SAMCache *eventsCache = [[SAMCache alloc] initWithName:@"com.up-next.BeaconCtrl.benchmark.events"];
+
+        // Stores events in the outbox the way BCLActionEventScheduler does, then serializes them in batches the way
+        // -[BCLBackend sendEvents:completion:] does
+        BCLBenchmarkRun(@"events_store_serialize", repeatCount, ^NSUInteger {
+            [eventsCache removeAllObjects];
+            BCLActionEventOutbox *outbox = [[BCLActionEventOutbox alloc] initWithCache:eventsCache eventsKey:@"events"];
+
+            for (NSUInteger idx = 0; idx < BCLBenchmarkEventsCount; idx++) {
+                BCLBeacon *beacon = beacons[idx % beacons.count];
+                BCLActionEvent *event = [[BCLActionEvent alloc] init];
+                event.eventType = BCLEventTypeEnter;
+                event.beaconIdentifier = beacon.beaconIdentifier;
+                event.zoneIdentifier = beacon.zone.zoneIdentifier;
+                event.actionIdentifier = @"1";
+                event.actionName = @"Welcome";
+                [outbox appendEvent:event];
+                [clock advanceBy:1];
+            }
+
+            NSUInteger serializedCount = 0;
+            BCLActionEventOutboxBatch *batch;
+            while ((batch = [outbox dequeueBatch])) {
+                NSMutableArray *payloadEvents = [NSMutableArray arrayWithCapacity:batch.events.count];
+                for (BCLActionEvent *event in batch.events) {
+                    [payloadEvents addObject:[event payloadDictionary]];
+                }
+                NSData *body = [NSJSONSerialization dataWithJSONObject:@{@"events": payloadEvents} options:0 error:nil];
+                serializedCount += body ? batch.events.count : 0;
+                [outbox acknowledgeBatch:batch];
+            }
+            return serializedCount;
+        });
+
+        [eventsCache removeAllObjects];
+
+        // One thread replaces beacons of a configuration and another one its zones, while others read both. Every
+        // writer checks that its write survived the other writer's, which only holds if writers are serialized.
+        NSArray *sortedZones = [zones.allObjects sortedArrayUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"zoneIdentifier" ascending:YES]]];
+        NSArray *beaconSets = @[[NSSet setWithArray:[beacons subarrayWithRange:NSMakeRange(0, beacons.count / 2)]],
+                                [NSSet setWithArray:[beacons subarrayWithRange:NSMakeRange(beacons.count / 2, beacons.count - beacons.count / 2)]]];
+        NSArray *zoneSets = @[[NSSet setWithArray:[sortedZones subarrayWithRange:NSMakeRange(0, sortedZones.count / 2)]],
+                              [NSSet setWithArray:[sortedZones subarrayWithRange:NSMakeRange(sortedZones.count / 2, sortedZones.count - sortedZones.count / 2)]]];
+
+        BCLBenchmarkRun(@"configuration_snapshot_stress", repeatCount, ^NSUInteger {
+            BCLConfiguration *configuration = [[BCLConfiguration alloc] init];
+            dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+            dispatch_group_t group = dispatch_group_create();
+
+            dispatch_group_async(group, queue, ^{
+                for (NSUInteger idx = 0; idx < BCLBenchmarkStressWritesCount; idx++) {
+                    [configuration setBeacons:beaconSets[idx % 2]];
+                    if (![configuration.beacons isEqualToSet:beaconSets[idx % 2]]) {
+                        atomic_fetch_add(&BCLBenchmarkLostUpdatesCount, 1);
+                    }
+                }
+            });
+
+            dispatch_group_async(group, queue, ^{
+                for (NSUInteger idx = 0; idx < BCLBenchmarkStressWritesCount; idx++) {
+                    [configuration setZones:zoneSets[idx % 2]];
+                    if (![configuration.zones isEqualToSet:zoneSets[idx % 2]]) {
+                        atomic_fetch_add(&BCLBenchmarkLostUpdatesCount, 1);
+                    }
+                }
+            });
+
+            for (NSUInteger readerIdx = 0; readerIdx < BCLBenchmarkStressReadersCount; readerIdx++) {
+                dispatch_group_async(group, queue, ^{
+                    for (NSUInteger idx = 0; idx < BCLBenchmarkStressWritesCount; idx++) {
+                        for (BCLBeacon *beacon in configuration.beacons) {
+                            [beacon.beaconIdentifier length];
+                        }
+                        for (BCLZone *zone in configuration.zones) {
+                            [zone.zoneIdentifier length];
+                        }
+                    }
+                });
+            }
+
+            dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+            return 2 * BCLBenchmarkStressWritesCount;
+        });
+
+        NSString *historyDirectoryPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"BeaconCtrlBenchmarkRangingHistory"];
+        BCLRangingHistory *history = [[BCLRangingHistory alloc] initWithDirectoryPath:historyDirectoryPath];
+        NSMutableArray *historyBeaconIdentifiers = [NSMutableArray arrayWithCapacity:BCLBenchmarkHistoryBeaconsCount];
+        for (NSUInteger idx = 0; idx < BCLBenchmarkHistoryBeaconsCount; idx++) {
+            [historyBeaconIdentifiers addObject:[NSString stringWithFormat:@"F7826DA6-4FA2-4E98-8024-BC5B71E0893E+1+%lu", (unsigned long)idx]];
+        }
+
+        BCLBenchmarkRun(@"ranging_history_ingest", repeatCount, ^NSUInteger {
+            [history removeAllReadings];
+            srand48(BCLBenchmarkWalkSeed);
+
+            NSTimeInterval start = clock.timeIntervalSince1970;
+            for (NSUInteger tick = 0; tick < BCLBenchmarkHistoryDuration * BCLBenchmarkHistoryRangingRate; tick++) {
+                for (NSUInteger idx = 0; idx < BCLBenchmarkHistoryBeaconsCount; idx++) {
+                    // Readings of a beacon come a few ms apart from the nominal rate and wobble by a few dB
+                    NSTimeInterval timestamp = start + (double)tick / BCLBenchmarkHistoryRangingRate + drand48() * 0.005;
+                    NSInteger rssi = -60 - (NSInteger)(idx % 30) + (NSInteger)lround(drand48() * 6 - 3);
+                    double accuracy = pow(10, (BCLBenchmarkTxPower - rssi) / (10 * BCLBenchmarkPathLossExponent));
+                    [history recordReadingForBeaconIdentifier:historyBeaconIdentifiers[idx] rssi:rssi accuracy:accuracy timestamp:timestamp];
+                }
+            }
+
+            // Waits for the readings to be stored
+            [history readingsCount];
+            return BCLBenchmarkHistoryDuration * BCLBenchmarkHistoryRangingRate * BCLBenchmarkHistoryBeaconsCount;
+        });
+
+        // What the readings take once they're all on disk, chunk headers and segment files included
+        [history flushToDisk];
+        NSUInteger historyReadingsCount = history.readingsCount;
+        NSDictionary *historyResult = @{@"name": @"ranging_history_storage",
+                                        @"readings": @(historyReadingsCount),
+                                        @"bytes_per_reading": @(historyReadingsCount ? (double)history.storedBytesCount / historyReadingsCount : 0)};
+        NSData *historyResultData = [NSJSONSerialization dataWithJSONObject:historyResult options:0 error:nil];
+        printf("%s\n", [[NSString alloc] initWithData:historyResultData encoding:NSUTF8StringEncoding].UTF8String);
+        [history removeAllReadings];
+
+        BCLZoneEstimator *evaluatedZoneEstimator = [[BCLZoneEstimator alloc] init];
+        BCLBenchmarkEvaluateZones(@"zone_estimator_walk", beacons, clock, ^BCLZone *(NSSet *floorBeacons) {
+            [evaluatedZoneEstimator updateWithBeacons:floorBeacons];
+            return evaluatedZoneEstimator.currentZone;
+        });
+
+        // The zone of the closest beacon heard, which the estimator is meant to improve on
+        BCLBenchmarkEvaluateZones(@"closest_beacon_walk", beacons, clock, ^BCLZone *(NSSet *floorBeacons) {
+            BCLBeacon *closestBeacon = nil;
+            for (BCLBeacon *beacon in floorBeacons) {
+                if (beacon.proximity != CLProximityUnknown && (!closestBeacon || beacon.estimatedDistance < closestBeacon.estimatedDistance)) {
+                    closestBeacon = beacon;
+                }
+            }
+            return closestBeacon.zone;
+        });
+
+        if (atomic_load(&BCLBenchmarkLostUpdatesCount)) {
+            fprintf(stderr, "configuration_snapshot_stress lost %llu updates\n", (unsigned long long)atomic_load(&BCLBenchmarkLostUpdatesCount));
+            status = 1;
+        }
+
+        [BCLClock setCurrentClock:nil];
+    }
+    return status;
+}